@@ -26,6 +26,10 @@ public class BelindaVPTool : ModuleRules
             new string[]
             {
                 "Core",
+                "LiveLinkInterface",
+                "LiveLinkComponents",
+                "LiveLinkCamera",
+                "MediaIOCore",
 				// ... add other public dependencies that you statically link with here ...
 			}
             );
@@ -39,9 +43,13 @@ public class BelindaVPTool : ModuleRules
                 "Slate",
                 "SlateCore",
                 "LiveLink",  // Add this line
-                "LiveLinkInterface" ,
-                "LiveLinkCamera",
-                "LiveLinkComponents",
+                "Sockets",
+                "Networking",
+                "CinematicCamera",
+                "TimeManagement",
+                "ImageCore",
+                "MediaAssets",
+                "MediaFrameworkUtilities",
                  //"EditorStyle",
 				// ... add private dependencies that you statically link with here ...	
 			}
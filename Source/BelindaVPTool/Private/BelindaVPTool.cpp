@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "BelindaVPTool.h"
+#include "VPTrackingSoakBenchmark.h"
 
 
 #define LOCTEXT_NAMESPACE "FBelindaVPToolModule"
@@ -12,7 +13,8 @@ void FBelindaVPToolModule::StartupModule()
 
 void FBelindaVPToolModule::ShutdownModule()
 {
-
+	// A soak still running would otherwise be torn down by the static destructors, after the engine
+	FVPTrackingSoakBenchmark::ShutdownConsoleRun();
 }
 
 #undef LOCTEXT_NAMESPACE
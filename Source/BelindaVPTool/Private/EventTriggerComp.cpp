@@ -2,15 +2,16 @@
 
 
 #include "EventTriggerComp.h"
+#include "VPEventTimelineSubsystem.h"
+#include "VPStageCueSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
 
 // Sets default values for this component's properties
 UEventTriggerComp::UEventTriggerComp()
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
-
-	// ...
+	// Events are dispatched by the world's event timeline, the component itself never ticks
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 
@@ -19,17 +20,20 @@ void UEventTriggerComp::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// ...
-	
+	for (const FVPTriggerEvent& Event : Events)
+	{
+		Schedule(Event);
+	}
 }
 
-
-// Called every frame
-void UEventTriggerComp::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UEventTriggerComp::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (UVPEventTimelineSubsystem* Timeline = GetWorld() ? GetWorld()->GetSubsystem<UVPEventTimelineSubsystem>() : nullptr)
+	{
+		Timeline->RemoveEvents(this);
+	}
 
-	// ...
+	Super::EndPlay(EndPlayReason);
 }
 
 void UEventTriggerComp::SetupCamera_Implementation()
@@ -37,3 +41,63 @@ void UEventTriggerComp::SetupCamera_Implementation()
 
 }
 
+void UEventTriggerComp::AddTimecodeEvent(FName EventName, FTimecode Timecode)
+{
+	FVPTriggerEvent Event;
+	Event.Name = EventName;
+	Event.TimeBase = EVPTriggerTimeBase::Timecode;
+	Event.Timecode = Timecode;
+	Events.Add(Event);
+
+	if (HasBegunPlay())
+	{
+		Schedule(Event);
+	}
+}
+
+void UEventTriggerComp::AddFrameEvent(FName EventName, int64 Frame)
+{
+	FVPTriggerEvent Event;
+	Event.Name = EventName;
+	Event.TimeBase = EVPTriggerTimeBase::Frame;
+	Event.Frame = Frame;
+	Events.Add(Event);
+
+	if (HasBegunPlay())
+	{
+		Schedule(Event);
+	}
+}
+
+void UEventTriggerComp::ClearEvents()
+{
+	Events.Empty();
+
+	if (UVPEventTimelineSubsystem* Timeline = GetWorld() ? GetWorld()->GetSubsystem<UVPEventTimelineSubsystem>() : nullptr)
+	{
+		Timeline->RemoveEvents(this);
+	}
+}
+
+void UEventTriggerComp::Trigger(FName EventName, const FTimecode& Timecode)
+{
+	OnEventTriggered.Broadcast(EventName, Timecode);
+
+	// Listeners of the bus don't need to bind every trigger of the level
+	if (UVPStageCueSubsystem* Cues = GEngine ? GEngine->GetEngineSubsystem<UVPStageCueSubsystem>() : nullptr)
+	{
+		FVPStageCue Cue;
+		Cue.Topic = VPStageCueTopics::Trigger;
+		Cue.Name = EventName;
+		Cue.Text = GetOwner() ? GetOwner()->GetName() : FString();
+		Cues->Publish(Cue);
+	}
+}
+
+void UEventTriggerComp::Schedule(const FVPTriggerEvent& Event)
+{
+	if (UVPEventTimelineSubsystem* Timeline = GetWorld() ? GetWorld()->GetSubsystem<UVPEventTimelineSubsystem>() : nullptr)
+	{
+		Timeline->AddEvent(this, Event);
+	}
+}
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLiveLinkCameraController.h"
+#include "LiveLinkCameraController.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "CineCameraActor.h"
+#include "CineCameraComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+
+namespace VPCameraControllerBenchmark
+{
+	// A UFunction call through ProcessEvent, as a Blueprint node does it, with its parameters allocated once
+	struct FReflectedCall
+	{
+		FReflectedCall(UObject* InTarget, FName FunctionName)
+			: Target(InTarget)
+			, Function(InTarget->FindFunction(FunctionName))
+		{
+			if (Function)
+			{
+				Params.SetNumZeroed(Function->ParmsSize);
+				Function->InitializeStruct(Params.GetData());
+				for (TFieldIterator<FProperty> It(Function); It && It->HasAnyPropertyFlags(CPF_Parm); ++It)
+				{
+					FirstParam = *It;
+					break;
+				}
+			}
+		}
+
+		~FReflectedCall()
+		{
+			if (Function)
+			{
+				Function->DestroyStruct(Params.GetData());
+			}
+		}
+
+		template<typename T>
+		void SetFirstParam(const T& Value)
+		{
+			if (FirstParam)
+			{
+				FirstParam->CopyCompleteValue(FirstParam->ContainerPtrToValuePtr<void>(Params.GetData()), &Value);
+			}
+		}
+
+		void Call()
+		{
+			if (Function)
+			{
+				Target->ProcessEvent(Function, Params.GetData());
+			}
+		}
+
+		UObject* Target = nullptr;
+		UFunction* Function = nullptr;
+		FProperty* FirstParam = nullptr;
+		TArray<uint8> Params;
+	};
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.IsValidIndex(0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+		UWorld* World = nullptr;
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			if (Context.World() && (Context.WorldType == EWorldType::PIE || Context.WorldType == EWorldType::Game || Context.WorldType == EWorldType::Editor))
+			{
+				World = Context.World();
+				break;
+			}
+		}
+		if (!World)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Camera controller benchmark needs a world"));
+			return;
+		}
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags = RF_Transient;
+		ACineCameraActor* CameraActor = World->SpawnActor<ACineCameraActor>(SpawnParameters);
+		if (!CameraActor)
+			return;
+		UCineCameraComponent* CineCamera = CameraActor->GetCineCameraComponent();
+
+		FLiveLinkSubjectFrameData SubjectData;
+		SubjectData.StaticData.InitializeWith(FLiveLinkCameraStaticData::StaticStruct(), nullptr);
+		SubjectData.FrameData.InitializeWith(FLiveLinkCameraFrameData::StaticStruct(), nullptr);
+		FLiveLinkCameraStaticData* StaticData = SubjectData.StaticData.Cast<FLiveLinkCameraStaticData>();
+		StaticData->bIsFocalLengthSupported = true;
+		StaticData->bIsApertureSupported = true;
+		StaticData->bIsFocusDistanceSupported = true;
+		FLiveLinkCameraFrameData* FrameData = SubjectData.FrameData.Cast<FLiveLinkCameraFrameData>();
+
+		FVPLensSettings Lens;
+		Lens.bEnabled = true;
+		const FVector NodalOffset(0.0, 0.0, 12.0);
+
+		// Stock controller followed by what the Blueprint setup does every frame: filmback, lens range and nodal offset
+		ULiveLinkCameraController* StockController = NewObject<ULiveLinkCameraController>(GetTransientPackage());
+		StockController->bUseCameraRange = true;
+		StockController->SetAttachedComponent(CineCamera);
+
+		FCameraFilmbackSettings Filmback;
+		Filmback.SensorWidth = Lens.SensorWidth;
+		Filmback.SensorHeight = Lens.SensorHeight;
+		FCameraLensSettings LensSettings = CineCamera->LensSettings;
+		LensSettings.MinFocalLength = Lens.MinFocalLength;
+		LensSettings.MaxFocalLength = Lens.MaxFocalLength;
+		LensSettings.MinFStop = Lens.MinFStop;
+		LensSettings.MaxFStop = Lens.MaxFStop;
+
+		FReflectedCall SetFilmback(CineCamera, TEXT("SetFilmback"));
+		FReflectedCall SetLensSettings(CineCamera, TEXT("SetLensSettings"));
+		FReflectedCall AddLocalOffset(CineCamera, TEXT("K2_AddLocalOffset"));
+		SetFilmback.SetFirstParam(Filmback);
+		SetLensSettings.SetFirstParam(LensSettings);
+		AddLocalOffset.SetFirstParam(NodalOffset);
+
+		UVPLiveLinkCameraController* FusedController = NewObject<UVPLiveLinkCameraController>(GetTransientPackage());
+		FusedController->JitterBuffer.bEnabled = false;
+		FusedController->Lens = Lens;
+		FusedController->NodalOffset = NodalOffset;
+		FusedController->SetAttachedComponent(CineCamera);
+
+		auto UpdateFrame = [FrameData](int32 Iteration)
+			{
+				const float Alpha = (Iteration % 100) * 0.01f;
+				FrameData->Transform = FTransform(FRotator(0.0, Alpha * 90.0, 0.0), FVector(Alpha * 100.0, 0.0, 150.0));
+				FrameData->FocalLength = Alpha;
+				FrameData->Aperture = Alpha;
+				FrameData->FocusDistance = Alpha;
+			};
+
+		double Begin = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			UpdateFrame(Iteration);
+			StockController->Tick(0.0f, SubjectData);
+			SetFilmback.Call();
+			SetLensSettings.Call();
+			AddLocalOffset.Call();
+		}
+		const double StockSeconds = FPlatformTime::Seconds() - Begin;
+
+		Begin = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			UpdateFrame(Iteration);
+			FusedController->Tick(0.0f, SubjectData);
+		}
+		const double FusedSeconds = FPlatformTime::Seconds() - Begin;
+
+		UE_LOG(LogTemp, Log, TEXT("Camera controller benchmark, %d ticks:"), Iterations);
+		UE_LOG(LogTemp, Log, TEXT("  Stock controller + Blueprint lens steps: %.0f ns/tick"), StockSeconds * 1.0e9 / Iterations);
+		UE_LOG(LogTemp, Log, TEXT("  Fused controller: %.0f ns/tick (%.1fx)"), FusedSeconds * 1.0e9 / Iterations, FusedSeconds > 0.0 ? StockSeconds / FusedSeconds : 0.0);
+		UE_LOG(LogTemp, Log, TEXT("  The Blueprint steps are timed as reflected calls only, the bytecode around them comes on top"));
+
+		StockController->Cleanup();
+		FusedController->Cleanup();
+		CameraActor->Destroy();
+	}
+}
+
+static FAutoConsoleCommand CameraControllerBenchmarkCommand(
+	TEXT("BelindaVP.Bench.CameraController"),
+	TEXT("Times the fused camera controller against the stock controller plus the Blueprint lens setup. Args: [Iterations=100000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&VPCameraControllerBenchmark::Run));
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPNullMediaOutput.h"
+#include "VPMediaCaptureSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+
+namespace VPCaptureBenchmark
+{
+	static const FName CaptureName(TEXT("Bench"));
+
+	// Render target and output of the running benchmark, released when it ends
+	static TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget;
+	static TStrongObjectPtr<UVPNullMediaOutput> Output;
+	static FTSTicker::FDelegateHandle FinishHandle;
+	static double StartTime = 0.0;
+
+	static void Finish()
+	{
+		// The ticker fires late under hitches, the rates are over the time that really passed
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		UVPMediaCaptureSubsystem* Captures = GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>();
+		UVPNullMediaCapture* MediaCapture = Cast<UVPNullMediaCapture>(Captures->GetCapture(CaptureName));
+		TSharedPtr<FVPFramePool, ESPMode::ThreadSafe> Pool = MediaCapture ? MediaCapture->GetFramePool() : nullptr;
+
+		if (Pool.IsValid())
+		{
+			const FVPHistogram& CopyTimes = Pool->GetCopyTimes();
+			const uint64 Consumed = MediaCapture->GetNumFramesConsumed();
+			UE_LOG(LogTemp, Log, TEXT("Capture benchmark, %dx%d for %.1f s, %d buffers:"), Output->Size.X, Output->Size.Y, Seconds, Pool->GetNumBuffers());
+			UE_LOG(LogTemp, Log, TEXT("  %llu frames consumed, %.1f fps, %.0f MB/s copied"), Consumed, Consumed / Seconds, Pool->GetBytesCopied() / Seconds / (1024.0 * 1024.0));
+			UE_LOG(LogTemp, Log, TEXT("  %llu frames dropped on an exhausted pool"), Pool->GetNumExhausted());
+			UE_LOG(LogTemp, Log, TEXT("  Copy p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms"), CopyTimes.GetPercentile(0.5) * 1000.0,
+				CopyTimes.GetPercentile(0.95) * 1000.0, CopyTimes.GetPercentile(0.99) * 1000.0, CopyTimes.GetMax() * 1000.0);
+			if (const FVPFrameWriter* Writer = MediaCapture->GetFrameWriter())
+			{
+				const FVPFrameWriterStats Stats = Writer->GetStats();
+				const FVPHistogram& EncodeTimes = Writer->GetEncodeTimes();
+				UE_LOG(LogTemp, Log, TEXT("  %llu frames written to %s, %llu failed, %llu dropped by the writer"), Stats.NumWritten, *Output->OutputDirectory.Path, Stats.NumFailed, Stats.NumDropped);
+				UE_LOG(LogTemp, Log, TEXT("  Writer queue full %llu times, max depth %d, blocked p95 %.3f ms"), Stats.NumQueueFull, Stats.MaxQueueDepth, Writer->GetBlockTimes().GetPercentile(0.95) * 1000.0);
+				UE_LOG(LogTemp, Log, TEXT("  Encode p50 %.2f ms, p95 %.2f ms, max %.2f ms"), EncodeTimes.GetPercentile(0.5) * 1000.0, EncodeTimes.GetPercentile(0.95) * 1000.0, EncodeTimes.GetMax() * 1000.0);
+			}
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Capture benchmark: the capture never started"));
+		}
+
+		Captures->StopCapture(CaptureName);
+		RenderTarget.Reset();
+		Output.Reset();
+		FinishHandle.Reset();
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		if (FinishHandle.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Capture benchmark already running"));
+			return;
+		}
+
+		const float Seconds = Args.IsValidIndex(0) ? FMath::Max(FCString::Atof(*Args[0]), 1.0f) : 10.0f;
+		const int32 Width = Args.IsValidIndex(1) ? FMath::Max(FCString::Atoi(*Args[1]), 16) : 1920;
+		const int32 Height = Args.IsValidIndex(2) ? FMath::Max(FCString::Atoi(*Args[2]), 16) : 1080;
+		const int32 NumBuffers = Args.IsValidIndex(3) ? FMath::Max(FCString::Atoi(*Args[3]), 1) : 4;
+
+		UVPMediaCaptureSubsystem* Captures = GEngine ? GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>() : nullptr;
+		if (!Captures)
+			return;
+
+		// A render target source needs no viewport, so this also runs headless with -RenderOffscreen
+		RenderTarget.Reset(NewObject<UTextureRenderTarget2D>(GetTransientPackage()));
+		RenderTarget->InitCustomFormat(Width, Height, PF_B8G8R8A8, false);
+		RenderTarget->UpdateResourceImmediate(true);
+
+		Output.Reset(NewObject<UVPNullMediaOutput>(GetTransientPackage()));
+		Output->Size = FIntPoint(Width, Height);
+		Output->NumBuffers = NumBuffers;
+		if (Args.IsValidIndex(4))
+		{
+			// Every frame goes to the writer, so the run shows whether it keeps up
+			Output->Mode = EVPNullOutputMode::RawFiles;
+			Output->OutputDirectory.Path = Args[4];
+			if (Args.IsValidIndex(5))
+			{
+				Output->Mode = EVPNullOutputMode::ImageSequence;
+				Output->Writer.Format = Args[5].Equals(TEXT("png"), ESearchCase::IgnoreCase) ? EVPFrameFileFormat::Png : EVPFrameFileFormat::Exr;
+			}
+		}
+
+		FVPCaptureOutputSettings Settings;
+		Settings.Name = CaptureName;
+		Settings.MediaOutput = Output.Get();
+		Settings.Source = EVPCaptureSource::RenderTarget;
+		Settings.RenderTarget = RenderTarget.Get();
+		if (!Captures->StartCapture(Settings))
+		{
+			RenderTarget.Reset();
+			Output.Reset();
+			return;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Capture benchmark running for %.1f s"), Seconds);
+		StartTime = FPlatformTime::Seconds();
+		FinishHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+			{
+				Finish();
+				return false;
+			}), Seconds);
+	}
+}
+
+static FAutoConsoleCommand CaptureBenchmarkCommand(
+	TEXT("BelindaVP.Bench.Capture"),
+	TEXT("Captures a render target to a null media output and logs throughput, pool misses, copy and writer times. Args: [Seconds=10] [Width=1920] [Height=1080] [NumBuffers=4] [OutputDirectory] [png|exr, raw without]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&VPCaptureBenchmark::Run));
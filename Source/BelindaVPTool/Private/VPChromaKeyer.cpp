@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPChromaKeyer.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Math/VectorRegister.h"
+
+namespace VPChromaKeyer
+{
+	// Rows per ParallelFor task, a 1080p tile stays within L2
+	static constexpr int32 TileRows = 32;
+
+	// The key reduced to per channel weights, shared by the scalar and vector paths
+	struct FCoefficients
+	{
+		// Screen channel minus the balanced mix of the others, dot this with a pixel
+		float DiffWeights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float ScreenMask[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float DiffScale = 0.0f;
+		float ClipScale = 1.0f;
+		float ClipBias = 0.0f;
+		float Spill = 0.0f;
+		bool bPremultiply = false;
+	};
+
+	static FCoefficients MakeCoefficients(const FVPChromaKeySettings& Settings)
+	{
+		FCoefficients C;
+		const float Key[3] = { Settings.KeyColor.R, Settings.KeyColor.G, Settings.KeyColor.B };
+
+		int32 Screen = 1;
+		if (Key[2] > Key[Screen])
+			Screen = 2;
+		if (Key[0] > Key[Screen])
+			Screen = 0;
+
+		const int32 First = Screen == 0 ? 1 : 0;
+		const int32 Second = Screen == 2 ? 1 : 2;
+		const float Balance = FMath::Clamp(Settings.Balance, 0.0f, 1.0f);
+		C.DiffWeights[Screen] = 1.0f;
+		C.DiffWeights[First] = -(1.0f - Balance);
+		C.DiffWeights[Second] = -Balance;
+		C.ScreenMask[Screen] = 1.0f;
+
+		// A key colour with no difference keys nothing
+		const float KeyDiff = Key[0] * C.DiffWeights[0] + Key[1] * C.DiffWeights[1] + Key[2] * C.DiffWeights[2];
+		C.DiffScale = KeyDiff > UE_KINDA_SMALL_NUMBER ? Settings.Gain / KeyDiff : 0.0f;
+
+		C.ClipScale = 1.0f / FMath::Max(Settings.ClipWhite - Settings.ClipBlack, 1.0e-4f);
+		C.ClipBias = -Settings.ClipBlack * C.ClipScale;
+		C.Spill = FMath::Clamp(Settings.SpillSuppression, 0.0f, 1.0f);
+		C.bPremultiply = Settings.bPremultiply;
+		return C;
+	}
+
+	static void KeyRows(const FLinearColor* In, FLinearColor* Out, int64 NumPixels, const FCoefficients& C)
+	{
+		const VectorRegister4Float DiffWeights = VectorLoad(C.DiffWeights);
+		const VectorRegister4Float SpillWeights = VectorMultiply(VectorLoad(C.ScreenMask), VectorSetFloat1(-C.Spill));
+		const VectorRegister4Float DiffScale = VectorSetFloat1(C.DiffScale);
+		const VectorRegister4Float ClipScale = VectorSetFloat1(C.ClipScale);
+		const VectorRegister4Float ClipBias = VectorSetFloat1(C.ClipBias);
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float One = VectorOneFloat();
+		const VectorRegister4Float ColorMask = MakeVectorRegisterFloatMask(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0);
+
+		// One pixel per register, every step is the same lane wise op as the scalar reference
+		for (int64 Index = 0; Index < NumPixels; ++Index)
+		{
+			const VectorRegister4Float Pixel = VectorLoad(&In[Index].R);
+			const VectorRegister4Float Diff = VectorDot4(Pixel, DiffWeights);
+
+			VectorRegister4Float Alpha = VectorSubtract(One, VectorMin(VectorMax(VectorMultiply(Diff, DiffScale), Zero), One));
+			Alpha = VectorMin(VectorMax(VectorMultiplyAdd(Alpha, ClipScale, ClipBias), Zero), One);
+			Alpha = VectorMultiply(Alpha, VectorReplicate(Pixel, 3));
+
+			VectorRegister4Float Color = VectorMultiplyAdd(VectorMax(Diff, Zero), SpillWeights, Pixel);
+			if (C.bPremultiply)
+			{
+				Color = VectorMultiply(Color, Alpha);
+			}
+
+			VectorStore(VectorSelect(ColorMask, Color, Alpha), &Out[Index].R);
+		}
+	}
+}
+
+FLinearColor FVPChromaKeyer::KeyPixel(const FLinearColor& Pixel, const FVPChromaKeySettings& Settings)
+{
+	const VPChromaKeyer::FCoefficients C = VPChromaKeyer::MakeCoefficients(Settings);
+
+	const float Diff = Pixel.R * C.DiffWeights[0] + Pixel.G * C.DiffWeights[1] + Pixel.B * C.DiffWeights[2];
+
+	float Alpha = 1.0f - FMath::Clamp(Diff * C.DiffScale, 0.0f, 1.0f);
+	Alpha = FMath::Clamp(Alpha * C.ClipScale + C.ClipBias, 0.0f, 1.0f) * Pixel.A;
+
+	const float Spill = FMath::Max(Diff, 0.0f) * C.Spill;
+	FLinearColor Result(Pixel.R - Spill * C.ScreenMask[0], Pixel.G - Spill * C.ScreenMask[1], Pixel.B - Spill * C.ScreenMask[2], Alpha);
+	if (C.bPremultiply)
+	{
+		Result.R *= Alpha;
+		Result.G *= Alpha;
+		Result.B *= Alpha;
+	}
+	return Result;
+}
+
+void FVPChromaKeyer::Key(const FLinearColor* In, FLinearColor* Out, int32 Width, int32 Height, const FVPChromaKeySettings& Settings)
+{
+	using namespace VPChromaKeyer;
+
+	if (!In || !Out || Width <= 0 || Height <= 0)
+		return;
+
+	const FCoefficients C = MakeCoefficients(Settings);
+	const int32 NumTiles = FMath::DivideAndRoundUp(Height, TileRows);
+
+	ParallelFor(NumTiles, [&](int32 Tile)
+		{
+			const int64 First = (int64)Tile * TileRows * Width;
+			const int32 NumRows = FMath::Min(TileRows, Height - Tile * TileRows);
+			KeyRows(In + First, Out + First, (int64)NumRows * Width, C);
+		});
+}
+
+void FVPChromaKeyer::Key(const FColor* In, FColor* Out, int32 Width, int32 Height, const FVPChromaKeySettings& Settings)
+{
+	using namespace VPChromaKeyer;
+
+	if (!In || !Out || Width <= 0 || Height <= 0)
+		return;
+
+	const FCoefficients C = MakeCoefficients(Settings);
+	const int32 NumTiles = FMath::DivideAndRoundUp(Height, TileRows);
+
+	ParallelFor(NumTiles, [&](int32 Tile)
+		{
+			const int64 First = (int64)Tile * TileRows * Width;
+			const int32 NumPixels = FMath::Min(TileRows, Height - Tile * TileRows) * Width;
+
+			// Decoded per tile, the linear copy of a whole frame never exists
+			TArray<FLinearColor> Linear;
+			Linear.SetNumUninitialized(NumPixels);
+			for (int32 Index = 0; Index < NumPixels; ++Index)
+			{
+				Linear[Index] = FLinearColor(In[First + Index]);
+			}
+
+			KeyRows(Linear.GetData(), Linear.GetData(), NumPixels, C);
+
+			for (int32 Index = 0; Index < NumPixels; ++Index)
+			{
+				Out[First + Index] = Linear[Index].ToFColor(true);
+			}
+		});
+}
+
+float FVPChromaKeyer::MaxDifference(const FLinearColor* A, const FLinearColor* B, int64 NumPixels)
+{
+	float MaxDiff = 0.0f;
+	for (int64 Index = 0; Index < NumPixels; ++Index)
+	{
+		const FLinearColor Diff = A[Index] - B[Index];
+		MaxDiff = FMath::Max(MaxDiff, FMath::Max(FMath::Max(FMath::Abs(Diff.R), FMath::Abs(Diff.G)), FMath::Max(FMath::Abs(Diff.B), FMath::Abs(Diff.A))));
+	}
+	return MaxDiff;
+}
+
+static FAutoConsoleCommand ChromaKeyCommand(
+	TEXT("BelindaVP.Key"),
+	TEXT("Keys an image file on the CPU, checks the vector path against the scalar one and optionally against a golden image. Args: In Out [R G B] [Gain] [Spill] [Golden] [Tolerance=0.01]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() < 2)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Usage: BelindaVP.Key In Out [R G B] [Gain] [Spill] [Golden] [Tolerance]"));
+				return;
+			}
+
+			auto FloatArg = [&Args](int32 Index, float Default) { return Args.IsValidIndex(Index) ? FCString::Atof(*Args[Index]) : Default; };
+
+			FVPChromaKeySettings Settings;
+			if (Args.Num() >= 5)
+			{
+				Settings.KeyColor = FLinearColor(FloatArg(2, 0.0f), FloatArg(3, 1.0f), FloatArg(4, 0.0f));
+			}
+			Settings.Gain = FloatArg(5, Settings.Gain);
+			Settings.SpillSuppression = FloatArg(6, Settings.SpillSuppression);
+
+			FImage Image;
+			if (!FImageUtils::LoadImage(*Args[0], Image))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Can't load %s"), *Args[0]);
+				return;
+			}
+			Image.ChangeFormat(ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+			TArrayView64<FLinearColor> Pixels = Image.AsRGBA32F();
+			const TArray64<FLinearColor> Source(Pixels.GetData(), Pixels.Num());
+
+			const double Begin = FPlatformTime::Seconds();
+			FVPChromaKeyer::Key(Pixels.GetData(), Pixels.GetData(), Image.SizeX, Image.SizeY, Settings);
+			const double Seconds = FPlatformTime::Seconds() - Begin;
+
+			if (!FImageUtils::SaveImageByExtension(*Args[1], Image))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Can't save %s"), *Args[1]);
+				return;
+			}
+			UE_LOG(LogTemp, Log, TEXT("Keyed %dx%d in %.2f ms to %s"), Image.SizeX, Image.SizeY, Seconds * 1000.0, *Args[1]);
+
+			// The vector path should only differ from the scalar reference by rounding
+			TArray64<FLinearColor> Reference;
+			Reference.SetNumUninitialized(Source.Num());
+			for (int64 Index = 0; Index < Source.Num(); ++Index)
+			{
+				Reference[Index] = FVPChromaKeyer::KeyPixel(Source[Index], Settings);
+			}
+			UE_LOG(LogTemp, Log, TEXT("Vector path against KeyPixel: max difference %.6f"), FVPChromaKeyer::MaxDifference(Pixels.GetData(), Reference.GetData(), Pixels.Num()));
+
+			if (Args.IsValidIndex(7))
+			{
+				FImage Golden;
+				if (!FImageUtils::LoadImage(*Args[7], Golden) || Golden.SizeX != Image.SizeX || Golden.SizeY != Image.SizeY)
+				{
+					UE_LOG(LogTemp, Error, TEXT("Golden image %s missing or of another size"), *Args[7]);
+					return;
+				}
+				Golden.ChangeFormat(ERawImageFormat::RGBA32F, EGammaSpace::Linear);
+
+				const float Tolerance = FloatArg(8, 0.01f);
+				const float MaxDiff = FVPChromaKeyer::MaxDifference(Pixels.GetData(), Golden.AsRGBA32F().GetData(), Pixels.Num());
+				UE_LOG(LogTemp, Log, TEXT("Golden check %s: max difference %.5f, tolerance %.5f"), MaxDiff <= Tolerance ? TEXT("passed") : TEXT("FAILED"), MaxDiff, Tolerance);
+			}
+		}));
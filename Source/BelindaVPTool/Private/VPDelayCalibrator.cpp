@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPDelayCalibrator.h"
+#include <limits>
+
+void FVPDelayCalibrator::Start(int32 MaxFrames, int32 InMaxLagFrames)
+{
+	MaxFrames = FMath::Max(MaxFrames, 2);
+	// Frames nobody filled in stay NaN, the solve treats them as no motion
+	TrackingPan.Init(std::numeric_limits<double>::quiet_NaN(), MaxFrames);
+	VideoMotion.Init(std::numeric_limits<double>::quiet_NaN(), MaxFrames);
+
+	StartFrame = GFrameCounter;
+	NumFrames = 0;
+	MaxLagFrames = FMath::Max(InMaxLagFrames, 1);
+	bRunning = true;
+}
+
+void FVPDelayCalibrator::Stop()
+{
+	bRunning = false;
+}
+
+int32 FVPDelayCalibrator::GetIndex(uint64 Frame)
+{
+	if (!bRunning || Frame < StartFrame || Frame - StartFrame >= (uint64)TrackingPan.Num())
+		return INDEX_NONE;
+
+	const int32 Index = (int32)(Frame - StartFrame);
+	NumFrames = FMath::Max(NumFrames, Index + 1);
+	return Index;
+}
+
+void FVPDelayCalibrator::AddTrackingSample(uint64 Frame, double PanDegrees)
+{
+	const int32 Index = GetIndex(Frame);
+	if (Index != INDEX_NONE)
+	{
+		TrackingPan[Index] = PanDegrees;
+	}
+}
+
+void FVPDelayCalibrator::AddVideoSample(uint64 Frame, double Motion)
+{
+	const int32 Index = GetIndex(Frame);
+	if (Index != INDEX_NONE)
+	{
+		VideoMotion[Index] = Motion;
+	}
+}
+
+bool FVPDelayCalibrator::Solve(double& OutLagFrames, double& OutConfidence) const
+{
+	return Solve(MakeArrayView(TrackingPan.GetData(), NumFrames), MakeArrayView(VideoMotion.GetData(), NumFrames), MaxLagFrames, OutLagFrames, OutConfidence);
+}
+
+bool FVPDelayCalibrator::Solve(TArrayView<const double> InTrackingPan, TArrayView<const double> InVideoMotion, int32 InMaxLagFrames, double& OutLagFrames, double& OutConfidence)
+{
+	OutLagFrames = 0.0;
+	OutConfidence = 0.0;
+
+	const int32 Num = FMath::Min(InTrackingPan.Num(), InVideoMotion.Num()) - 1;
+	const int32 MaxLag = FMath::Max(InMaxLagFrames, 1);
+	if (Num < MaxLag * 4)
+		return false;
+
+	// Velocities remove the offset between the two signals, frames missing on either side count as no motion
+	TArray<double> TrackingVelocity;
+	TArray<double> VideoVelocity;
+	TrackingVelocity.SetNumUninitialized(Num);
+	VideoVelocity.SetNumUninitialized(Num);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const double PanDelta = InTrackingPan[Index + 1] - InTrackingPan[Index];
+		const double VideoDelta = InVideoMotion[Index + 1] - InVideoMotion[Index];
+		TrackingVelocity[Index] = FMath::IsFinite(PanDelta) ? FRotator::NormalizeAxis(PanDelta) : 0.0;
+		VideoVelocity[Index] = FMath::IsFinite(VideoDelta) ? VideoDelta : 0.0;
+	}
+
+	auto RemoveMean = [](TArray<double>& Values)
+		{
+			double Sum = 0.0;
+			for (double Value : Values)
+			{
+				Sum += Value;
+			}
+			const double Mean = Sum / Values.Num();
+			for (double& Value : Values)
+			{
+				Value -= Mean;
+			}
+		};
+	RemoveMean(TrackingVelocity);
+	RemoveMean(VideoVelocity);
+
+	// Normalized correlation of the video at frame i against the tracking at frame i - Lag.
+	// The absolute value is used since the video measure can move against the pan.
+	auto Correlate = [&](int32 Lag)
+		{
+			double Cross = 0.0;
+			double TrackingEnergy = 0.0;
+			double VideoEnergy = 0.0;
+			for (int32 Index = FMath::Max(Lag, 0); Index < FMath::Min(Num, Num + Lag); ++Index)
+			{
+				const double Tracking = TrackingVelocity[Index - Lag];
+				const double Video = VideoVelocity[Index];
+				Cross += Tracking * Video;
+				TrackingEnergy += Tracking * Tracking;
+				VideoEnergy += Video * Video;
+			}
+			const double Energy = FMath::Sqrt(TrackingEnergy * VideoEnergy);
+			return Energy > UE_DOUBLE_SMALL_NUMBER ? FMath::Abs(Cross) / Energy : 0.0;
+		};
+
+	int32 BestLag = 0;
+	double BestCorrelation = -1.0;
+	double Before = 0.0;
+	double After = 0.0;
+	double Previous = Correlate(-MaxLag - 1);
+	double Current = Correlate(-MaxLag);
+	for (int32 Lag = -MaxLag; Lag <= MaxLag; ++Lag)
+	{
+		const double Next = Correlate(Lag + 1);
+		if (Current > BestCorrelation)
+		{
+			BestLag = Lag;
+			BestCorrelation = Current;
+			Before = Previous;
+			After = Next;
+		}
+		Previous = Current;
+		Current = Next;
+	}
+
+	// Vertex of the parabola through the peak and its neighbours
+	const double Curvature = Before - 2.0 * BestCorrelation + After;
+	const double SubFrame = Curvature < -UE_DOUBLE_SMALL_NUMBER ? FMath::Clamp(0.5 * (Before - After) / Curvature, -0.5, 0.5) : 0.0;
+
+	OutLagFrames = BestLag + SubFrame;
+	OutConfidence = BestCorrelation;
+	return BestCorrelation >= MinConfidence;
+}
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPEncoderMapping.h"
+
+namespace VPEncoderMapping
+{
+	// Keeps the reciprocal of an infinity focus mark finite
+	static constexpr float MinReciprocal = 1.0e-7f;
+
+	struct FBlock
+	{
+		double SumWeight = 0.0;
+		double SumX = 0.0;
+		double SumY = 0.0;
+
+		double X() const { return SumX / SumWeight; }
+		double Y() const { return SumY / SumWeight; }
+	};
+}
+
+void FVPEncoderCurve::Reset()
+{
+	Knots.Reset();
+	Segments.Reset();
+	InvWidths.Reset();
+	bReciprocal = false;
+}
+
+bool FVPEncoderCurve::Fit(TArrayView<const FVPEncoderSample> Samples, bool bInReciprocal, int32 MaxKnots)
+{
+	using namespace VPEncoderMapping;
+
+	Reset();
+	bReciprocal = bInReciprocal;
+
+	TArray<FVector2D> Points;
+	Points.Reserve(Samples.Num());
+	for (const FVPEncoderSample& Sample : Samples)
+	{
+		if (!FMath::IsFinite(Sample.Raw) || !FMath::IsFinite(Sample.Value) || (bReciprocal && Sample.Value <= 0.0f))
+			continue;
+
+		Points.Emplace(Sample.Raw, bReciprocal ? 1.0 / Sample.Value : Sample.Value);
+	}
+	if (Points.Num() == 0)
+		return false;
+
+	Points.Sort([](const FVector2D& A, const FVector2D& B) { return A.X < B.X; });
+
+	// Pool adjacent violators: repeated or noisy readings are averaged until the values are strictly monotonic.
+	// Each block then becomes one knot at the mean of its encoder counts.
+	const double Direction = Points.Last().Y >= Points[0].Y ? 1.0 : -1.0;
+	TArray<FBlock> Blocks;
+	Blocks.Reserve(Points.Num());
+	for (const FVector2D& Point : Points)
+	{
+		FBlock& Block = Blocks.AddDefaulted_GetRef();
+		Block.SumWeight = 1.0;
+		Block.SumX = Point.X;
+		Block.SumY = Point.Y * Direction;
+
+		while (Blocks.Num() > 1)
+		{
+			const FBlock& Last = Blocks.Last();
+			FBlock& Previous = Blocks[Blocks.Num() - 2];
+			if (Previous.Y() < Last.Y() && Previous.X() < Last.X())
+				break;
+
+			Previous.SumWeight += Last.SumWeight;
+			Previous.SumX += Last.SumX;
+			Previous.SumY += Last.SumY;
+			Blocks.Pop(EAllowShrinking::No);
+		}
+	}
+
+	// Evenly thinned out when the calibration is denser than needed, the ends are always kept
+	const int32 NumKnots = FMath::Min(Blocks.Num(), FMath::Max(MaxKnots, 2));
+	TArray<double> X;
+	TArray<double> Y;
+	X.SetNumUninitialized(NumKnots);
+	Y.SetNumUninitialized(NumKnots);
+	for (int32 Knot = 0; Knot < NumKnots; ++Knot)
+	{
+		const int32 BlockIndex = NumKnots > 1 ? FMath::RoundToInt32((double)Knot * (Blocks.Num() - 1) / (NumKnots - 1)) : 0;
+		X[Knot] = Blocks[BlockIndex].X();
+		Y[Knot] = Blocks[BlockIndex].Y() * Direction;
+	}
+
+	Knots.SetNumUninitialized(NumKnots);
+	for (int32 Knot = 0; Knot < NumKnots; ++Knot)
+	{
+		Knots[Knot] = (float)X[Knot];
+	}
+
+	if (NumKnots == 1)
+	{
+		Segments.Add(FVector4f((float)Y[0], 0.0f, 0.0f, 0.0f));
+		InvWidths.Add(0.0f);
+		return true;
+	}
+
+	// Brodlie slopes: zero at extrema, harmonic mean of the secants weighted by the neighbouring widths elsewhere
+	TArray<double> Secants;
+	TArray<double> Slopes;
+	Secants.SetNumUninitialized(NumKnots - 1);
+	Slopes.SetNumUninitialized(NumKnots);
+	for (int32 Segment = 0; Segment < NumKnots - 1; ++Segment)
+	{
+		Secants[Segment] = (Y[Segment + 1] - Y[Segment]) / (X[Segment + 1] - X[Segment]);
+	}
+
+	Slopes[0] = Secants[0];
+	Slopes[NumKnots - 1] = Secants[NumKnots - 2];
+	for (int32 Knot = 1; Knot < NumKnots - 1; ++Knot)
+	{
+		const double Before = Secants[Knot - 1];
+		const double After = Secants[Knot];
+		if (Before * After <= 0.0)
+		{
+			Slopes[Knot] = 0.0;
+			continue;
+		}
+
+		const double WidthBefore = X[Knot] - X[Knot - 1];
+		const double WidthAfter = X[Knot + 1] - X[Knot];
+		const double WeightBefore = 2.0 * WidthAfter + WidthBefore;
+		const double WeightAfter = WidthAfter + 2.0 * WidthBefore;
+		Slopes[Knot] = (WeightBefore + WeightAfter) / (WeightBefore / Before + WeightAfter / After);
+	}
+
+	Segments.SetNumUninitialized(NumKnots - 1);
+	InvWidths.SetNumUninitialized(NumKnots - 1);
+	for (int32 Segment = 0; Segment < NumKnots - 1; ++Segment)
+	{
+		const double Width = X[Segment + 1] - X[Segment];
+		const double Rise = Y[Segment + 1] - Y[Segment];
+		const double SlopeStart = Slopes[Segment] * Width;
+		const double SlopeEnd = Slopes[Segment + 1] * Width;
+
+		Segments[Segment] = FVector4f(
+			(float)Y[Segment],
+			(float)SlopeStart,
+			(float)(3.0 * Rise - 2.0 * SlopeStart - SlopeEnd),
+			(float)(SlopeStart + SlopeEnd - 2.0 * Rise));
+		InvWidths[Segment] = (float)(1.0 / Width);
+	}
+	return true;
+}
+
+float FVPEncoderCurve::Evaluate(float Raw) const
+{
+	const int32 NumKnots = Knots.Num();
+	if (NumKnots == 0)
+		return Raw;
+
+	const float* KnotData = Knots.GetData();
+	const float X = FMath::Clamp(Raw, KnotData[0], KnotData[NumKnots - 1]);
+
+	// Lower bound over the segment starts, the select compiles to a conditional move
+	const float* Base = KnotData;
+	int32 Count = FMath::Max(NumKnots - 1, 1);
+	while (Count > 1)
+	{
+		const int32 Half = Count / 2;
+		Base = Base[Half] <= X ? Base + Half : Base;
+		Count -= Half;
+	}
+
+	const int32 Segment = (int32)(Base - KnotData);
+	const float T = (X - KnotData[Segment]) * InvWidths[Segment];
+	const FVector4f& C = Segments[Segment];
+	const float Value = C.X + T * (C.Y + T * (C.Z + T * C.W));
+	return bReciprocal ? 1.0f / FMath::Max(Value, VPEncoderMapping::MinReciprocal) : Value;
+}
+
+bool FVPEncoderMapping::Fit(const FVPEncoderCalibration& Calibration)
+{
+	const bool bZoom = Zoom.Fit(Calibration.Zoom);
+	const bool bFocus = Focus.Fit(Calibration.Focus, true);
+	const bool bIris = Iris.Fit(Calibration.Iris);
+	return bZoom || bFocus || bIris;
+}
+
+void FVPEncoderMapping::Apply(FVPTrackingSample& InOutSample) const
+{
+	InOutSample.FocalLength = Zoom.Evaluate(InOutSample.FocalLength);
+	InOutSample.FocusDistance = Focus.Evaluate(InOutSample.FocusDistance);
+	InOutSample.Aperture = Iris.Evaluate(InOutSample.Aperture);
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPEncoderMappingSubsystem.h"
+
+bool UVPEncoderMappingSubsystem::FitMapping(FName Mapping, const FVPEncoderCalibration& Calibration)
+{
+	TSharedPtr<FVPEncoderMapping> Fitted = MakeShared<FVPEncoderMapping>();
+	if (!Fitted->Fit(Calibration))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Encoder mapping %s has no usable calibration samples"), *Mapping.ToString());
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Encoder mapping %s fitted, %d zoom, %d focus and %d iris knots"), *Mapping.ToString(),
+		Fitted->Zoom.GetNumKnots(), Fitted->Focus.GetNumKnots(), Fitted->Iris.GetNumKnots());
+
+	Mappings.Add(Mapping, Fitted);
+	++Generation;
+	return true;
+}
+
+void UVPEncoderMappingSubsystem::RemoveMapping(FName Mapping)
+{
+	if (Mappings.Remove(Mapping) > 0)
+	{
+		++Generation;
+	}
+}
+
+bool UVPEncoderMappingSubsystem::MapEncoders(FName Mapping, float RawZoom, float RawFocus, float RawIris, float& OutFocalLength, float& OutFocusDistance, float& OutFStop) const
+{
+	const TSharedPtr<const FVPEncoderMapping>* Found = Mappings.Find(Mapping);
+	if (!Found)
+		return false;
+
+	OutFocalLength = (*Found)->Zoom.Evaluate(RawZoom);
+	OutFocusDistance = (*Found)->Focus.Evaluate(RawFocus);
+	OutFStop = (*Found)->Iris.Evaluate(RawIris);
+	return true;
+}
+
+TSharedPtr<const FVPEncoderMapping> UVPEncoderMappingSubsystem::GetMapping(FName Mapping) const
+{
+	const TSharedPtr<const FVPEncoderMapping>* Found = Mappings.Find(Mapping);
+	return Found ? *Found : nullptr;
+}
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPEventTimelineSubsystem.h"
+#include "VPTrackingStats.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/App.h"
+
+DECLARE_CYCLE_STAT(TEXT("Event timeline"), STAT_BelindaVP_EventTimeline, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduled events"), STAT_BelindaVP_ScheduledEvents, STATGROUP_BelindaVP);
+
+void FVPEventTimeline::Add(FEntry Entry)
+{
+	FOwnerState& State = Owners.FindOrAdd(TObjectKey<UEventTriggerComp>(Entry.Owner.Get()));
+	++State.NumEntries;
+	Entry.Generation = State.Generation;
+	Entry.Sequence = NextSequence++;
+	Pending.Add(MoveTemp(Entry));
+}
+
+void FVPEventTimeline::Remove(const UEventTriggerComp* Owner)
+{
+	FOwnerState* State = Owners.Find(TObjectKey<UEventTriggerComp>(Owner));
+	if (!State || State->NumEntries == 0)
+		return;
+
+	++State->Generation;
+	NumStale += State->NumEntries;
+	State->NumEntries = 0;
+
+	// Tearing a level down removes every owner, sweeping each time would be quadratic
+	if (NumStale * 2 > Entries.Num() + Pending.Num())
+	{
+		Compact();
+	}
+}
+
+bool FVPEventTimeline::IsLive(const FEntry& Entry) const
+{
+	const UEventTriggerComp* Owner = Entry.Owner.Get();
+	const FOwnerState* State = Owner ? Owners.Find(TObjectKey<UEventTriggerComp>(Owner)) : nullptr;
+	return State && State->Generation == Entry.Generation;
+}
+
+void FVPEventTimeline::Compact()
+{
+	// Entries of destroyed components are dropped on the way
+	auto IsRemoved = [this](const FEntry& Entry) { return !IsLive(Entry); };
+	Entries.RemoveAll(IsRemoved);
+	Pending.RemoveAll(IsRemoved);
+	NumStale = 0;
+
+	for (auto It = Owners.CreateIterator(); It; ++It)
+	{
+		if (It->Value.NumEntries == 0 || !It->Key.ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	Cursor = bStarted ? LowerBound(LastKey + 1) : 0;
+}
+
+void FVPEventTimeline::Rekey(const FFrameRate& Rate)
+{
+	Entries.Append(MoveTemp(Pending));
+	Pending.Reset();
+	for (FEntry& Entry : Entries)
+	{
+		Entry.Key = Entry.Timecode.ToFrameNumber(Rate).Value;
+	}
+	Sort();
+
+	// Keys of the old rate mean nothing anymore
+	bStarted = false;
+	Cursor = 0;
+}
+
+void FVPEventTimeline::Advance(int64 Key, int64 MaxCatchUp, TArray<FEntry>& OutDue)
+{
+	if (Pending.Num() > 0)
+	{
+		Entries.Append(MoveTemp(Pending));
+		Pending.Reset();
+		Sort();
+		Cursor = bStarted ? LowerBound(LastKey + 1) : 0;
+	}
+
+	if (!bStarted || Key < LastKey || Key - LastKey > MaxCatchUp)
+	{
+		Cursor = LowerBound(Key);
+		bStarted = true;
+	}
+
+	for (; Cursor < Entries.Num() && Entries[Cursor].Key <= Key; ++Cursor)
+	{
+		if (IsLive(Entries[Cursor]))
+		{
+			OutDue.Add(Entries[Cursor]);
+		}
+	}
+	LastKey = Key;
+}
+
+void FVPEventTimeline::Sort()
+{
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.Key != B.Key ? A.Key < B.Key : A.Sequence < B.Sequence; });
+}
+
+int32 FVPEventTimeline::LowerBound(int64 Key) const
+{
+	return Algo::LowerBoundBy(Entries, Key, &FEntry::Key);
+}
+
+void UVPEventTimelineSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TimecodeRate = FApp::GetTimecodeFrameRate();
+}
+
+bool UVPEventTimelineSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UVPEventTimelineSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVPEventTimelineSubsystem, STATGROUP_Tickables);
+}
+
+void UVPEventTimelineSubsystem::AddEvent(UEventTriggerComp* Owner, const FVPTriggerEvent& Event)
+{
+	FVPEventTimeline::FEntry Entry;
+	Entry.Owner = Owner;
+	Entry.Name = Event.Name;
+
+	if (Event.TimeBase == EVPTriggerTimeBase::Timecode)
+	{
+		Entry.Timecode = Event.Timecode;
+		Entry.Key = Event.Timecode.ToFrameNumber(TimecodeRate).Value;
+		TimecodeTimeline.Add(MoveTemp(Entry));
+	}
+	else
+	{
+		Entry.Key = Event.Frame;
+		FrameTimeline.Add(MoveTemp(Entry));
+	}
+}
+
+void UVPEventTimelineSubsystem::RemoveEvents(const UEventTriggerComp* Owner)
+{
+	TimecodeTimeline.Remove(Owner);
+	FrameTimeline.Remove(Owner);
+}
+
+void UVPEventTimelineSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BelindaVP_EventTimeline);
+
+	Due.Reset();
+
+	const TOptional<FQualifiedFrameTime> FrameTime = FApp::GetCurrentFrameTime();
+	if (FrameTime.IsSet())
+	{
+		if (FrameTime->Rate != TimecodeRate)
+		{
+			TimecodeRate = FrameTime->Rate;
+			TimecodeTimeline.Rekey(TimecodeRate);
+		}
+
+		// Up to a second of skipped frames is caught up, a longer jump is a seek
+		TimecodeTimeline.Advance(FrameTime->Time.GetFrame().Value, TimecodeRate.AsFrameNumber(1.0).Value, Due);
+	}
+
+	FrameTimeline.Advance(FrameNumber, MAX_int64, Due);
+	++FrameNumber;
+
+	SET_DWORD_STAT(STAT_BelindaVP_ScheduledEvents, GetNumEvents());
+
+	if (Due.Num() == 0)
+		return;
+
+	// Handlers may add or remove events, the timelines are done for this frame
+	const FTimecode Timecode = FApp::GetTimecode();
+	for (const FVPEventTimeline::FEntry& Entry : Due)
+	{
+		if (UEventTriggerComp* Owner = Entry.Owner.Get())
+		{
+			Owner->Trigger(Entry.Name, Timecode);
+		}
+	}
+}
@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPFramePacing.h"
+#include "Misc/FileHelper.h"
+
+namespace VPFramePacing
+{
+	// Without a sync count, a frame longer than this many periods skipped some
+	static constexpr double MissThreshold = 1.5;
+
+	// Slack on the timecode advance expected from the engine delta
+	static constexpr double TimecodeTolerance = 0.05;
+}
+
+FVPFramePacing::FVPFramePacing()
+{
+	Ring.SetNumZeroed(Capacity);
+	for (std::atomic<uint64>& Run : MissedRuns)
+	{
+		Run.store(0, std::memory_order_relaxed);
+	}
+}
+
+const FVPFrameRecord& FVPFramePacing::AddFrame(const FVPFrameRecord& InRecord, double ExpectedInterval, const FFrameRate& TimecodeRate)
+{
+	FVPFrameRecord Record = InRecord;
+	Record.Flags &= EVPFrameFlags::Genlocked | EVPFrameFlags::HasTimecode;
+	Record.NumMissed = 0;
+	Expected.store(ExpectedInterval, std::memory_order_relaxed);
+
+	if (bHasLast)
+	{
+		Record.FrameTime = (float)(Record.Time - Last.Time);
+
+		if (Record.Flags & EVPFrameFlags::Genlocked)
+		{
+			Record.NumMissed = Record.SyncCountDelta > 1 ? Record.SyncCountDelta - 1 : 0;
+			if (Record.SyncCountDelta == 0)
+			{
+				Record.Flags |= EVPFrameFlags::Duplicated;
+			}
+		}
+		else if (ExpectedInterval > 0.0 && Record.FrameTime > ExpectedInterval * VPFramePacing::MissThreshold)
+		{
+			Record.NumMissed = (uint16)FMath::Min(FMath::RoundToInt(Record.FrameTime / ExpectedInterval) - 1, (int32)MAX_uint16);
+		}
+
+		if ((Record.Flags & Last.Flags & EVPFrameFlags::HasTimecode) && TimecodeRate.IsValid())
+		{
+			// The engine delta includes the skipped syncs, so the timecode has to move by as much
+			const double ExpectedAdvance = (Record.EngineTime - Last.EngineTime) * TimecodeRate.AsDecimal();
+			const int32 Advance = Record.TimecodeFrame - Last.TimecodeFrame;
+			if (Advance == 0 && ExpectedAdvance >= 1.0 - VPFramePacing::TimecodeTolerance)
+			{
+				Record.Flags |= EVPFrameFlags::Duplicated;
+			}
+			else if (Advance < FMath::FloorToInt(ExpectedAdvance - VPFramePacing::TimecodeTolerance) || Advance > FMath::CeilToInt(ExpectedAdvance + VPFramePacing::TimecodeTolerance))
+			{
+				Record.Flags |= EVPFrameFlags::TimecodeJump;
+			}
+		}
+
+		if (Record.NumMissed > 0)
+		{
+			Record.Flags |= EVPFrameFlags::Missed;
+			NumMissed.fetch_add(Record.NumMissed, std::memory_order_relaxed);
+			MissedRuns[FMath::Min((int32)Record.NumMissed, NumMissedRunBuckets) - 1].fetch_add(1, std::memory_order_relaxed);
+		}
+		if (Record.Flags & EVPFrameFlags::Duplicated)
+		{
+			NumDuplicated.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (Record.Flags & EVPFrameFlags::TimecodeJump)
+		{
+			NumTimecodeJumps.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		FrameTimes.Add(Record.FrameTime);
+		WaitTimes.Add(Record.WaitTime);
+	}
+	else
+	{
+		Record.FrameTime = 0.0f;
+		FirstTime.store(Record.Time, std::memory_order_relaxed);
+	}
+
+	LastTime.store(Record.Time, std::memory_order_relaxed);
+	Last = Record;
+	bHasLast = true;
+
+	// Readers drop what was overwritten while they copied, see GetRecentFrames
+	const uint64 Index = Head.load(std::memory_order_relaxed);
+	FVPFrameRecord& Slot = Ring[(int32)(Index & (Capacity - 1))];
+	Slot = Record;
+	Head.store(Index + 1, std::memory_order_release);
+	return Slot;
+}
+
+void FVPFramePacing::GetRecentFrames(TArray<FVPFrameRecord>& OutFrames) const
+{
+	const uint64 End = Head.load(std::memory_order_acquire);
+	const uint64 Begin = End > Capacity ? End - Capacity : 0;
+
+	TArray<FVPFrameRecord> Frames;
+	Frames.Reserve((int32)(End - Begin));
+	for (uint64 Index = Begin; Index < End; ++Index)
+	{
+		Frames.Add(Ring[(int32)(Index & (Capacity - 1))]);
+	}
+
+	// The writer may have wrapped over the oldest slots, including the one it's writing now
+	const uint64 Written = Head.load(std::memory_order_acquire);
+	const uint64 FirstValid = Written >= Capacity ? Written - Capacity + 1 : 0;
+	const int32 NumStale = (int32)FMath::Min<uint64>(FirstValid > Begin ? FirstValid - Begin : 0, Frames.Num());
+
+	OutFrames.Reset(Frames.Num() - NumStale);
+	OutFrames.Append(Frames.GetData() + NumStale, Frames.Num() - NumStale);
+}
+
+FVPFramePacingReport FVPFramePacing::GetReport() const
+{
+	FVPFramePacingReport Report;
+	Report.Frames = (int64)FrameTimes.Num();
+	Report.Seconds = (float)(LastTime.load(std::memory_order_relaxed) - FirstTime.load(std::memory_order_relaxed));
+	Report.ExpectedFrameTimeMs = (float)(Expected.load(std::memory_order_relaxed) * 1000.0);
+	Report.MissedFrames = (int64)NumMissed.load(std::memory_order_relaxed);
+	Report.DuplicatedFrames = (int64)NumDuplicated.load(std::memory_order_relaxed);
+	Report.TimecodeDiscontinuities = (int64)NumTimecodeJumps.load(std::memory_order_relaxed);
+
+	Report.FrameTimeMeanMs = (float)(FrameTimes.GetMean() * 1000.0);
+	Report.FrameTimeP50Ms = (float)(FrameTimes.GetPercentile(0.5) * 1000.0);
+	Report.FrameTimeP95Ms = (float)(FrameTimes.GetPercentile(0.95) * 1000.0);
+	Report.FrameTimeP99Ms = (float)(FrameTimes.GetPercentile(0.99) * 1000.0);
+	Report.FrameTimeMaxMs = (float)(FrameTimes.GetMax() * 1000.0);
+	Report.WaitMeanMs = (float)(WaitTimes.GetMean() * 1000.0);
+	Report.WaitP05Ms = (float)(WaitTimes.GetPercentile(0.05) * 1000.0);
+
+	Report.MissedRuns.SetNumZeroed(NumMissedRunBuckets);
+	for (int32 Bucket = 0; Bucket < NumMissedRunBuckets; ++Bucket)
+	{
+		Report.MissedRuns[Bucket] = (int64)MissedRuns[Bucket].load(std::memory_order_relaxed);
+	}
+	return Report;
+}
+
+void FVPFramePacing::Reset()
+{
+	Head.store(0, std::memory_order_release);
+	bHasLast = false;
+
+	FrameTimes.Reset();
+	WaitTimes.Reset();
+	for (std::atomic<uint64>& Run : MissedRuns)
+	{
+		Run.store(0, std::memory_order_relaxed);
+	}
+	NumMissed = 0;
+	NumDuplicated = 0;
+	NumTimecodeJumps = 0;
+	FirstTime = 0.0;
+	LastTime = 0.0;
+}
+
+bool FVPFramePacing::SaveFramesCsv(const FString& FilePath) const
+{
+	TArray<FVPFrameRecord> Frames;
+	GetRecentFrames(Frames);
+
+	FString Csv = TEXT("Frame,Time,EngineTime,DeltaMs,FrameTimeMs,WaitMs,SyncDelta,Missed,Duplicated,TimecodeJump,Genlocked,TimecodeFrame\n");
+	Csv.Reserve(Csv.Len() + Frames.Num() * 96);
+	for (const FVPFrameRecord& Frame : Frames)
+	{
+		Csv += FString::Printf(TEXT("%llu,%.6f,%.6f,%.3f,%.3f,%.3f,%u,%u,%d,%d,%d,%s\n"),
+			Frame.FrameNumber, Frame.Time, Frame.EngineTime, Frame.DeltaTime * 1000.0f, Frame.FrameTime * 1000.0f, Frame.WaitTime * 1000.0f,
+			Frame.SyncCountDelta, Frame.NumMissed,
+			(Frame.Flags & EVPFrameFlags::Duplicated) ? 1 : 0, (Frame.Flags & EVPFrameFlags::TimecodeJump) ? 1 : 0, (Frame.Flags & EVPFrameFlags::Genlocked) ? 1 : 0,
+			(Frame.Flags & EVPFrameFlags::HasTimecode) ? *FString::FromInt(Frame.TimecodeFrame) : TEXT(""));
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
+
+bool FVPFramePacing::SaveReportCsv(const FString& FilePath) const
+{
+	const FVPFramePacingReport Report = GetReport();
+
+	FString Csv = TEXT("Metric,Value\n");
+	Csv += FString::Printf(TEXT("Frames,%lld\nSeconds,%.3f\nExpectedFrameTimeMs,%.3f\n"), Report.Frames, Report.Seconds, Report.ExpectedFrameTimeMs);
+	Csv += FString::Printf(TEXT("MissedFrames,%lld\nDuplicatedFrames,%lld\nTimecodeDiscontinuities,%lld\n"), Report.MissedFrames, Report.DuplicatedFrames, Report.TimecodeDiscontinuities);
+	Csv += FString::Printf(TEXT("FrameTimeMeanMs,%.3f\nFrameTimeP50Ms,%.3f\nFrameTimeP95Ms,%.3f\nFrameTimeP99Ms,%.3f\nFrameTimeMaxMs,%.3f\n"),
+		Report.FrameTimeMeanMs, Report.FrameTimeP50Ms, Report.FrameTimeP95Ms, Report.FrameTimeP99Ms, Report.FrameTimeMaxMs);
+	Csv += FString::Printf(TEXT("WaitMeanMs,%.3f\nWaitP05Ms,%.3f\n"), Report.WaitMeanMs, Report.WaitP05Ms);
+
+	Csv += TEXT("\nMissedRun,Count\n");
+	for (int32 Bucket = 0; Bucket < Report.MissedRuns.Num(); ++Bucket)
+	{
+		Csv += FString::Printf(TEXT("%d%s,%lld\n"), Bucket + 1, Bucket == Report.MissedRuns.Num() - 1 ? TEXT("+") : TEXT(""), Report.MissedRuns[Bucket]);
+	}
+
+	// Empty buckets are skipped, the bounds are enough to rebuild the histograms
+	Csv += TEXT("\nUpperBoundMs,FrameTimeCount,WaitCount\n");
+	for (int32 Bucket = 0; Bucket < FVPHistogram::NumBuckets; ++Bucket)
+	{
+		const uint64 FrameCount = FrameTimes.GetBucketCount(Bucket);
+		const uint64 WaitCount = WaitTimes.GetBucketCount(Bucket);
+		if (FrameCount > 0 || WaitCount > 0)
+		{
+			Csv += FString::Printf(TEXT("%.4f,%llu,%llu\n"), FVPHistogram::GetBucketUpperBound(Bucket) * 1000.0, FrameCount, WaitCount);
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPFramePacingSubsystem.h"
+#include "GenlockedCustomTimeStep.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+TRACE_DECLARE_FLOAT_COUNTER(BelindaVP_FrameTime, TEXT("BelindaVP/Pacing/Frame time (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(BelindaVP_WaitTime, TEXT("BelindaVP/Pacing/Wait (ms)"));
+TRACE_DECLARE_INT_COUNTER(BelindaVP_SyncDelta, TEXT("BelindaVP/Pacing/Sync count delta"));
+TRACE_DECLARE_INT_COUNTER(BelindaVP_Missed, TEXT("BelindaVP/Pacing/Missed frames"));
+
+static FAutoConsoleCommand PacingCommand(
+	TEXT("BelindaVP.Pacing"),
+	TEXT("Logs the frame pacing since the last reset"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UVPFramePacingSubsystem* Pacing = GEngine ? GEngine->GetEngineSubsystem<UVPFramePacingSubsystem>() : nullptr;
+			if (!Pacing)
+				return;
+
+			const FVPFramePacingReport Report = Pacing->GetReport();
+			UE_LOG(LogTemp, Log, TEXT("%lld frames in %.1f s (expected %.2f ms): %lld missed, %lld duplicated, %lld timecode discontinuities, frame time mean %.2f ms p95 %.2f ms p99 %.2f ms max %.2f ms, wait mean %.2f ms p05 %.2f ms"),
+				Report.Frames, Report.Seconds, Report.ExpectedFrameTimeMs, Report.MissedFrames, Report.DuplicatedFrames, Report.TimecodeDiscontinuities,
+				Report.FrameTimeMeanMs, Report.FrameTimeP95Ms, Report.FrameTimeP99Ms, Report.FrameTimeMaxMs, Report.WaitMeanMs, Report.WaitP05Ms);
+		}));
+
+static FAutoConsoleCommand PacingExportCommand(
+	TEXT("BelindaVP.Pacing.Export"),
+	TEXT("Writes the recent frames and the frame pacing report to CSV. Args: [FilePath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPFramePacingSubsystem* Pacing = GEngine ? GEngine->GetEngineSubsystem<UVPFramePacingSubsystem>() : nullptr)
+			{
+				const FString FilePath = Pacing->ExportCsv(Args.IsValidIndex(0) ? Args[0] : FString());
+				UE_LOG(LogTemp, Log, TEXT("Frame pacing written to %s"), *FilePath);
+			}
+		}));
+
+static FAutoConsoleCommand PacingResetCommand(
+	TEXT("BelindaVP.Pacing.Reset"),
+	TEXT("Resets the frame pacing counters and histograms"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UVPFramePacingSubsystem* Pacing = GEngine ? GEngine->GetEngineSubsystem<UVPFramePacingSubsystem>() : nullptr)
+			{
+				Pacing->ResetPacing();
+			}
+		}));
+
+void UVPFramePacingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UVPFramePacingSubsystem::OnEndFrame);
+}
+
+void UVPFramePacingSubsystem::Deinitialize()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	Take.Reset();
+
+	Super::Deinitialize();
+}
+
+void UVPFramePacingSubsystem::OnEndFrame()
+{
+	FVPFrameRecord Record;
+	Record.FrameNumber = GFrameCounter;
+	Record.Time = FPlatformTime::Seconds();
+	Record.EngineTime = FApp::GetCurrentTime();
+	Record.DeltaTime = (float)FApp::GetDeltaTime();
+	Record.WaitTime = (float)FApp::GetIdleTime();
+
+	// The period of the time step, the timecode rate stands in when the engine runs free
+	double ExpectedInterval = FApp::GetTimecodeFrameRate().AsInterval();
+	const UEngineCustomTimeStep* TimeStep = GEngine ? GEngine->GetCustomTimeStep() : nullptr;
+	if (const UFixedFrameRateCustomTimeStep* FixedTimeStep = Cast<UFixedFrameRateCustomTimeStep>(TimeStep))
+	{
+		ExpectedInterval = FixedTimeStep->GetFixedFrameRate().AsInterval();
+	}
+	if (const UGenlockedCustomTimeStep* Genlock = Cast<UGenlockedCustomTimeStep>(TimeStep))
+	{
+		if (Genlock->GetSynchronizationState() == ECustomTimeStepSynchronizationState::Synchronized && Genlock->IsLastSyncDataValid())
+		{
+			Record.SyncCountDelta = (uint16)FMath::Min<uint32>(Genlock->GetLastSyncCountDelta(), MAX_uint16);
+			Record.Flags |= EVPFrameFlags::Genlocked;
+		}
+	}
+
+	FFrameRate TimecodeRate;
+	const TOptional<FQualifiedFrameTime> FrameTime = FApp::GetCurrentFrameTime();
+	if (FrameTime.IsSet())
+	{
+		Record.TimecodeFrame = FrameTime->Time.GetFrame().Value;
+		TimecodeRate = FrameTime->Rate;
+		Record.Flags |= EVPFrameFlags::HasTimecode;
+	}
+
+	const FVPFrameRecord& Added = Session.AddFrame(Record, ExpectedInterval, TimecodeRate);
+	if (Take.IsValid())
+	{
+		Take->AddFrame(Record, ExpectedInterval, TimecodeRate);
+	}
+
+	TRACE_COUNTER_SET(BelindaVP_FrameTime, Added.FrameTime * 1000.0f);
+	TRACE_COUNTER_SET(BelindaVP_WaitTime, Added.WaitTime * 1000.0f);
+	TRACE_COUNTER_SET(BelindaVP_SyncDelta, Added.SyncCountDelta);
+	TRACE_COUNTER_SET(BelindaVP_Missed, Added.NumMissed);
+	if (Added.NumMissed > 0)
+	{
+		TRACE_BOOKMARK(TEXT("BelindaVP missed %u frames"), (uint32)Added.NumMissed);
+	}
+}
+
+FString UVPFramePacingSubsystem::ExportCsv(const FString& FilePath) const
+{
+	const FString OutputPath = !FilePath.IsEmpty() ? FilePath
+		: FPaths::ProfilingDir() / TEXT("BelindaVP") / FString::Printf(TEXT("FramePacing_%s.csv"), *FDateTime::Now().ToString());
+
+	const FString ReportPath = FPaths::GetPath(OutputPath) / (FPaths::GetBaseFilename(OutputPath) + TEXT("_Report.csv"));
+	if (!Session.SaveFramesCsv(OutputPath) || !Session.SaveReportCsv(ReportPath))
+		return FString();
+
+	return OutputPath;
+}
+
+void UVPFramePacingSubsystem::BeginTake()
+{
+	Take = MakeUnique<FVPFramePacing>();
+}
+
+void UVPFramePacingSubsystem::EndTake(const FString& BasePath)
+{
+	if (!Take.IsValid())
+		return;
+
+	const FVPFramePacingReport Report = Take->GetReport();
+	if (!Take->SaveFramesCsv(BasePath + TEXT(".pacing.csv")) || !Take->SaveReportCsv(BasePath + TEXT(".pacing_report.csv")))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Pacing report of %s could not be written"), *BasePath);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Log, TEXT("Take pacing: %lld frames, %lld missed, %lld duplicated, %lld timecode discontinuities, frame time p99 %.2f ms"),
+			Report.Frames, Report.MissedFrames, Report.DuplicatedFrames, Report.TimecodeDiscontinuities, Report.FrameTimeP99Ms);
+	}
+
+	Take.Reset();
+}
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPFramePool.h"
+#include "HAL/PlatformTime.h"
+
+namespace VPFramePool
+{
+	// Rows are copied with wide vector stores, start them on a cache line
+	static constexpr uint32 BufferAlignment = 64;
+}
+
+FVPFrameBuffer::FVPFrameBuffer(int64 InCapacity)
+	: Capacity(InCapacity)
+{
+	Data = (uint8*)FMemory::Malloc(Capacity, VPFramePool::BufferAlignment);
+	// Touch every page now rather than on the first captured frame
+	FMemory::Memzero(Data, Capacity);
+}
+
+FVPFrameBuffer::~FVPFrameBuffer()
+{
+	FMemory::Free(Data);
+}
+
+TSharedRef<FVPFramePool, ESPMode::ThreadSafe> FVPFramePool::Create(int32 NumBuffers, int64 BufferSize)
+{
+	return MakeShareable(new FVPFramePool(NumBuffers, BufferSize));
+}
+
+FVPFramePool::FVPFramePool(int32 NumBuffers, int64 InBufferSize)
+	: BufferSize(InBufferSize)
+{
+	Buffers.Reserve(NumBuffers);
+	for (int32 Index = 0; Index < NumBuffers; ++Index)
+	{
+		FVPFrameBuffer* Buffer = Buffers.Emplace_GetRef(new FVPFrameBuffer(BufferSize)).Get();
+		Free.Push(Buffer);
+	}
+}
+
+FVPFramePool::~FVPFramePool()
+{
+	// Every frame holds a reference on the pool, none can be out anymore
+	check(NumInUse.load() == 0);
+}
+
+FVPFrameBufferPtr FVPFramePool::Acquire()
+{
+	FVPFrameBuffer* Buffer = Free.Pop();
+	if (!Buffer)
+	{
+		NumExhausted.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	NumInUse.fetch_add(1, std::memory_order_relaxed);
+	NumAcquired.fetch_add(1, std::memory_order_relaxed);
+
+	// The deleter keeps the pool alive until its last frame is back
+	TSharedRef<FVPFramePool, ESPMode::ThreadSafe> Pool = AsShared();
+	return FVPFrameBufferPtr(Buffer, [Pool](FVPFrameBuffer* Released) { Pool->Release(Released); });
+}
+
+FVPFrameBufferPtr FVPFramePool::AcquireAndCopy(const void* Source, int32 Width, int32 Height, int32 SourceStride, int32 BytesPerPixel)
+{
+	const int32 RowSize = Width * BytesPerPixel;
+	if (!Source || (int64)RowSize * Height > BufferSize)
+		return nullptr;
+
+	FVPFrameBufferPtr Frame = Acquire();
+	if (!Frame.IsValid())
+		return nullptr;
+
+	const double Start = FPlatformTime::Seconds();
+
+	// Rows are packed in the pool, a padded source is copied row by row
+	const uint8* SourceBytes = static_cast<const uint8*>(Source);
+	if (SourceStride == RowSize)
+	{
+		FMemory::Memcpy(Frame->GetData(), SourceBytes, (SIZE_T)RowSize * Height);
+	}
+	else
+	{
+		for (int32 Row = 0; Row < Height; ++Row)
+		{
+			FMemory::Memcpy(Frame->GetData() + (int64)Row * RowSize, SourceBytes + (int64)Row * SourceStride, RowSize);
+		}
+	}
+
+	CopyTimes.Add(FPlatformTime::Seconds() - Start);
+	BytesCopied.fetch_add((uint64)RowSize * Height, std::memory_order_relaxed);
+
+	Frame->Width = Width;
+	Frame->Height = Height;
+	Frame->Stride = RowSize;
+	return Frame;
+}
+
+void FVPFramePool::Release(FVPFrameBuffer* Buffer)
+{
+	Buffer->FrameNumber = 0;
+	Buffer->Timecode = FTimecode();
+	Free.Push(Buffer);
+	NumInUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FVPFramePool::ResetStats()
+{
+	NumAcquired = 0;
+	NumExhausted = 0;
+	BytesCopied = 0;
+	CopyTimes.Reset();
+}
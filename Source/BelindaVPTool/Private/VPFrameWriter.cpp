@@ -0,0 +1,294 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPFrameWriter.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Misc/App.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+class FVPFrameWriter::FWorker : public FRunnable
+{
+public:
+	FWorker(FVPFrameWriter& InOwner, int32 Index)
+		: Owner(InOwner)
+	{
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("VPFrameWriter%d"), Index), 0, TPri_BelowNormal);
+	}
+
+	virtual ~FWorker()
+	{
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+	}
+
+	virtual uint32 Run() override
+	{
+		// Stopping only exits once the queue is empty, nothing submitted is lost
+		for (;;)
+		{
+			FJob Job;
+			if (Owner.PopJob(Job))
+			{
+				Owner.Process(Job);
+			}
+			else if (Owner.bStopping)
+			{
+				break;
+			}
+			else
+			{
+				Owner.WorkEvent->Wait(10);
+			}
+		}
+		return 0;
+	}
+
+private:
+	FVPFrameWriter& Owner;
+	FRunnableThread* Thread = nullptr;
+};
+
+FVPFrameWriter::FVPFrameWriter(const FVPFrameWriterSettings& InSettings)
+	: Settings(InSettings)
+{
+	Settings.QueueCapacity = FMath::Max(Settings.QueueCapacity, 1);
+	if (Settings.bUseEngineTimecodeRate || !Settings.FrameRate.IsValid())
+	{
+		Settings.FrameRate = FApp::GetTimecodeFrameRate();
+	}
+	Settings.Directory = FPaths::ConvertRelativePathToFull(Settings.Directory);
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Settings.Directory);
+
+	Queue.Reserve(Settings.QueueCapacity);
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	SpaceEvent = FPlatformProcess::GetSynchEventFromPool(false);
+
+	const int32 NumWorkers = Settings.NumWorkers > 0 ? Settings.NumWorkers : FMath::Clamp(FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 2, 1, 32);
+	for (int32 Index = 0; Index < NumWorkers; ++Index)
+	{
+		Workers.Emplace(MakeUnique<FWorker>(*this, Index));
+	}
+}
+
+FVPFrameWriter::~FVPFrameWriter()
+{
+	bStopping = true;
+	for (int32 Index = 0; Index < Workers.Num(); ++Index)
+	{
+		WorkEvent->Trigger();
+	}
+	Workers.Empty();
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	FPlatformProcess::ReturnSynchEventToPool(SpaceEvent);
+
+	UE_LOG(LogTemp, Log, TEXT("Frame writer %s closed: %llu written, %llu failed, %llu dropped"), *Settings.Directory, NumWritten.load(), NumFailed.load(), NumDropped.load());
+}
+
+bool FVPFrameWriter::Submit(FVPFrameBufferRef Frame)
+{
+	NumSubmitted.fetch_add(1, std::memory_order_relaxed);
+
+	FJob Evicted;
+	double BlockStart = 0.0;
+	for (;;)
+	{
+		{
+			FScopeLock ScopeLock(&QueueLock);
+
+			const bool bFull = Queue.Num() >= Settings.QueueCapacity;
+			if (bFull && BlockStart == 0.0)
+			{
+				NumQueueFull.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			if (bFull && Settings.DropPolicy == EVPFrameDropPolicy::DropNewest)
+			{
+				NumDropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			if (bFull && Settings.DropPolicy == EVPFrameDropPolicy::DropOldest)
+			{
+				Evicted = MoveTemp(Queue[0]);
+				Queue.RemoveAt(0, 1, EAllowShrinking::No);
+			}
+
+			if (!bFull || Settings.DropPolicy == EVPFrameDropPolicy::DropOldest)
+			{
+				FJob& Job = Queue.AddDefaulted_GetRef();
+				Job.Sequence = NextSequence++;
+				Job.FileNumber = (int64)Job.Sequence;
+				if (Settings.Naming == EVPFrameNaming::Timecode)
+				{
+					Job.FileNumber = Frame->Timecode.ToFrameNumber(Settings.FrameRate).Value;
+					Job.Repeat = FileNumberUses.FindOrAdd(Job.FileNumber)++;
+
+					// A repeat comes within the frames in flight, pruned in batches so a long take stays bounded
+					const int64 Window = Settings.QueueCapacity + Workers.Num();
+					if (FileNumberUses.Num() > 2 * Window)
+					{
+						for (auto It = FileNumberUses.CreateIterator(); It; ++It)
+						{
+							if (FMath::Abs(It.Key() - Job.FileNumber) > Window)
+							{
+								It.RemoveCurrent();
+							}
+						}
+					}
+				}
+				Job.Frame = Frame;
+				NumInFlight.fetch_add(1);
+
+				int32 Depth = MaxQueueDepth.load(std::memory_order_relaxed);
+				while (Queue.Num() > Depth && !MaxQueueDepth.compare_exchange_weak(Depth, Queue.Num()))
+				{
+				}
+				break;
+			}
+		}
+
+		// Block policy, wait for a worker to take a frame
+		if (BlockStart == 0.0)
+		{
+			BlockStart = FPlatformTime::Seconds();
+		}
+		SpaceEvent->Wait(1);
+	}
+
+	if (BlockStart != 0.0)
+	{
+		BlockTimes.Add(FPlatformTime::Seconds() - BlockStart);
+	}
+
+	WorkEvent->Trigger();
+
+	if (Evicted.Frame.IsValid())
+	{
+		const FTimecode Timecode = Evicted.Frame->Timecode;
+		Evicted.Frame.Reset();
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+		Complete(Evicted.Sequence, Timecode, FString(), false);
+		NumInFlight.fetch_sub(1);
+	}
+	return true;
+}
+
+void FVPFrameWriter::Flush()
+{
+	while (NumInFlight.load() > 0)
+	{
+		WorkEvent->Trigger();
+		FPlatformProcess::SleepNoStats(0.001f);
+	}
+}
+
+bool FVPFrameWriter::IsIdle() const
+{
+	return NumInFlight.load() == 0;
+}
+
+FVPFrameWriterStats FVPFrameWriter::GetStats() const
+{
+	FVPFrameWriterStats Stats;
+	Stats.NumSubmitted = NumSubmitted.load(std::memory_order_relaxed);
+	Stats.NumWritten = NumWritten.load(std::memory_order_relaxed);
+	Stats.NumFailed = NumFailed.load(std::memory_order_relaxed);
+	Stats.NumDropped = NumDropped.load(std::memory_order_relaxed);
+	Stats.NumQueueFull = NumQueueFull.load(std::memory_order_relaxed);
+	Stats.MaxQueueDepth = MaxQueueDepth.load(std::memory_order_relaxed);
+	{
+		FScopeLock ScopeLock(&QueueLock);
+		Stats.QueueDepth = Queue.Num();
+	}
+	{
+		FScopeLock ScopeLock(&CompletionLock);
+		Stats.NumCompleted = NextCompletion;
+	}
+	return Stats;
+}
+
+bool FVPFrameWriter::PopJob(FJob& OutJob)
+{
+	{
+		FScopeLock ScopeLock(&QueueLock);
+		if (Queue.IsEmpty())
+			return false;
+
+		OutJob = MoveTemp(Queue[0]);
+		Queue.RemoveAt(0, 1, EAllowShrinking::No);
+	}
+
+	SpaceEvent->Trigger();
+	return true;
+}
+
+void FVPFrameWriter::Process(FJob& Job)
+{
+	const FVPFrameBuffer& Frame = *Job.Frame;
+	const FString Path = MakePath(Job);
+	const double Start = FPlatformTime::Seconds();
+
+	bool bSuccess = false;
+	if (Settings.Format == EVPFrameFileFormat::Raw)
+	{
+		TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+		bSuccess = File.IsValid() && File->Write(Frame.GetData(), Frame.GetSize());
+	}
+	else
+	{
+		// Pool frames are packed BGRA as read back from the capture
+		const FImageView View(const_cast<uint8*>(Frame.GetData()), Frame.Width, Frame.Height, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+		if (Settings.Format == EVPFrameFileFormat::Exr)
+		{
+			FImage Linear;
+			View.CopyTo(Linear, ERawImageFormat::RGBA16F, EGammaSpace::Linear);
+			bSuccess = FImageUtils::SaveImageByExtension(*Path, Linear);
+		}
+		else
+		{
+			bSuccess = FImageUtils::SaveImageByExtension(*Path, View);
+		}
+	}
+
+	EncodeTimes.Add(FPlatformTime::Seconds() - Start);
+	(bSuccess ? NumWritten : NumFailed).fetch_add(1, std::memory_order_relaxed);
+
+	// Back to the pool before waiting on the completion order
+	const FTimecode Timecode = Frame.Timecode;
+	Job.Frame.Reset();
+
+	Complete(Job.Sequence, Timecode, bSuccess ? Path : FString(), bSuccess);
+	NumInFlight.fetch_sub(1);
+}
+
+void FVPFrameWriter::Complete(uint64 Sequence, const FTimecode& Timecode, const FString& Path, bool bSuccess)
+{
+	FScopeLock ScopeLock(&CompletionLock);
+
+	PendingCompletions.Add(Sequence, MakeTuple(Timecode, Path, bSuccess));
+	while (TTuple<FTimecode, FString, bool>* Next = PendingCompletions.Find(NextCompletion))
+	{
+		OnFrameWritten.Broadcast(NextCompletion, Next->Get<0>(), Next->Get<1>(), Next->Get<2>());
+		PendingCompletions.Remove(NextCompletion);
+		++NextCompletion;
+	}
+}
+
+FString FVPFrameWriter::MakePath(const FJob& Job) const
+{
+	static const TCHAR* Extensions[] = { TEXT("png"), TEXT("exr"), TEXT("bgra") };
+
+	const TCHAR* Extension = Extensions[(int32)Settings.Format];
+	return Settings.Directory / (Job.Repeat == 0 ? FString::Printf(TEXT("%s.%07lld.%s"), *Settings.BaseName, Job.FileNumber, Extension)
+		: FString::Printf(TEXT("%s.%07lld_%d.%s"), *Settings.BaseName, Job.FileNumber, Job.Repeat, Extension));
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPFreeDPacket.h"
+
+namespace VPFreeD
+{
+	// Angles are sent in 1/32768 degree, positions in 1/64 mm
+	static constexpr double AngleScale = 32768.0;
+	static constexpr double PositionScale = 64.0 * 10.0;
+
+	static void WriteSigned24(uint8* Out, double Value)
+	{
+		const int32 Raw = FMath::Clamp((int32)FMath::RoundToInt(Value), -0x800000, 0x7FFFFF);
+		Out[0] = (uint8)((Raw >> 16) & 0xFF);
+		Out[1] = (uint8)((Raw >> 8) & 0xFF);
+		Out[2] = (uint8)(Raw & 0xFF);
+	}
+
+	static void WriteUnsigned24(uint8* Out, int32 Value)
+	{
+		const int32 Raw = FMath::Clamp(Value, 0, MaxEncoderValue);
+		Out[0] = (uint8)((Raw >> 16) & 0xFF);
+		Out[1] = (uint8)((Raw >> 8) & 0xFF);
+		Out[2] = (uint8)(Raw & 0xFF);
+	}
+
+	static int32 ReadSigned24(const uint8* In)
+	{
+		int32 Raw = ((int32)In[0] << 16) | ((int32)In[1] << 8) | (int32)In[2];
+		if (Raw & 0x800000)
+		{
+			Raw |= ~0xFFFFFF;
+		}
+		return Raw;
+	}
+
+	static int32 ReadUnsigned24(const uint8* In)
+	{
+		return ((int32)In[0] << 16) | ((int32)In[1] << 8) | (int32)In[2];
+	}
+
+	static uint8 Checksum(const uint8* Packet)
+	{
+		uint8 Sum = 0x40;
+		for (int32 Index = 0; Index < PacketSize - 1; ++Index)
+		{
+			Sum -= Packet[Index];
+		}
+		return Sum;
+	}
+}
+
+void VPFreeD::Encode(const FVPFreeDData& Data, uint8 (&OutPacket)[PacketSize])
+{
+	OutPacket[0] = MessageD1;
+	OutPacket[1] = Data.CameraId;
+	WriteSigned24(&OutPacket[2], Data.Pan * AngleScale);
+	WriteSigned24(&OutPacket[5], Data.Tilt * AngleScale);
+	WriteSigned24(&OutPacket[8], Data.Roll * AngleScale);
+	WriteSigned24(&OutPacket[11], Data.Position.Y * PositionScale);
+	WriteSigned24(&OutPacket[14], Data.Position.X * PositionScale);
+	WriteSigned24(&OutPacket[17], Data.Position.Z * PositionScale);
+	WriteUnsigned24(&OutPacket[20], Data.Zoom);
+	WriteUnsigned24(&OutPacket[23], Data.Focus);
+	OutPacket[26] = (uint8)(Data.User >> 8);
+	OutPacket[27] = (uint8)(Data.User & 0xFF);
+	OutPacket[28] = Checksum(OutPacket);
+}
+
+bool VPFreeD::Decode(const uint8* Packet, int32 Size, FVPFreeDData& OutData)
+{
+	if (Size < PacketSize || Packet[0] != MessageD1 || Packet[28] != Checksum(Packet))
+		return false;
+
+	OutData.CameraId = Packet[1];
+	OutData.Pan = ReadSigned24(&Packet[2]) / AngleScale;
+	OutData.Tilt = ReadSigned24(&Packet[5]) / AngleScale;
+	OutData.Roll = ReadSigned24(&Packet[8]) / AngleScale;
+	OutData.Position.Y = ReadSigned24(&Packet[11]) / PositionScale;
+	OutData.Position.X = ReadSigned24(&Packet[14]) / PositionScale;
+	OutData.Position.Z = ReadSigned24(&Packet[17]) / PositionScale;
+	OutData.Zoom = ReadUnsigned24(&Packet[20]);
+	OutData.Focus = ReadUnsigned24(&Packet[23]);
+	OutData.User = (uint16)((Packet[26] << 8) | Packet[27]);
+	return true;
+}
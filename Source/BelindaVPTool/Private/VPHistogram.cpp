@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPHistogram.h"
+
+void FVPHistogram::Add(double Seconds)
+{
+	const uint64 Microseconds = (uint64)FMath::Max(Seconds * 1.0e6, 0.0);
+
+	// Four buckets per power of two
+	int32 Bucket = 0;
+	if (Microseconds > 0)
+	{
+		Bucket = FMath::Clamp((int32)(FMath::Log2((double)Microseconds) * 4.0) + 1, 1, NumBuckets - 1);
+	}
+
+	Buckets[Bucket].fetch_add(1, std::memory_order_relaxed);
+	Count.fetch_add(1, std::memory_order_relaxed);
+	SumMicroseconds.fetch_add(Microseconds, std::memory_order_relaxed);
+
+	uint64 CurrentMax = MaxMicroseconds.load(std::memory_order_relaxed);
+	while (Microseconds > CurrentMax && !MaxMicroseconds.compare_exchange_weak(CurrentMax, Microseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void FVPHistogram::Reset()
+{
+	for (std::atomic<uint64>& Bucket : Buckets)
+	{
+		Bucket.store(0, std::memory_order_relaxed);
+	}
+	Count.store(0, std::memory_order_relaxed);
+	SumMicroseconds.store(0, std::memory_order_relaxed);
+	MaxMicroseconds.store(0, std::memory_order_relaxed);
+}
+
+double FVPHistogram::GetMean() const
+{
+	const uint64 NumValues = Num();
+	return NumValues > 0 ? (SumMicroseconds.load(std::memory_order_relaxed) * 1.0e-6) / NumValues : 0.0;
+}
+
+double FVPHistogram::GetPercentile(double Percentile) const
+{
+	const uint64 NumValues = Num();
+	if (NumValues == 0)
+		return 0.0;
+
+	const uint64 Target = (uint64)FMath::CeilToDouble(FMath::Clamp(Percentile, 0.0, 1.0) * NumValues);
+	uint64 Cumulated = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Cumulated += GetBucketCount(Bucket);
+		if (Cumulated >= Target)
+		{
+			return FMath::Min(GetBucketUpperBound(Bucket), GetMax());
+		}
+	}
+	return GetMax();
+}
+
+double FVPHistogram::GetBucketUpperBound(int32 Bucket)
+{
+	if (Bucket <= 0)
+		return 1.0e-6;
+
+	return FMath::Pow(2.0, Bucket / 4.0) * 1.0e-6;
+}
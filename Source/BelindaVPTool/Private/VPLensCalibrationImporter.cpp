@@ -0,0 +1,527 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLensCalibrationImporter.h"
+#include "Async/Async.h"
+#include "HAL/PlatformFileManager.h"
+
+namespace VPLensCalibrationImporter
+{
+	enum EField : int32
+	{
+		Zoom,
+		Focus,
+		FocalLength,
+		FocusDistance,
+		K1,
+		K2,
+		K3,
+		P1,
+		P2,
+		NodalX,
+		NodalY,
+		NodalZ,
+		NumFields,
+		Ignored = -1
+	};
+
+	static const ANSICHAR* FieldNames[NumFields] = { "zoom", "focus", "focallength", "focusdistance", "k1", "k2", "k3", "p1", "p2", "nodalx", "nodaly", "nodalz" };
+
+	static constexpr uint32 RequiredFields = (1u << Zoom) | (1u << Focus);
+
+	// Tolerance on the normalized zoom/focus range before a sample counts as out of range
+	static constexpr double RangeTolerance = 1.0e-3;
+
+	// Lower case letters and digits only, so "Focal Length", "focal_length" and "FocalLength" all match
+	static EField MatchField(const ANSICHAR* Begin, const ANSICHAR* End)
+	{
+		ANSICHAR Normalized[64];
+		int32 Length = 0;
+		for (const ANSICHAR* It = Begin; It < End && Length < UE_ARRAY_COUNT(Normalized) - 1; ++It)
+		{
+			if (FCharAnsi::IsAlnum(*It))
+			{
+				Normalized[Length++] = FCharAnsi::ToLower(*It);
+			}
+		}
+		Normalized[Length] = 0;
+
+		for (int32 Field = 0; Field < NumFields; ++Field)
+		{
+			if (FCStringAnsi::Strcmp(Normalized, FieldNames[Field]) == 0)
+				return (EField)Field;
+		}
+		return Ignored;
+	}
+
+	static bool ParseNumber(const ANSICHAR* Begin, const ANSICHAR* End, double& OutValue)
+	{
+		while (Begin < End && (FCharAnsi::IsWhitespace(*Begin) || *Begin == '"'))
+		{
+			++Begin;
+		}
+		while (End > Begin && (FCharAnsi::IsWhitespace(End[-1]) || End[-1] == '"'))
+		{
+			--End;
+		}
+
+		ANSICHAR Buffer[64];
+		const int32 Length = (int32)(End - Begin);
+		if (Length <= 0 || Length >= UE_ARRAY_COUNT(Buffer) || !(FCharAnsi::IsDigit(*Begin) || *Begin == '-' || *Begin == '+' || *Begin == '.'))
+			return false;
+
+		FMemory::Memcpy(Buffer, Begin, Length);
+		Buffer[Length] = 0;
+		OutValue = FCStringAnsi::Atod(Buffer);
+		return true;
+	}
+
+	struct FBin
+	{
+		double Sum[NumFields] = {};
+		uint32 Count[NumFields] = {};
+	};
+
+	struct FAccumulator
+	{
+		explicit FAccumulator(int32 InNumBins)
+			: NumBins(InNumBins)
+		{
+			Bins.SetNum(NumBins * NumBins);
+		}
+
+		void AddSample(double Values[NumFields], uint32 Present, double InvEncoderMax)
+		{
+			// Objects or lines with nothing we know about (metadata, blank lines) aren't samples
+			if (Present == 0)
+				return;
+
+			++NumSamples;
+			if ((Present & RequiredFields) != RequiredFields)
+			{
+				++NumRejected;
+				return;
+			}
+
+			Values[Zoom] *= InvEncoderMax;
+			Values[Focus] *= InvEncoderMax;
+			for (int32 Field = 0; Field < NumFields; ++Field)
+			{
+				if ((Present & (1u << Field)) && !FMath::IsFinite(Values[Field]))
+				{
+					++NumRejected;
+					return;
+				}
+			}
+
+			const bool bOutOfRange = Values[Zoom] < -RangeTolerance || Values[Zoom] > 1.0 + RangeTolerance || Values[Focus] < -RangeTolerance || Values[Focus] > 1.0 + RangeTolerance;
+			const bool bBadLens = ((Present & (1u << FocalLength)) && Values[FocalLength] <= 0.0) || ((Present & (1u << FocusDistance)) && Values[FocusDistance] <= 0.0);
+			if (bOutOfRange || bBadLens)
+			{
+				++NumRejected;
+				return;
+			}
+
+			Values[Zoom] = FMath::Clamp(Values[Zoom], 0.0, 1.0);
+			Values[Focus] = FMath::Clamp(Values[Focus], 0.0, 1.0);
+			const int32 ZoomBin = FMath::Min((int32)(Values[Zoom] * NumBins), NumBins - 1);
+			const int32 FocusBin = FMath::Min((int32)(Values[Focus] * NumBins), NumBins - 1);
+
+			FBin& Bin = Bins[FocusBin * NumBins + ZoomBin];
+			for (int32 Field = 0; Field < NumFields; ++Field)
+			{
+				if (Present & (1u << Field))
+				{
+					Bin.Sum[Field] += Values[Field];
+					++Bin.Count[Field];
+				}
+			}
+		}
+
+		void Merge(const FAccumulator& Other)
+		{
+			NumSamples += Other.NumSamples;
+			NumRejected += Other.NumRejected;
+			for (int32 Index = 0; Index < Bins.Num(); ++Index)
+			{
+				for (int32 Field = 0; Field < NumFields; ++Field)
+				{
+					Bins[Index].Sum[Field] += Other.Bins[Index].Sum[Field];
+					Bins[Index].Count[Field] += Other.Bins[Index].Count[Field];
+				}
+			}
+		}
+
+		int32 NumBins;
+		TArray<FBin> Bins;
+		int64 NumSamples = 0;
+		int64 NumRejected = 0;
+	};
+
+	struct FCsvLayout
+	{
+		TArray<EField> Columns;
+		ANSICHAR Delimiter = ',';
+	};
+
+	static void ParseCsv(const ANSICHAR* Begin, const ANSICHAR* End, const FCsvLayout& Layout, double InvEncoderMax, FAccumulator& Out)
+	{
+		const ANSICHAR* Line = Begin;
+		while (Line < End)
+		{
+			const ANSICHAR* LineEnd = Line;
+			while (LineEnd < End && *LineEnd != '\n')
+			{
+				++LineEnd;
+			}
+
+			double Values[NumFields] = {};
+			uint32 Present = 0;
+			const ANSICHAR* Field = Line;
+			for (int32 Column = 0; Column < Layout.Columns.Num() && Field <= LineEnd; ++Column)
+			{
+				const ANSICHAR* FieldEnd = Field;
+				while (FieldEnd < LineEnd && *FieldEnd != Layout.Delimiter)
+				{
+					++FieldEnd;
+				}
+
+				const EField Target = Layout.Columns[Column];
+				double Value;
+				if (Target != Ignored && ParseNumber(Field, FieldEnd, Value))
+				{
+					Values[Target] = Value;
+					Present |= 1u << Target;
+				}
+				Field = FieldEnd + 1;
+			}
+
+			Out.AddSample(Values, Present, InvEncoderMax);
+			Line = LineEnd + 1;
+		}
+	}
+
+	static const ANSICHAR* SkipString(const ANSICHAR* Quote, const ANSICHAR* End)
+	{
+		const ANSICHAR* It = Quote + 1;
+		while (It < End && *It != '"')
+		{
+			It += *It == '\\' ? 2 : 1;
+		}
+		return FMath::Min(It, End);
+	}
+
+	// Flat object body between its braces
+	static void ParseJsonObject(const ANSICHAR* Begin, const ANSICHAR* End, double InvEncoderMax, FAccumulator& Out)
+	{
+		double Values[NumFields] = {};
+		uint32 Present = 0;
+
+		const ANSICHAR* It = Begin;
+		while (It < End)
+		{
+			while (It < End && *It != '"')
+			{
+				++It;
+			}
+			if (It >= End)
+				break;
+
+			const ANSICHAR* KeyBegin = It + 1;
+			const ANSICHAR* KeyEnd = SkipString(It, End);
+
+			It = KeyEnd + 1;
+			while (It < End && *It != ':')
+			{
+				++It;
+			}
+			const ANSICHAR* ValueBegin = It + 1;
+
+			const ANSICHAR* ValueEnd = ValueBegin;
+			while (ValueEnd < End && FCharAnsi::IsWhitespace(*ValueEnd))
+			{
+				++ValueEnd;
+			}
+			if (ValueEnd < End && *ValueEnd == '"')
+			{
+				ValueEnd = SkipString(ValueEnd, End) + 1;
+			}
+			while (ValueEnd < End && *ValueEnd != ',')
+			{
+				++ValueEnd;
+			}
+
+			const EField Target = MatchField(KeyBegin, KeyEnd);
+			double Value;
+			if (Target != Ignored && ParseNumber(ValueBegin, FMath::Min(ValueEnd, End), Value))
+			{
+				Values[Target] = Value;
+				Present |= 1u << Target;
+			}
+			It = ValueEnd + 1;
+		}
+
+		Out.AddSample(Values, Present, InvEncoderMax);
+	}
+
+	static void ParseJson(const ANSICHAR* Begin, const ANSICHAR* End, double InvEncoderMax, FAccumulator& Out)
+	{
+		const ANSICHAR* It = Begin;
+		while (It < End)
+		{
+			while (It < End && *It != '{')
+			{
+				It = *It == '"' ? SkipString(It, End) + 1 : It + 1;
+			}
+			if (It >= End)
+				break;
+
+			// Wrapper objects restart the search at the innermost object, which is the sample
+			const ANSICHAR* Open = It;
+			const ANSICHAR* Close = It + 1;
+			while (Close < End && *Close != '}')
+			{
+				if (*Close == '{')
+				{
+					Open = Close;
+				}
+				Close = *Close == '"' ? SkipString(Close, End) + 1 : Close + 1;
+			}
+			if (Close >= End)
+				break;
+
+			ParseJsonObject(Open + 1, Close, InvEncoderMax, Out);
+			It = Close + 1;
+		}
+	}
+
+	// Offset of the last brace closing an object, braces inside string values don't count
+	static int32 FindLastJsonRecordEnd(const ANSICHAR* Begin, const ANSICHAR* End)
+	{
+		int32 Last = INDEX_NONE;
+		for (const ANSICHAR* It = Begin; It < End; It = *It == '"' ? SkipString(It, End) + 1 : It + 1)
+		{
+			if (*It == '}')
+			{
+				Last = (int32)(It - Begin);
+			}
+		}
+		return Last;
+	}
+
+	static bool ParseCsvHeader(const ANSICHAR* Begin, const ANSICHAR* End, FCsvLayout& OutLayout)
+	{
+		int32 Commas = 0;
+		int32 Semicolons = 0;
+		int32 Tabs = 0;
+		for (const ANSICHAR* It = Begin; It < End; ++It)
+		{
+			Commas += *It == ',';
+			Semicolons += *It == ';';
+			Tabs += *It == '\t';
+		}
+		OutLayout.Delimiter = Tabs > Commas && Tabs > Semicolons ? '\t' : Semicolons > Commas ? ';' : ',';
+
+		uint32 Found = 0;
+		const ANSICHAR* Field = Begin;
+		while (Field <= End)
+		{
+			const ANSICHAR* FieldEnd = Field;
+			while (FieldEnd < End && *FieldEnd != OutLayout.Delimiter)
+			{
+				++FieldEnd;
+			}
+
+			const EField Column = MatchField(Field, FieldEnd);
+			OutLayout.Columns.Add(Column);
+			if (Column != Ignored)
+			{
+				Found |= 1u << Column;
+			}
+			Field = FieldEnd + 1;
+		}
+		return (Found & RequiredFields) == RequiredFields;
+	}
+}
+
+bool FVPLensCalibrationImporter::Import(const FString& SourcePath, const FVPLensImportOptions& Options, TArray<FVPLensCalibrationPoint>& OutPoints, FVPLensImportResult& OutResult)
+{
+	using namespace VPLensCalibrationImporter;
+
+	const double StartTime = FPlatformTime::Seconds();
+	OutResult = FVPLensImportResult();
+	OutPoints.Reset();
+
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*SourcePath));
+	if (!File.IsValid())
+	{
+		OutResult.Error = FString::Printf(TEXT("Can't open %s"), *SourcePath);
+		return false;
+	}
+
+	const int32 NumBins = FMath::Clamp(Options.Bins, 2, 256);
+	const int64 ChunkSize = (int64)FMath::Max(Options.ChunkSizeKB, 64) * 1024;
+	const double InvEncoderMax = 1.0 / FMath::Max((double)Options.EncoderMax, 1.0e-6);
+	const int32 MaxInFlight = FMath::Max(FPlatformMisc::NumberOfWorkerThreadsToSpawn(), 2);
+
+	int64 Remaining = File->Size();
+	TArray<ANSICHAR> Pending;
+	auto ReadMore = [&File, &Remaining, &Pending, ChunkSize]()
+		{
+			const int32 ToRead = (int32)FMath::Min(ChunkSize, Remaining);
+			const int32 Offset = Pending.Num();
+			Pending.AddUninitialized(ToRead);
+			if (!File->Read(reinterpret_cast<uint8*>(Pending.GetData() + Offset), ToRead))
+				return false;
+
+			Remaining -= ToRead;
+			return true;
+		};
+
+	if (!ReadMore())
+	{
+		OutResult.Error = FString::Printf(TEXT("Can't read %s"), *SourcePath);
+		return false;
+	}
+
+	// UTF-8 BOM
+	if (Pending.Num() >= 3 && (uint8)Pending[0] == 0xEF && (uint8)Pending[1] == 0xBB && (uint8)Pending[2] == 0xBF)
+	{
+		Pending.RemoveAt(0, 3, EAllowShrinking::No);
+	}
+
+	int32 FirstChar = 0;
+	while (FirstChar < Pending.Num() && FCharAnsi::IsWhitespace(Pending[FirstChar]))
+	{
+		++FirstChar;
+	}
+	const bool bJson = FirstChar < Pending.Num() && (Pending[FirstChar] == '{' || Pending[FirstChar] == '[');
+
+	FCsvLayout Layout;
+	if (!bJson)
+	{
+		int32 HeaderEnd = INDEX_NONE;
+		while (!Pending.Find('\n', HeaderEnd) && Remaining > 0 && ReadMore())
+		{
+		}
+		if (HeaderEnd == INDEX_NONE)
+		{
+			HeaderEnd = Pending.Num();
+		}
+
+		if (!ParseCsvHeader(Pending.GetData(), Pending.GetData() + HeaderEnd, Layout))
+		{
+			OutResult.Error = FString::Printf(TEXT("%s has no Zoom and Focus columns"), *SourcePath);
+			return false;
+		}
+		Pending.RemoveAt(0, FMath::Min(HeaderEnd + 1, Pending.Num()), EAllowShrinking::No);
+	}
+
+	// Chunks are handed to the thread pool as they are read, at most MaxInFlight of them are held at once
+	FAccumulator Total(NumBins);
+	TArray<TFuture<TUniquePtr<FAccumulator>>> InFlight;
+	auto Launch = [&](TArray<ANSICHAR>&& Chunk)
+		{
+			if (InFlight.Num() >= MaxInFlight)
+			{
+				Total.Merge(*InFlight[0].Get());
+				InFlight.RemoveAt(0);
+			}
+
+			InFlight.Add(Async(EAsyncExecution::ThreadPool, [Chunk = MoveTemp(Chunk), Layout, bJson, InvEncoderMax, NumBins]()
+				{
+					TUniquePtr<FAccumulator> Accumulator = MakeUnique<FAccumulator>(NumBins);
+					const ANSICHAR* Begin = Chunk.GetData();
+					if (bJson)
+					{
+						ParseJson(Begin, Begin + Chunk.Num(), InvEncoderMax, *Accumulator);
+					}
+					else
+					{
+						ParseCsv(Begin, Begin + Chunk.Num(), Layout, InvEncoderMax, *Accumulator);
+					}
+					return Accumulator;
+				}));
+		};
+
+	bool bReadError = false;
+	while (true)
+	{
+		const bool bEndOfFile = Remaining == 0;
+
+		// Everything up to the last complete record goes, the partial one waits for the next read.
+		// Pending always starts on a record boundary, so the JSON scan starts outside any string.
+		int32 Cut = Pending.Num();
+		if (!bEndOfFile)
+		{
+			int32 LastRecordEnd = INDEX_NONE;
+			if (bJson)
+			{
+				LastRecordEnd = FindLastJsonRecordEnd(Pending.GetData(), Pending.GetData() + Pending.Num());
+			}
+			else
+			{
+				Pending.FindLast('\n', LastRecordEnd);
+			}
+			Cut = LastRecordEnd + 1;
+		}
+
+		if (Cut > 0)
+		{
+			Launch(TArray<ANSICHAR>(Pending.GetData(), Cut));
+			Pending.RemoveAt(0, Cut, EAllowShrinking::No);
+		}
+
+		if (bEndOfFile)
+			break;
+
+		if (!ReadMore())
+		{
+			bReadError = true;
+			break;
+		}
+	}
+
+	for (TFuture<TUniquePtr<FAccumulator>>& Future : InFlight)
+	{
+		Total.Merge(*Future.Get());
+	}
+
+	if (bReadError)
+	{
+		OutResult.Error = FString::Printf(TEXT("Read error in %s"), *SourcePath);
+		return false;
+	}
+
+	for (int32 Index = 0; Index < Total.Bins.Num(); ++Index)
+	{
+		const FBin& Bin = Total.Bins[Index];
+		if (Bin.Count[Zoom] == 0)
+			continue;
+
+		auto Mean = [&Bin](EField Field) { return Bin.Count[Field] > 0 ? (float)(Bin.Sum[Field] / Bin.Count[Field]) : 0.0f; };
+
+		FVPLensCalibrationPoint& Point = OutPoints.AddDefaulted_GetRef();
+		Point.Zoom = Mean(Zoom);
+		Point.Focus = Mean(Focus);
+		Point.FocalLength = Mean(FocalLength);
+		Point.FocusDistance = Mean(FocusDistance);
+		Point.K1 = Mean(K1);
+		Point.K2 = Mean(K2);
+		Point.K3 = Mean(K3);
+		Point.P1 = Mean(P1);
+		Point.P2 = Mean(P2);
+		Point.NodalShift = FVector3f(Mean(NodalX), Mean(NodalY), Mean(NodalZ));
+	}
+
+	OutResult.NumSamples = Total.NumSamples;
+	OutResult.NumRejected = Total.NumRejected;
+	OutResult.NumPoints = OutPoints.Num();
+	OutResult.Seconds = (float)(FPlatformTime::Seconds() - StartTime);
+	OutResult.bSuccess = OutPoints.Num() > 0;
+	if (!OutResult.bSuccess)
+	{
+		OutResult.Error = FString::Printf(TEXT("No valid samples in %s (%lld rejected)"), *SourcePath, Total.NumRejected);
+	}
+	return OutResult.bSuccess;
+}
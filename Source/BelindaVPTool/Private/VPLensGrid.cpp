@@ -0,0 +1,351 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLensGrid.h"
+#include "Math/VectorRegister.h"
+#include "HAL/FileManager.h"
+#include "Serialization/Archive.h"
+
+namespace VPLensGrid
+{
+	static constexpr uint32 FileMagic = 0x4C505642; // BVPL
+	static constexpr uint32 FileVersion = 1;
+	// Zoom, focus, focal length, focus distance, five distortion coefficients and the nodal shift
+	static constexpr int64 PointBytes = 12 * sizeof(float);
+
+	static constexpr int32 NumRegisters = sizeof(FVPLensGridSample) / sizeof(VectorRegister4Float);
+
+	static float FieldOfView(float SensorSize, float FocalLength)
+	{
+		return FocalLength > 0.0f ? FMath::RadiansToDegrees(2.0f * FMath::Atan(SensorSize / (2.0f * FocalLength))) : 0.0f;
+	}
+
+	// Cell index and fraction along one axis, the last cell is never the lower one so Index + 1 stays valid
+	static void Locate(float Normalized, int32 Steps, int32& OutIndex, float& OutFraction)
+	{
+		const float Position = FMath::Clamp(Normalized, 0.0f, 1.0f) * (Steps - 1);
+		OutIndex = FMath::Min(FMath::FloorToInt32(Position), Steps - 2);
+		OutFraction = Position - OutIndex;
+	}
+
+	// Grid nodes blend this many of their nearest points. The weights fade out at the next nearest point,
+	// so the grid stays continuous where the set of neighbours changes.
+	static constexpr int32 NumNeighbours = 8;
+
+	// Squared normalized distance under which a node takes the point's values as they are
+	static constexpr double CoincidentDistanceSquared = 1e-10;
+
+	// Weighted sums in double, float accumulators lose the small weights next to a close point
+	struct FBlend
+	{
+		double Weight = 0.0;
+		double FocalLength = 0.0;
+		double FocusDistance = 0.0;
+		double K1 = 0.0;
+		double K2 = 0.0;
+		double K3 = 0.0;
+		double P1 = 0.0;
+		double P2 = 0.0;
+		FVector3d NodalShift = FVector3d::ZeroVector;
+
+		void Add(const FVPLensCalibrationPoint& Point, double PointWeight)
+		{
+			Weight += PointWeight;
+			FocalLength += PointWeight * Point.FocalLength;
+			FocusDistance += PointWeight * Point.FocusDistance;
+			K1 += PointWeight * Point.K1;
+			K2 += PointWeight * Point.K2;
+			K3 += PointWeight * Point.K3;
+			P1 += PointWeight * Point.P1;
+			P2 += PointWeight * Point.P2;
+			NodalShift += PointWeight * FVector3d(Point.NodalShift);
+		}
+	};
+
+	static void CopyPoint(const FVPLensCalibrationPoint& Point, FVPLensGridSample& OutSample)
+	{
+		OutSample.FocalLength = Point.FocalLength;
+		OutSample.FocusDistance = Point.FocusDistance;
+		OutSample.K1 = Point.K1;
+		OutSample.K2 = Point.K2;
+		OutSample.K3 = Point.K3;
+		OutSample.P1 = Point.P1;
+		OutSample.P2 = Point.P2;
+		OutSample.NodalShift = Point.NodalShift;
+	}
+
+	static void CatmullRomWeights(float T, float OutWeights[4])
+	{
+		OutWeights[0] = 0.5f * ((-T + 2.0f) * T - 1.0f) * T;
+		OutWeights[1] = 0.5f * ((3.0f * T - 5.0f) * T * T + 2.0f);
+		OutWeights[2] = 0.5f * ((-3.0f * T + 4.0f) * T + 1.0f) * T;
+		OutWeights[3] = 0.5f * (T - 1.0f) * T * T;
+	}
+}
+
+void FVPCompiledLens::Compile(const FVPLensSettings& InLens, TArrayView<const FVPLensCalibrationPoint> Points, int32 InZoomSteps, int32 InFocusSteps)
+{
+	Lens = InLens;
+	ZoomSteps = FMath::Max(InZoomSteps, 2);
+	FocusSteps = FMath::Max(InFocusSteps, 2);
+	Cells.SetNumUninitialized(ZoomSteps * FocusSteps);
+
+	// Points missing a focal length or focus distance take the value the lens ranges give at their position
+	TArray<FVPLensCalibrationPoint> Resolved(Points.GetData(), Points.Num());
+	for (FVPLensCalibrationPoint& Point : Resolved)
+	{
+		Point.FocalLength = Point.FocalLength > 0.0f ? Point.FocalLength : Lens.MapFocalLength(Point.Zoom);
+		Point.FocusDistance = Point.FocusDistance > 0.0f ? Point.FocusDistance : Lens.MapFocusDistance(Point.Focus);
+	}
+
+	for (int32 FocusIndex = 0; FocusIndex < FocusSteps; ++FocusIndex)
+	{
+		const float Focus = (float)FocusIndex / (FocusSteps - 1);
+		for (int32 ZoomIndex = 0; ZoomIndex < ZoomSteps; ++ZoomIndex)
+		{
+			const float Zoom = (float)ZoomIndex / (ZoomSteps - 1);
+
+			FVPLensGridSample& Sample = Cells[FocusIndex * ZoomSteps + ZoomIndex];
+			Sample = FVPLensGridSample();
+			Sample.FocalLength = Lens.MapFocalLength(Zoom);
+			Sample.FocusDistance = Lens.MapFocusDistance(Focus);
+
+			if (Resolved.Num() > 0)
+			{
+				// Nearest points first, one more than the blended ones to know where their weights fade out
+				TArray<TPair<double, int32>, TInlineAllocator<VPLensGrid::NumNeighbours + 1>> Nearest;
+				for (int32 PointIndex = 0; PointIndex < Resolved.Num(); ++PointIndex)
+				{
+					const FVPLensCalibrationPoint& Point = Resolved[PointIndex];
+					const double DistanceSquared = FMath::Square((double)Zoom - Point.Zoom) + FMath::Square((double)Focus - Point.Focus);
+					if (Nearest.Num() > VPLensGrid::NumNeighbours && DistanceSquared >= Nearest.Last().Key)
+						continue;
+
+					int32 Insert = Nearest.Num();
+					while (Insert > 0 && Nearest[Insert - 1].Key > DistanceSquared)
+					{
+						--Insert;
+					}
+					Nearest.Insert(TPair<double, int32>(DistanceSquared, PointIndex), Insert);
+					if (Nearest.Num() > VPLensGrid::NumNeighbours + 1)
+					{
+						Nearest.Pop(EAllowShrinking::No);
+					}
+				}
+
+				if (Nearest[0].Key <= VPLensGrid::CoincidentDistanceSquared)
+				{
+					VPLensGrid::CopyPoint(Resolved[Nearest[0].Value], Sample);
+				}
+				else
+				{
+					const int32 NumBlended = FMath::Min(Nearest.Num(), VPLensGrid::NumNeighbours);
+					const double Radius = Nearest.Num() > VPLensGrid::NumNeighbours ? FMath::Sqrt(Nearest.Last().Key) : 0.0;
+
+					// Franke-Little weights inside the radius, plain inverse square when every point is used
+					VPLensGrid::FBlend Blend;
+					for (int32 Index = 0; Index < NumBlended; ++Index)
+					{
+						const double Distance = FMath::Sqrt(Nearest[Index].Key);
+						const double Weight = Radius > 0.0 ? FMath::Square(FMath::Max(Radius - Distance, 0.0) / (Radius * Distance)) : 1.0 / Nearest[Index].Key;
+						Blend.Add(Resolved[Nearest[Index].Value], Weight);
+					}
+
+					// All the neighbours as far as the next point, nothing fades then
+					if (Blend.Weight <= 0.0)
+					{
+						Blend = VPLensGrid::FBlend();
+						for (int32 Index = 0; Index < NumBlended; ++Index)
+						{
+							Blend.Add(Resolved[Nearest[Index].Value], 1.0 / Nearest[Index].Key);
+						}
+					}
+
+					const double Normalize = 1.0 / Blend.Weight;
+					Sample.FocalLength = (float)(Blend.FocalLength * Normalize);
+					Sample.FocusDistance = (float)(Blend.FocusDistance * Normalize);
+					Sample.K1 = (float)(Blend.K1 * Normalize);
+					Sample.K2 = (float)(Blend.K2 * Normalize);
+					Sample.K3 = (float)(Blend.K3 * Normalize);
+					Sample.P1 = (float)(Blend.P1 * Normalize);
+					Sample.P2 = (float)(Blend.P2 * Normalize);
+					Sample.NodalShift = FVector3f(Blend.NodalShift * Normalize);
+				}
+			}
+
+			Sample.HorizontalFOV = VPLensGrid::FieldOfView(Lens.SensorWidth, Sample.FocalLength);
+			Sample.VerticalFOV = VPLensGrid::FieldOfView(Lens.SensorHeight, Sample.FocalLength);
+		}
+	}
+}
+
+void FVPCompiledLens::EvaluateBilinear(float Zoom, float Focus, FVPLensGridSample& OutSample) const
+{
+	int32 ZoomIndex, FocusIndex;
+	float ZoomFraction, FocusFraction;
+	VPLensGrid::Locate(Zoom, ZoomSteps, ZoomIndex, ZoomFraction);
+	VPLensGrid::Locate(Focus, FocusSteps, FocusIndex, FocusFraction);
+
+	const float* Corners[4] =
+	{
+		reinterpret_cast<const float*>(&Cell(ZoomIndex, FocusIndex)),
+		reinterpret_cast<const float*>(&Cell(ZoomIndex + 1, FocusIndex)),
+		reinterpret_cast<const float*>(&Cell(ZoomIndex, FocusIndex + 1)),
+		reinterpret_cast<const float*>(&Cell(ZoomIndex + 1, FocusIndex + 1)),
+	};
+	const VectorRegister4Float Weights[4] =
+	{
+		VectorSetFloat1((1.0f - ZoomFraction) * (1.0f - FocusFraction)),
+		VectorSetFloat1(ZoomFraction * (1.0f - FocusFraction)),
+		VectorSetFloat1((1.0f - ZoomFraction) * FocusFraction),
+		VectorSetFloat1(ZoomFraction * FocusFraction),
+	};
+
+	float* Out = reinterpret_cast<float*>(&OutSample);
+	for (int32 Register = 0; Register < VPLensGrid::NumRegisters; ++Register)
+	{
+		const int32 Offset = Register * 4;
+		VectorRegister4Float Value = VectorMultiply(VectorLoad(Corners[0] + Offset), Weights[0]);
+		Value = VectorMultiplyAdd(VectorLoad(Corners[1] + Offset), Weights[1], Value);
+		Value = VectorMultiplyAdd(VectorLoad(Corners[2] + Offset), Weights[2], Value);
+		Value = VectorMultiplyAdd(VectorLoad(Corners[3] + Offset), Weights[3], Value);
+		VectorStore(Value, Out + Offset);
+	}
+}
+
+void FVPCompiledLens::EvaluateBicubic(float Zoom, float Focus, FVPLensGridSample& OutSample) const
+{
+	int32 ZoomIndex, FocusIndex;
+	float ZoomFraction, FocusFraction;
+	VPLensGrid::Locate(Zoom, ZoomSteps, ZoomIndex, ZoomFraction);
+	VPLensGrid::Locate(Focus, FocusSteps, FocusIndex, FocusFraction);
+
+	float ZoomWeights[4];
+	float FocusWeights[4];
+	VPLensGrid::CatmullRomWeights(ZoomFraction, ZoomWeights);
+	VPLensGrid::CatmullRomWeights(FocusFraction, FocusWeights);
+
+	VectorRegister4Float Values[VPLensGrid::NumRegisters] = { VectorZeroFloat(), VectorZeroFloat(), VectorZeroFloat() };
+	for (int32 FocusTap = 0; FocusTap < 4; ++FocusTap)
+	{
+		const int32 Row = FMath::Clamp(FocusIndex - 1 + FocusTap, 0, FocusSteps - 1);
+		for (int32 ZoomTap = 0; ZoomTap < 4; ++ZoomTap)
+		{
+			const int32 Column = FMath::Clamp(ZoomIndex - 1 + ZoomTap, 0, ZoomSteps - 1);
+			const float* Source = reinterpret_cast<const float*>(&Cell(Column, Row));
+			const VectorRegister4Float Weight = VectorSetFloat1(ZoomWeights[ZoomTap] * FocusWeights[FocusTap]);
+			for (int32 Register = 0; Register < VPLensGrid::NumRegisters; ++Register)
+			{
+				Values[Register] = VectorMultiplyAdd(VectorLoad(Source + Register * 4), Weight, Values[Register]);
+			}
+		}
+	}
+
+	float* Out = reinterpret_cast<float*>(&OutSample);
+	for (int32 Register = 0; Register < VPLensGrid::NumRegisters; ++Register)
+	{
+		VectorStore(Values[Register], Out + Register * 4);
+	}
+}
+
+void FVPCompiledLens::EvaluateBatch(TArrayView<const FVector2f> ZoomFocus, TArrayView<FVPLensGridSample> OutSamples, bool bBicubic) const
+{
+	check(ZoomFocus.Num() == OutSamples.Num());
+
+	for (int32 Index = 0; Index < ZoomFocus.Num(); ++Index)
+	{
+		if (bBicubic)
+		{
+			EvaluateBicubic(ZoomFocus[Index].X, ZoomFocus[Index].Y, OutSamples[Index]);
+		}
+		else
+		{
+			EvaluateBilinear(ZoomFocus[Index].X, ZoomFocus[Index].Y, OutSamples[Index]);
+		}
+	}
+}
+
+bool FVPCompiledLens::Save(const FString& FilePath, TArrayView<const FVPLensCalibrationPoint> Points) const
+{
+	if (!IsValid())
+		return false;
+
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Ar.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Can't write lens file %s"), *FilePath);
+		return false;
+	}
+
+	uint32 Magic = VPLensGrid::FileMagic;
+	uint32 Version = VPLensGrid::FileVersion;
+	FVPLensSettings SavedLens = Lens;
+	int32 SavedZoomSteps = ZoomSteps;
+	int32 SavedFocusSteps = FocusSteps;
+	int32 NumPoints = Points.Num();
+
+	*Ar << Magic << Version;
+	*Ar << SavedLens.SensorName << SavedLens.SensorWidth << SavedLens.SensorHeight << SavedLens.MinFocalLength << SavedLens.MaxFocalLength
+		<< SavedLens.MinFStop << SavedLens.MaxFStop << SavedLens.MinFocusDistance << SavedLens.MaxFocusDistance;
+	*Ar << SavedZoomSteps << SavedFocusSteps << NumPoints;
+	Ar->Serialize(const_cast<FVPLensGridSample*>(Cells.GetData()), Cells.Num() * sizeof(FVPLensGridSample));
+
+	for (FVPLensCalibrationPoint Point : Points)
+	{
+		*Ar << Point.Zoom << Point.Focus << Point.FocalLength << Point.FocusDistance << Point.K1 << Point.K2 << Point.K3 << Point.P1 << Point.P2 << Point.NodalShift;
+	}
+
+	return Ar->Close();
+}
+
+bool FVPCompiledLens::Load(const FString& FilePath, TArray<FVPLensCalibrationPoint>& OutPoints)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileReader(*FilePath, FILEREAD_Silent));
+	if (!Ar.IsValid())
+		return false;
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Ar << Magic << Version;
+	if (Magic != VPLensGrid::FileMagic || Version != VPLensGrid::FileVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is not a lens file this version can read"), *FilePath);
+		return false;
+	}
+
+	FVPLensSettings LoadedLens;
+	LoadedLens.bEnabled = true;
+	int32 LoadedZoomSteps = 0;
+	int32 LoadedFocusSteps = 0;
+	int32 NumPoints = 0;
+	*Ar << LoadedLens.SensorName << LoadedLens.SensorWidth << LoadedLens.SensorHeight << LoadedLens.MinFocalLength << LoadedLens.MaxFocalLength
+		<< LoadedLens.MinFStop << LoadedLens.MaxFStop << LoadedLens.MinFocusDistance << LoadedLens.MaxFocusDistance;
+	*Ar << LoadedZoomSteps << LoadedFocusSteps << NumPoints;
+
+	// Sizes are checked against what is left of the file before anything is allocated from them
+	const int64 CellBytes = (int64)LoadedZoomSteps * LoadedFocusSteps * sizeof(FVPLensGridSample);
+	const int64 PointsBytes = NumPoints * VPLensGrid::PointBytes;
+	if (LoadedZoomSteps < 2 || LoadedFocusSteps < 2 || NumPoints < 0 || Ar->TotalSize() - Ar->Tell() < CellBytes + PointsBytes)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is truncated or corrupt"), *FilePath);
+		return false;
+	}
+
+	TArray<FVPLensGridSample> LoadedCells;
+	LoadedCells.SetNumUninitialized(LoadedZoomSteps * LoadedFocusSteps);
+	Ar->Serialize(LoadedCells.GetData(), CellBytes);
+
+	OutPoints.SetNum(NumPoints);
+	for (FVPLensCalibrationPoint& Point : OutPoints)
+	{
+		*Ar << Point.Zoom << Point.Focus << Point.FocalLength << Point.FocusDistance << Point.K1 << Point.K2 << Point.K3 << Point.P1 << Point.P2 << Point.NodalShift;
+	}
+	if (Ar->IsError())
+		return false;
+
+	Lens = LoadedLens;
+	ZoomSteps = LoadedZoomSteps;
+	FocusSteps = LoadedFocusSteps;
+	Cells = MoveTemp(LoadedCells);
+	return true;
+}
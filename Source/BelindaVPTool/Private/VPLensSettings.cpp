@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLensSettings.h"
+#include "Engine/DataTable.h"
+#include "UObject/UnrealType.h"
+
+namespace VPLensSettings
+{
+	// Blueprint struct members carry a suffix after their display name, e.g. MaxFStop_19_DC21C76F...
+	static bool MatchesField(const FProperty* Property, const TCHAR* FieldName)
+	{
+		const FString PropertyName = Property->GetName();
+		const int32 FieldLength = FCString::Strlen(FieldName);
+		return PropertyName.StartsWith(FieldName) && (PropertyName.Len() == FieldLength || PropertyName[FieldLength] == TEXT('_'));
+	}
+}
+
+bool FVPLensSettings::FromDataTableRow(const UDataTable* Table, FName RowName, FVPLensSettings& OutSettings)
+{
+	if (!Table || !Table->GetRowStruct())
+		return false;
+
+	const uint8* Row = Table->FindRowUnchecked(RowName);
+	if (!Row)
+		return false;
+
+	// A sparser row than the previous one must not inherit its values
+	OutSettings = FVPLensSettings();
+
+	struct FNumericField
+	{
+		const TCHAR* Name;
+		float* Value;
+	};
+	// The table spells focal length "Focallenght"
+	const FNumericField NumericFields[] =
+	{
+		{ TEXT("SensorWidth"), &OutSettings.SensorWidth },
+		{ TEXT("SensorHeight"), &OutSettings.SensorHeight },
+		{ TEXT("MinFocallenght"), &OutSettings.MinFocalLength },
+		{ TEXT("MaxFocallenght"), &OutSettings.MaxFocalLength },
+		{ TEXT("MinFStop"), &OutSettings.MinFStop },
+		{ TEXT("MaxFStop"), &OutSettings.MaxFStop },
+		{ TEXT("PrincipalPointX"), &OutSettings.PrincipalPoint.X },
+		{ TEXT("PrincipalPointY"), &OutSettings.PrincipalPoint.Y },
+	};
+
+	for (TFieldIterator<FProperty> It(Table->GetRowStruct()); It; ++It)
+	{
+		const FProperty* Property = *It;
+		const void* Value = Property->ContainerPtrToValuePtr<void>(Row);
+
+		if (const FNumericProperty* NumericProperty = CastField<FNumericProperty>(Property))
+		{
+			for (const FNumericField& Field : NumericFields)
+			{
+				if (VPLensSettings::MatchesField(Property, Field.Name))
+				{
+					*Field.Value = NumericProperty->IsFloatingPoint() ? (float)NumericProperty->GetFloatingPointPropertyValue(Value) : (float)NumericProperty->GetSignedIntPropertyValue(Value);
+				}
+			}
+		}
+		else if (const FStrProperty* StrProperty = CastField<FStrProperty>(Property))
+		{
+			if (VPLensSettings::MatchesField(Property, TEXT("Sensorname")))
+			{
+				OutSettings.SensorName = StrProperty->GetPropertyValue(Value);
+			}
+		}
+		else if (const FNameProperty* NameProperty = CastField<FNameProperty>(Property))
+		{
+			if (VPLensSettings::MatchesField(Property, TEXT("Sensorname")))
+			{
+				OutSettings.SensorName = NameProperty->GetPropertyValue(Value).ToString();
+			}
+		}
+	}
+
+	OutSettings.LensName = RowName;
+	OutSettings.bEnabled = true;
+	return true;
+}
@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLensSubsystem.h"
+#include "Engine/DataTable.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+namespace VPLensSubsystem
+{
+	static bool SameRanges(const FVPLensSettings& A, const FVPLensSettings& B)
+	{
+		return A.SensorWidth == B.SensorWidth && A.SensorHeight == B.SensorHeight
+			&& A.MinFocalLength == B.MinFocalLength && A.MaxFocalLength == B.MaxFocalLength
+			&& A.MinFocusDistance == B.MinFocusDistance && A.MaxFocusDistance == B.MaxFocusDistance;
+	}
+}
+
+static FAutoConsoleCommand LensImportCommand(
+	TEXT("BelindaVP.Lens.Import"),
+	TEXT("Imports a vendor lens calibration into a lens table row. Args: <TablePath> <RowName> <File> [EncoderMax]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			UVPLensSubsystem* Lenses = GEngine ? GEngine->GetEngineSubsystem<UVPLensSubsystem>() : nullptr;
+			if (!Lenses || Args.Num() < 3)
+				return;
+
+			const UDataTable* Table = LoadObject<UDataTable>(nullptr, *Args[0]);
+			if (!Table)
+			{
+				UE_LOG(LogTemp, Error, TEXT("Lens table %s not found"), *Args[0]);
+				return;
+			}
+
+			FVPLensImportOptions Options;
+			if (Args.IsValidIndex(3))
+			{
+				Options.EncoderMax = FCString::Atof(*Args[3]);
+			}
+
+			FVPLensImportResult Result;
+			Lenses->ImportCalibration(Table, FName(*Args[1]), Args[2], Options, Result);
+		}));
+
+void UVPLensSubsystem::Deinitialize()
+{
+#if WITH_EDITOR
+	for (const TWeakObjectPtr<const UDataTable>& Table : WatchedTables)
+	{
+		if (Table.IsValid())
+		{
+			const_cast<UDataTable*>(Table.Get())->OnDataTableChanged().RemoveAll(this);
+		}
+	}
+#endif
+	WatchedTables.Empty();
+	CompiledLenses.Empty();
+	CalibrationPoints.Empty();
+	LensFilesChecked.Empty();
+
+	Super::Deinitialize();
+}
+
+TSharedPtr<const FVPCompiledLens> UVPLensSubsystem::GetCompiledLens(const UDataTable* Table, FName RowName)
+{
+	if (!Table)
+		return nullptr;
+
+	const FLensKey Key(FObjectKey(Table), RowName);
+	if (const TSharedPtr<const FVPCompiledLens>* Found = CompiledLenses.Find(Key))
+		return *Found;
+
+	FVPLensSettings Lens;
+	if (!FVPLensSettings::FromDataTableRow(Table, RowName, Lens))
+		return nullptr;
+
+	WatchTable(Table);
+
+	if (!LensFilesChecked.Contains(Key))
+	{
+		LensFilesChecked.Add(Key);
+		if (TSharedPtr<const FVPCompiledLens> Loaded = LoadLensFile(Table, RowName, Lens))
+		{
+			CompiledLenses.Add(Key, Loaded);
+			return Loaded;
+		}
+	}
+
+	const TArray<FVPLensCalibrationPoint>* Points = CalibrationPoints.Find(Key);
+
+	TSharedPtr<FVPCompiledLens> Compiled = MakeShared<FVPCompiledLens>();
+	Compiled->Compile(Lens, Points ? TArrayView<const FVPLensCalibrationPoint>(*Points) : TArrayView<const FVPLensCalibrationPoint>(), ZoomSteps, FocusSteps);
+	CompiledLenses.Add(Key, Compiled);
+	return Compiled;
+}
+
+void UVPLensSubsystem::SetCalibrationPoints(const UDataTable* Table, FName RowName, TArray<FVPLensCalibrationPoint> Points)
+{
+	if (!Table)
+		return;
+
+	const FLensKey Key(FObjectKey(Table), RowName);
+	if (Points.Num() > 0)
+	{
+		CalibrationPoints.Add(Key, MoveTemp(Points));
+	}
+	else
+	{
+		CalibrationPoints.Remove(Key);
+	}
+
+	CompiledLenses.Remove(Key);
+	++Generation;
+}
+
+const TArray<FVPLensCalibrationPoint>* UVPLensSubsystem::GetCalibrationPoints(const UDataTable* Table, FName RowName) const
+{
+	return Table ? CalibrationPoints.Find(FLensKey(FObjectKey(Table), RowName)) : nullptr;
+}
+
+void UVPLensSubsystem::SetResolution(int32 InZoomSteps, int32 InFocusSteps)
+{
+	ZoomSteps = FMath::Max(InZoomSteps, 2);
+	FocusSteps = FMath::Max(InFocusSteps, 2);
+
+	CompiledLenses.Empty();
+	++Generation;
+}
+
+void UVPLensSubsystem::Invalidate(const UDataTable* Table)
+{
+	const FObjectKey TableKey(Table);
+	for (auto It = CompiledLenses.CreateIterator(); It; ++It)
+	{
+		if (It->Key.Get<0>() == TableKey)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	++Generation;
+}
+
+void UVPLensSubsystem::WatchTable(const UDataTable* Table)
+{
+#if WITH_EDITOR
+	// Rows edited in the table editor are recompiled the next time a controller asks for them
+	if (!WatchedTables.Contains(Table))
+	{
+		WatchedTables.Add(Table);
+		TWeakObjectPtr<const UDataTable> WeakTable(Table);
+		const_cast<UDataTable*>(Table)->OnDataTableChanged().AddWeakLambda(this, [this, WeakTable]()
+			{
+				if (WeakTable.IsValid())
+				{
+					Invalidate(WeakTable.Get());
+				}
+			});
+	}
+#endif
+}
+
+FString UVPLensSubsystem::GetLensFilePath(const UDataTable* Table, FName RowName)
+{
+	FString TableFile;
+	if (!Table || !FPackageName::TryConvertLongPackageNameToFilename(Table->GetPackage()->GetName(), TableFile))
+		return FString();
+
+	return FPaths::GetPath(TableFile) / (RowName.ToString() + TEXT(".bvplens"));
+}
+
+TSharedPtr<const FVPCompiledLens> UVPLensSubsystem::LoadLensFile(const UDataTable* Table, FName RowName, const FVPLensSettings& Lens)
+{
+	const FString FilePath = GetLensFilePath(Table, RowName);
+	if (FilePath.IsEmpty() || !FPaths::FileExists(FilePath))
+		return nullptr;
+
+	TSharedPtr<FVPCompiledLens> Loaded = MakeShared<FVPCompiledLens>();
+	TArray<FVPLensCalibrationPoint> Points;
+	if (!Loaded->Load(FilePath, Points))
+		return nullptr;
+
+	const FLensKey Key(FObjectKey(Table), RowName);
+	if (Points.Num() > 0 && !CalibrationPoints.Contains(Key))
+	{
+		CalibrationPoints.Add(Key, Points);
+	}
+
+	// The saved grid is only reused as is while the row and resolution are what it was compiled for
+	if (!VPLensSubsystem::SameRanges(Loaded->GetLens(), Lens) || Loaded->GetZoomSteps() != ZoomSteps || Loaded->GetFocusSteps() != FocusSteps)
+		return nullptr;
+
+	return Loaded;
+}
+
+bool UVPLensSubsystem::ImportCalibration(const UDataTable* Table, FName RowName, const FString& SourcePath, const FVPLensImportOptions& Options, FVPLensImportResult& OutResult)
+{
+	OutResult = FVPLensImportResult();
+
+	FVPLensSettings Lens;
+	if (!FVPLensSettings::FromDataTableRow(Table, RowName, Lens))
+	{
+		OutResult.Error = FString::Printf(TEXT("Row %s not found in the lens table"), *RowName.ToString());
+		UE_LOG(LogTemp, Error, TEXT("%s"), *OutResult.Error);
+		return false;
+	}
+
+	TArray<FVPLensCalibrationPoint> Points;
+	if (!FVPLensCalibrationImporter::Import(SourcePath, Options, Points, OutResult))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Lens calibration import failed: %s"), *OutResult.Error);
+		return false;
+	}
+
+	TSharedPtr<FVPCompiledLens> Compiled = MakeShared<FVPCompiledLens>();
+	Compiled->Compile(Lens, Points, ZoomSteps, FocusSteps);
+
+	OutResult.OutputPath = GetLensFilePath(Table, RowName);
+	if (OutResult.OutputPath.IsEmpty() || !Compiled->Save(OutResult.OutputPath, Points))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Lens calibration of %s imported but not saved next to the table"), *RowName.ToString());
+		OutResult.OutputPath.Empty();
+	}
+
+	const FLensKey Key(FObjectKey(Table), RowName);
+	CalibrationPoints.Add(Key, MoveTemp(Points));
+	CompiledLenses.Add(Key, Compiled);
+	LensFilesChecked.Add(Key);
+	WatchTable(Table);
+	++Generation;
+
+	UE_LOG(LogTemp, Log, TEXT("Imported %lld lens samples (%lld rejected) into %d points for %s in %.2f s"),
+		OutResult.NumSamples, OutResult.NumRejected, OutResult.NumPoints, *RowName.ToString(), OutResult.Seconds);
+	return true;
+}
@@ -0,0 +1,411 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPLiveLinkCameraController.h"
+#include "VPTrackingSubsystem.h"
+#include "VPLensSubsystem.h"
+#include "VPEncoderMappingSubsystem.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "CineCameraComponent.h"
+#include "Engine/Engine.h"
+#include "Misc/App.h"
+
+namespace VPLiveLinkCameraController
+{
+	// Far end of the camera focus range, same as the stock controller (cm)
+	static constexpr float CameraRangeMaxFocusDistance = 100000.0f;
+}
+
+void UVPLiveLinkCameraController::Tick(float DeltaTime, const FLiveLinkSubjectFrameData& SubjectData)
+{
+	const FLiveLinkCameraStaticData* StaticData = SubjectData.StaticData.Cast<FLiveLinkCameraStaticData>();
+	const FLiveLinkCameraFrameData* FrameData = SubjectData.FrameData.Cast<FLiveLinkCameraFrameData>();
+	if (!StaticData || !FrameData)
+	{
+		Super::Tick(DeltaTime, SubjectData);
+		return;
+	}
+
+	UpdateEncoderMapping();
+
+	FVPTrackingSample Sample;
+	const bool bBuffered = GetBufferedSample(Sample);
+
+	if (bBuffered && DelayCalibrator.IsRunning())
+	{
+		DelayCalibrator.AddTrackingSample(GFrameCounter, Sample.Rotation.Rotator().Yaw);
+	}
+
+	if (!bFusedUpdate)
+	{
+		TickStock(DeltaTime, SubjectData, bBuffered ? &Sample : nullptr);
+		return;
+	}
+
+	// Nothing buffered yet, drive the camera with the latest frame
+	if (!bBuffered)
+	{
+		Sample.ReadFrom(*FrameData);
+		if (ActiveEncoderMapping.IsValid())
+		{
+			ActiveEncoderMapping->Apply(Sample);
+		}
+	}
+
+	ApplyFused(Sample, *StaticData, *FrameData);
+}
+
+bool UVPLiveLinkCameraController::GetBufferedSample(FVPTrackingSample& OutSample)
+{
+	UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+	if (!Tracking || !JitterBuffer.bEnabled)
+		return false;
+
+	UpdateRegistration();
+	bHasLensStreamSample = false;
+	if (!RegisteredLensSubject.IsNone())
+		return Tracking->GetFusedSample(RegisteredSubject, RegisteredLensSubject, OutSample, bHasLensStreamSample);
+
+	return Tracking->GetEvaluatedSample(RegisteredSubject, OutSample);
+}
+
+void UVPLiveLinkCameraController::TickStock(float DeltaTime, const FLiveLinkSubjectFrameData& SubjectData, const FVPTrackingSample* Sample)
+{
+	if (!Sample)
+	{
+		Super::Tick(DeltaTime, SubjectData);
+		return;
+	}
+
+	// Only copy the static data again when the subject changed it, the frame struct is reused as is
+	UVPTrackingSubsystem* Tracking = GEngine->GetEngineSubsystem<UVPTrackingSubsystem>();
+	const uint32 CurrentGeneration = Tracking->GetStaticDataGeneration(RegisteredSubject);
+	if (BufferedData.StaticData.GetStruct() != SubjectData.StaticData.GetStruct() || StaticDataGeneration != CurrentGeneration)
+	{
+		BufferedData.StaticData.InitializeWith(SubjectData.StaticData);
+		StaticDataGeneration = CurrentGeneration;
+	}
+
+	if (BufferedData.FrameData.GetStruct() != SubjectData.FrameData.GetStruct())
+	{
+		BufferedData.FrameData.InitializeWith(SubjectData.FrameData);
+	}
+
+	const FLiveLinkCameraFrameData* FrameData = SubjectData.FrameData.Cast<FLiveLinkCameraFrameData>();
+	FLiveLinkCameraFrameData* BufferedFrame = BufferedData.FrameData.Cast<FLiveLinkCameraFrameData>();
+	BufferedFrame->AspectRatio = FrameData->AspectRatio;
+	BufferedFrame->FilmBackWidth = FrameData->FilmBackWidth;
+	BufferedFrame->FilmBackHeight = FrameData->FilmBackHeight;
+	BufferedFrame->ProjectionMode = FrameData->ProjectionMode;
+	BufferedFrame->Transform.SetScale3D(FrameData->Transform.GetScale3D());
+	Sample->WriteTo(*BufferedFrame);
+
+	Super::Tick(DeltaTime, BufferedData);
+}
+
+void UVPLiveLinkCameraController::ApplyFused(const FVPTrackingSample& Sample, const FLiveLinkCameraStaticData& StaticData, const FLiveLinkCameraFrameData& FrameData)
+{
+	UCameraComponent* CameraComponent = Cast<UCameraComponent>(GetAttachedComponent());
+	if (!CameraComponent)
+		return;
+
+	// The compiled grid replaces the linear lens ranges when the lens comes from a table row
+	const FVPCompiledLens* Grid = Lens.bEnabled ? GetCompiledLens() : nullptr;
+	bHasLensSample = Grid != nullptr;
+
+	// Encoder curves already turned FIZ into physical values, the grid is located from them
+	const bool bPhysicalLens = ActiveEncoderMapping.IsValid();
+	if (Grid)
+	{
+		const float Zoom = bPhysicalLens ? FMath::GetRangePct(Lens.MinFocalLength, Lens.MaxFocalLength, Sample.FocalLength) : Sample.FocalLength;
+		const float Focus = bPhysicalLens ? FMath::GetRangePct(Lens.MinFocusDistance, Lens.MaxFocusDistance, Sample.FocusDistance) : Sample.FocusDistance;
+		Grid->EvaluateBilinear(Zoom, Focus, LensSample);
+	}
+
+	// Pose with the nodal offset applied in camera space
+	const FVector Nodal = Grid ? NodalOffset + FVector(LensSample.NodalShift) : NodalOffset;
+	const FTransform Pose(Sample.Rotation, Sample.Location, FrameData.Transform.GetScale3D());
+	TransformData.ApplyTransform(CameraComponent, FTransform(NodalRotation, Nodal) * Pose, StaticData);
+	LastTrackedPose = Pose;
+
+	UCineCameraComponent* CineCamera = Cast<UCineCameraComponent>(CameraComponent);
+	if (!CineCamera)
+	{
+		if (StaticData.bIsFieldOfViewSupported)
+		{
+			CameraComponent->SetFieldOfView(Sample.FieldOfView);
+		}
+		return;
+	}
+
+	// A separate lens stream brings the FIZ values the pose subject may not advertise, once it has buffered some
+	const bool bLensStream = bHasLensStreamSample;
+
+	// Lens ranges: the plugin lens first, then the camera's own lens settings like the stock controller
+	const bool bMapLens = Lens.bEnabled && !bPhysicalLens;
+	const bool bMapCamera = !Lens.bEnabled && !bPhysicalLens && bUseCameraRange;
+	const FCameraLensSettings& CameraLens = CineCamera->LensSettings;
+
+	if (Lens.bEnabled || StaticData.bIsFilmBackSupported)
+	{
+		const float SensorWidth = Lens.bEnabled ? Lens.SensorWidth : FrameData.FilmBackWidth;
+		const float SensorHeight = Lens.bEnabled ? Lens.SensorHeight : FrameData.FilmBackHeight;
+		if (SensorWidth > 0.0f && SensorHeight > 0.0f && (CineCamera->Filmback.SensorWidth != SensorWidth || CineCamera->Filmback.SensorHeight != SensorHeight))
+		{
+			FCameraFilmbackSettings Filmback = CineCamera->Filmback;
+			Filmback.SensorWidth = SensorWidth;
+			Filmback.SensorHeight = SensorHeight;
+			CineCamera->SetFilmback(Filmback);
+		}
+	}
+
+	if (bLensStream || StaticData.bIsFocalLengthSupported)
+	{
+		const float FocalLength = Grid && !bPhysicalLens ? LensSample.FocalLength
+			: bMapLens ? Lens.MapFocalLength(Sample.FocalLength)
+			: bMapCamera ? FMath::Lerp(CameraLens.MinFocalLength, CameraLens.MaxFocalLength, Sample.FocalLength)
+			: Sample.FocalLength;
+		if (CineCamera->CurrentFocalLength != FocalLength)
+		{
+			CineCamera->SetCurrentFocalLength(FocalLength);
+		}
+	}
+	LastFocalLength = CineCamera->CurrentFocalLength;
+
+	if (bLensStream || StaticData.bIsApertureSupported)
+	{
+		CineCamera->CurrentAperture = bMapLens ? Lens.MapFStop(Sample.Aperture)
+			: bMapCamera ? FMath::Lerp(CameraLens.MinFStop, CameraLens.MaxFStop, Sample.Aperture)
+			: Sample.Aperture;
+	}
+
+	// The camera lens has no far focus limit, its minimum is in mm
+	if (bLensStream || StaticData.bIsFocusDistanceSupported)
+	{
+		CineCamera->FocusSettings.ManualFocusDistance = Grid && !bPhysicalLens ? LensSample.FocusDistance
+			: bMapLens ? Lens.MapFocusDistance(Sample.FocusDistance)
+			: bMapCamera ? FMath::Lerp(CameraLens.MinimumFocusDistance * 0.1f, VPLiveLinkCameraController::CameraRangeMaxFocusDistance, Sample.FocusDistance)
+			: Sample.FocusDistance;
+	}
+}
+
+bool UVPLiveLinkCameraController::SetLensFromTable(const UDataTable* InLensTable, FName RowName)
+{
+	CompiledLens.Reset();
+	bHasLensSample = false;
+
+	if (!FVPLensSettings::FromDataTableRow(InLensTable, RowName, Lens))
+	{
+		LensTable.Reset();
+		LensRow = NAME_None;
+		return false;
+	}
+
+	LensTable = InLensTable;
+	LensRow = RowName;
+	return true;
+}
+
+bool UVPLiveLinkCameraController::GetLensSample(FVPLensGridSample& OutSample) const
+{
+	if (!bHasLensSample)
+		return false;
+
+	OutSample = LensSample;
+	return true;
+}
+
+const FVPCompiledLens* UVPLiveLinkCameraController::GetCompiledLens()
+{
+	UVPLensSubsystem* LensSubsystem = GEngine ? GEngine->GetEngineSubsystem<UVPLensSubsystem>() : nullptr;
+	if (!LensSubsystem || !LensTable.IsValid())
+		return nullptr;
+
+	// Fetched again only when a row was edited or recalibrated
+	if (!CompiledLens.IsValid() || CompiledLensGeneration != LensSubsystem->GetGeneration())
+	{
+		CompiledLens = LensSubsystem->GetCompiledLens(LensTable.Get(), LensRow);
+		CompiledLensGeneration = LensSubsystem->GetGeneration();
+		if (CompiledLens.IsValid())
+		{
+			FVPLensSettings::FromDataTableRow(LensTable.Get(), LensRow, Lens);
+		}
+	}
+	return CompiledLens.Get();
+}
+
+void UVPLiveLinkCameraController::Cleanup()
+{
+	ReleaseSubject();
+
+	Super::Cleanup();
+}
+
+void UVPLiveLinkCameraController::BeginDestroy()
+{
+	ReleaseSubject();
+
+	Super::BeginDestroy();
+}
+
+void UVPLiveLinkCameraController::ReleaseSubject()
+{
+	if (UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+	{
+		if (!RegisteredSubject.IsNone())
+		{
+			Tracking->UnregisterSubject(RegisteredSubject);
+		}
+		if (!RegisteredLensSubject.IsNone())
+		{
+			Tracking->UnregisterSubject(RegisteredLensSubject);
+		}
+	}
+	RegisteredSubject = FLiveLinkSubjectName();
+	RegisteredLensSubject = FLiveLinkSubjectName();
+}
+
+void UVPLiveLinkCameraController::UpdateRegistration()
+{
+	UVPTrackingSubsystem* Tracking = GEngine->GetEngineSubsystem<UVPTrackingSubsystem>();
+
+	if (SelectedSubject.Subject != RegisteredSubject)
+	{
+		if (!RegisteredSubject.IsNone())
+		{
+			Tracking->UnregisterSubject(RegisteredSubject);
+		}
+
+		RegisteredSubject = SelectedSubject.Subject;
+		Tracking->RegisterSubject(RegisteredSubject, JitterBuffer);
+	}
+
+	const FLiveLinkSubjectName LensSubject = LensStream.bEnabled && LensStream.Subject != RegisteredSubject ? LensStream.Subject : FLiveLinkSubjectName();
+	if (LensSubject != RegisteredLensSubject)
+	{
+		if (!RegisteredLensSubject.IsNone())
+		{
+			Tracking->UnregisterSubject(RegisteredLensSubject);
+		}
+
+		RegisteredLensSubject = LensSubject;
+		if (!RegisteredLensSubject.IsNone())
+		{
+			Tracking->RegisterSubject(RegisteredLensSubject, JitterBuffer);
+		}
+	}
+
+	PushSettings(Tracking);
+}
+
+void UVPLiveLinkCameraController::UpdateEncoderMapping()
+{
+	UVPEncoderMappingSubsystem* Mappings = GEngine ? GEngine->GetEngineSubsystem<UVPEncoderMappingSubsystem>() : nullptr;
+	const FName MappingName = EncoderMapping.bEnabled ? EncoderMapping.Mapping : NAME_None;
+	if (!Mappings || (MappingName == ActiveEncoderMappingName && EncoderMappingGeneration == Mappings->GetGeneration()))
+		return;
+
+	ActiveEncoderMapping = MappingName.IsNone() ? nullptr : Mappings->GetMapping(MappingName);
+	ActiveEncoderMappingName = MappingName;
+	EncoderMappingGeneration = Mappings->GetGeneration();
+}
+
+void UVPLiveLinkCameraController::PushSettings(UVPTrackingSubsystem* Tracking)
+{
+	Tracking->SetSubjectSettings(RegisteredSubject, JitterBuffer);
+	Tracking->SetSubjectDelay(RegisteredSubject, DelayLine);
+	Tracking->SetSubjectFilter(RegisteredSubject, MotionFilter);
+	Tracking->SetSubjectEncoderMapping(RegisteredSubject, ActiveEncoderMapping);
+
+	if (!RegisteredLensSubject.IsNone())
+	{
+		// Same depth and delay as the pose so both streams are read at the same instant, shifted by the encoder latency
+		FVPJitterBufferSettings LensSettings = JitterBuffer;
+		LensSettings.TimeSource = LensStream.TimeSource;
+
+		Tracking->SetSubjectSettings(RegisteredLensSubject, LensSettings);
+		Tracking->SetSubjectDelay(RegisteredLensSubject, DelayLine, LensStream.LatencyMs * 0.001);
+		Tracking->SetSubjectFilter(RegisteredLensSubject, MotionFilter);
+		Tracking->SetSubjectEncoderMapping(RegisteredLensSubject, ActiveEncoderMapping);
+	}
+}
+
+void UVPLiveLinkCameraController::StartDelayCalibration(float MaxSeconds, float MaxLagFrames)
+{
+	const double FrameRate = FApp::GetTimecodeFrameRate().AsDecimal();
+	DelayCalibrator.Start(FMath::CeilToInt(MaxSeconds * FrameRate), FMath::CeilToInt(MaxLagFrames));
+}
+
+void UVPLiveLinkCameraController::AddDelayCalibrationVideoSample(float VideoMotion)
+{
+	DelayCalibrator.AddVideoSample(GFrameCounter, VideoMotion);
+}
+
+bool UVPLiveLinkCameraController::FinishDelayCalibration(bool bApply, float& OutLagFrames, float& OutConfidence)
+{
+	DelayCalibrator.Stop();
+
+	// The tracking side is sampled after the delay line, so the lag found is what is left to compensate
+	double LagFrames = 0.0;
+	double Confidence = 0.0;
+	const bool bSolved = DelayCalibrator.Solve(LagFrames, Confidence);
+	OutLagFrames = (float)LagFrames;
+	OutConfidence = (float)Confidence;
+
+	if (!bSolved)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Delay calibration of %s failed, correlation %.2f"), *RegisteredSubject.ToString(), Confidence);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Delay calibration of %s: video is %.2f frames behind the tracking, correlation %.2f"), *RegisteredSubject.ToString(), LagFrames, Confidence);
+
+	if (bApply)
+	{
+		const double LagValue = DelayLine.Unit == EVPDelayUnit::Frames ? LagFrames : LagFrames * FApp::GetTimecodeFrameRate().AsInterval() * 1000.0;
+		DelayLine.Delay = FMath::Max(DelayLine.Delay + (float)LagValue, 0.0f);
+	}
+	return true;
+}
+
+void UVPLiveLinkCameraController::AddNodalObservation(FVector TargetPoint, FVector2D ImagePoint)
+{
+	const UCineCameraComponent* CineCamera = Cast<UCineCameraComponent>(GetAttachedComponent());
+	if (!CineCamera || LastFocalLength <= 0.0f)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Nodal observations need a cine camera driven by the fused update"));
+		return;
+	}
+
+	FVPNodalObservation& Observation = NodalObservations.AddDefaulted_GetRef();
+	Observation.TrackedPose = LastTrackedPose;
+	Observation.TargetPoint = TargetPoint;
+	Observation.ImagePoint = ImagePoint;
+	Observation.FocalLength = LastFocalLength;
+	Observation.SensorWidth = CineCamera->Filmback.SensorWidth;
+	Observation.SensorHeight = CineCamera->Filmback.SensorHeight;
+	Observation.NodalShift = bHasLensSample ? FVector(LensSample.NodalShift) : FVector::ZeroVector;
+}
+
+bool UVPLiveLinkCameraController::SolveNodalOffset(const FVPNodalSolverSettings& Settings, bool bApply, FVPNodalSolution& OutSolution)
+{
+	// Each observation carries the lens grid's nodal shift of its zoom and focus, the solve is the offset without it
+	FVPNodalSolverSettings SolverSettings = Settings;
+	SolverSettings.InitialOffset = FTransform(NodalRotation, NodalOffset);
+
+	const double Begin = FPlatformTime::Seconds();
+	const bool bSolved = FVPNodalSolver::Solve(NodalObservations, SolverSettings, OutSolution);
+	if (!bSolved)
+		return false;
+
+	UE_LOG(LogTemp, Log, TEXT("Nodal offset of %s: %s, rotation %s, %d/%d inliers, %.2f px rms, %.0f ms"), *RegisteredSubject.ToString(),
+		*OutSolution.Offset.GetLocation().ToString(), *OutSolution.Offset.Rotator().ToString(), OutSolution.NumInliers, NodalObservations.Num(),
+		OutSolution.RmsErrorPixels, (FPlatformTime::Seconds() - Begin) * 1000.0);
+
+	if (bApply)
+	{
+		NodalOffset = OutSolution.Offset.GetLocation();
+		NodalRotation = OutSolution.Offset.Rotator();
+	}
+	return true;
+}
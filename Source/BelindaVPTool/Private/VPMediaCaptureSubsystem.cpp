@@ -0,0 +1,265 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPMediaCaptureSubsystem.h"
+#include "MediaOutput.h"
+#include "Engine/Engine.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "HAL/IConsoleManager.h"
+#include "Slate/SceneViewport.h"
+
+namespace VPMediaCapture
+{
+	static bool SameOptions(const FMediaCaptureOptions& A, const FMediaCaptureOptions& B)
+	{
+		return FMediaCaptureOptions::StaticStruct()->CompareScriptStruct(&A, &B, PPF_None);
+	}
+}
+
+static FAutoConsoleCommand CaptureStartCommand(
+	TEXT("BelindaVP.Capture.Start"),
+	TEXT("Starts or reconfigures a named media capture. Args: <Name> <MediaOutputPath> [RenderTargetPath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			UVPMediaCaptureSubsystem* Captures = GEngine ? GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>() : nullptr;
+			if (!Captures || Args.Num() < 2)
+				return;
+
+			FVPCaptureOutputSettings Settings;
+			Settings.Name = FName(*Args[0]);
+			Settings.MediaOutput = LoadObject<UMediaOutput>(nullptr, *Args[1]);
+			if (Args.IsValidIndex(2))
+			{
+				Settings.Source = EVPCaptureSource::RenderTarget;
+				Settings.RenderTarget = LoadObject<UTextureRenderTarget2D>(nullptr, *Args[2]);
+			}
+			Captures->StartCapture(Settings);
+		}));
+
+static FAutoConsoleCommand CaptureStopCommand(
+	TEXT("BelindaVP.Capture.Stop"),
+	TEXT("Stops a named media capture, or all of them. Args: [Name]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPMediaCaptureSubsystem* Captures = GEngine ? GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>() : nullptr)
+			{
+				if (Args.IsValidIndex(0))
+				{
+					Captures->StopCapture(FName(*Args[0]));
+				}
+				else
+				{
+					Captures->StopAllCaptures();
+				}
+			}
+		}));
+
+static FAutoConsoleCommand CaptureStatusCommand(
+	TEXT("BelindaVP.Capture.Status"),
+	TEXT("Logs the state of every media capture"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UVPMediaCaptureSubsystem* Captures = GEngine ? GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>() : nullptr)
+			{
+				for (const FVPCaptureStatus& Status : Captures->GetCaptureStatus())
+				{
+					UE_LOG(LogTemp, Log, TEXT("%s: %s to %s, %dx%d, %s"), *Status.Name.ToString(), *UEnum::GetValueAsString(Status.Source),
+						*Status.MediaOutput, Status.Size.X, Status.Size.Y, *UEnum::GetValueAsString(Status.State));
+				}
+			}
+		}));
+
+void UVPMediaCaptureSubsystem::Deinitialize()
+{
+	StopAllCaptures();
+	Stopping.Empty();
+	ViewportResolver.Unbind();
+
+	Super::Deinitialize();
+}
+
+bool UVPMediaCaptureSubsystem::StartCapture(const FVPCaptureOutputSettings& Settings)
+{
+	PruneStopped();
+
+	if (Settings.Name.IsNone() || !Settings.MediaOutput)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Media capture needs a name and a media output"));
+		return false;
+	}
+	if (Settings.Source == EVPCaptureSource::RenderTarget && !Settings.RenderTarget)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Media capture %s has no render target"), *Settings.Name.ToString());
+		return false;
+	}
+
+	if (TObjectPtr<UMediaCapture>* Running = Captures.Find(Settings.Name))
+	{
+		const FVPCaptureOutputSettings& Current = CaptureSettings.FindChecked(Settings.Name);
+		UMediaCapture* MediaCapture = *Running;
+
+		// Same output and options, the source is swapped on the running capture without a restart
+		const bool bRunning = MediaCapture && (MediaCapture->GetState() == EMediaCaptureState::Capturing || MediaCapture->GetState() == EMediaCaptureState::Preparing);
+		if (bRunning && Current.MediaOutput == Settings.MediaOutput && Current.Source == Settings.Source && VPMediaCapture::SameOptions(Current.Options, Settings.Options))
+		{
+			if (UpdateSource(MediaCapture, Settings))
+			{
+				CaptureSettings.Add(Settings.Name, Settings);
+				return true;
+			}
+		}
+
+		Release(MediaCapture);
+		Captures.Remove(Settings.Name);
+		CaptureSettings.Remove(Settings.Name);
+	}
+
+	UMediaCapture* MediaCapture = Settings.MediaOutput->CreateMediaCapture();
+	if (!MediaCapture)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s can't create a media capture"), *Settings.MediaOutput->GetName());
+		return false;
+	}
+
+	const FName Name = Settings.Name;
+	TWeakObjectPtr<UMediaCapture> WeakCapture(MediaCapture);
+	MediaCapture->OnStateChangedNative.AddWeakLambda(this, [this, Name, WeakCapture]()
+		{
+			if (WeakCapture.IsValid())
+			{
+				OnCaptureStateChanged.Broadcast(Name, WeakCapture->GetState());
+			}
+		});
+
+	if (!Capture(MediaCapture, Settings))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Media capture %s could not start on %s"), *Name.ToString(), *Settings.MediaOutput->GetName());
+		Release(MediaCapture);
+		return false;
+	}
+
+	Captures.Add(Name, MediaCapture);
+	CaptureSettings.Add(Name, Settings);
+	return true;
+}
+
+int32 UVPMediaCaptureSubsystem::ApplyCaptures(const TArray<FVPCaptureOutputSettings>& Outputs)
+{
+	TArray<FName> Names;
+	Captures.GetKeys(Names);
+	for (const FName& Name : Names)
+	{
+		if (!Outputs.ContainsByPredicate([&Name](const FVPCaptureOutputSettings& Output) { return Output.Name == Name; }))
+		{
+			StopCapture(Name);
+		}
+	}
+
+	int32 NumStarted = 0;
+	for (const FVPCaptureOutputSettings& Output : Outputs)
+	{
+		NumStarted += StartCapture(Output) ? 1 : 0;
+	}
+	return NumStarted;
+}
+
+void UVPMediaCaptureSubsystem::StopCapture(FName Name)
+{
+	TObjectPtr<UMediaCapture> MediaCapture;
+	if (Captures.RemoveAndCopyValue(Name, MediaCapture))
+	{
+		Release(MediaCapture);
+	}
+	CaptureSettings.Remove(Name);
+}
+
+void UVPMediaCaptureSubsystem::StopAllCaptures()
+{
+	for (const TPair<FName, TObjectPtr<UMediaCapture>>& Pair : Captures)
+	{
+		Release(Pair.Value);
+	}
+	Captures.Empty();
+	CaptureSettings.Empty();
+}
+
+TArray<FVPCaptureStatus> UVPMediaCaptureSubsystem::GetCaptureStatus() const
+{
+	TArray<FVPCaptureStatus> Statuses;
+	for (const TPair<FName, TObjectPtr<UMediaCapture>>& Pair : Captures)
+	{
+		const FVPCaptureOutputSettings& Settings = CaptureSettings.FindChecked(Pair.Key);
+
+		FVPCaptureStatus& Status = Statuses.AddDefaulted_GetRef();
+		Status.Name = Pair.Key;
+		Status.MediaOutput = Settings.MediaOutput ? Settings.MediaOutput->GetName() : FString();
+		Status.Source = Settings.Source;
+		if (Pair.Value)
+		{
+			Status.State = Pair.Value->GetState();
+			Status.Size = Pair.Value->GetDesiredSize();
+		}
+		else
+		{
+			Status.State = EMediaCaptureState::Error;
+		}
+	}
+	return Statuses;
+}
+
+UMediaCapture* UVPMediaCaptureSubsystem::GetCapture(FName Name) const
+{
+	const TObjectPtr<UMediaCapture>* Found = Captures.Find(Name);
+	return Found ? Found->Get() : nullptr;
+}
+
+bool UVPMediaCaptureSubsystem::Capture(UMediaCapture* MediaCapture, const FVPCaptureOutputSettings& Settings)
+{
+	if (Settings.Source == EVPCaptureSource::RenderTarget)
+		return MediaCapture->CaptureTextureRenderTarget2D(Settings.RenderTarget, Settings.Options);
+
+	TSharedPtr<FSceneViewport> Viewport = ResolveViewport();
+	return Viewport.IsValid() ? MediaCapture->CaptureSceneViewport(Viewport, Settings.Options) : MediaCapture->CaptureActiveSceneViewport(Settings.Options);
+}
+
+bool UVPMediaCaptureSubsystem::UpdateSource(UMediaCapture* MediaCapture, const FVPCaptureOutputSettings& Settings)
+{
+	if (Settings.Source == EVPCaptureSource::RenderTarget)
+		return MediaCapture->UpdateTextureRenderTarget2D(Settings.RenderTarget);
+
+	TSharedPtr<FSceneViewport> Viewport = ResolveViewport();
+	return Viewport.IsValid() && MediaCapture->UpdateSceneViewport(Viewport);
+}
+
+TSharedPtr<FSceneViewport> UVPMediaCaptureSubsystem::ResolveViewport() const
+{
+	// The PIE and game viewports are found by the capture itself
+	if (GEngine && GEngine->GameViewport)
+		return nullptr;
+
+	return ViewportResolver.IsBound() ? ViewportResolver.Execute() : nullptr;
+}
+
+void UVPMediaCaptureSubsystem::Release(UMediaCapture* MediaCapture)
+{
+	if (!MediaCapture)
+		return;
+
+	MediaCapture->OnStateChangedNative.RemoveAll(this);
+
+	const EMediaCaptureState State = MediaCapture->GetState();
+	if (State != EMediaCaptureState::Stopped && State != EMediaCaptureState::Error)
+	{
+		// Doesn't block the game thread, the frames in flight are still sent
+		MediaCapture->StopCapture(true);
+		Stopping.Add(MediaCapture);
+	}
+}
+
+void UVPMediaCaptureSubsystem::PruneStopped()
+{
+	Stopping.RemoveAll([](const TObjectPtr<UMediaCapture>& MediaCapture)
+		{
+			return !MediaCapture || MediaCapture->GetState() == EMediaCaptureState::Stopped || MediaCapture->GetState() == EMediaCaptureState::Error;
+		});
+}
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPMediaWarmStartSubsystem.h"
+#include "MediaBundle.h"
+#include "MediaPlayer.h"
+#include "MediaTexture.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+namespace VPMediaWarmStart
+{
+	// Media texture plus the samples a player keeps queued, roughly
+	static constexpr int32 FramesPerSource = 4;
+
+	// Assumed until the player reports its video size
+	static const FIntPoint DefaultSize(1920, 1080);
+
+	static int64 EstimateBytes(const FIntPoint& Size)
+	{
+		return (int64)Size.X * Size.Y * 4 * FramesPerSource;
+	}
+
+	static UMediaBundle* FindBundle(const TArray<FString>& Args)
+	{
+		return Args.IsValidIndex(0) ? LoadObject<UMediaBundle>(nullptr, *Args[0]) : nullptr;
+	}
+}
+
+static FAutoConsoleCommand WarmStartPrimeCommand(
+	TEXT("BelindaVP.WarmStart.Prime"),
+	TEXT("Opens a media bundle in the background. Args: <MediaBundlePath>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPMediaWarmStartSubsystem* WarmStart = GEngine ? GEngine->GetEngineSubsystem<UVPMediaWarmStartSubsystem>() : nullptr)
+			{
+				WarmStart->Prime(VPMediaWarmStart::FindBundle(Args));
+			}
+		}));
+
+static FAutoConsoleCommand WarmStartSwitchCommand(
+	TEXT("BelindaVP.WarmStart.Switch"),
+	TEXT("Switches the active input to a media bundle. Args: <MediaBundlePath>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPMediaWarmStartSubsystem* WarmStart = GEngine ? GEngine->GetEngineSubsystem<UVPMediaWarmStartSubsystem>() : nullptr)
+			{
+				WarmStart->SwitchTo(VPMediaWarmStart::FindBundle(Args));
+			}
+		}));
+
+static FAutoConsoleCommand WarmStartStatusCommand(
+	TEXT("BelindaVP.WarmStart.Status"),
+	TEXT("Logs the primed media bundles and the switch latencies"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UVPMediaWarmStartSubsystem* WarmStart = GEngine ? GEngine->GetEngineSubsystem<UVPMediaWarmStartSubsystem>() : nullptr;
+			if (!WarmStart)
+				return;
+
+			for (const FVPWarmSource& Source : WarmStart->GetSources())
+			{
+				UE_LOG(LogTemp, Log, TEXT("%s%s: %s, %dx%d, ~%lld MB"), *GetNameSafe(Source.Bundle), Source.Bundle == WarmStart->GetActive() ? TEXT(" (active)") : TEXT(""),
+					*UEnum::GetValueAsString(Source.State), Source.Size.X, Source.Size.Y, Source.EstimatedBytes / (1024 * 1024));
+			}
+			const FVPHistogram& Latencies = WarmStart->GetSwitchLatencies();
+			UE_LOG(LogTemp, Log, TEXT("%llu switches, p95 %.1f ms, max %.1f ms, last took %d frames"), Latencies.Num(), Latencies.GetPercentile(0.95) * 1000.0,
+				Latencies.GetMax() * 1000.0, WarmStart->GetLastSwitchFrames());
+		}));
+
+void UVPMediaWarmStartSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &UVPMediaWarmStartSubsystem::OnBeginFrame);
+}
+
+void UVPMediaWarmStartSubsystem::Deinitialize()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+
+	for (int32 Index = Sources.Num() - 1; Index >= 0; --Index)
+	{
+		Close(Index);
+	}
+	Active = nullptr;
+	Pending = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool UVPMediaWarmStartSubsystem::Prime(UMediaBundle* Bundle)
+{
+	if (!Bundle)
+		return false;
+
+	// A failed player is closed and opened again, priming it once more is how it gets retried
+	const int32 Index = Sources.IndexOfByPredicate([Bundle](const FVPWarmSource& Source) { return Source.Bundle == Bundle; });
+	if (Index != INDEX_NONE && Sources[Index].State != EVPWarmState::Error)
+		return true;
+	if (Index != INDEX_NONE)
+	{
+		Close(Index);
+	}
+
+	// The bundle counts open references, ours keeps the player running while nothing shows it
+	if (!Bundle->OpenMediaSource())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Media bundle %s could not be opened"), *Bundle->GetName());
+		return false;
+	}
+
+	FVPWarmSource& Source = Sources.AddDefaulted_GetRef();
+	Source.Bundle = Bundle;
+	Source.EstimatedBytes = VPMediaWarmStart::EstimateBytes(VPMediaWarmStart::DefaultSize);
+	Source.LastActiveTime = FPlatformTime::Seconds();
+
+	Trim();
+	return true;
+}
+
+void UVPMediaWarmStartSubsystem::Release(UMediaBundle* Bundle)
+{
+	if (!Bundle || Bundle == Active || Bundle == Pending)
+		return;
+
+	const int32 Index = Sources.IndexOfByPredicate([Bundle](const FVPWarmSource& Source) { return Source.Bundle == Bundle; });
+	if (Index != INDEX_NONE)
+	{
+		Close(Index);
+	}
+}
+
+bool UVPMediaWarmStartSubsystem::SwitchTo(UMediaBundle* Bundle)
+{
+	if (!Bundle || Bundle == Active)
+		return Bundle != nullptr;
+
+	if (Pending && Pending != Bundle)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Switch to %s dropped after %llu frames, replaced by a switch to %s"), *GetNameSafe(Pending), GFrameCounter - PendingFrame, *Bundle->GetName());
+	}
+
+	// Pending before priming, so the budget never closes the bundle being switched to
+	Pending = Bundle;
+	PendingFrame = GFrameCounter;
+	PendingTime = FPlatformTime::Seconds();
+
+	if (!Prime(Bundle))
+	{
+		Pending = nullptr;
+		return false;
+	}
+
+	if (Find(Bundle)->State != EVPWarmState::Ready)
+		return false;
+
+	CompleteSwitch();
+	return true;
+}
+
+void UVPMediaWarmStartSubsystem::OnBeginFrame()
+{
+	const double Now = FPlatformTime::Seconds();
+	for (FVPWarmSource& Source : Sources)
+	{
+		UMediaPlayer* Player = Source.Bundle ? Source.Bundle->GetMediaPlayer() : nullptr;
+		if (!Player || Source.State == EVPWarmState::Error)
+			continue;
+
+		if (Player->HasError())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Media bundle %s failed while primed"), *Source.Bundle->GetName());
+			Source.State = EVPWarmState::Error;
+			continue;
+		}
+
+		if (Source.Bundle == Active)
+		{
+			Source.LastActiveTime = Now;
+		}
+
+		// Stopped or paused behind our back, a switch to it would show a frozen frame
+		if (!Player->IsPlaying())
+		{
+			if (Source.State == EVPWarmState::Ready)
+			{
+				UE_LOG(LogTemp, Log, TEXT("Media bundle %s stopped playing, no longer ready"), *Source.Bundle->GetName());
+			}
+			Source.State = EVPWarmState::Opening;
+			Source.FramesPlaying = 0;
+			continue;
+		}
+
+		if (Source.State == EVPWarmState::Opening)
+		{
+			const FIntPoint Size = Player->GetVideoTrackDimensions(INDEX_NONE, INDEX_NONE);
+			if (Size.X > 0 && Size.Y > 0)
+			{
+				Source.Size = Size;
+				Source.EstimatedBytes = VPMediaWarmStart::EstimateBytes(Size);
+			}
+
+			// Players show black or a stale sample for their first few frames
+			const UMediaTexture* Texture = Source.Bundle->GetMediaTexture();
+			if (++Source.FramesPlaying > SettleFrames && Texture && Texture->GetWidth() > 0)
+			{
+				Source.State = EVPWarmState::Ready;
+			}
+		}
+	}
+
+	if (Pending)
+	{
+		const FVPWarmSource* Source = Find(Pending);
+		if (!Source || Source->State == EVPWarmState::Error)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Switch to %s abandoned, the input stays on %s"), *GetNameSafe(Pending), *GetNameSafe(Active));
+			Pending = nullptr;
+		}
+		else if (Source->State == EVPWarmState::Ready)
+		{
+			CompleteSwitch();
+		}
+		else if (GFrameCounter - PendingFrame >= (uint64)SwitchTimeoutFrames)
+		{
+			// Paused or stalled players stay opening forever, the switch can't be left hanging
+			UE_LOG(LogTemp, Warning, TEXT("Switch to %s abandoned, not settled after %d frames, the input stays on %s"), *GetNameSafe(Pending), SwitchTimeoutFrames, *GetNameSafe(Active));
+			Pending = nullptr;
+		}
+	}
+
+	Trim();
+}
+
+void UVPMediaWarmStartSubsystem::CompleteSwitch()
+{
+	UMediaBundle* Previous = Active;
+	Active = Pending;
+	Pending = nullptr;
+
+	LastSwitchFrames = (int32)(GFrameCounter - PendingFrame);
+	SwitchLatencies.Add(FPlatformTime::Seconds() - PendingTime);
+	Find(Active)->LastActiveTime = FPlatformTime::Seconds();
+	if (FVPWarmSource* PreviousSource = Find(Previous))
+	{
+		PreviousSource->LastActiveTime = FPlatformTime::Seconds();
+	}
+
+	OnMediaSwitched.Broadcast(Previous, Active, Active->GetMediaTexture());
+}
+
+void UVPMediaWarmStartSubsystem::Trim()
+{
+	const int64 Budget = (int64)MemoryBudgetMB * 1024 * 1024;
+	for (;;)
+	{
+		int64 Total = 0;
+		int32 Oldest = INDEX_NONE;
+		for (int32 Index = 0; Index < Sources.Num(); ++Index)
+		{
+			const FVPWarmSource& Source = Sources[Index];
+			Total += Source.EstimatedBytes;
+
+			// Failed players go first, then the ones inactive the longest
+			if (Source.Bundle == Active || Source.Bundle == Pending)
+				continue;
+
+			auto EvictionKey = [](const FVPWarmSource& Candidate) { return MakeTuple(Candidate.State != EVPWarmState::Error, Candidate.LastActiveTime); };
+			if (Oldest == INDEX_NONE || EvictionKey(Source) < EvictionKey(Sources[Oldest]))
+			{
+				Oldest = Index;
+			}
+		}
+
+		if (Total <= Budget || Oldest == INDEX_NONE)
+			break;
+
+		UE_LOG(LogTemp, Log, TEXT("Media bundle %s closed to stay within %d MB"), *GetNameSafe(Sources[Oldest].Bundle), MemoryBudgetMB);
+		Close(Oldest);
+	}
+}
+
+void UVPMediaWarmStartSubsystem::Close(int32 Index)
+{
+	if (UMediaBundle* Bundle = Sources[Index].Bundle)
+	{
+		Bundle->CloseMediaSource();
+	}
+	Sources.RemoveAt(Index);
+}
+
+FVPWarmSource* UVPMediaWarmStartSubsystem::Find(UMediaBundle* Bundle)
+{
+	return Bundle ? Sources.FindByPredicate([Bundle](const FVPWarmSource& Source) { return Source.Bundle == Bundle; }) : nullptr;
+}
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPMotionFilter.h"
+
+namespace VPMotionFilter
+{
+	// Longer gaps than this restart the filters from the input instead of smoothing across them
+	static constexpr double MaxDeltaTime = 0.5;
+
+	static double SmoothingAlpha(double CutoffHz, double DeltaTime)
+	{
+		const double Tau = 1.0 / (UE_TWO_PI * FMath::Max(CutoffHz, 1.0e-3));
+		return 1.0 / (1.0 + Tau / DeltaTime);
+	}
+}
+
+void FVPMotionFilter::Reset()
+{
+	bInitialized = false;
+}
+
+const FVPAxisFilterParams& FVPMotionFilter::GetParams(const FVPMotionFilterSettings& Settings, int32 Axis)
+{
+	switch (Axis)
+	{
+	case AxisX: return Settings.X;
+	case AxisY: return Settings.Y;
+	case AxisZ: return Settings.Z;
+	case AxisPan: return Settings.Pan;
+	case AxisTilt: return Settings.Tilt;
+	case AxisRoll: return Settings.Roll;
+	case AxisFocalLength: return Settings.FocalLength;
+	default: return Settings.FocusDistance;
+	}
+}
+
+void FVPMotionFilter::Apply(const FVPMotionFilterSettings& Settings, double Time, FVPTrackingSample& InOutSample)
+{
+	if (Settings.Mode == EVPMotionFilterMode::None)
+	{
+		bInitialized = false;
+		return;
+	}
+
+	const FRotator Rotation = InOutSample.Rotation.Rotator();
+	double Inputs[NumAxes] =
+	{
+		InOutSample.Location.X,
+		InOutSample.Location.Y,
+		InOutSample.Location.Z,
+		Rotation.Yaw,
+		Rotation.Pitch,
+		Rotation.Roll,
+		InOutSample.FocalLength,
+		InOutSample.FocusDistance
+	};
+
+	const double DeltaTime = Time - LastTime;
+	LastTime = Time;
+
+	// A clock going backwards is a seek or a timecode jump
+	if (!bInitialized || Settings.Mode != LastMode || DeltaTime < 0.0 || DeltaTime > VPMotionFilter::MaxDeltaTime)
+	{
+		for (int32 Axis = 0; Axis < NumAxes; ++Axis)
+		{
+			Axes[Axis] = FAxisState();
+			Axes[Axis].Raw = Inputs[Axis];
+			Axes[Axis].Value = Inputs[Axis];
+		}
+		LastMode = Settings.Mode;
+		bInitialized = true;
+		return;
+	}
+
+	// Evaluated twice at the same time, the state is already up to date
+	const bool bAdvance = DeltaTime > 0.0;
+
+	const double Prediction = Settings.PredictionMs * 0.001;
+	double Outputs[NumAxes];
+	for (int32 Axis = 0; Axis < NumAxes; ++Axis)
+	{
+		FAxisState& State = Axes[Axis];
+
+		if (bAdvance)
+		{
+			// Keep the angles continuous with the previous frame
+			double Input = Inputs[Axis];
+			if (Axis == AxisPan || Axis == AxisTilt || Axis == AxisRoll)
+			{
+				Input = State.Raw + FRotator::NormalizeAxis(Input - State.Raw);
+			}
+
+			const FVPAxisFilterParams& Params = GetParams(Settings, Axis);
+			switch (Settings.Mode)
+			{
+			case EVPMotionFilterMode::OneEuro:
+				OneEuro(Params, Input, DeltaTime, State);
+				break;
+			case EVPMotionFilterMode::CriticallyDamped:
+				CriticallyDamped(Params, Input, DeltaTime, State);
+				break;
+			default:
+				Predictive(Params, Input, DeltaTime, State);
+				break;
+			}
+			State.Raw = Input;
+		}
+
+		Outputs[Axis] = State.Value + State.Velocity * Prediction + 0.5 * State.Acceleration * Prediction * Prediction;
+	}
+
+	InOutSample.Location = FVector(Outputs[AxisX], Outputs[AxisY], Outputs[AxisZ]);
+	InOutSample.Rotation = FRotator(Outputs[AxisTilt], Outputs[AxisPan], Outputs[AxisRoll]).Quaternion();
+	InOutSample.FocalLength = (float)FMath::Max(Outputs[AxisFocalLength], 0.0);
+	InOutSample.FocusDistance = (float)FMath::Max(Outputs[AxisFocusDistance], 0.0);
+}
+
+void FVPMotionFilter::OneEuro(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State)
+{
+	// Casiez et al. The speed is smoothed first, then sets how far the cutoff opens
+	const double RawVelocity = (Input - State.Raw) / DeltaTime;
+	State.Velocity = FMath::Lerp(State.Velocity, RawVelocity, VPMotionFilter::SmoothingAlpha(Params.DerivativeCutoff, DeltaTime));
+
+	const double Cutoff = Params.MinCutoff + Params.Beta * FMath::Abs(State.Velocity);
+	State.Value = FMath::Lerp(State.Value, Input, VPMotionFilter::SmoothingAlpha(Cutoff, DeltaTime));
+}
+
+void FVPMotionFilter::CriticallyDamped(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State)
+{
+	// Critically damped spring towards the input, with the usual polynomial fit of the exponential
+	const double Omega = 2.0 / FMath::Max(Params.SmoothingTime, 1.0e-3f);
+	const double X = Omega * DeltaTime;
+	const double Decay = 1.0 / (1.0 + X + 0.48 * X * X + 0.235 * X * X * X);
+
+	const double Change = State.Value - Input;
+	const double Temp = (State.Velocity + Omega * Change) * DeltaTime;
+	State.Velocity = (State.Velocity - Omega * Temp) * Decay;
+	State.Value = Input + (Change + Temp) * Decay;
+}
+
+void FVPMotionFilter::Predictive(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State)
+{
+	// Alpha-beta-gamma tracker with critically damped gains, one damping parameter sets all three
+	const double Theta = FMath::Clamp((double)Params.PredictionDamping, 0.0, 0.99);
+	const double Gain = 1.0 - Theta * Theta * Theta;
+	const double VelocityGain = 1.5 * (1.0 - Theta) * (1.0 - Theta) * (1.0 + Theta);
+	const double AccelerationGain = 0.5 * (1.0 - Theta) * (1.0 - Theta) * (1.0 - Theta);
+
+	const double Predicted = State.Value + State.Velocity * DeltaTime + 0.5 * State.Acceleration * DeltaTime * DeltaTime;
+	const double PredictedVelocity = State.Velocity + State.Acceleration * DeltaTime;
+	const double Residual = Input - Predicted;
+
+	State.Value = Predicted + Gain * Residual;
+	State.Velocity = PredictedVelocity + VelocityGain * Residual / DeltaTime;
+	State.Acceleration += 2.0 * AccelerationGain * Residual / (DeltaTime * DeltaTime);
+}
@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPNodalSolver.h"
+#include "Async/ParallelFor.h"
+
+namespace VPNodalSolver
+{
+	static constexpr int32 NumParams = 6;
+	static constexpr int32 MaxIterations = 50;
+	static constexpr double DerivativeStep = 1.0e-6;
+
+	// Observation in the tracked point's frame with the lens folded into a focal length in pixels
+	struct FPrepared
+	{
+		FVector3d LocalPoint;
+		FVector3d NodalShift;
+		double FocalPixels;
+		double U;
+		double V;
+	};
+
+	// Rotation vector (radians) then translation (cm)
+	using FParams = double[NumParams];
+
+	static FTransform ToTransform(const FParams Params)
+	{
+		const FVector3d RotationVector(Params[0], Params[1], Params[2]);
+		const double Angle = RotationVector.Size();
+		const FQuat Rotation = Angle > UE_DOUBLE_SMALL_NUMBER ? FQuat(RotationVector / Angle, Angle) : FQuat::Identity;
+		return FTransform(Rotation, FVector(Params[3], Params[4], Params[5]));
+	}
+
+	static void FromTransform(const FTransform& Transform, FParams OutParams)
+	{
+		FVector Axis;
+		double Angle;
+		Transform.GetRotation().GetNormalized().ToAxisAndAngle(Axis, Angle);
+		const FVector RotationVector = Axis * FMath::UnwindRadians(Angle);
+		OutParams[0] = RotationVector.X;
+		OutParams[1] = RotationVector.Y;
+		OutParams[2] = RotationVector.Z;
+		OutParams[3] = Transform.GetLocation().X;
+		OutParams[4] = Transform.GetLocation().Y;
+		OutParams[5] = Transform.GetLocation().Z;
+	}
+
+	// Reprojection error in pixels, camera looking down +X with Y right and Z up like a UE camera
+	static void Residual(const FParams Params, const FPrepared& Observation, double& OutU, double& OutV)
+	{
+		FTransform Offset = ToTransform(Params);
+		Offset.AddToTranslation(Observation.NodalShift);
+		const FVector3d CameraPoint = Offset.InverseTransformPositionNoScale(Observation.LocalPoint);
+		if (CameraPoint.X <= UE_KINDA_SMALL_NUMBER)
+		{
+			// Behind the lens, a large constant keeps the solver away from it
+			OutU = 1.0e4;
+			OutV = 1.0e4;
+			return;
+		}
+
+		OutU = Observation.FocalPixels * CameraPoint.Y / CameraPoint.X - Observation.U;
+		OutV = -Observation.FocalPixels * CameraPoint.Z / CameraPoint.X - Observation.V;
+	}
+
+	static double ErrorSquared(const FParams Params, const FPrepared& Observation)
+	{
+		double U, V;
+		Residual(Params, Observation, U, V);
+		return U * U + V * V;
+	}
+
+	// Gaussian elimination with partial pivoting on the 6x6 normal equations
+	static bool SolveLinear(double A[NumParams][NumParams], double B[NumParams], double OutX[NumParams])
+	{
+		for (int32 Column = 0; Column < NumParams; ++Column)
+		{
+			int32 Pivot = Column;
+			for (int32 Row = Column + 1; Row < NumParams; ++Row)
+			{
+				if (FMath::Abs(A[Row][Column]) > FMath::Abs(A[Pivot][Column]))
+				{
+					Pivot = Row;
+				}
+			}
+			if (FMath::Abs(A[Pivot][Column]) < 1.0e-18)
+				return false;
+
+			if (Pivot != Column)
+			{
+				for (int32 Index = 0; Index < NumParams; ++Index)
+				{
+					Swap(A[Pivot][Index], A[Column][Index]);
+				}
+				Swap(B[Pivot], B[Column]);
+			}
+
+			for (int32 Row = Column + 1; Row < NumParams; ++Row)
+			{
+				const double Factor = A[Row][Column] / A[Column][Column];
+				for (int32 Index = Column; Index < NumParams; ++Index)
+				{
+					A[Row][Index] -= Factor * A[Column][Index];
+				}
+				B[Row] -= Factor * B[Column];
+			}
+		}
+
+		for (int32 Row = NumParams - 1; Row >= 0; --Row)
+		{
+			double Sum = B[Row];
+			for (int32 Index = Row + 1; Index < NumParams; ++Index)
+			{
+				Sum -= A[Row][Index] * OutX[Index];
+			}
+			OutX[Row] = Sum / A[Row][Row];
+		}
+		return true;
+	}
+
+	// Levenberg-Marquardt over the given observations, HuberThreshold <= 0 is plain least squares
+	static double Fit(TArrayView<const FPrepared> Observations, TArrayView<const int32> Indices, double HuberThreshold, FParams InOutParams)
+	{
+		auto Cost = [&](const FParams Params)
+			{
+				double Sum = 0.0;
+				for (const int32 Index : Indices)
+				{
+					const double Error = FMath::Sqrt(ErrorSquared(Params, Observations[Index]));
+					Sum += HuberThreshold > 0.0 && Error > HuberThreshold ? HuberThreshold * (2.0 * Error - HuberThreshold) : Error * Error;
+				}
+				return Sum;
+			};
+
+		double Lambda = 1.0e-3;
+		double CurrentCost = Cost(InOutParams);
+
+		for (int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+		{
+			double Normal[NumParams][NumParams] = {};
+			double Gradient[NumParams] = {};
+
+			for (const int32 Index : Indices)
+			{
+				const FPrepared& Observation = Observations[Index];
+				double U, V;
+				Residual(InOutParams, Observation, U, V);
+
+				const double Error = FMath::Sqrt(U * U + V * V);
+				const double Weight = HuberThreshold > 0.0 && Error > HuberThreshold ? HuberThreshold / Error : 1.0;
+
+				// Forward differences are plenty for six parameters and keep this allocation free
+				double JacobianU[NumParams];
+				double JacobianV[NumParams];
+				for (int32 Param = 0; Param < NumParams; ++Param)
+				{
+					FParams Shifted;
+					FMemory::Memcpy(Shifted, InOutParams, sizeof(FParams));
+					Shifted[Param] += DerivativeStep;
+
+					double ShiftedU, ShiftedV;
+					Residual(Shifted, Observation, ShiftedU, ShiftedV);
+					JacobianU[Param] = (ShiftedU - U) / DerivativeStep;
+					JacobianV[Param] = (ShiftedV - V) / DerivativeStep;
+				}
+
+				for (int32 Row = 0; Row < NumParams; ++Row)
+				{
+					for (int32 Column = 0; Column < NumParams; ++Column)
+					{
+						Normal[Row][Column] += Weight * (JacobianU[Row] * JacobianU[Column] + JacobianV[Row] * JacobianV[Column]);
+					}
+					Gradient[Row] -= Weight * (JacobianU[Row] * U + JacobianV[Row] * V);
+				}
+			}
+
+			bool bImproved = false;
+			while (Lambda < 1.0e10)
+			{
+				double Damped[NumParams][NumParams];
+				double Right[NumParams];
+				FMemory::Memcpy(Damped, Normal, sizeof(Normal));
+				FMemory::Memcpy(Right, Gradient, sizeof(Gradient));
+				for (int32 Param = 0; Param < NumParams; ++Param)
+				{
+					Damped[Param][Param] += Lambda * FMath::Max(Normal[Param][Param], 1.0e-9);
+				}
+
+				double Step[NumParams];
+				FParams Candidate;
+				if (SolveLinear(Damped, Right, Step))
+				{
+					for (int32 Param = 0; Param < NumParams; ++Param)
+					{
+						Candidate[Param] = InOutParams[Param] + Step[Param];
+					}
+
+					const double CandidateCost = Cost(Candidate);
+					if (CandidateCost < CurrentCost)
+					{
+						const double Gain = CurrentCost - CandidateCost;
+						FMemory::Memcpy(InOutParams, Candidate, sizeof(FParams));
+						CurrentCost = CandidateCost;
+						Lambda = FMath::Max(Lambda * 0.3, 1.0e-9);
+						bImproved = Gain > 1.0e-10 * (1.0 + CurrentCost);
+						break;
+					}
+				}
+				Lambda *= 10.0;
+			}
+
+			if (!bImproved)
+				break;
+		}
+		return CurrentCost;
+	}
+
+	struct FHypothesis
+	{
+		FParams Params;
+		int32 NumInliers = 0;
+		double InlierError = UE_DOUBLE_BIG_NUMBER;
+	};
+}
+
+bool FVPNodalSolver::Solve(TArrayView<const FVPNodalObservation> Observations, const FVPNodalSolverSettings& Settings, FVPNodalSolution& OutSolution)
+{
+	using namespace VPNodalSolver;
+
+	OutSolution = FVPNodalSolution();
+	OutSolution.Offset = Settings.InitialOffset;
+
+	const int32 NumObservations = Observations.Num();
+	if (NumObservations < MinimalSetSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Nodal solve needs at least %d observations, got %d"), MinimalSetSize, NumObservations);
+		return false;
+	}
+
+	TArray<FPrepared> Prepared;
+	Prepared.SetNumUninitialized(NumObservations);
+	for (int32 Index = 0; Index < NumObservations; ++Index)
+	{
+		const FVPNodalObservation& Observation = Observations[Index];
+		const double ImageHeight = Settings.ImageWidth * Observation.SensorHeight / FMath::Max(Observation.SensorWidth, 1.0f);
+		Prepared[Index].LocalPoint = Observation.TrackedPose.InverseTransformPositionNoScale(Observation.TargetPoint);
+		Prepared[Index].NodalShift = Observation.NodalShift;
+		Prepared[Index].FocalPixels = Settings.ImageWidth * Observation.FocalLength / FMath::Max(Observation.SensorWidth, 1.0f);
+		Prepared[Index].U = (Observation.ImagePoint.X - 0.5) * Settings.ImageWidth;
+		Prepared[Index].V = (Observation.ImagePoint.Y - 0.5) * ImageHeight;
+	}
+
+	FParams Initial;
+	FromTransform(Settings.InitialOffset, Initial);
+
+	const double ThresholdSquared = FMath::Square((double)Settings.InlierThresholdPixels);
+	auto Score = [&](FHypothesis& Hypothesis)
+		{
+			Hypothesis.NumInliers = 0;
+			Hypothesis.InlierError = 0.0;
+			for (const FPrepared& Observation : Prepared)
+			{
+				const double Error = ErrorSquared(Hypothesis.Params, Observation);
+				if (Error < ThresholdSquared)
+				{
+					++Hypothesis.NumInliers;
+					Hypothesis.InlierError += Error;
+				}
+			}
+		};
+
+	// Every hypothesis is independent, seeded by its index so a solve is reproducible
+	TArray<FHypothesis> Hypotheses;
+	Hypotheses.SetNum(FMath::Max(Settings.Hypotheses, 1));
+	ParallelFor(Hypotheses.Num(), [&](int32 HypothesisIndex)
+		{
+			FRandomStream Random(HypothesisIndex * 7919 + 1);
+			int32 Subset[MinimalSetSize];
+			for (int32 Pick = 0; Pick < MinimalSetSize; ++Pick)
+			{
+				bool bDuplicate;
+				do
+				{
+					Subset[Pick] = Random.RandHelper(NumObservations);
+					bDuplicate = false;
+					for (int32 Previous = 0; Previous < Pick; ++Previous)
+					{
+						bDuplicate |= Subset[Previous] == Subset[Pick];
+					}
+				} while (bDuplicate);
+			}
+
+			FHypothesis& Hypothesis = Hypotheses[HypothesisIndex];
+			FMemory::Memcpy(Hypothesis.Params, Initial, sizeof(FParams));
+			Fit(Prepared, TArrayView<const int32>(Subset, MinimalSetSize), 0.0, Hypothesis.Params);
+			Score(Hypothesis);
+		});
+
+	const FHypothesis* Best = &Hypotheses[0];
+	for (const FHypothesis& Hypothesis : Hypotheses)
+	{
+		if (Hypothesis.NumInliers > Best->NumInliers || (Hypothesis.NumInliers == Best->NumInliers && Hypothesis.InlierError < Best->InlierError))
+		{
+			Best = &Hypothesis;
+		}
+	}
+
+	if (Best->NumInliers < FMath::Max(MinimalSetSize, FMath::CeilToInt32(Settings.MinInlierRatio * NumObservations)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Nodal solve found no consensus, best hypothesis explains %d of %d observations"), Best->NumInliers, NumObservations);
+		OutSolution.NumInliers = Best->NumInliers;
+		return false;
+	}
+
+	// Refine on the consensus set, Huber keeps the observations near the threshold from dominating
+	FHypothesis Refined = *Best;
+	TArray<int32> Inliers;
+	for (int32 Index = 0; Index < NumObservations; ++Index)
+	{
+		if (ErrorSquared(Best->Params, Prepared[Index]) < ThresholdSquared)
+		{
+			Inliers.Add(Index);
+		}
+	}
+	Fit(Prepared, Inliers, Settings.InlierThresholdPixels, Refined.Params);
+	Score(Refined);
+	if (Refined.NumInliers < Best->NumInliers)
+	{
+		Refined = *Best;
+	}
+
+	OutSolution.bSolved = true;
+	OutSolution.Offset = ToTransform(Refined.Params);
+	OutSolution.NumInliers = Refined.NumInliers;
+	OutSolution.RmsErrorPixels = (float)FMath::Sqrt(Refined.InlierError / FMath::Max(Refined.NumInliers, 1));
+	return true;
+}
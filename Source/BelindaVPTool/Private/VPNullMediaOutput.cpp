@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPNullMediaOutput.h"
+
+// Consumes the captured frames, kept apart from the capture object so the writer never touches it
+struct FVPNullFrameSink
+{
+	EVPNullOutputMode Mode = EVPNullOutputMode::Discard;
+	int32 WriteEveryNthFrame = 1;
+	TUniquePtr<FVPFrameWriter> Writer;
+
+	std::atomic<uint64> NumConsumed{ 0 };
+
+	void Consume(FVPFrameBufferRef Frame)
+	{
+		const uint64 Index = NumConsumed.fetch_add(1, std::memory_order_relaxed);
+		if (!Writer.IsValid() || Index % WriteEveryNthFrame != 0)
+			return;
+
+		// The pool buffer is only released once the file is written
+		Writer->Submit(MoveTemp(Frame));
+	}
+};
+
+bool UVPNullMediaOutput::Validate(FString& FailureReason) const
+{
+	if (!Super::Validate(FailureReason))
+		return false;
+
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		FailureReason = FString::Printf(TEXT("Can't validate MediaOutput '%s'. The size is invalid."), *GetName());
+		return false;
+	}
+	if (Mode != EVPNullOutputMode::Discard && OutputDirectory.Path.IsEmpty())
+	{
+		FailureReason = FString::Printf(TEXT("Can't validate MediaOutput '%s'. No output directory is set."), *GetName());
+		return false;
+	}
+	return true;
+}
+
+UMediaCapture* UVPNullMediaOutput::CreateMediaCaptureImpl()
+{
+	UMediaCapture* Result = NewObject<UVPNullMediaCapture>();
+	if (Result)
+	{
+		Result->SetMediaOutput(this);
+	}
+	return Result;
+}
+
+bool UVPNullMediaCapture::InitializeCapture()
+{
+	const UVPNullMediaOutput* Output = CastChecked<UVPNullMediaOutput>(MediaOutput);
+
+	Sink = MakeShared<FVPNullFrameSink, ESPMode::ThreadSafe>();
+	Sink->Mode = Output->Mode;
+	Sink->WriteEveryNthFrame = FMath::Max(Output->WriteEveryNthFrame, 1);
+	if (Output->Mode != EVPNullOutputMode::Discard)
+	{
+		FVPFrameWriterSettings WriterSettings = Output->Writer;
+		WriterSettings.Directory = Output->OutputDirectory.Path;
+		if (Output->Mode == EVPNullOutputMode::RawFiles)
+		{
+			WriterSettings.Format = EVPFrameFileFormat::Raw;
+		}
+		Sink->Writer = MakeUnique<FVPFrameWriter>(WriterSettings);
+	}
+
+	// A full queue and busy workers, plus the frame being copied in: fewer buffers and the pool runs dry
+	// before the writer's drop policy ever applies
+	int32 NumBuffers = FMath::Max(Output->NumBuffers, 1);
+	if (Sink->Writer.IsValid())
+	{
+		const int32 WriterBuffers = Sink->Writer->GetSettings().QueueCapacity + Sink->Writer->GetNumWorkers() + 1;
+		if (NumBuffers < WriterBuffers)
+		{
+			UE_LOG(LogTemp, Log, TEXT("%s: %d buffers raised to %d for the writer queue and workers"), *GetName(), NumBuffers, WriterBuffers);
+			NumBuffers = WriterBuffers;
+		}
+	}
+
+	// Sized for the requested frame, readbacks are packed to that size before they reach us
+	const FIntPoint Size = GetDesiredSize();
+	FramePool = FVPFramePool::Create(NumBuffers, (int64)Size.X * Size.Y * 4);
+
+	SetState(EMediaCaptureState::Capturing);
+	return true;
+}
+
+void UVPNullMediaCapture::StopCaptureImpl(bool bAllowPendingFrameToBeProcess)
+{
+	UE_LOG(LogTemp, Log, TEXT("%s stopped: %llu frames consumed, %llu pool misses"), *GetName(), GetNumFramesConsumed(), FramePool ? FramePool->GetNumExhausted() : 0);
+}
+
+bool UVPNullMediaCapture::HasFinishedProcessing() const
+{
+	return Super::HasFinishedProcessing() && (!Sink || !Sink->Writer || Sink->Writer->IsIdle());
+}
+
+void UVPNullMediaCapture::OnFrameCaptured_RenderingThread(const FCaptureBaseData& InBaseData, TSharedPtr<FMediaCaptureUserData, ESPMode::ThreadSafe> InUserData, void* InBuffer, int32 Width, int32 Height, int32 BytesPerRow)
+{
+	if (!FramePool || !Sink)
+		return;
+
+	// An exhausted pool drops the frame, as a card with no free slot would
+	FVPFrameBufferPtr Frame = FramePool->AcquireAndCopy(InBuffer, Width, Height, BytesPerRow, 4);
+	if (!Frame.IsValid())
+		return;
+
+	Frame->FrameNumber = InBaseData.SourceFrameNumberRenderThread;
+	Frame->Timecode = InBaseData.SourceFrameTimecode;
+	Sink->Consume(Frame.ToSharedRef());
+}
+
+uint64 UVPNullMediaCapture::GetNumFramesConsumed() const
+{
+	return Sink ? Sink->NumConsumed.load(std::memory_order_relaxed) : 0;
+}
+
+uint64 UVPNullMediaCapture::GetNumFramesWritten() const
+{
+	return GetFrameWriter() ? GetFrameWriter()->GetStats().NumWritten : 0;
+}
+
+const FVPFrameWriter* UVPNullMediaCapture::GetFrameWriter() const
+{
+	return Sink ? Sink->Writer.Get() : nullptr;
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPOscBridgeSubsystem.h"
+#include "VPOscPacket.h"
+#include "Async/Async.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace VPOscBenchmark
+{
+	struct FStart
+	{
+		uint64 Messages = 0;
+		uint64 Batches = 0;
+		uint64 Applied = 0;
+		uint64 Frame = 0;
+	};
+
+	// Faders on /bench/fader<N>, all moving at Rate messages per second each
+	static int64 Send(int32 Port, double Rate, double Seconds, int32 NumFaders)
+	{
+		ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		FSocket* Socket = FUdpSocketBuilder(TEXT("VPOscBenchmark")).Build();
+		if (!Socket)
+			return 0;
+
+		TSharedRef<FInternetAddr> Target = SocketSubsystem->CreateInternetAddr();
+		Target->SetLoopbackAddress();
+		Target->SetPort(Port);
+
+		TArray<uint8> Packet;
+		int64 NumSent = 0;
+		int64 Tick = 0;
+		const double Start = FPlatformTime::Seconds();
+		for (double Elapsed = 0.0; Elapsed < Seconds; Elapsed = FPlatformTime::Seconds() - Start)
+		{
+			// Sleep granularity is coarser than 1 ms on some platforms, catch up on the missed ticks
+			for (const int64 Due = (int64)(Elapsed * Rate); Tick < Due; ++Tick)
+			{
+				const float Value = 0.5f + 0.5f * FMath::Sin((float)(Tick / Rate) * UE_TWO_PI);
+				for (int32 Fader = 0; Fader < NumFaders; ++Fader)
+				{
+					TAnsiStringBuilder<32> Address;
+					Address.Appendf("/bench/fader%d", Fader);
+					VPOsc::Encode(Address.ToView(), MakeArrayView(&Value, 1), Packet);
+					int32 BytesSent = 0;
+					NumSent += Socket->SendTo(Packet.GetData(), Packet.Num(), BytesSent, *Target) ? 1 : 0;
+				}
+			}
+			FPlatformProcess::Sleep(0.0005f);
+		}
+
+		SocketSubsystem->DestroySocket(Socket);
+		return NumSent;
+	}
+}
+
+static FAutoConsoleCommand OscBenchCommand(
+	TEXT("BelindaVP.Bench.Osc"),
+	TEXT("Sends fader messages to the OSC bridge on this machine and logs how many reached the game thread. Args: [Port] [Rate] [Seconds] [Faders]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			UVPOscBridgeSubsystem* Bridge = GEngine ? GEngine->GetEngineSubsystem<UVPOscBridgeSubsystem>() : nullptr;
+			const int32 Port = Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 8000;
+			const double Rate = Args.IsValidIndex(1) ? FMath::Max(FCString::Atod(*Args[1]), 1.0) : 1000.0;
+			const double Seconds = Args.IsValidIndex(2) ? FMath::Max(FCString::Atod(*Args[2]), 0.1) : 5.0;
+			const int32 NumFaders = Args.IsValidIndex(3) ? FMath::Clamp(FCString::Atoi(*Args[3]), 1, 128) : 8;
+			if (!Bridge || !Bridge->StartListening(Port))
+				return;
+
+			VPOscBenchmark::FStart Start;
+			Start.Messages = Bridge->GetNumMessages();
+			Start.Batches = Bridge->GetNumBatches();
+			Start.Applied = Bridge->GetNumApplied();
+			Start.Frame = GFrameCounter;
+
+			// The histogram has no snapshot like the counters, earlier traffic would weigh in the percentiles
+			Bridge->ResetLatencies();
+
+			TWeakObjectPtr<UVPOscBridgeSubsystem> WeakBridge = Bridge;
+			Async(EAsyncExecution::Thread, [WeakBridge, Start, Port, Rate, Seconds, NumFaders]()
+				{
+					const int64 NumSent = VPOscBenchmark::Send(Port, Rate, Seconds, NumFaders);
+
+					// Let the last flush reach the game thread before reading the counters there
+					FPlatformProcess::Sleep(0.1f);
+					AsyncTask(ENamedThreads::GameThread, [WeakBridge, Start, NumSent]()
+						{
+							const UVPOscBridgeSubsystem* Bridge = WeakBridge.Get();
+							if (!Bridge)
+								return;
+
+							const uint64 Frames = FMath::Max<uint64>(GFrameCounter - Start.Frame, 1);
+							const uint64 Applied = Bridge->GetNumApplied() - Start.Applied;
+							const FVPHistogram& Latencies = Bridge->GetLatencies();
+							UE_LOG(LogTemp, Log, TEXT("OSC bench: %lld sent, %llu received, %llu batches, %llu updates applied over %llu frames (%.1f per frame)"),
+								NumSent, Bridge->GetNumMessages() - Start.Messages, Bridge->GetNumBatches() - Start.Batches, Applied, Frames, (double)Applied / Frames);
+							UE_LOG(LogTemp, Log, TEXT("OSC bench: receive to apply p50 %.2f ms, p95 %.2f ms, max %.2f ms"),
+								Latencies.GetPercentile(0.5) * 1000.0, Latencies.GetPercentile(0.95) * 1000.0, Latencies.GetMax() * 1000.0);
+						});
+				});
+		}));
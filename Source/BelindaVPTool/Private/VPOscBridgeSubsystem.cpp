@@ -0,0 +1,445 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPOscBridgeSubsystem.h"
+#include "VPStageCueSubsystem.h"
+#include "VPTrackingStats.h"
+#include "Components/SceneComponent.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CoreDelegates.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("OSC apply"), STAT_BelindaVP_OscApply, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("OSC updates/frame"), STAT_BelindaVP_OscUpdatesPerFrame, STATGROUP_BelindaVP);
+
+namespace VPOscBridge
+{
+	static constexpr int32 MaxPacketSize = 65507;
+
+	// Room for a few ms of a busy console while the thread is descheduled
+	static constexpr int32 ReceiveBufferSize = 2 * 1024 * 1024;
+
+	static UVPOscBridgeSubsystem* Get()
+	{
+		return GEngine ? GEngine->GetEngineSubsystem<UVPOscBridgeSubsystem>() : nullptr;
+	}
+}
+
+static FAutoConsoleCommand OscListenCommand(
+	TEXT("BelindaVP.Osc.Listen"),
+	TEXT("Listens for OSC on UDP ports. Args: <Port> [Port...]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPOscBridgeSubsystem* Bridge = VPOscBridge::Get())
+			{
+				for (const FString& Arg : Args)
+				{
+					Bridge->StartListening(FCString::Atoi(*Arg));
+				}
+			}
+		}));
+
+static FAutoConsoleCommand OscStopCommand(
+	TEXT("BelindaVP.Osc.Stop"),
+	TEXT("Closes every OSC port"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UVPOscBridgeSubsystem* Bridge = VPOscBridge::Get())
+			{
+				Bridge->StopAll();
+			}
+		}));
+
+static FAutoConsoleCommand OscStatusCommand(
+	TEXT("BelindaVP.Osc.Status"),
+	TEXT("Logs the OSC ports and how much the receive threads coalesced"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const UVPOscBridgeSubsystem* Bridge = VPOscBridge::Get();
+			if (!Bridge)
+				return;
+
+			FString Ports;
+			for (const int32 Port : Bridge->GetPorts())
+			{
+				Ports += FString::Printf(TEXT(" %d"), Port);
+			}
+			const FVPHistogram& Latencies = Bridge->GetLatencies();
+			UE_LOG(LogTemp, Log, TEXT("OSC ports:%s"), Ports.IsEmpty() ? TEXT(" none") : *Ports);
+			UE_LOG(LogTemp, Log, TEXT("%llu packets, %llu messages, %llu decode errors, %llu batches, %llu updates applied, p95 latency %.2f ms, max %.2f ms"),
+				Bridge->GetNumPackets(), Bridge->GetNumMessages(), Bridge->GetNumDecodeErrors(), Bridge->GetNumBatches(), Bridge->GetNumApplied(),
+				Latencies.GetPercentile(0.95) * 1000.0, Latencies.GetMax() * 1000.0);
+		}));
+
+class UVPOscBridgeSubsystem::FReceiver : public FRunnable
+{
+public:
+	FReceiver(UVPOscBridgeSubsystem& InOwner, int32 InPort, FSocket* InSocket, double InFlushInterval)
+		: Owner(InOwner)
+		, Port(InPort)
+		, Socket(InSocket)
+		, FlushInterval(InFlushInterval)
+	{
+		Sender = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("VPOscReceiver%d"), Port), 0, TPri_AboveNormal);
+	}
+
+	virtual ~FReceiver()
+	{
+		bStopping = true;
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	}
+
+	int32 GetPort() const { return Port; }
+
+	virtual uint32 Run() override
+	{
+		TArray<uint8> Buffer;
+		Buffer.SetNumUninitialized(VPOscBridge::MaxPacketSize);
+
+		double LastFlush = 0.0;
+		while (!bStopping)
+		{
+			if (Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(1.0)))
+			{
+				int32 BytesRead = 0;
+				while (Socket->RecvFrom(Buffer.GetData(), Buffer.Num(), BytesRead, *Sender) && BytesRead > 0)
+				{
+					Receive(Buffer.GetData(), BytesRead);
+				}
+			}
+
+			// An update after a quiet spell goes out right away, a busy surface at most every FlushInterval
+			const double Now = FPlatformTime::Seconds();
+			if (Pending.Num() > 0 && Now - LastFlush >= FlushInterval)
+			{
+				Flush();
+				LastFlush = Now;
+			}
+		}
+		return 0;
+	}
+
+private:
+	void Receive(const uint8* Packet, int32 Size)
+	{
+		Owner.NumPackets.fetch_add(1, std::memory_order_relaxed);
+		NewestReceive = FPlatformTime::Seconds();
+
+		int32 NumDecoded = 0;
+		const bool bValid = VPOsc::Decode(Packet, Size, [this, &NumDecoded](FAnsiStringView Address, TConstArrayView<float> Values)
+			{
+				// Only a new address allocates
+				Scratch.Reset();
+				Scratch.AppendChars(Address.GetData(), Address.Len());
+				VPOsc::FValues& Latest = Pending.FindOrAdd(Scratch);
+				Latest.Reset();
+				Latest.Append(Values.GetData(), Values.Num());
+				++NumDecoded;
+			});
+
+		Owner.NumMessages.fetch_add(NumDecoded, std::memory_order_relaxed);
+		if (!bValid)
+		{
+			Owner.NumDecodeErrors.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void Flush()
+	{
+		FBatch Batch;
+		Batch.ReceiveTime = NewestReceive;
+		Batch.Updates.Reserve(Pending.Num());
+		for (TPair<FString, VPOsc::FValues>& Pair : Pending)
+		{
+			Batch.Updates.Add({ MoveTemp(Pair.Key), MoveTemp(Pair.Value) });
+		}
+		Pending.Reset();
+
+		Owner.Queue.Enqueue(MoveTemp(Batch));
+	}
+
+	UVPOscBridgeSubsystem& Owner;
+	const int32 Port;
+	FSocket* Socket = nullptr;
+	const double FlushInterval;
+	TSharedPtr<FInternetAddr> Sender;
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopping{ false };
+
+	// Latest values by address since the last flush
+	TMap<FString, VPOsc::FValues> Pending;
+	FString Scratch;
+	double NewestReceive = 0.0;
+};
+
+void UVPOscBridgeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &UVPOscBridgeSubsystem::OnBeginFrame);
+	ObjectsReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddUObject(this, &UVPOscBridgeSubsystem::OnObjectsReplaced);
+}
+
+void UVPOscBridgeSubsystem::Deinitialize()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove(ObjectsReplacedHandle);
+
+	StopAll();
+	while (Queue.Dequeue())
+	{
+	}
+	Bindings.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UVPOscBridgeSubsystem::StartListening(int32 Port)
+{
+	if (Port <= 0 || Port > 65535)
+		return false;
+
+	if (Receivers.ContainsByPredicate([Port](const TSharedPtr<FReceiver>& Receiver) { return Receiver->GetPort() == Port; }))
+		return true;
+
+	FSocket* Socket = FUdpSocketBuilder(TEXT("VPOscBridge"))
+		.AsNonBlocking()
+		.BoundToPort(Port)
+		.WithReceiveBufferSize(VPOscBridge::ReceiveBufferSize)
+		.Build();
+	if (!Socket)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Can't listen for OSC on port %d"), Port);
+		return false;
+	}
+
+	Receivers.Emplace(MakeShared<FReceiver>(*this, Port, Socket, FlushIntervalMs / 1000.0));
+	UE_LOG(LogTemp, Log, TEXT("Listening for OSC on port %d"), Port);
+	return true;
+}
+
+void UVPOscBridgeSubsystem::StopListening(int32 Port)
+{
+	Receivers.RemoveAll([Port](const TSharedPtr<FReceiver>& Receiver) { return Receiver->GetPort() == Port; });
+}
+
+void UVPOscBridgeSubsystem::StopAll()
+{
+	Receivers.Empty();
+}
+
+TArray<int32> UVPOscBridgeSubsystem::GetPorts() const
+{
+	TArray<int32> Ports;
+	for (const TSharedPtr<FReceiver>& Receiver : Receivers)
+	{
+		Ports.Add(Receiver->GetPort());
+	}
+	return Ports;
+}
+
+bool UVPOscBridgeSubsystem::Bind(const FVPOscBinding& Binding)
+{
+	if (!Binding.Target || Binding.Address.IsEmpty())
+		return false;
+
+	FResolvedBinding Resolved;
+	Resolved.Target = Binding.Target.Get();
+	Resolved.PropertyPath = Binding.PropertyPath;
+	Resolved.FirstArgument = FMath::Max(Binding.FirstArgument, 0);
+	Resolved.Scale = Binding.Scale;
+	Resolved.Offset = Binding.Offset;
+	if (!Resolve(Resolved, Binding.Address))
+		return false;
+
+	// Good time to forget the targets that were destroyed
+	for (auto It = Bindings.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().Target.IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	Bindings.Add(Binding.Address, MoveTemp(Resolved));
+	return true;
+}
+
+bool UVPOscBridgeSubsystem::Resolve(FResolvedBinding& Binding, const FString& Address)
+{
+	const UObject* Target = Binding.Target.Get();
+	if (!Target)
+		return false;
+
+	TArray<FString> Names;
+	Binding.PropertyPath.ParseIntoArray(Names, TEXT("."));
+
+	Binding.Chain.Reset();
+	const UStruct* Struct = Target->GetClass();
+	for (const FString& Name : Names)
+	{
+		FProperty* Property = Struct ? FindFProperty<FProperty>(Struct, *Name) : nullptr;
+		if (!Property)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("OSC binding %s: %s has no property %s"), *Address, *Target->GetName(), *Binding.PropertyPath);
+			return false;
+		}
+		Binding.Chain.Add(Property);
+
+		const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+		Struct = StructProperty ? StructProperty->Struct : nullptr;
+	}
+
+	const bool bNumeric = !Binding.Chain.IsEmpty() && (Binding.Chain.Last()->IsA<FNumericProperty>() || (Struct && TFieldIterator<FNumericProperty>(Struct)));
+	if (!bNumeric)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("OSC binding %s: %s.%s is not numeric"), *Address, *Target->GetName(), *Binding.PropertyPath);
+		return false;
+	}
+	return true;
+}
+
+void UVPOscBridgeSubsystem::OnObjectsReplaced(const TMap<UObject*, UObject*>& ReplacementMap)
+{
+	// A Blueprint compile or a reload reinstances the targets and frees the properties the chains point to
+	for (auto It = Bindings.CreateIterator(); It; ++It)
+	{
+		FResolvedBinding& Binding = It.Value();
+		if (UObject* const* Replacement = ReplacementMap.Find(Binding.Target.Get(true)))
+		{
+			Binding.Target = *Replacement;
+		}
+		if (!Resolve(Binding, It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UVPOscBridgeSubsystem::Unbind(UObject* Target, const FString& Address)
+{
+	for (auto It = Bindings.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Target == Target && (Address.IsEmpty() || It.Key() == Address))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UVPOscBridgeSubsystem::OnBeginFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BelindaVP_OscApply);
+
+	// Receive threads coalesce per port, this merges the ports and the flushes of the frame
+	double NewestReceive = 0.0;
+	while (TOptional<FBatch> Batch = Queue.Dequeue())
+	{
+		++NumBatches;
+		NewestReceive = FMath::Max(NewestReceive, Batch->ReceiveTime);
+		for (FUpdate& Update : Batch->Updates)
+		{
+			FrameUpdates.FindOrAdd(MoveTemp(Update.Address)) = MoveTemp(Update.Values);
+		}
+	}
+
+	if (FrameUpdates.IsEmpty())
+		return;
+
+	UVPStageCueSubsystem* Cues = bPublishUnboundToCues && GEngine ? GEngine->GetEngineSubsystem<UVPStageCueSubsystem>() : nullptr;
+
+	TSet<UObject*> Touched;
+	TArray<const FResolvedBinding*, TInlineAllocator<4>> Found;
+	for (const TPair<FString, VPOsc::FValues>& Pair : FrameUpdates)
+	{
+		Found.Reset();
+		Bindings.MultiFindPointer(Pair.Key, Found);
+		for (const FResolvedBinding* Binding : Found)
+		{
+			Apply(*Binding, Pair.Value, Touched);
+		}
+
+		if (Found.IsEmpty() && Cues)
+		{
+			const VPOsc::FValues& Values = Pair.Value;
+			FVPStageCue Cue;
+			Cue.Topic = VPStageCueTopics::Osc;
+			Cue.Text = Pair.Key;
+			Cue.Value = Values.IsValidIndex(0) ? Values[0] : 0.0f;
+			Cue.Vector = FVector(Cue.Value, Values.IsValidIndex(1) ? Values[1] : 0.0f, Values.IsValidIndex(2) ? Values[2] : 0.0f);
+			Cues->Publish(Cue);
+		}
+	}
+
+	// Raw property writes skip the transform update, once per component for the whole batch
+	for (UObject* Object : Touched)
+	{
+		if (USceneComponent* Component = Cast<USceneComponent>(Object))
+		{
+			Component->UpdateComponentToWorld();
+		}
+	}
+
+	NumApplied += FrameUpdates.Num();
+	SET_DWORD_STAT(STAT_BelindaVP_OscUpdatesPerFrame, FrameUpdates.Num());
+	Latencies.Add(FPlatformTime::Seconds() - NewestReceive);
+	FrameUpdates.Reset();
+}
+
+void UVPOscBridgeSubsystem::Apply(const FResolvedBinding& Binding, TConstArrayView<float> Values, TSet<UObject*>& OutTouched)
+{
+	UObject* Object = Binding.Target.Get();
+	if (!Object)
+		return;
+
+	void* Container = Object;
+	for (int32 Index = 0; Index < Binding.Chain.Num() - 1; ++Index)
+	{
+		Container = Binding.Chain[Index]->ContainerPtrToValuePtr<void>(Container);
+	}
+
+	const FProperty* Leaf = Binding.Chain.Last();
+	void* Data = Leaf->ContainerPtrToValuePtr<void>(Container);
+
+	int32 Argument = Binding.FirstArgument;
+	auto Write = [&Binding, Values, &Argument](const FNumericProperty* Numeric, void* Value)
+	{
+		if (!Values.IsValidIndex(Argument))
+			return;
+
+		const double Mapped = (double)Values[Argument++] * Binding.Scale + Binding.Offset;
+		if (Numeric->IsFloatingPoint())
+		{
+			Numeric->SetFloatingPointPropertyValue(Value, Mapped);
+		}
+		else
+		{
+			Numeric->SetIntPropertyValue(Value, (int64)FMath::RoundToDouble(Mapped));
+		}
+	};
+
+	if (const FNumericProperty* Numeric = CastField<FNumericProperty>(Leaf))
+	{
+		Write(Numeric, Data);
+	}
+	else if (const FStructProperty* StructProperty = CastField<FStructProperty>(Leaf))
+	{
+		for (TFieldIterator<FNumericProperty> It(StructProperty->Struct); It; ++It)
+		{
+			Write(*It, It->ContainerPtrToValuePtr<void>(Data));
+		}
+	}
+
+	OutTouched.Add(Object);
+}
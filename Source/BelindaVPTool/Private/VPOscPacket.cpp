@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPOscPacket.h"
+
+namespace VPOsc
+{
+	static constexpr int32 MaxBundleDepth = 8;
+	static const ANSICHAR BundleTag[] = "#bundle";
+
+	static int32 Align4(int32 Size)
+	{
+		return (Size + 3) & ~3;
+	}
+
+	static uint32 ReadUInt32(const uint8* In)
+	{
+		return ((uint32)In[0] << 24) | ((uint32)In[1] << 16) | ((uint32)In[2] << 8) | (uint32)In[3];
+	}
+
+	static uint64 ReadUInt64(const uint8* In)
+	{
+		return ((uint64)ReadUInt32(In) << 32) | ReadUInt32(In + 4);
+	}
+
+	static void WriteUInt32(uint8* Out, uint32 Value)
+	{
+		Out[0] = (uint8)(Value >> 24);
+		Out[1] = (uint8)(Value >> 16);
+		Out[2] = (uint8)(Value >> 8);
+		Out[3] = (uint8)Value;
+	}
+
+	// Padded string starting at Offset, Offset moves past its padding
+	static bool ReadString(const uint8* Packet, int32 Size, int32& Offset, FAnsiStringView& OutString)
+	{
+		const ANSICHAR* Start = (const ANSICHAR*)Packet + Offset;
+		int32 Length = 0;
+		while (Offset + Length < Size && Start[Length] != '\0')
+		{
+			++Length;
+		}
+		if (Offset + Length >= Size)
+			return false;
+
+		OutString = FAnsiStringView(Start, Length);
+		Offset += Align4(Length + 1);
+		return Offset <= Size;
+	}
+
+	static bool DecodeMessage(const uint8* Packet, int32 Size, FMessageCallback OnMessage)
+	{
+		int32 Offset = 0;
+		FAnsiStringView Address;
+		if (!ReadString(Packet, Size, Offset, Address) || Address.IsEmpty() || Address[0] != '/')
+			return false;
+
+		// Very old senders leave the type tags out, there is nothing to decode then
+		FAnsiStringView Tags;
+		if (Offset >= Size)
+		{
+			OnMessage(Address, {});
+			return true;
+		}
+		if (!ReadString(Packet, Size, Offset, Tags) || Tags.IsEmpty() || Tags[0] != ',')
+			return false;
+
+		float Values[MaxArguments];
+		int32 NumValues = 0;
+		auto Push = [&Values, &NumValues](float Value)
+		{
+			if (NumValues < MaxArguments)
+			{
+				Values[NumValues++] = Value;
+			}
+		};
+
+		for (int32 TagIndex = 1; TagIndex < Tags.Len(); ++TagIndex)
+		{
+			const ANSICHAR Tag = Tags[TagIndex];
+			const int32 Remaining = Size - Offset;
+			switch (Tag)
+			{
+			case 'f':
+			case 'i':
+			case 'c':
+			case 'r':
+			case 'm':
+				if (Remaining < 4)
+					return false;
+				if (Tag == 'f')
+				{
+					const uint32 Bits = ReadUInt32(Packet + Offset);
+					float Value;
+					FMemory::Memcpy(&Value, &Bits, sizeof(Value));
+					Push(Value);
+				}
+				else if (Tag == 'i')
+				{
+					Push((float)(int32)ReadUInt32(Packet + Offset));
+				}
+				Offset += 4;
+				break;
+
+			case 'd':
+			case 'h':
+			case 't':
+				if (Remaining < 8)
+					return false;
+				if (Tag == 'd')
+				{
+					const uint64 Bits = ReadUInt64(Packet + Offset);
+					double Value;
+					FMemory::Memcpy(&Value, &Bits, sizeof(Value));
+					Push((float)Value);
+				}
+				else if (Tag == 'h')
+				{
+					Push((float)(int64)ReadUInt64(Packet + Offset));
+				}
+				Offset += 8;
+				break;
+
+			case 's':
+			case 'S':
+			{
+				FAnsiStringView Skipped;
+				if (!ReadString(Packet, Size, Offset, Skipped))
+					return false;
+				break;
+			}
+
+			case 'b':
+			{
+				if (Remaining < 4)
+					return false;
+				const uint32 BlobSize = ReadUInt32(Packet + Offset);
+				if (BlobSize > (uint32)(Remaining - 4))
+					return false;
+				Offset += 4 + Align4((int32)BlobSize);
+				break;
+			}
+
+			case 'T':
+				Push(1.0f);
+				break;
+
+			case 'F':
+				Push(0.0f);
+				break;
+
+			case 'N':
+			case 'I':
+			case '[':
+			case ']':
+				break;
+
+			default:
+				// The size of an unknown type can't be guessed, the rest of the message is lost
+				OnMessage(Address, TConstArrayView<float>(Values, NumValues));
+				return false;
+			}
+		}
+
+		OnMessage(Address, TConstArrayView<float>(Values, NumValues));
+		return Offset <= Size;
+	}
+
+	static bool DecodePacket(const uint8* Packet, int32 Size, FMessageCallback OnMessage, int32 Depth)
+	{
+		if (Size < 4 || (Size & 3) != 0)
+			return false;
+
+		if (Packet[0] != '#')
+			return DecodeMessage(Packet, Size, OnMessage);
+
+		// "#bundle", 8 byte time tag, then size prefixed elements
+		if (Depth >= MaxBundleDepth || Size < 16 || FMemory::Memcmp(Packet, BundleTag, sizeof(BundleTag)) != 0)
+			return false;
+
+		int32 Offset = 16;
+		while (Offset + 4 <= Size)
+		{
+			const uint32 ElementSize = ReadUInt32(Packet + Offset);
+			Offset += 4;
+			if (ElementSize > (uint32)(Size - Offset))
+				return false;
+
+			if (!DecodePacket(Packet + Offset, (int32)ElementSize, OnMessage, Depth + 1))
+				return false;
+			Offset += (int32)ElementSize;
+		}
+		return Offset == Size;
+	}
+}
+
+bool VPOsc::Decode(const uint8* Packet, int32 Size, FMessageCallback OnMessage)
+{
+	return Packet && DecodePacket(Packet, Size, OnMessage, 0);
+}
+
+void VPOsc::Encode(FAnsiStringView Address, TConstArrayView<float> Values, TArray<uint8>& OutPacket)
+{
+	const int32 AddressSize = Align4(Address.Len() + 1);
+	const int32 TagsSize = Align4(Values.Num() + 2);
+
+	OutPacket.SetNumZeroed(AddressSize + TagsSize + Values.Num() * 4);
+	uint8* Out = OutPacket.GetData();
+
+	FMemory::Memcpy(Out, Address.GetData(), Address.Len());
+	Out += AddressSize;
+
+	Out[0] = ',';
+	for (int32 Index = 0; Index < Values.Num(); ++Index)
+	{
+		Out[Index + 1] = 'f';
+	}
+	Out += TagsSize;
+
+	for (const float Value : Values)
+	{
+		uint32 Bits;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		WriteUInt32(Out, Bits);
+		Out += 4;
+	}
+}
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPPlatePlayerComponent.h"
+#include "Engine/Texture2D.h"
+#include "Misc/App.h"
+#include "RenderUtils.h"
+
+UVPPlatePlayerComponent::UVPPlatePlayerComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+void UVPPlatePlayerComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	OpenPlate();
+}
+
+void UVPPlatePlayerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClosePlate();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UVPPlatePlayerComponent::OpenPlate()
+{
+	FVPPlateReaderSettings Settings;
+	Settings.FrameRate = FrameRate;
+	Settings.ReadAheadFrames = ReadAheadFrames;
+	Settings.CacheBudgetMB = CacheBudgetMB;
+	Settings.NumWorkers = NumDecodeWorkers;
+	Settings.bLoop = bLoop;
+	Settings.bUseMemoryMapping = bUseMemoryMapping;
+	if (bUseStartTimecode)
+	{
+		Settings.StartTimecode = StartTimecode;
+	}
+
+	DisplayedFrame = INDEX_NONE;
+	if (!Reader.Open(Directory.Path, Settings))
+		return false;
+
+	Playhead = Reader.GetFirstFrame();
+	return true;
+}
+
+void UVPPlatePlayerComponent::ClosePlate()
+{
+	Reader.Close();
+	DisplayedFrame = INDEX_NONE;
+}
+
+void UVPPlatePlayerComponent::Seek(int64 FrameNumber)
+{
+	Playhead = FrameNumber;
+}
+
+void UVPPlatePlayerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!Reader.IsOpen())
+		return;
+
+	int64 FrameNumber = INDEX_NONE;
+	if (bFollowTimecode && FApp::GetTimecode() != FTimecode())
+	{
+		FrameNumber = Reader.GetFrameAtTimecode(FApp::GetTimecode());
+	}
+	else
+	{
+		if (bPlaying)
+		{
+			Playhead += DeltaTime * FrameRate.AsDecimal();
+		}
+
+		// Kept in the plate range, so a looped frame matches the one on screen and isn't uploaded again
+		const int64 Whole = FMath::FloorToInt64(Playhead);
+		FrameNumber = Reader.Wrap(Whole);
+		Playhead += FrameNumber - Whole;
+	}
+
+	if (FrameNumber == INDEX_NONE || FrameNumber == DisplayedFrame)
+		return;
+
+	// A frame still being read keeps the previous one on screen instead of stalling the game thread
+	if (FVPPlateFramePtr Frame = Reader.GetFrame(FrameNumber))
+	{
+		Upload(Frame);
+		DisplayedFrame = Frame->FrameNumber;
+	}
+}
+
+void UVPPlatePlayerComponent::Upload(const FVPPlateFramePtr& Frame)
+{
+	const int32 Width = Frame->Image.SizeX;
+	const int32 Height = Frame->Image.SizeY;
+
+	if (!Texture || Texture->GetSizeX() != Width || Texture->GetSizeY() != Height)
+	{
+		Texture = UTexture2D::CreateTransient(Width, Height, PF_FloatRGBA);
+		Texture->SRGB = false;
+		Texture->UpdateResource();
+		OnTextureCreated.Broadcast(Texture);
+	}
+
+	// The frame and the region live until the render thread copied them
+	const uint32 BytesPerPixel = GPixelFormats[PF_FloatRGBA].BlockBytes;
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Width, Height);
+	FVPPlateFramePtr* Holder = new FVPPlateFramePtr(Frame);
+	Texture->UpdateTextureRegions(0, 1, Region, Width * BytesPerPixel, BytesPerPixel, const_cast<uint8*>(Frame->Image.RawData.GetData()),
+		[Holder](uint8*, const FUpdateTextureRegion2D* InRegions)
+		{
+			delete InRegions;
+			delete Holder;
+		});
+}
@@ -0,0 +1,447 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPPlateReader.h"
+#include "Async/MappedFileHandle.h"
+#include "Containers/Ticker.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "ImageUtils.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+namespace VPPlateReader
+{
+	static bool IsSupportedExtension(const FString& Extension)
+	{
+		return Extension == TEXT("exr") || Extension == TEXT("png") || Extension == TEXT("jpg") || Extension == TEXT("jpeg");
+	}
+
+	// Trailing digits of Plate.0001234 or Plate_0001234
+	static bool ParseFrameNumber(const FString& BaseName, int64& OutFrameNumber)
+	{
+		int32 Start = BaseName.Len();
+		while (Start > 0 && FChar::IsDigit(BaseName[Start - 1]))
+		{
+			--Start;
+		}
+		if (Start == BaseName.Len())
+			return false;
+
+		OutFrameNumber = FCString::Atoi64(*BaseName + Start);
+		return true;
+	}
+}
+
+class FVPPlateReader::FWorker : public FRunnable
+{
+public:
+	FWorker(FVPPlateReader& InOwner, int32 Index)
+		: Owner(InOwner)
+	{
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("VPPlateReader%d"), Index), 0, TPri_BelowNormal);
+	}
+
+	virtual ~FWorker()
+	{
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+	}
+
+	virtual uint32 Run() override
+	{
+		while (!Owner.bStopping)
+		{
+			int64 FrameNumber = 0;
+			if (Owner.PopRequest(FrameNumber))
+			{
+				Owner.Decode(FrameNumber);
+			}
+			else
+			{
+				Owner.WorkEvent->Wait(10);
+			}
+		}
+		return 0;
+	}
+
+private:
+	FVPPlateReader& Owner;
+	FRunnableThread* Thread = nullptr;
+};
+
+FVPPlateReader::~FVPPlateReader()
+{
+	Close();
+}
+
+bool FVPPlateReader::Open(const FString& Directory, const FVPPlateReaderSettings& InSettings)
+{
+	Close();
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Directory / TEXT("*")), true, false);
+
+	TMap<FString, TMap<int64, FString>> ByExtension;
+	for (const FString& File : Files)
+	{
+		const FString Extension = FPaths::GetExtension(File).ToLower();
+		int64 FrameNumber = 0;
+		if (VPPlateReader::IsSupportedExtension(Extension) && VPPlateReader::ParseFrameNumber(FPaths::GetBaseFilename(File), FrameNumber))
+		{
+			ByExtension.FindOrAdd(Extension).Add(FrameNumber, Directory / File);
+		}
+	}
+
+	for (TPair<FString, TMap<int64, FString>>& Pair : ByExtension)
+	{
+		if (Pair.Value.Num() > Frames.Num())
+		{
+			Frames = MoveTemp(Pair.Value);
+		}
+	}
+	if (Frames.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No numbered image sequence in %s"), *Directory);
+		return false;
+	}
+
+	Settings = InSettings;
+	Settings.ReadAheadFrames = FMath::Max(Settings.ReadAheadFrames, 1);
+	FirstFrame = MAX_int64;
+	LastFrame = MIN_int64;
+	for (const TPair<int64, FString>& Pair : Frames)
+	{
+		FirstFrame = FMath::Min(FirstFrame, Pair.Key);
+		LastFrame = FMath::Max(LastFrame, Pair.Key);
+	}
+
+	bStopping = false;
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	const int32 NumWorkers = Settings.NumWorkers > 0 ? Settings.NumWorkers : FMath::Clamp(FPlatformMisc::NumberOfCores() / 2, 1, 16);
+	for (int32 Index = 0; Index < NumWorkers; ++Index)
+	{
+		Workers.Emplace(MakeUnique<FWorker>(*this, Index));
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Plate %s: %d frames, %lld to %lld"), *Directory, Frames.Num(), FirstFrame, LastFrame);
+	return true;
+}
+
+void FVPPlateReader::Close()
+{
+	if (WorkEvent)
+	{
+		{
+			FScopeLock ScopeLock(&Lock);
+			Requests.Reset();
+		}
+
+		bStopping = true;
+		for (int32 Index = 0; Index < Workers.Num(); ++Index)
+		{
+			WorkEvent->Trigger();
+		}
+		Workers.Empty();
+
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+		WorkEvent = nullptr;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Frames.Empty();
+	Cache.Empty();
+	InFlight.Empty();
+	CachedBytes = 0;
+	LastRequested = INDEX_NONE;
+	Direction = 1;
+	NumHits = 0;
+	NumMisses = 0;
+	DecodeTimes.Reset();
+}
+
+int64 FVPPlateReader::GetFrameAtTimecode(const FTimecode& Timecode) const
+{
+	if (!IsOpen())
+		return INDEX_NONE;
+
+	int64 FrameNumber = Timecode.ToFrameNumber(Settings.FrameRate).Value;
+	if (Settings.StartTimecode.IsSet())
+	{
+		FrameNumber += FirstFrame - Settings.StartTimecode->ToFrameNumber(Settings.FrameRate).Value;
+	}
+	FrameNumber = Wrap(FrameNumber);
+	return FrameNumber >= FirstFrame && FrameNumber <= LastFrame ? FrameNumber : INDEX_NONE;
+}
+
+FVPPlateFramePtr FVPPlateReader::GetFrame(int64 FrameNumber)
+{
+	if (!IsOpen())
+		return nullptr;
+
+	FrameNumber = Wrap(FrameNumber);
+
+	FScopeLock ScopeLock(&Lock);
+
+	// Played forward when it follows the last frame, looping included, and backward when it comes before
+	if (LastRequested != INDEX_NONE && FrameNumber != LastRequested)
+	{
+		Direction = FrameNumber > LastRequested || FrameNumber == Wrap(LastRequested + 1) ? 1 : -1;
+	}
+	if (FrameNumber != LastRequested)
+	{
+		LastRequested = FrameNumber;
+		QueueReadAhead(FrameNumber);
+	}
+
+	if (FCacheEntry* Entry = Cache.Find(FrameNumber))
+	{
+		Entry->LastUse = ++UseCounter;
+		NumHits.fetch_add(1, std::memory_order_relaxed);
+		return Entry->Frame;
+	}
+
+	NumMisses.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+FVPPlateFramePtr FVPPlateReader::GetFrameBlocking(int64 FrameNumber, double Timeout)
+{
+	FVPPlateFramePtr Frame = GetFrame(FrameNumber);
+	if (Frame.IsValid() || !Frames.Contains(Wrap(FrameNumber)))
+		return Frame;
+
+	const double EndTime = FPlatformTime::Seconds() + Timeout;
+	while (FPlatformTime::Seconds() < EndTime)
+	{
+		FPlatformProcess::SleepNoStats(0.001f);
+
+		FScopeLock ScopeLock(&Lock);
+		if (const FCacheEntry* Entry = Cache.Find(Wrap(FrameNumber)))
+			return Entry->Frame;
+	}
+	return nullptr;
+}
+
+int64 FVPPlateReader::GetCachedBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return CachedBytes;
+}
+
+void FVPPlateReader::QueueReadAhead(int64 FrameNumber)
+{
+	WindowStart = FrameNumber;
+
+	// Whatever was queued for the previous playhead is stale, frames being decoded still land in the cache
+	Requests.Reset();
+	for (int32 Offset = 0; Offset < Settings.ReadAheadFrames; ++Offset)
+	{
+		const int64 Wanted = Wrap(FrameNumber + Offset * Direction);
+		if (Wanted < FirstFrame || Wanted > LastFrame)
+			break;
+
+		if (Frames.Contains(Wanted) && !Cache.Contains(Wanted) && !InFlight.Contains(Wanted) && !Requests.Contains(Wanted))
+		{
+			Requests.Add(Wanted);
+		}
+	}
+
+	for (int32 Index = 0; Index < FMath::Min(Requests.Num(), Workers.Num()); ++Index)
+	{
+		WorkEvent->Trigger();
+	}
+}
+
+bool FVPPlateReader::PopRequest(int64& OutFrameNumber)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Requests.IsEmpty())
+		return false;
+
+	OutFrameNumber = Requests[0];
+	Requests.RemoveAt(0, 1, EAllowShrinking::No);
+	InFlight.Add(OutFrameNumber);
+	return true;
+}
+
+void FVPPlateReader::Decode(int64 FrameNumber)
+{
+	const FString& Path = Frames.FindChecked(FrameNumber);
+	const double Start = FPlatformTime::Seconds();
+
+	TSharedPtr<FVPPlateFrame, ESPMode::ThreadSafe> Frame = MakeShared<FVPPlateFrame, ESPMode::ThreadSafe>();
+	Frame->FrameNumber = FrameNumber;
+
+	// Mapped, the decoder reads straight from the page cache without a copy of the file
+	bool bDecoded = false;
+	bool bRead = false;
+	if (Settings.bUseMemoryMapping)
+	{
+		TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile.IsValid() ? MappedFile->MapRegion(0, MappedFile->GetFileSize()) : nullptr);
+		if (MappedRegion.IsValid())
+		{
+			bRead = true;
+			bDecoded = FImageUtils::DecompressImage(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), Frame->Image);
+		}
+	}
+	if (!bRead)
+	{
+		TArray64<uint8> FileData;
+		if (FFileHelper::LoadFileToArray(FileData, *Path))
+		{
+			bDecoded = FImageUtils::DecompressImage(FileData.GetData(), FileData.Num(), Frame->Image);
+		}
+	}
+
+	if (bDecoded)
+	{
+		Frame->Image.ChangeFormat(ERawImageFormat::RGBA16F, EGammaSpace::Linear);
+		DecodeTimes.Add(FPlatformTime::Seconds() - Start);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Can't decode plate frame %s"), *Path);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	InFlight.Remove(FrameNumber);
+	if (bDecoded)
+	{
+		CachedBytes += Frame->GetSizeBytes();
+		Cache.Add(FrameNumber, { Frame, ++UseCounter });
+		Trim();
+	}
+}
+
+void FVPPlateReader::Trim()
+{
+	const int64 Budget = (int64)FMath::Max(Settings.CacheBudgetMB, 1) * 1024 * 1024;
+	while (CachedBytes > Budget && Cache.Num() > 1)
+	{
+		// Read-ahead frames are only given up when nothing else is left
+		int64 Oldest = INDEX_NONE;
+		uint64 OldestUse = MAX_uint64;
+		bool bOldestInWindow = true;
+		for (const TPair<int64, FCacheEntry>& Pair : Cache)
+		{
+			if (Pair.Key == LastRequested)
+				continue;
+
+			const bool bInWindow = InWindow(Pair.Key);
+			if ((bOldestInWindow && !bInWindow) || (bInWindow == bOldestInWindow && Pair.Value.LastUse < OldestUse))
+			{
+				Oldest = Pair.Key;
+				OldestUse = Pair.Value.LastUse;
+				bOldestInWindow = bInWindow;
+			}
+		}
+		if (Oldest == INDEX_NONE)
+			break;
+
+		CachedBytes -= Cache.FindChecked(Oldest).Frame->GetSizeBytes();
+		Cache.Remove(Oldest);
+	}
+}
+
+bool FVPPlateReader::InWindow(int64 FrameNumber) const
+{
+	int64 Distance = (FrameNumber - WindowStart) * Direction;
+	if (Settings.bLoop && Distance < 0)
+	{
+		Distance += LastFrame - FirstFrame + 1;
+	}
+	return Distance >= 0 && Distance < Settings.ReadAheadFrames;
+}
+
+int64 FVPPlateReader::Wrap(int64 FrameNumber) const
+{
+	if (!Settings.bLoop || LastFrame < FirstFrame)
+		return FrameNumber;
+
+	const int64 Length = LastFrame - FirstFrame + 1;
+	int64 Offset = (FrameNumber - FirstFrame) % Length;
+	if (Offset < 0)
+	{
+		Offset += Length;
+	}
+	return FirstFrame + Offset;
+}
+
+namespace VPPlateBenchmark
+{
+	struct FRun
+	{
+		FVPPlateReader Reader;
+		int32 NumFrames = 0;
+		int32 NumChecked = 0;
+		int32 NumLate = 0;
+		double Start = 0.0;
+	};
+
+	static TUniquePtr<FRun> Running;
+	static FTSTicker::FDelegateHandle TickHandle;
+
+	// Real time playback, a frame not decoded by its due time is a visible stutter
+	static bool Tick(float)
+	{
+		FRun& Run = *Running;
+		const FFrameRate& FrameRate = Run.Reader.GetSettings().FrameRate;
+		const int32 Due = FMath::Min((int32)((FPlatformTime::Seconds() - Run.Start) * FrameRate.AsDecimal()) + 1, Run.NumFrames);
+		for (; Run.NumChecked < Due; ++Run.NumChecked)
+		{
+			Run.NumLate += Run.Reader.GetFrame(Run.Reader.GetFirstFrame() + Run.NumChecked).IsValid() ? 0 : 1;
+		}
+		if (Run.NumChecked < Run.NumFrames)
+			return true;
+
+		const FVPHistogram& DecodeTimes = Run.Reader.GetDecodeTimes();
+		UE_LOG(LogTemp, Log, TEXT("Plate benchmark, %d frames at %.2f fps:"), Run.NumFrames, FrameRate.AsDecimal());
+		UE_LOG(LogTemp, Log, TEXT("  %d frames not ready in time, %.0f MB cached"), Run.NumLate, Run.Reader.GetCachedBytes() / (1024.0 * 1024.0));
+		UE_LOG(LogTemp, Log, TEXT("  Decode p50 %.1f ms, p95 %.1f ms, max %.1f ms"), DecodeTimes.GetPercentile(0.5) * 1000.0, DecodeTimes.GetPercentile(0.95) * 1000.0, DecodeTimes.GetMax() * 1000.0);
+
+		Running.Reset();
+		TickHandle.Reset();
+		return false;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+			return;
+		if (TickHandle.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Plate benchmark already running"));
+			return;
+		}
+
+		FVPPlateReaderSettings Settings;
+		Settings.FrameRate = FFrameRate(Args.IsValidIndex(2) ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 25, 1);
+		Settings.ReadAheadFrames = Args.IsValidIndex(3) ? FCString::Atoi(*Args[3]) : Settings.ReadAheadFrames;
+		Settings.CacheBudgetMB = Args.IsValidIndex(4) ? FCString::Atoi(*Args[4]) : Settings.CacheBudgetMB;
+
+		TUniquePtr<FRun> Run = MakeUnique<FRun>();
+		if (!Run->Reader.Open(Args[0], Settings))
+			return;
+
+		// Checked from the core ticker, so the engine frame rate has to stay above the plate's for the result to mean anything
+		Run->NumFrames = Args.IsValidIndex(1) ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 250;
+		Run->Start = FPlatformTime::Seconds();
+		Running = MoveTemp(Run);
+		TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&Tick));
+	}
+}
+
+static FAutoConsoleCommand PlateBenchmarkCommand(
+	TEXT("BelindaVP.Bench.Plate"),
+	TEXT("Plays an image sequence through the plate reader at its frame rate and logs the frames that weren't ready. Args: Directory [Frames=250] [FrameRate=25] [ReadAhead=24] [BudgetMB=4096]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&VPPlateBenchmark::Run));
@@ -0,0 +1,391 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPSTMap.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/CityHash.h"
+#include "Math/VectorRegister.h"
+#include "Misc/Crc.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+namespace VPSTMap
+{
+	static constexpr uint32 FileMagic = 0x53505642; // BVPS
+	static constexpr uint32 Version = 2;
+
+	// Fixed point iterations inverting the model for distort maps, converges well below a pixel for broadcast lenses
+	static constexpr int32 InverseIterations = 10;
+
+	struct FFileHeader
+	{
+		uint32 Magic = FileMagic;
+		uint32 Version = VPSTMap::Version;
+		uint32 Width = 0;
+		uint32 Height = 0;
+		uint32 Direction = 0;
+		uint32 Reserved = 0;
+		uint64 Key = 0;
+	};
+	static_assert(sizeof(FFileHeader) == 32, "ST map header layout changed");
+
+	struct FKeyData
+	{
+		uint32 Version;
+		uint32 Width;
+		uint32 Height;
+		uint32 Direction;
+		uint32 LensNameCrc;
+		uint32 SensorNameCrc;
+		float PrincipalX;
+		float PrincipalY;
+		float SensorWidth;
+		float SensorHeight;
+		float FocalLength;
+		float K1;
+		float K2;
+		float K3;
+		float P1;
+		float P2;
+	};
+
+	struct FCoefficients
+	{
+		VectorRegister4Float K1;
+		VectorRegister4Float K2;
+		VectorRegister4Float K3;
+		VectorRegister4Float P1;
+		VectorRegister4Float P2;
+	};
+
+	// Brown-Conrady on lens coordinates, returns the radial factor and the tangential terms separately
+	static FORCEINLINE void Evaluate(const VectorRegister4Float& X, const VectorRegister4Float& Y, const FCoefficients& C,
+		VectorRegister4Float& OutRadial, VectorRegister4Float& OutTangentialX, VectorRegister4Float& OutTangentialY)
+	{
+		const VectorRegister4Float Two = VectorSetFloat1(2.0f);
+		const VectorRegister4Float X2 = VectorMultiply(X, X);
+		const VectorRegister4Float Y2 = VectorMultiply(Y, Y);
+		const VectorRegister4Float R2 = VectorAdd(X2, Y2);
+		const VectorRegister4Float TwoXY = VectorMultiply(Two, VectorMultiply(X, Y));
+
+		OutRadial = VectorMultiplyAdd(R2, VectorMultiplyAdd(R2, VectorMultiplyAdd(R2, C.K3, C.K2), C.K1), VectorOneFloat());
+		OutTangentialX = VectorMultiplyAdd(C.P1, TwoXY, VectorMultiply(C.P2, VectorMultiplyAdd(Two, X2, R2)));
+		OutTangentialY = VectorMultiplyAdd(C.P2, TwoXY, VectorMultiply(C.P1, VectorMultiplyAdd(Two, Y2, R2)));
+	}
+}
+
+FVPSTMap::~FVPSTMap()
+{
+	Data = nullptr;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+uint32 FVPSTMap::ComputeChecksum() const
+{
+	return Data ? FCrc::MemCrc32(Data, Width * Height * sizeof(FVector2f)) : 0;
+}
+
+TSharedPtr<FVPSTMap> FVPSTMap::Generate(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 InWidth, int32 InHeight, EVPSTMapDirection InDirection)
+{
+	using namespace VPSTMap;
+
+	if (InWidth <= 0 || InHeight <= 0)
+		return nullptr;
+
+	TSharedPtr<FVPSTMap> Map = MakeShared<FVPSTMap>();
+	Map->Width = InWidth;
+	Map->Height = InHeight;
+	Map->Direction = InDirection;
+	Map->Pixels.SetNumUninitialized(InWidth * InHeight);
+	Map->Data = Map->Pixels.GetData();
+
+	// Lens coordinates are in focal length units around the principal point, T runs bottom to top
+	const float CentreS = Lens.PrincipalPoint.X;
+	const float CentreT = 1.0f - Lens.PrincipalPoint.Y;
+	const float FocalLength = Sample.FocalLength > 0.0f ? Sample.FocalLength : Lens.MinFocalLength;
+	const float ScaleX = FocalLength > 0.0f ? Lens.SensorWidth / FocalLength : 1.0f;
+	const float ScaleY = FocalLength > 0.0f ? Lens.SensorHeight / FocalLength : 1.0f;
+
+	FCoefficients Coefficients;
+	Coefficients.K1 = VectorSetFloat1(Sample.K1);
+	Coefficients.K2 = VectorSetFloat1(Sample.K2);
+	Coefficients.K3 = VectorSetFloat1(Sample.K3);
+	Coefficients.P1 = VectorSetFloat1(Sample.P1);
+	Coefficients.P2 = VectorSetFloat1(Sample.P2);
+
+	const bool bInverse = InDirection == EVPSTMapDirection::Distort;
+	FVector2f* Pixels = Map->Pixels.GetData();
+
+	ParallelFor(InHeight, [&](int32 Row)
+		{
+			const VectorRegister4Float Centre = VectorSetFloat1(CentreS);
+			const VectorRegister4Float CentreY = VectorSetFloat1(CentreT);
+			const VectorRegister4Float Lanes = MakeVectorRegisterFloat(0.5f, 1.5f, 2.5f, 3.5f);
+			const VectorRegister4Float InvWidth = VectorSetFloat1(1.0f / InWidth);
+			const VectorRegister4Float LensScaleX = VectorSetFloat1(ScaleX);
+			const VectorRegister4Float InvLensScaleX = VectorSetFloat1(1.0f / ScaleX);
+			const VectorRegister4Float InvLensScaleY = VectorSetFloat1(1.0f / ScaleY);
+
+			const float T = 1.0f - (Row + 0.5f) / InHeight;
+			const VectorRegister4Float Y = VectorSetFloat1((T - CentreT) * ScaleY);
+
+			FVector2f* RowPixels = Pixels + Row * InWidth;
+			for (int32 Column = 0; Column < InWidth; Column += 4)
+			{
+				const VectorRegister4Float S = VectorMultiply(VectorAdd(VectorSetFloat1((float)Column), Lanes), InvWidth);
+				const VectorRegister4Float X = VectorMultiply(VectorSubtract(S, Centre), LensScaleX);
+
+				VectorRegister4Float OutX, OutY;
+				VectorRegister4Float Radial, TangentialX, TangentialY;
+				if (!bInverse)
+				{
+					Evaluate(X, Y, Coefficients, Radial, TangentialX, TangentialY);
+					OutX = VectorMultiplyAdd(X, Radial, TangentialX);
+					OutY = VectorMultiplyAdd(Y, Radial, TangentialY);
+				}
+				else
+				{
+					OutX = X;
+					OutY = Y;
+					for (int32 Iteration = 0; Iteration < InverseIterations; ++Iteration)
+					{
+						Evaluate(OutX, OutY, Coefficients, Radial, TangentialX, TangentialY);
+						OutX = VectorDivide(VectorSubtract(X, TangentialX), Radial);
+						OutY = VectorDivide(VectorSubtract(Y, TangentialY), Radial);
+					}
+				}
+
+				float OutS[4];
+				float OutT[4];
+				VectorStore(VectorMultiplyAdd(OutX, InvLensScaleX, Centre), OutS);
+				VectorStore(VectorMultiplyAdd(OutY, InvLensScaleY, CentreY), OutT);
+
+				const int32 NumLanes = FMath::Min(4, InWidth - Column);
+				for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+				{
+					RowPixels[Column + Lane] = FVector2f(OutS[Lane], OutT[Lane]);
+				}
+			}
+		});
+
+	return Map;
+}
+
+TSharedPtr<FVPSTMap> FVPSTMap::Load(const FString& FilePath, uint64 ExpectedKey)
+{
+	using namespace VPSTMap;
+
+	TSharedPtr<FVPSTMap> Map = MakeShared<FVPSTMap>();
+	Map->MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (!Map->MappedFile.IsValid() || Map->MappedFile->GetFileSize() < (int64)sizeof(FFileHeader))
+		return nullptr;
+
+	Map->MappedRegion.Reset(Map->MappedFile->MapRegion(0, Map->MappedFile->GetFileSize()));
+	if (!Map->MappedRegion.IsValid())
+		return nullptr;
+
+	FFileHeader Header;
+	FMemory::Memcpy(&Header, Map->MappedRegion->GetMappedPtr(), sizeof(FFileHeader));
+	const int64 ExpectedSize = (int64)sizeof(FFileHeader) + (int64)Header.Width * Header.Height * sizeof(FVector2f);
+	if (Header.Magic != FileMagic || Header.Version != Version || Header.Key != ExpectedKey || Map->MappedRegion->GetMappedSize() != ExpectedSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring stale ST map cache file %s"), *FilePath);
+		return nullptr;
+	}
+
+	Map->Width = Header.Width;
+	Map->Height = Header.Height;
+	Map->Direction = (EVPSTMapDirection)Header.Direction;
+	Map->Data = reinterpret_cast<const FVector2f*>(Map->MappedRegion->GetMappedPtr() + sizeof(FFileHeader));
+	return Map;
+}
+
+bool FVPSTMap::Save(const FString& FilePath, uint64 Key) const
+{
+	using namespace VPSTMap;
+
+	if (!Data)
+		return false;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+
+	// Written aside then moved in place, so a reader never maps a half written file
+	const FString TempPath = FilePath + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+	{
+		TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*TempPath));
+		if (!File.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't write ST map cache file %s"), *TempPath);
+			return false;
+		}
+
+		FFileHeader Header;
+		Header.Width = Width;
+		Header.Height = Height;
+		Header.Direction = (uint32)Direction;
+		Header.Key = Key;
+		if (!File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FFileHeader))
+			|| !File->Write(reinterpret_cast<const uint8*>(Data), (int64)Width * Height * sizeof(FVector2f)))
+		{
+			File.Reset();
+			PlatformFile.DeleteFile(*TempPath);
+			return false;
+		}
+	}
+
+	// Another process may have produced the same map meanwhile, both files are identical
+	PlatformFile.DeleteFile(*FilePath);
+	if (!PlatformFile.MoveFile(*FilePath, *TempPath))
+	{
+		PlatformFile.DeleteFile(*TempPath);
+		return false;
+	}
+	return true;
+}
+
+uint64 FVPSTMapCache::ComputeKey(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 Width, int32 Height, EVPSTMapDirection Direction)
+{
+	VPSTMap::FKeyData KeyData;
+	FMemory::Memzero(KeyData);
+	KeyData.Version = VPSTMap::Version;
+	KeyData.Width = Width;
+	KeyData.Height = Height;
+	KeyData.Direction = (uint32)Direction;
+	KeyData.LensNameCrc = FCrc::StrCrc32(*Lens.LensName.ToString());
+	KeyData.SensorNameCrc = FCrc::StrCrc32(*Lens.SensorName);
+	KeyData.PrincipalX = Lens.PrincipalPoint.X;
+	KeyData.PrincipalY = Lens.PrincipalPoint.Y;
+	KeyData.SensorWidth = Lens.SensorWidth;
+	KeyData.SensorHeight = Lens.SensorHeight;
+	KeyData.FocalLength = Sample.FocalLength;
+	KeyData.K1 = Sample.K1;
+	KeyData.K2 = Sample.K2;
+	KeyData.K3 = Sample.K3;
+	KeyData.P1 = Sample.P1;
+	KeyData.P2 = Sample.P2;
+	return CityHash64(reinterpret_cast<const char*>(&KeyData), sizeof(KeyData));
+}
+
+FString FVPSTMapCache::GetCacheDirectory()
+{
+	return FPaths::ProjectSavedDir() / TEXT("BelindaVP") / TEXT("STMaps");
+}
+
+FString FVPSTMapCache::GetCachePath(uint64 Key)
+{
+	return GetCacheDirectory() / FString::Printf(TEXT("%016llx.stmap"), Key);
+}
+
+TSharedPtr<const FVPSTMap> FVPSTMapCache::FindOrGenerate(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 Width, int32 Height, EVPSTMapDirection Direction)
+{
+	static FCriticalSection Lock;
+	static TMap<uint64, TWeakPtr<const FVPSTMap>> LiveMaps;
+	// Keys being loaded or generated, the file of a key is only ever written by one thread at a time
+	static TSet<uint64> PendingKeys;
+
+	const uint64 Key = ComputeKey(Lens, Sample, Width, Height, Direction);
+	for (;;)
+	{
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (const TWeakPtr<const FVPSTMap>* Found = LiveMaps.Find(Key))
+			{
+				if (TSharedPtr<const FVPSTMap> Live = Found->Pin())
+					return Live;
+			}
+			if (!PendingKeys.Contains(Key))
+			{
+				PendingKeys.Add(Key);
+				break;
+			}
+		}
+		FPlatformProcess::SleepNoStats(0.001f);
+	}
+
+	// Generated outside the lock, other keys go on meanwhile
+	const FString CachePath = GetCachePath(Key);
+	TSharedPtr<const FVPSTMap> Map = FVPSTMap::Load(CachePath, Key);
+	if (!Map.IsValid())
+	{
+		TSharedPtr<FVPSTMap> Generated = FVPSTMap::Generate(Lens, Sample, Width, Height, Direction);
+		if (Generated.IsValid())
+		{
+			Generated->Save(CachePath, Key);
+		}
+		Map = Generated;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	PendingKeys.Remove(Key);
+	if (!Map.IsValid())
+		return nullptr;
+
+	for (auto It = LiveMaps.CreateIterator(); It; ++It)
+	{
+		if (!It->Value.IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	LiveMaps.Add(Key, Map);
+	return Map;
+}
+
+void FVPSTMapCache::ClearDiskCache()
+{
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(GetCacheDirectory() / TEXT("*.stmap")), true, false);
+	for (const FString& File : Files)
+	{
+		IFileManager::Get().Delete(*(GetCacheDirectory() / File));
+	}
+}
+
+static FAutoConsoleCommand STMapGenerateCommand(
+	TEXT("BelindaVP.STMap"),
+	TEXT("Generates or loads a cached ST map and logs its checksum. Args: Width Height FocalLength K1 [K2] [K3] [P1] [P2] [Distort]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.Num() < 4)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Usage: BelindaVP.STMap Width Height FocalLength K1 [K2] [K3] [P1] [P2] [Distort]"));
+				return;
+			}
+
+			auto FloatArg = [&Args](int32 Index) { return Args.IsValidIndex(Index) ? FCString::Atof(*Args[Index]) : 0.0f; };
+
+			FVPLensSettings Lens;
+			FVPLensGridSample Sample;
+			Sample.FocalLength = FloatArg(2);
+			Sample.K1 = FloatArg(3);
+			Sample.K2 = FloatArg(4);
+			Sample.K3 = FloatArg(5);
+			Sample.P1 = FloatArg(6);
+			Sample.P2 = FloatArg(7);
+			const EVPSTMapDirection Direction = Args.IsValidIndex(8) && Args[8].Equals(TEXT("Distort"), ESearchCase::IgnoreCase) ? EVPSTMapDirection::Distort : EVPSTMapDirection::Undistort;
+
+			const double Begin = FPlatformTime::Seconds();
+			TSharedPtr<const FVPSTMap> Map = FVPSTMapCache::FindOrGenerate(Lens, Sample, FCString::Atoi(*Args[0]), FCString::Atoi(*Args[1]), Direction);
+			const double Seconds = FPlatformTime::Seconds() - Begin;
+			if (!Map.IsValid())
+			{
+				UE_LOG(LogTemp, Error, TEXT("ST map generation failed"));
+				return;
+			}
+
+			UE_LOG(LogTemp, Log, TEXT("ST map %dx%d %s in %.1f ms, crc %08x, %s"), Map->GetWidth(), Map->GetHeight(),
+				Map->IsMapped() ? TEXT("mapped from cache") : TEXT("generated"), Seconds * 1000.0, Map->ComputeChecksum(),
+				*FVPSTMapCache::GetCachePath(FVPSTMapCache::ComputeKey(Lens, Sample, Map->GetWidth(), Map->GetHeight(), Direction)));
+		}));
+
+static FAutoConsoleCommand STMapClearCommand(
+	TEXT("BelindaVP.STMap.Clear"),
+	TEXT("Deletes the ST map disk cache"),
+	FConsoleCommandDelegate::CreateStatic(&FVPSTMapCache::ClearDiskCache));
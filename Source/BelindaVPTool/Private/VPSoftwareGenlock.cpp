@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPSoftwareGenlock.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FrameRate.h"
+
+static FAutoConsoleCommand SoftwareGenlockCommand(
+	TEXT("BelindaVP.Genlock.Software"),
+	TEXT("Replaces the engine time step and timecode provider with the software genlock. Args: [FrameRate] [Realtime|FixedStep|Jitter] [JitterMs] [MissProbability] [Seed]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (!GEngine)
+				return;
+
+			UVPSoftwareGenlockTimeStep* TimeStep = NewObject<UVPSoftwareGenlockTimeStep>(GEngine);
+			if (Args.IsValidIndex(0) && !TryParseString(TimeStep->FrameRate, *Args[0]))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Invalid frame rate %s"), *Args[0]);
+				return;
+			}
+			if (Args.IsValidIndex(1))
+			{
+				TimeStep->Mode = Args[1] == TEXT("FixedStep") ? EVPSoftwareGenlockMode::FixedStep : Args[1] == TEXT("Jitter") ? EVPSoftwareGenlockMode::Jitter : EVPSoftwareGenlockMode::Realtime;
+			}
+			if (Args.IsValidIndex(2))
+			{
+				TimeStep->JitterMilliseconds = FCString::Atof(*Args[2]);
+			}
+			if (Args.IsValidIndex(3))
+			{
+				TimeStep->MissProbability = FMath::Clamp(FCString::Atof(*Args[3]), 0.0f, 1.0f);
+			}
+			if (Args.IsValidIndex(4))
+			{
+				TimeStep->Seed = FCString::Atoi(*Args[4]);
+			}
+
+			UVPSoftwareTimecodeProvider* Timecode = NewObject<UVPSoftwareTimecodeProvider>(GEngine);
+			Timecode->FrameRate = TimeStep->FrameRate;
+
+			if (!GEngine->SetCustomTimeStep(TimeStep) || !GEngine->SetTimecodeProvider(Timecode))
+			{
+				UE_LOG(LogTemp, Error, TEXT("Software genlock could not be installed"));
+				return;
+			}
+
+			UE_LOG(LogTemp, Log, TEXT("Software genlock at %s fps (%s)"), *TimeStep->FrameRate.ToPrettyText().ToString(), *UEnum::GetValueAsString(TimeStep->Mode));
+		}));
+
+bool UVPSoftwareGenlockTimeStep::Initialize(UEngine* InEngine)
+{
+	if (!FrameRate.IsValid() || FrameRate.Numerator <= 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Software genlock needs a valid frame rate"));
+		State = ECustomTimeStepSynchronizationState::Error;
+		return false;
+	}
+
+	Random.Initialize(Seed);
+	StartSeconds = FPlatformTime::Seconds();
+	LastSyncTime = StartSeconds;
+	SyncCount = 0;
+	NumMissedSyncs = 0;
+	LastSyncCountDelta = 1;
+	bLastSyncDataValid = false;
+	State = ECustomTimeStepSynchronizationState::Synchronized;
+	return true;
+}
+
+void UVPSoftwareGenlockTimeStep::Shutdown(UEngine* InEngine)
+{
+	State = ECustomTimeStepSynchronizationState::Closed;
+	bLastSyncDataValid = false;
+}
+
+bool UVPSoftwareGenlockTimeStep::UpdateTimeStep(UEngine* InEngine)
+{
+	if (State != ECustomTimeStepSynchronizationState::Synchronized)
+		return true;
+
+	// Copies the time used by the previous frame into FApp's last time
+	UpdateApplicationLastTime();
+
+	const double TimeBeforeSync = FPlatformTime::Seconds();
+	if (!WaitForSync())
+		return true;
+
+	// The delta is the sync count times the period, the idle time is the wait, zero in fixed step
+	const double TimeAfterSync = Mode == EVPSoftwareGenlockMode::FixedStep ? TimeBeforeSync : FPlatformTime::Seconds();
+	UpdateAppTimes(TimeBeforeSync, TimeAfterSync);
+	return false;
+}
+
+ECustomTimeStepSynchronizationState UVPSoftwareGenlockTimeStep::GetSynchronizationState() const
+{
+	return State;
+}
+
+bool UVPSoftwareGenlockTimeStep::WaitForSync()
+{
+	if (State != ECustomTimeStepSynchronizationState::Synchronized)
+		return false;
+
+	const double Period = FrameRate.AsInterval();
+	uint64 Target = SyncCount + 1;
+
+	if (Mode == EVPSoftwareGenlockMode::FixedStep)
+	{
+		LastSyncTime = StartSeconds + Target * Period;
+	}
+	else
+	{
+		// A late frame waits for the next pulse and skips the ones it missed, as with a card
+		const double Now = FPlatformTime::Seconds();
+		Target = FMath::Max<uint64>(Target, (uint64)FMath::FloorToDouble((Now - StartSeconds) / Period) + 1);
+
+		double Pulse = StartSeconds + Target * Period;
+		if (Mode == EVPSoftwareGenlockMode::Jitter)
+		{
+			// Bounded to keep the pulses in order
+			for (int32 Miss = 0; Miss < 8 && Random.FRand() < MissProbability; ++Miss)
+			{
+				++Target;
+				++NumMissedSyncs;
+			}
+
+			const double Jitter = FMath::Min(JitterMilliseconds * 0.001, Period * 0.45);
+			Pulse = StartSeconds + Target * Period + Random.FRandRange(-1.0f, 1.0f) * Jitter;
+		}
+
+		WaitUntil(Pulse);
+		LastSyncTime = FPlatformTime::Seconds();
+	}
+
+	LastSyncCountDelta = (uint32)(Target - SyncCount);
+	SyncCount = Target;
+	bLastSyncDataValid = true;
+	return true;
+}
+
+void UVPSoftwareGenlockTimeStep::WaitUntil(double Seconds) const
+{
+	const double SpinSeconds = SpinMilliseconds * 0.001;
+	for (double Remaining = Seconds - FPlatformTime::Seconds(); Remaining > 0.0; Remaining = Seconds - FPlatformTime::Seconds())
+	{
+		if (Remaining > SpinSeconds)
+		{
+			FPlatformProcess::SleepNoStats((float)(Remaining - SpinSeconds));
+		}
+		else
+		{
+			FPlatformProcess::YieldCycles(1000);
+		}
+	}
+}
+
+bool UVPSoftwareTimecodeProvider::Initialize(UEngine* InEngine)
+{
+	StartSeconds = FPlatformTime::Seconds();
+	StartOffset = bStartAtTimeOfDay ? FDateTime::Now().GetTimeOfDay().GetTotalSeconds() : 0.0;
+	State = ETimecodeProviderSynchronizationState::Synchronized;
+	return true;
+}
+
+void UVPSoftwareTimecodeProvider::Shutdown(UEngine* InEngine)
+{
+	State = ETimecodeProviderSynchronizationState::Closed;
+}
+
+FFrameRate UVPSoftwareTimecodeProvider::GetRate() const
+{
+	const UVPSoftwareGenlockTimeStep* Genlock = GEngine ? Cast<UVPSoftwareGenlockTimeStep>(GEngine->GetCustomTimeStep()) : nullptr;
+	return Genlock ? Genlock->FrameRate : FrameRate;
+}
+
+bool UVPSoftwareTimecodeProvider::FetchTimecode(FQualifiedFrameTime& OutFrameTime)
+{
+	if (State != ETimecodeProviderSynchronizationState::Synchronized)
+		return false;
+
+	const FFrameRate Rate = GetRate();
+	const int64 StartFrame = Rate.AsFrameTime(StartOffset).FloorToFrame().Value;
+
+	int64 Frame;
+	const UVPSoftwareGenlockTimeStep* Genlock = GEngine ? Cast<UVPSoftwareGenlockTimeStep>(GEngine->GetCustomTimeStep()) : nullptr;
+	if (Genlock && Genlock->GetSynchronizationState() == ECustomTimeStepSynchronizationState::Synchronized)
+	{
+		Frame = StartFrame + (int64)Genlock->GetSyncCount();
+	}
+	else
+	{
+		Frame = StartFrame + (int64)FMath::FloorToDouble((FPlatformTime::Seconds() - StartSeconds) * Rate.AsDecimal());
+	}
+
+	// Timecode wraps at midnight
+	const int64 FramesPerDay = Rate.AsFrameTime(24.0 * 60.0 * 60.0).FloorToFrame().Value;
+	OutFrameTime = FQualifiedFrameTime(FFrameTime(FFrameNumber((int32)(Frame % FramesPerDay))), Rate);
+	return true;
+}
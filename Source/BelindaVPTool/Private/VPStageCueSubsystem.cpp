@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPStageCueSubsystem.h"
+#include "VPTrackingStats.h"
+#include "Algo/StableSort.h"
+#include "Misc/App.h"
+#include "Misc/CoreDelegates.h"
+
+DECLARE_CYCLE_STAT(TEXT("Stage cues"), STAT_BelindaVP_StageCues, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stage cues/frame"), STAT_BelindaVP_StageCuesPerFrame, STATGROUP_BelindaVP);
+
+namespace VPStageCueTopics
+{
+	const FName SetupCamera(TEXT("Camera.Setup"));
+	const FName Trigger(TEXT("Trigger"));
+	const FName Osc(TEXT("Osc"));
+}
+
+void UVPStageCueSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &UVPStageCueSubsystem::Drain);
+}
+
+void UVPStageCueSubsystem::Deinitialize()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+
+	// Nobody will handle them anymore
+	while (Queue.Dequeue())
+	{
+	}
+	Topics.Empty();
+
+	Super::Deinitialize();
+}
+
+void UVPStageCueSubsystem::Post(FVPStageCue Cue)
+{
+	Cue.PostTime = FPlatformTime::Seconds();
+	Queue.Enqueue(MoveTemp(Cue));
+	NumPosted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void UVPStageCueSubsystem::Publish(const FVPStageCue& Cue)
+{
+	check(IsInGameThread());
+
+	FVPStageCue Published = Cue;
+	Published.PostTime = FPlatformTime::Seconds();
+	Published.Timecode = FApp::GetTimecode();
+	NumPosted.fetch_add(1, std::memory_order_relaxed);
+
+	Dispatch(TArrayView<FVPStageCue>(&Published, 1));
+}
+
+FDelegateHandle UVPStageCueSubsystem::Subscribe(FName Topic, FOnVPStageCues::FDelegate Delegate)
+{
+	TSharedPtr<FTopic>& Found = Topics.FindOrAdd(Topic);
+	if (!Found.IsValid())
+	{
+		Found = MakeShared<FTopic>();
+	}
+	return Found->Native.Add(MoveTemp(Delegate));
+}
+
+void UVPStageCueSubsystem::Unsubscribe(FName Topic, FDelegateHandle Handle)
+{
+	if (TSharedPtr<FTopic>* Found = Topics.Find(Topic))
+	{
+		(*Found)->Native.Remove(Handle);
+	}
+}
+
+void UVPStageCueSubsystem::SubscribeToTopic(FName Topic, FVPStageCueHandler Handler)
+{
+	TSharedPtr<FTopic>& Found = Topics.FindOrAdd(Topic);
+	if (!Found.IsValid())
+	{
+		Found = MakeShared<FTopic>();
+	}
+	Found->Handlers.AddUnique(Handler);
+}
+
+void UVPStageCueSubsystem::UnsubscribeFromTopic(FName Topic, FVPStageCueHandler Handler)
+{
+	if (TSharedPtr<FTopic>* Found = Topics.Find(Topic))
+	{
+		(*Found)->Handlers.Remove(Handler);
+	}
+}
+
+void UVPStageCueSubsystem::UnsubscribeAll(const UObject* Listener)
+{
+	for (const TPair<FName, TSharedPtr<FTopic>>& Pair : Topics)
+	{
+		Pair.Value->Native.RemoveAll(Listener);
+		Pair.Value->Handlers.RemoveAll([Listener](const FVPStageCueHandler& Handler) { return !Handler.IsBound() || Handler.GetUObject() == Listener; });
+	}
+}
+
+void UVPStageCueSubsystem::Drain()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BelindaVP_StageCues);
+
+	Batch.Reset();
+	while (TOptional<FVPStageCue> Cue = Queue.Dequeue())
+	{
+		Batch.Add(MoveTemp(Cue.GetValue()));
+	}
+
+	SET_DWORD_STAT(STAT_BelindaVP_StageCuesPerFrame, Batch.Num());
+	if (Batch.Num() == 0)
+		return;
+
+	const FTimecode Timecode = FApp::GetTimecode();
+	for (FVPStageCue& Cue : Batch)
+	{
+		Cue.Timecode = Timecode;
+	}
+
+	// Cues posted by the handlers wait in the queue for the next frame
+	Dispatch(Batch);
+}
+
+void UVPStageCueSubsystem::Dispatch(TArrayView<FVPStageCue> Cues)
+{
+	// Stable, cues of a topic stay in the order they were posted
+	Algo::StableSort(Cues, [](const FVPStageCue& A, const FVPStageCue& B) { return A.Topic.FastLess(B.Topic); });
+
+	for (int32 Start = 0; Start < Cues.Num();)
+	{
+		int32 End = Start + 1;
+		while (End < Cues.Num() && Cues[End].Topic == Cues[Start].Topic)
+		{
+			++End;
+		}
+
+		if (!Cues[Start].Topic.IsNone())
+		{
+			DispatchTopic(Cues[Start].Topic, TConstArrayView<FVPStageCue>(Cues.GetData() + Start, End - Start));
+		}
+		Start = End;
+	}
+
+	DispatchTopic(NAME_None, Cues);
+	NumDispatched += Cues.Num();
+}
+
+void UVPStageCueSubsystem::DispatchTopic(FName Topic, TConstArrayView<FVPStageCue> Cues)
+{
+	const TSharedPtr<FTopic>* Found = Topics.Find(Topic);
+	if (!Found)
+		return;
+
+	const TSharedPtr<FTopic> Listeners = *Found;
+	Listeners->Native.Broadcast(Cues);
+
+	if (Listeners->Handlers.Num() > 0)
+	{
+		// Handlers may unsubscribe while being called
+		const TArray<FVPStageCueHandler> Handlers = Listeners->Handlers;
+		for (const FVPStageCue& Cue : Cues)
+		{
+			for (const FVPStageCueHandler& Handler : Handlers)
+			{
+				Handler.ExecuteIfBound(Cue);
+			}
+		}
+	}
+}
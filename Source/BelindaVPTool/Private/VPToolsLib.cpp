@@ -7,7 +7,10 @@
 #include "LiveLinkController.h"
 #include "LiveLinkComponentController.h"
 #include "LiveLinkCameraController.h"
+#include "VPLiveLinkCameraController.h"
 #include "Roles/LiveLinkCameraRole.h"
+#include "VPTrackingSubsystem.h"
+#include "Misc/Paths.h"
 
 
 void UVPToolsLib::DisplayErrorMessage(FString message, bool succes)
@@ -98,11 +101,82 @@ void UVPToolsLib::DisplayErrorMessage(FString message, bool succes)
 
 void UVPToolsLib::SetLiveLink(ULiveLinkComponentController* freedFiz, UCameraComponent* camComp)
 {
-    ULiveLinkCameraController* cameraController = NewObject<ULiveLinkCameraController>(); 
+    if (!freedFiz)
+        return;
+
+    // The component owns its controllers, so it keeps this one alive and saves it with the actor
+    UVPLiveLinkCameraController* cameraController = NewObject<UVPLiveLinkCameraController>(freedFiz, NAME_None, RF_Transactional);
     cameraController->bUseCameraRange = true;
 
     cameraController->SetAttachedComponent(camComp);
 
+    if (TObjectPtr<ULiveLinkControllerBase>* previous = freedFiz->ControllerMap.Find(ULiveLinkCameraRole::StaticClass()))
+    {
+        if (*previous)
+        {
+            (*previous)->Cleanup();
+        }
+    }
+
     freedFiz->ControllerMap.Add(ULiveLinkCameraRole::StaticClass(), cameraController);
 }
 
+UVPLiveLinkCameraController* UVPToolsLib::GetTrackingController(ULiveLinkComponentController* freedFiz)
+{
+    if (!freedFiz)
+        return nullptr;
+
+    TObjectPtr<ULiveLinkControllerBase>* controller = freedFiz->ControllerMap.Find(ULiveLinkCameraRole::StaticClass());
+    return controller ? Cast<UVPLiveLinkCameraController>(*controller) : nullptr;
+}
+
+FString UVPToolsLib::StartTrackingRecording(FString takeName)
+{
+    UVPTrackingSubsystem* tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+    if (!tracking)
+        return FString();
+
+    if (takeName.IsEmpty())
+    {
+        takeName = FString::Printf(TEXT("Take_%s"), *FDateTime::Now().ToString());
+    }
+
+    FString filePath = FPaths::ProjectSavedDir() / TEXT("TrackingJournals") / (FPaths::MakeValidFileName(takeName) + TEXT(".bvpj"));
+    if (!tracking->StartRecording(filePath))
+        return FString();
+
+    return filePath;
+}
+
+void UVPToolsLib::StopTrackingRecording()
+{
+    if (UVPTrackingSubsystem* tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+    {
+        tracking->StopRecording();
+    }
+}
+
+bool UVPToolsLib::StartTrackingReplay(FString journalPath, FVPReplaySettings settings)
+{
+    UVPTrackingSubsystem* tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+    if (!tracking)
+        return false;
+
+    return tracking->StartReplay(journalPath, settings);
+}
+
+void UVPToolsLib::StepTrackingReplay(int32 numFrames)
+{
+    if (UVPTrackingSubsystem* tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+    {
+        tracking->StepReplay(numFrames);
+    }
+}
+
+void UVPToolsLib::StopTrackingReplay()
+{
+    if (UVPTrackingSubsystem* tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+    {
+        tracking->StopReplay();
+    }
+}
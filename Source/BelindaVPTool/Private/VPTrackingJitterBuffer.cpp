@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingJitterBuffer.h"
+#include "Misc/ScopeLock.h"
+
+FVPTrackingJitterBuffer::FVPTrackingJitterBuffer(int32 InCapacity)
+{
+	Samples.SetNum(FMath::Max(InCapacity, 2));
+}
+
+void FVPTrackingJitterBuffer::Push(const FVPTrackingSample& Sample)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	const int32 Capacity = Samples.Num();
+
+	// Find where the sample goes, most of the time this is the end of the ring
+	int32 InsertIndex = Count;
+	while (InsertIndex > 0 && At(InsertIndex - 1).Time >= Sample.Time)
+	{
+		--InsertIndex;
+	}
+
+	if (InsertIndex < Count && At(InsertIndex).Time == Sample.Time)
+	{
+		// Same time stamp received twice, keep the latest values
+		At(InsertIndex) = Sample;
+		return;
+	}
+
+	if (Count == Capacity)
+	{
+		if (InsertIndex == 0)
+		{
+			// Older than everything we hold, nothing to do with it
+			return;
+		}
+
+		// Drop the oldest sample to make room
+		Head = (Head + 1) % Capacity;
+		--Count;
+		--InsertIndex;
+	}
+
+	for (int32 Index = Count; Index > InsertIndex; --Index)
+	{
+		At(Index) = At(Index - 1);
+	}
+
+	At(InsertIndex) = Sample;
+	++Count;
+}
+
+void FVPTrackingJitterBuffer::SetCapacity(int32 NewCapacity)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	NewCapacity = FMath::Max(NewCapacity, 2);
+	if (NewCapacity == Samples.Num())
+		return;
+
+	TArray<FVPTrackingSample> Resized;
+	Resized.SetNum(NewCapacity);
+	const int32 Kept = FMath::Min(Count, NewCapacity);
+	for (int32 Index = 0; Index < Kept; ++Index)
+	{
+		Resized[Index] = At(Count - Kept + Index);
+	}
+
+	Samples = MoveTemp(Resized);
+	Head = 0;
+	Count = Kept;
+}
+
+bool FVPTrackingJitterBuffer::Evaluate(double Time, FVPTrackingSample& OutSample) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	if (Time <= At(0).Time)
+	{
+		OutSample = At(0);
+		return true;
+	}
+
+	if (Time >= At(Count - 1).Time)
+	{
+		OutSample = At(Count - 1);
+		return true;
+	}
+
+	// Binary search the first sample after Time
+	int32 Low = 0;
+	int32 High = Count - 1;
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High) / 2;
+		if (At(Middle).Time <= Time)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	const FVPTrackingSample& Before = At(Low - 1);
+	const FVPTrackingSample& After = At(Low);
+	const double Span = After.Time - Before.Time;
+	const double Alpha = Span > UE_DOUBLE_SMALL_NUMBER ? (Time - Before.Time) / Span : 1.0;
+
+	OutSample = FVPTrackingSample::Interpolate(Before, After, Alpha);
+	OutSample.Time = Time;
+	return true;
+}
+
+void FVPTrackingJitterBuffer::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	Head = 0;
+	Count = 0;
+}
+
+bool FVPTrackingJitterBuffer::GetTimeRange(double& OutOldest, double& OutNewest) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	OutOldest = At(0).Time;
+	OutNewest = At(Count - 1).Time;
+	return true;
+}
+
+void FVPTrackingJitterBuffer::GetSampleTimes(TArray<double>& OutTimes) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	OutTimes.Reset(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		OutTimes.Add(At(Index).Time);
+	}
+}
+
+int32 FVPTrackingJitterBuffer::Num() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Count;
+}
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingJournal.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Algo/BinarySearch.h"
+
+uint32 VPTrackingJournal::FRecord::ComputeCrc() const
+{
+	return FCrc::MemCrc32(this, STRUCT_OFFSET(FRecord, Crc));
+}
+
+FVPTrackingJournalReader::~FVPTrackingJournalReader()
+{
+	Close();
+}
+
+bool FVPTrackingJournalReader::Open(const FString& FilePath)
+{
+	using namespace VPTrackingJournal;
+
+	Close();
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (!MappedFile.IsValid() || MappedFile->GetFileSize() < (int64)sizeof(FFileHeader))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Can't open tracking journal %s"), *FilePath);
+		Close();
+		return false;
+	}
+
+	MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	if (!MappedRegion.IsValid())
+	{
+		Close();
+		return false;
+	}
+
+	FMemory::Memcpy(&Header, MappedRegion->GetMappedPtr(), sizeof(FFileHeader));
+	if (Header.Magic != FileMagic || Header.Version != Version || Header.RecordSize != RecordSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is not a tracking journal this version can read"), *FilePath);
+		Close();
+		return false;
+	}
+
+	Records = reinterpret_cast<const FRecord*>(MappedRegion->GetMappedPtr() + sizeof(FFileHeader));
+	const int64 NumRecordsOnDisk = (MappedRegion->GetMappedSize() - (int64)sizeof(FFileHeader)) / RecordSize;
+
+	// Everything up to the first bad record is usable, a crashed session stops there
+	NumValidRecords = 0;
+	for (int64 RecordIndex = 0; RecordIndex < NumRecordsOnDisk; ++RecordIndex)
+	{
+		const FRecord& Record = Records[RecordIndex];
+		if (!Record.IsValid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Tracking journal %s truncated after %lld records"), *FilePath, RecordIndex);
+			break;
+		}
+
+		if (Record.Type == (uint16)ERecordType::Subject)
+		{
+			const ANSICHAR* Name = reinterpret_cast<const ANSICHAR*>(Record.Payload);
+			if (Subjects.Num() <= Record.SubjectIndex)
+			{
+				Subjects.SetNum(Record.SubjectIndex + 1);
+			}
+			Subjects[Record.SubjectIndex] = UTF8_TO_TCHAR(Name);
+		}
+		++NumValidRecords;
+	}
+
+	LoadIndex(FilePath + TEXT(".idx"));
+	return true;
+}
+
+void FVPTrackingJournalReader::Close()
+{
+	Records = nullptr;
+	NumValidRecords = 0;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	Subjects.Empty();
+	Index.Empty();
+}
+
+bool FVPTrackingJournalReader::GetSample(int64 RecordIndex, int32& OutSubjectIndex, FVPTrackingRecordEntry& OutEntry) const
+{
+	using namespace VPTrackingJournal;
+
+	if (RecordIndex < 0 || RecordIndex >= NumValidRecords)
+		return false;
+
+	const FRecord& Record = Records[RecordIndex];
+	if (Record.Type != (uint16)ERecordType::Sample)
+		return false;
+
+	FSamplePayload Payload;
+	FMemory::Memcpy(&Payload, Record.Payload, sizeof(FSamplePayload));
+
+	OutSubjectIndex = Record.SubjectIndex;
+	OutEntry.ArrivalTime = Payload.ArrivalTime;
+	OutEntry.bHasTimecode = Payload.RateDenominator > 0;
+	OutEntry.SceneTime = FQualifiedFrameTime(
+		FFrameTime(FFrameNumber(Payload.TimecodeFrame), Payload.TimecodeSubFrame),
+		FFrameRate(Payload.RateNumerator, FMath::Max(Payload.RateDenominator, 1)));
+
+	FVPTrackingSample& Sample = OutEntry.Sample;
+	Sample.Time = Payload.SampleTime;
+	Sample.Location = FVector(Payload.Location[0], Payload.Location[1], Payload.Location[2]);
+	Sample.Rotation = FQuat(Payload.Rotation[0], Payload.Rotation[1], Payload.Rotation[2], Payload.Rotation[3]);
+	Sample.FieldOfView = Payload.FieldOfView;
+	Sample.FocalLength = Payload.FocalLength;
+	Sample.Aperture = Payload.Aperture;
+	Sample.FocusDistance = Payload.FocusDistance;
+	return true;
+}
+
+int64 FVPTrackingJournalReader::FindRecordAtTime(double Time) const
+{
+	using namespace VPTrackingJournal;
+
+	// Jump close using the sidecar index, then walk forward
+	int64 RecordIndex = 0;
+	if (Index.Num() > 0)
+	{
+		const int32 EntryIndex = Algo::UpperBoundBy(Index, Time, &FIndexEntry::SampleTime) - 1;
+		if (EntryIndex >= 0)
+		{
+			RecordIndex = FMath::Min((int64)Index[EntryIndex].RecordIndex, NumValidRecords);
+		}
+	}
+
+	for (; RecordIndex < NumValidRecords; ++RecordIndex)
+	{
+		const FRecord& Record = Records[RecordIndex];
+		if (Record.Type != (uint16)ERecordType::Sample)
+			continue;
+
+		double SampleTime = 0.0;
+		FMemory::Memcpy(&SampleTime, Record.Payload + STRUCT_OFFSET(FSamplePayload, SampleTime), sizeof(double));
+		if (SampleTime >= Time)
+			break;
+	}
+	return RecordIndex;
+}
+
+void FVPTrackingJournalReader::LoadIndex(const FString& IndexPath)
+{
+	using namespace VPTrackingJournal;
+
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *IndexPath, FILEREAD_Silent))
+		return;
+
+	// A partially written last entry is simply ignored
+	const int32 NumEntries = Bytes.Num() / sizeof(FIndexEntry);
+	Index.SetNumUninitialized(NumEntries);
+	FMemory::Memcpy(Index.GetData(), Bytes.GetData(), NumEntries * sizeof(FIndexEntry));
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingLiveLinkSource.h"
+#include "ILiveLinkClient.h"
+#include "Features/IModularFeatures.h"
+#include "Roles/LiveLinkCameraRole.h"
+#include "Roles/LiveLinkCameraTypes.h"
+
+#define LOCTEXT_NAMESPACE "VPTrackingLiveLinkSource"
+
+FVPTrackingLiveLinkSource::FVPTrackingLiveLinkSource(const FText& InSourceType, const FString& InMachineName)
+	: SourceType(InSourceType)
+	, MachineName(InMachineName)
+{
+}
+
+void FVPTrackingLiveLinkSource::ReceiveClient(ILiveLinkClient* InClient, FGuid InSourceGuid)
+{
+	SourceGuid = InSourceGuid;
+	Client = InClient;
+}
+
+bool FVPTrackingLiveLinkSource::IsSourceStillValid() const
+{
+	return Client.load() != nullptr;
+}
+
+bool FVPTrackingLiveLinkSource::RequestSourceShutdown()
+{
+	Client = nullptr;
+	return true;
+}
+
+FText FVPTrackingLiveLinkSource::GetSourceStatus() const
+{
+	return IsSourceStillValid() ? LOCTEXT("Active", "Active") : LOCTEXT("Stopped", "Stopped");
+}
+
+bool FVPTrackingLiveLinkSource::AddToClient(const TSharedPtr<FVPTrackingLiveLinkSource>& Source)
+{
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+		return false;
+
+	ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName).AddSource(Source);
+	return Source->IsSourceStillValid();
+}
+
+void FVPTrackingLiveLinkSource::RemoveFromClient(const TSharedPtr<FVPTrackingLiveLinkSource>& Source)
+{
+	if (!Source.IsValid() || !Source->IsSourceStillValid())
+		return;
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName).RemoveSource(Source->GetSourceGuid());
+	}
+	Source->Client = nullptr;
+}
+
+void FVPTrackingLiveLinkSource::PushCameraStaticData(FName SubjectName)
+{
+	ILiveLinkClient* CurrentClient = Client.load();
+	if (!CurrentClient)
+		return;
+
+	FLiveLinkStaticDataStruct StaticData(FLiveLinkCameraStaticData::StaticStruct());
+	FLiveLinkCameraStaticData* CameraData = StaticData.Cast<FLiveLinkCameraStaticData>();
+	CameraData->bIsFieldOfViewSupported = true;
+	CameraData->bIsFocalLengthSupported = true;
+	CameraData->bIsApertureSupported = true;
+	CameraData->bIsFocusDistanceSupported = true;
+	CurrentClient->PushSubjectStaticData_AnyThread(FLiveLinkSubjectKey(SourceGuid, SubjectName), ULiveLinkCameraRole::StaticClass(), MoveTemp(StaticData));
+}
+
+void FVPTrackingLiveLinkSource::PushCameraFrame(FName SubjectName, FLiveLinkFrameDataStruct&& FrameData)
+{
+	if (ILiveLinkClient* CurrentClient = Client.load())
+	{
+		CurrentClient->PushSubjectFrameData_AnyThread(FLiveLinkSubjectKey(SourceGuid, SubjectName), MoveTemp(FrameData));
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingLoadGenerator.h"
+#include "VPTrackingLiveLinkSource.h"
+#include "VPFreeDPacket.h"
+#include "HAL/RunnableThread.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Math/RandomStream.h"
+
+#define LOCTEXT_NAMESPACE "VPTrackingLoadGenerator"
+
+FVPTrackingLoadGenerator::~FVPTrackingLoadGenerator()
+{
+	Finish();
+}
+
+bool FVPTrackingLoadGenerator::Start(const FVPLoadGeneratorSettings& InSettings)
+{
+	Finish();
+
+	Settings = InSettings;
+	Settings.NumCameras = FMath::Clamp(Settings.NumCameras, 1, 255);
+	Settings.RateHz = FMath::Clamp(Settings.RateHz, 60.0f, 2000.0f);
+
+	SubjectNames.Reset();
+	Motions.Reset();
+	for (int32 CameraIndex = 0; CameraIndex < Settings.NumCameras; ++CameraIndex)
+	{
+		SubjectNames.Add(FName(*FString::Printf(TEXT("%s_%d"), *Settings.SubjectPrefix, CameraIndex)));
+		Motions.Emplace(CameraIndex, Settings.Seed);
+	}
+
+	if (Settings.Output == EVPReplayOutput::LiveLink)
+	{
+		LiveLinkSource = MakeShared<FVPTrackingLiveLinkSource>(LOCTEXT("SourceType", "Belinda Load Generator"), FPlatformProcess::ComputerName());
+		if (!FVPTrackingLiveLinkSource::AddToClient(LiveLinkSource))
+		{
+			UE_LOG(LogTemp, Error, TEXT("LiveLink client not available, can't start the tracking load generator"));
+			Finish();
+			return false;
+		}
+
+		for (const FName& SubjectName : SubjectNames)
+		{
+			LiveLinkSource->PushCameraStaticData(SubjectName);
+		}
+	}
+	else
+	{
+		Socket = FUdpSocketBuilder(TEXT("VPTrackingLoadGenerator")).AsNonBlocking().Build();
+
+		bool bIsValidAddress = false;
+		FreeDTarget = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+		FreeDTarget->SetIp(*Settings.FreeDAddress, bIsValidAddress);
+		FreeDTarget->SetPort(Settings.FreeDPort);
+
+		if (!Socket || !bIsValidAddress)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Can't send FreeD packets to %s:%d"), *Settings.FreeDAddress, Settings.FreeDPort);
+			Finish();
+			return false;
+		}
+	}
+
+	// Enough room for every packet that can be held back by the jitter at once
+	const int32 TicksInFlight = FMath::CeilToInt(Settings.JitterMs * 0.001f * Settings.RateHz) + 4;
+	Pending.Reset(Settings.NumCameras * TicksInFlight);
+
+	NumSent = 0;
+	NumLost = 0;
+	bStopRequested = false;
+	Thread = FRunnableThread::Create(this, TEXT("VPTrackingLoadGenerator"), 0, TPri_AboveNormal);
+	return true;
+}
+
+void FVPTrackingLoadGenerator::Finish()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FVPTrackingLiveLinkSource::RemoveFromClient(LiveLinkSource);
+	LiveLinkSource.Reset();
+
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+	FreeDTarget.Reset();
+}
+
+FName FVPTrackingLoadGenerator::GetSubjectName(int32 CameraIndex) const
+{
+	return SubjectNames.IsValidIndex(CameraIndex) ? SubjectNames[CameraIndex] : NAME_None;
+}
+
+FVPSynthCameraMotion::FVPSynthCameraMotion(int32 InCameraIndex, int32 Seed)
+	: CameraIndex(InCameraIndex)
+{
+	FRandomStream Stream(Seed * 977 + CameraIndex);
+	for (double& Phase : Phases)
+	{
+		Phase = Stream.FRandRange(0.0f, UE_TWO_PI);
+	}
+}
+
+FVPTrackingSample FVPSynthCameraMotion::Evaluate(double Time) const
+{
+	// Slow, out of phase sines per axis give sweeping pans and dolly moves that never repeat exactly
+	FVPTrackingSample Sample;
+	Sample.Time = Time;
+	Sample.Location = FVector(
+		CameraIndex * 300.0 + 200.0 * FMath::Sin(0.21 * Time + Phases[0]),
+		150.0 * FMath::Sin(0.13 * Time + Phases[1]),
+		150.0 + 40.0 * FMath::Sin(0.37 * Time + Phases[2]));
+	Sample.Rotation = FRotator(
+		10.0 * FMath::Sin(0.29 * Time + Phases[3]),
+		45.0 * FMath::Sin(0.17 * Time + Phases[4]),
+		2.0 * FMath::Sin(0.11 * Time + Phases[5])).Quaternion();
+
+	Sample.FocalLength = 35.0f + 25.0f * FMath::Sin(0.07 * Time + Phases[6]);
+	Sample.FocusDistance = 500.0f + 400.0f * FMath::Sin(0.09 * Time + Phases[7]);
+	Sample.Aperture = 2.8f;
+
+	// Full frame filmback
+	Sample.FieldOfView = FMath::RadiansToDegrees(2.0f * FMath::Atan(36.0f / (2.0f * Sample.FocalLength)));
+	return Sample;
+}
+
+FVPTrackingSample FVPTrackingLoadGenerator::SynthesizeSample(int32 CameraIndex, int32 Seed, double Time)
+{
+	return FVPSynthCameraMotion(CameraIndex, Seed).Evaluate(Time);
+}
+
+uint32 FVPTrackingLoadGenerator::Run()
+{
+	const double Interval = 1.0 / Settings.RateHz;
+	const double MaxJitter = Settings.JitterMs * 0.001;
+	const double StartTime = FPlatformTime::Seconds();
+
+	FRandomStream Random(Settings.Seed);
+	int64 Tick = 0;
+	uint16 Sequence = 0;
+
+	while (!bStopRequested)
+	{
+		const double Now = FPlatformTime::Seconds();
+
+		// Produce every tick that is due, each camera packet gets its own loss and delay
+		while (StartTime + Tick * Interval <= Now)
+		{
+			const double TickTime = StartTime + Tick * Interval;
+			for (int32 CameraIndex = 0; CameraIndex < Settings.NumCameras; ++CameraIndex)
+			{
+				if (Random.FRand() < Settings.PacketLoss)
+				{
+					++NumLost;
+					continue;
+				}
+
+				FPendingPacket& Packet = Pending.AddDefaulted_GetRef();
+				Packet.SendTime = TickTime + Random.FRand() * MaxJitter;
+				Packet.CameraIndex = CameraIndex;
+				Packet.Sequence = Sequence;
+				Packet.Sample = Motions[CameraIndex].Evaluate(TickTime - StartTime);
+			}
+			++Tick;
+			++Sequence;
+		}
+
+		for (int32 Index = 0; Index < Pending.Num();)
+		{
+			if (Pending[Index].SendTime <= Now)
+			{
+				Send(Pending[Index]);
+				Pending.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+			}
+			else
+			{
+				++Index;
+			}
+		}
+
+		const double NextTick = StartTime + Tick * Interval;
+		FPlatformProcess::SleepNoStats(NextTick - FPlatformTime::Seconds() > 0.002 ? 0.001f : 0.0f);
+	}
+
+	return 0;
+}
+
+void FVPTrackingLoadGenerator::Stop()
+{
+	bStopRequested = true;
+}
+
+void FVPTrackingLoadGenerator::Send(const FPendingPacket& Packet)
+{
+	if (Settings.Output == EVPReplayOutput::LiveLink)
+	{
+		FLiveLinkFrameDataStruct FrameData(FLiveLinkCameraFrameData::StaticStruct());
+		FLiveLinkCameraFrameData* CameraData = FrameData.Cast<FLiveLinkCameraFrameData>();
+		Packet.Sample.WriteTo(*CameraData);
+		CameraData->WorldTime = FLiveLinkWorldTime(FPlatformTime::Seconds());
+		LiveLinkSource->PushCameraFrame(SubjectNames[Packet.CameraIndex], MoveTemp(FrameData));
+	}
+	else
+	{
+		const FRotator Rotation = Packet.Sample.Rotation.Rotator();
+
+		FVPFreeDData Data;
+		Data.CameraId = (uint8)Packet.CameraIndex;
+		Data.Pan = Rotation.Yaw;
+		Data.Tilt = Rotation.Pitch;
+		Data.Roll = Rotation.Roll;
+		Data.Position = Packet.Sample.Location;
+		Data.Zoom = (int32)(FMath::GetRangePct(10.0f, 100.0f, Packet.Sample.FocalLength) * VPFreeD::MaxEncoderValue);
+		Data.Focus = (int32)(FMath::GetRangePct(30.0f, 10000.0f, Packet.Sample.FocusDistance) * VPFreeD::MaxEncoderValue);
+		Data.User = Packet.Sequence;
+
+		uint8 Buffer[VPFreeD::PacketSize];
+		VPFreeD::Encode(Data, Buffer);
+
+		int32 BytesSent = 0;
+		Socket->SendTo(Buffer, VPFreeD::PacketSize, BytesSent, *FreeDTarget);
+	}
+
+	++NumSent;
+}
+
+#undef LOCTEXT_NAMESPACE
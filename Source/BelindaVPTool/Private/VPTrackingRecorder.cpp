@@ -0,0 +1,260 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingRecorder.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/Paths.h"
+
+namespace VPTrackingRecorder
+{
+	// Records are written in batches of at most this many
+	static constexpr int32 BatchSize = 1024;
+
+	// Sample time between two index entries
+	static constexpr double IndexInterval = 0.25;
+
+	// The OS cache survives a crash of the editor, a full flush also covers a power cut
+	static constexpr double FullFlushInterval = 1.0;
+}
+
+FVPTrackingRecorder::~FVPTrackingRecorder()
+{
+	Close();
+}
+
+bool FVPTrackingRecorder::Open(const FString& FilePath)
+{
+	using namespace VPTrackingJournal;
+
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+
+	JournalFile.Reset(PlatformFile.OpenWrite(*FilePath, false, true));
+	IndexFile.Reset(PlatformFile.OpenWrite(*(FilePath + TEXT(".idx")), false, true));
+	if (!JournalFile.IsValid() || !IndexFile.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Can't create tracking journal %s"), *FilePath);
+		JournalFile.Reset();
+		IndexFile.Reset();
+		return false;
+	}
+
+	JournalPath = FilePath;
+	StartTime = FPlatformTime::Seconds();
+	NextSequence = 0;
+	NextIndexTime = -DBL_MAX;
+	LastFlushTime = StartTime;
+	NumWrittenSamples = 0;
+	PendingRecords.Reset(VPTrackingRecorder::BatchSize);
+
+	FFileHeader Header;
+	Header.StartTime = StartTime;
+	Header.StartUtcTicks = FDateTime::UtcNow().GetTicks();
+	JournalFile->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FFileHeader));
+	JournalFile->Flush();
+
+	bStopRequested = false;
+	Thread = FRunnableThread::Create(this, TEXT("VPTrackingRecorder"), 0, TPri_BelowNormal);
+
+	UE_LOG(LogTemp, Log, TEXT("Recording tracking to %s"), *FilePath);
+	return true;
+}
+
+void FVPTrackingRecorder::Close()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+
+		UE_LOG(LogTemp, Log, TEXT("Tracking journal %s closed, %llu samples written"), *JournalPath, NumWrittenSamples.load());
+	}
+
+	JournalFile.Reset();
+	IndexFile.Reset();
+
+	FScopeLock ScopeLock(&SubjectsLock);
+	Subjects.Empty();
+	WriterSubjects.Empty();
+}
+
+void FVPTrackingRecorder::AddSubject(FName SubjectName, TSharedPtr<FQueue> Queue)
+{
+	FScopeLock ScopeLock(&SubjectsLock);
+
+	// A subject registered again mid-take feeds a new queue, it keeps its index in the journal
+	if (FSubject* Existing = Subjects.FindByPredicate([SubjectName](const FSubject& Subject) { return Subject.Name == SubjectName; }))
+	{
+		Existing->Queue = MoveTemp(Queue);
+		return;
+	}
+
+	FSubject& Subject = Subjects.AddDefaulted_GetRef();
+	Subject.Name = SubjectName;
+	Subject.Index = (uint16)(Subjects.Num() - 1);
+	Subject.Queue = MoveTemp(Queue);
+}
+
+uint32 FVPTrackingRecorder::Run()
+{
+	while (!bStopRequested)
+	{
+		if (!Drain(false))
+		{
+			FPlatformProcess::SleepNoStats(0.001f);
+		}
+	}
+
+	// Pick up whatever was pushed before the stop
+	Drain(true);
+	return 0;
+}
+
+void FVPTrackingRecorder::Stop()
+{
+	bStopRequested = true;
+}
+
+bool FVPTrackingRecorder::Drain(bool bFinal)
+{
+	using namespace VPTrackingJournal;
+
+	{
+		// Subjects only ever get appended, the existing ones can only have their queue replaced
+		FScopeLock ScopeLock(&SubjectsLock);
+		for (int32 Index = 0; Index < WriterSubjects.Num(); ++Index)
+		{
+			FSubject& Subject = WriterSubjects[Index];
+			if (Subject.Queue != Subjects[Index].Queue)
+			{
+				// Samples pushed before the subject was registered again are still written
+				if (!Subject.PreviousQueue.IsValid())
+				{
+					Subject.PreviousQueue = Subject.Queue;
+				}
+				Subject.Queue = Subjects[Index].Queue;
+			}
+		}
+		for (int32 Index = WriterSubjects.Num(); Index < Subjects.Num(); ++Index)
+		{
+			WriterSubjects.Add(Subjects[Index]);
+		}
+	}
+
+	bool bWroteAnything = false;
+
+	for (FSubject& Subject : WriterSubjects)
+	{
+		if (!Subject.bDeclared)
+		{
+			FRecord& Record = PendingRecords.AddDefaulted_GetRef();
+			Record.Type = (uint16)ERecordType::Subject;
+			Record.SubjectIndex = Subject.Index;
+			Record.Sequence = NextSequence++;
+			const FTCHARToUTF8 Name(*Subject.Name.ToString());
+			FMemory::Memcpy(Record.Payload, Name.Get(), FMath::Min(Name.Length(), MaxSubjectNameLength));
+			Record.Crc = Record.ComputeCrc();
+			Subject.bDeclared = true;
+		}
+
+		if (Subject.PreviousQueue.IsValid())
+		{
+			bWroteAnything |= WriteSamples(Subject, *Subject.PreviousQueue);
+			Subject.PreviousQueue.Reset();
+		}
+		bWroteAnything |= WriteSamples(Subject, *Subject.Queue);
+	}
+
+	WritePending();
+	if (bWroteAnything)
+	{
+		JournalFile->Flush();
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (bFinal || Now - LastFlushTime >= VPTrackingRecorder::FullFlushInterval)
+	{
+		JournalFile->Flush(true);
+		IndexFile->Flush(true);
+		LastFlushTime = Now;
+	}
+
+	return bWroteAnything;
+}
+
+bool FVPTrackingRecorder::WriteSamples(const FSubject& Subject, FQueue& Queue)
+{
+	using namespace VPTrackingJournal;
+
+	bool bWroteAnything = false;
+	FVPTrackingRecordEntry Entry;
+	while (Queue.Dequeue(Entry))
+	{
+		FSamplePayload Payload;
+		FMemory::Memzero(Payload);
+		Payload.ArrivalTime = Entry.ArrivalTime - StartTime;
+		Payload.SampleTime = Entry.Sample.Time;
+		if (Entry.bHasTimecode)
+		{
+			Payload.TimecodeFrame = Entry.SceneTime.Time.GetFrame().Value;
+			Payload.TimecodeSubFrame = Entry.SceneTime.Time.GetSubFrame();
+			Payload.RateNumerator = Entry.SceneTime.Rate.Numerator;
+			Payload.RateDenominator = Entry.SceneTime.Rate.Denominator;
+		}
+		Payload.Location[0] = Entry.Sample.Location.X;
+		Payload.Location[1] = Entry.Sample.Location.Y;
+		Payload.Location[2] = Entry.Sample.Location.Z;
+		Payload.Rotation[0] = Entry.Sample.Rotation.X;
+		Payload.Rotation[1] = Entry.Sample.Rotation.Y;
+		Payload.Rotation[2] = Entry.Sample.Rotation.Z;
+		Payload.Rotation[3] = Entry.Sample.Rotation.W;
+		Payload.FieldOfView = Entry.Sample.FieldOfView;
+		Payload.FocalLength = Entry.Sample.FocalLength;
+		Payload.Aperture = Entry.Sample.Aperture;
+		Payload.FocusDistance = Entry.Sample.FocusDistance;
+
+		if (Entry.Sample.Time >= NextIndexTime)
+		{
+			FIndexEntry IndexEntry;
+			IndexEntry.SampleTime = Entry.Sample.Time;
+			IndexEntry.RecordIndex = NextSequence;
+			IndexFile->Write(reinterpret_cast<const uint8*>(&IndexEntry), sizeof(FIndexEntry));
+			NextIndexTime = Entry.Sample.Time + VPTrackingRecorder::IndexInterval;
+		}
+
+		FRecord& Record = PendingRecords.AddDefaulted_GetRef();
+		Record.Type = (uint16)ERecordType::Sample;
+		Record.SubjectIndex = Subject.Index;
+		Record.Sequence = NextSequence++;
+		FMemory::Memcpy(Record.Payload, &Payload, sizeof(FSamplePayload));
+		Record.Crc = Record.ComputeCrc();
+
+		if (PendingRecords.Num() >= VPTrackingRecorder::BatchSize)
+		{
+			WritePending();
+		}
+		bWroteAnything = true;
+	}
+	return bWroteAnything;
+}
+
+void FVPTrackingRecorder::WritePending()
+{
+	if (PendingRecords.Num() == 0)
+		return;
+
+	int32 NumSamples = 0;
+	for (const VPTrackingJournal::FRecord& Record : PendingRecords)
+	{
+		NumSamples += Record.Type == (uint16)VPTrackingJournal::ERecordType::Sample ? 1 : 0;
+	}
+
+	JournalFile->Write(reinterpret_cast<const uint8*>(PendingRecords.GetData()), PendingRecords.Num() * sizeof(VPTrackingJournal::FRecord));
+	NumWrittenSamples += NumSamples;
+	PendingRecords.Reset();
+}
@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingReplay.h"
+#include "VPFreeDPacket.h"
+#include "HAL/RunnableThread.h"
+#include "VPTrackingLiveLinkSource.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Misc/App.h"
+#include "Misc/Paths.h"
+
+#define LOCTEXT_NAMESPACE "VPTrackingReplay"
+
+FVPTrackingReplay::~FVPTrackingReplay()
+{
+	Finish();
+}
+
+bool FVPTrackingReplay::Start(const FString& JournalPath, const FVPReplaySettings& InSettings)
+{
+	Finish();
+
+	if (!Reader.Open(JournalPath))
+		return false;
+
+	Settings = InSettings;
+	FallbackFrameRate = FApp::GetTimecodeFrameRate();
+
+	const TOptional<FQualifiedFrameTime> FrameTime = FApp::GetCurrentFrameTime();
+	TimelineAnchor = FrameTime.IsSet() ? FrameTime->AsSeconds() : FApp::GetCurrentTime();
+	WallAnchor = FPlatformTime::Seconds();
+
+	if (Settings.Output == EVPReplayOutput::LiveLink)
+	{
+		LiveLinkSource = MakeShared<FVPTrackingLiveLinkSource>(LOCTEXT("SourceType", "Belinda Replay"), FPaths::GetBaseFilename(JournalPath));
+		if (!FVPTrackingLiveLinkSource::AddToClient(LiveLinkSource))
+		{
+			UE_LOG(LogTemp, Error, TEXT("LiveLink client not available, can't replay %s"), *JournalPath);
+			Finish();
+			return false;
+		}
+
+		for (const FString& SubjectName : Reader.GetSubjects())
+		{
+			LiveLinkSource->PushCameraStaticData(FName(*SubjectName));
+		}
+	}
+	else
+	{
+		Socket = FUdpSocketBuilder(TEXT("VPTrackingReplay")).AsNonBlocking().Build();
+
+		bool bIsValidAddress = false;
+		FreeDTarget = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+		FreeDTarget->SetIp(*Settings.FreeDAddress, bIsValidAddress);
+		FreeDTarget->SetPort(Settings.FreeDPort);
+
+		if (!Socket || !bIsValidAddress)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Can't send FreeD packets to %s:%d"), *Settings.FreeDAddress, Settings.FreeDPort);
+			Finish();
+			return false;
+		}
+	}
+
+	if (!Rewind())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Tracking journal %s has no samples"), *JournalPath);
+		Finish();
+		return false;
+	}
+
+	bStopRequested = false;
+	bFinished = false;
+	PendingSteps = 0;
+	Thread = FRunnableThread::Create(this, TEXT("VPTrackingReplay"), 0, TPri_AboveNormal);
+	return true;
+}
+
+void FVPTrackingReplay::Finish()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FVPTrackingLiveLinkSource::RemoveFromClient(LiveLinkSource);
+	LiveLinkSource.Reset();
+
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+	FreeDTarget.Reset();
+
+	Reader.Close();
+}
+
+void FVPTrackingReplay::Step(int32 NumFrames)
+{
+	PendingSteps += FMath::Max(NumFrames, 0);
+}
+
+uint32 FVPTrackingReplay::Run()
+{
+	const double Speed = Settings.Mode == EVPReplayMode::Accelerated ? FMath::Max(Settings.Speed, 0.01f) : 1.0;
+	double WallStart = FPlatformTime::Seconds();
+
+	while (!bStopRequested)
+	{
+		if (Cursor >= Reader.NumRecords())
+		{
+			if (!Settings.bLoop || !Rewind())
+				break;
+
+			WallStart = FPlatformTime::Seconds();
+			continue;
+		}
+
+		int32 SubjectIndex = 0;
+		FVPTrackingRecordEntry Entry;
+		if (!Reader.GetSample(Cursor, SubjectIndex, Entry))
+		{
+			++Cursor;
+			continue;
+		}
+
+		if (Settings.Mode == EVPReplayMode::FrameStepped)
+		{
+			if (Entry.Sample.Time >= StepTime)
+			{
+				if (PendingSteps <= 0)
+				{
+					FPlatformProcess::SleepNoStats(0.001f);
+					continue;
+				}
+
+				--PendingSteps;
+				const double FrameInterval = Entry.bHasTimecode ? Entry.SceneTime.Rate.AsInterval() : FallbackFrameRate.AsInterval();
+				StepTime += FrameInterval;
+				continue;
+			}
+		}
+		else
+		{
+			// Paced on the recorded arrival times so the network jitter is reproduced too
+			const double DueTime = WallStart + (Entry.ArrivalTime - FirstArrivalTime) / Speed;
+			const double Wait = DueTime - FPlatformTime::Seconds();
+			if (Wait > 0.0)
+			{
+				FPlatformProcess::SleepNoStats(Wait > 0.002 ? 0.001f : 0.0f);
+				continue;
+			}
+		}
+
+		Emit(SubjectIndex, Entry);
+		++Cursor;
+	}
+
+	bFinished = true;
+	return 0;
+}
+
+void FVPTrackingReplay::Stop()
+{
+	bStopRequested = true;
+}
+
+void FVPTrackingReplay::Emit(int32 SubjectIndex, const FVPTrackingRecordEntry& Entry)
+{
+	if (Settings.Output == EVPReplayOutput::FreeD)
+	{
+		SendFreeD(SubjectIndex, Entry);
+		return;
+	}
+
+	if (!Reader.GetSubjects().IsValidIndex(SubjectIndex))
+		return;
+
+	FLiveLinkFrameDataStruct FrameData(FLiveLinkCameraFrameData::StaticStruct());
+	FLiveLinkCameraFrameData* CameraData = FrameData.Cast<FLiveLinkCameraFrameData>();
+	Entry.Sample.WriteTo(*CameraData);
+	if (Entry.bHasTimecode)
+	{
+		// The recorded timecode is long gone, each pass is laid on the engine timeline from where it started
+		const double SceneSeconds = Entry.SceneTime.AsSeconds();
+		if (!FirstSceneSeconds.IsSet())
+		{
+			FirstSceneSeconds = SceneSeconds;
+			SceneOffset = TimelineAnchor + (FPlatformTime::Seconds() - WallAnchor);
+		}
+
+		const double Speed = Settings.Mode == EVPReplayMode::Accelerated ? FMath::Max(Settings.Speed, 0.01f) : 1.0;
+		const double Restamped = SceneOffset + (SceneSeconds - FirstSceneSeconds.GetValue()) / Speed;
+		CameraData->MetaData.SceneTime = FQualifiedFrameTime(Entry.SceneTime.Rate.AsFrameTime(Restamped), Entry.SceneTime.Rate);
+	}
+
+	LiveLinkSource->PushCameraFrame(FName(*Reader.GetSubjects()[SubjectIndex]), MoveTemp(FrameData));
+}
+
+void FVPTrackingReplay::SendFreeD(int32 SubjectIndex, const FVPTrackingRecordEntry& Entry)
+{
+	const FRotator Rotation = Entry.Sample.Rotation.Rotator();
+
+	FVPFreeDData Data;
+	Data.CameraId = (uint8)SubjectIndex;
+	Data.Pan = Rotation.Yaw;
+	Data.Tilt = Rotation.Pitch;
+	Data.Roll = Rotation.Roll;
+	Data.Position = Entry.Sample.Location;
+
+	const double ZoomAlpha = FMath::GetRangePct(Settings.FocalLengthRange.X, Settings.FocalLengthRange.Y, (double)Entry.Sample.FocalLength);
+	const double FocusAlpha = FMath::GetRangePct(Settings.FocusDistanceRange.X, Settings.FocusDistanceRange.Y, (double)Entry.Sample.FocusDistance);
+	Data.Zoom = (int32)(FMath::Clamp(ZoomAlpha, 0.0, 1.0) * VPFreeD::MaxEncoderValue);
+	Data.Focus = (int32)(FMath::Clamp(FocusAlpha, 0.0, 1.0) * VPFreeD::MaxEncoderValue);
+
+	uint8 Packet[VPFreeD::PacketSize];
+	VPFreeD::Encode(Data, Packet);
+
+	int32 BytesSent = 0;
+	Socket->SendTo(Packet, VPFreeD::PacketSize, BytesSent, *FreeDTarget);
+}
+
+bool FVPTrackingReplay::Rewind()
+{
+	for (Cursor = 0; Cursor < Reader.NumRecords(); ++Cursor)
+	{
+		int32 SubjectIndex = 0;
+		FVPTrackingRecordEntry Entry;
+		if (Reader.GetSample(Cursor, SubjectIndex, Entry))
+		{
+			FirstArrivalTime = Entry.ArrivalTime;
+			FirstSceneSeconds.Reset();
+			FirstSampleTime = Entry.Sample.Time;
+			StepTime = FirstSampleTime;
+			return true;
+		}
+	}
+	return false;
+}
+
+#undef LOCTEXT_NAMESPACE
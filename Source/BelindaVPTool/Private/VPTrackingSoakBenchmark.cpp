@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingSoakBenchmark.h"
+#include "VPTrackingSubsystem.h"
+#include "VPFreeDPacket.h"
+#include "ILiveLinkClient.h"
+#include "Features/IModularFeatures.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Engine/Engine.h"
+
+static TUniquePtr<FVPTrackingSoakBenchmark> GSoakBenchmark;
+
+static FAutoConsoleCommand SoakCommand(
+	TEXT("BelindaVP.Soak"),
+	TEXT("Soaks the tracking path with synthetic cameras. Args: [NumCameras=4] [RateHz=240] [Seconds=60] [PacketLoss=0] [JitterMs=0]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FVPLoadGeneratorSettings Settings;
+			Settings.NumCameras = Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 4;
+			Settings.RateHz = Args.IsValidIndex(1) ? FCString::Atof(*Args[1]) : 240.0f;
+			const double Seconds = Args.IsValidIndex(2) ? FCString::Atod(*Args[2]) : 60.0;
+			Settings.PacketLoss = Args.IsValidIndex(3) ? FCString::Atof(*Args[3]) : 0.0f;
+			Settings.JitterMs = Args.IsValidIndex(4) ? FCString::Atof(*Args[4]) : 0.0f;
+
+			GSoakBenchmark = MakeUnique<FVPTrackingSoakBenchmark>();
+			GSoakBenchmark->Start(Settings, Seconds);
+		}));
+
+static FAutoConsoleCommand SoakStopCommand(
+	TEXT("BelindaVP.Soak.Stop"),
+	TEXT("Stops the running soak benchmark and writes its report"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (GSoakBenchmark.IsValid())
+			{
+				GSoakBenchmark->Finish();
+			}
+		}));
+
+void FVPTrackingSoakBenchmark::ShutdownConsoleRun()
+{
+	GSoakBenchmark.Reset();
+}
+
+FVPTrackingSoakBenchmark::~FVPTrackingSoakBenchmark()
+{
+	Finish();
+}
+
+bool FVPTrackingSoakBenchmark::Start(const FVPLoadGeneratorSettings& Settings, double DurationSeconds)
+{
+	Finish();
+
+	UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!Tracking || !ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Soak benchmark needs the LiveLink client and the tracking subsystem"));
+		return false;
+	}
+
+	FreeDDecodeRate = MeasureFreeDDecodeRate();
+
+	// The soak measures the LiveLink path, FreeD output would need a FreeD source set up on the same port
+	GeneratorSettings = Settings;
+	GeneratorSettings.Output = EVPReplayOutput::LiveLink;
+	if (!Generator.Start(GeneratorSettings))
+		return false;
+
+	Latency.Reset();
+	EvaluateCost.Reset();
+	NumReceived = 0;
+
+	ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+	for (int32 CameraIndex = 0; CameraIndex < GeneratorSettings.NumCameras; ++CameraIndex)
+	{
+		FSubjectHandles& Handles = Subjects.AddDefaulted_GetRef();
+		Handles.SubjectName = Generator.GetSubjectName(CameraIndex);
+
+		// Latency is measured where the plugin buffers receive the sample
+		TSubclassOf<ULiveLinkRole> SubjectRole;
+		Client.RegisterForSubjectFrames(Handles.SubjectName,
+			FOnLiveLinkSubjectStaticDataReceived::FDelegate(),
+			FOnLiveLinkSubjectFrameDataReceived::FDelegate::CreateLambda([this](FLiveLinkSubjectKey, TSubclassOf<ULiveLinkRole>, const FLiveLinkFrameDataStruct& FrameData)
+				{
+					if (const FLiveLinkBaseFrameData* BaseData = FrameData.GetBaseData())
+					{
+						Latency.Add(FPlatformTime::Seconds() - BaseData->WorldTime.GetSourceTime());
+						++NumReceived;
+					}
+				}),
+			Handles.StaticDataHandle,
+			Handles.FrameDataHandle,
+			SubjectRole);
+
+		Tracking->RegisterSubject(Handles.SubjectName, FVPJitterBufferSettings());
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	Duration = DurationSeconds;
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FVPTrackingSoakBenchmark::Tick));
+
+	UE_LOG(LogTemp, Log, TEXT("Tracking soak started: %d cameras at %.0f Hz for %.0f s"), GeneratorSettings.NumCameras, GeneratorSettings.RateHz, Duration);
+	return true;
+}
+
+void FVPTrackingSoakBenchmark::Finish()
+{
+	if (!TickerHandle.IsValid())
+		return;
+
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+
+	Generator.Finish();
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+	for (const FSubjectHandles& Handles : Subjects)
+	{
+		if (ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+		{
+			ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName).UnregisterSubjectFramesHandle(Handles.SubjectName, Handles.StaticDataHandle, Handles.FrameDataHandle);
+		}
+		if (Tracking)
+		{
+			Tracking->UnregisterSubject(Handles.SubjectName);
+		}
+	}
+	Subjects.Empty();
+
+	WriteReport();
+}
+
+double FVPTrackingSoakBenchmark::MeasureFreeDDecodeRate(int32 NumPackets)
+{
+	// A small working set of distinct packets, decoded over and over
+	static constexpr int32 NumDistinct = 1024;
+	static constexpr int32 NumCameras = 16;
+	TArray<FVPSynthCameraMotion> Motions;
+	for (int32 CameraIndex = 0; CameraIndex < NumCameras; ++CameraIndex)
+	{
+		Motions.Emplace(CameraIndex, 0);
+	}
+
+	TArray<uint8> Packets;
+	Packets.SetNumUninitialized(NumDistinct * VPFreeD::PacketSize);
+	for (int32 Index = 0; Index < NumDistinct; ++Index)
+	{
+		const FVPTrackingSample Sample = Motions[Index % NumCameras].Evaluate(Index * 0.004);
+		const FRotator Rotation = Sample.Rotation.Rotator();
+
+		FVPFreeDData Data;
+		Data.CameraId = (uint8)(Index % NumCameras);
+		Data.Pan = Rotation.Yaw;
+		Data.Tilt = Rotation.Pitch;
+		Data.Roll = Rotation.Roll;
+		Data.Position = Sample.Location;
+
+		uint8 Packet[VPFreeD::PacketSize];
+		VPFreeD::Encode(Data, Packet);
+		FMemory::Memcpy(&Packets[Index * VPFreeD::PacketSize], Packet, VPFreeD::PacketSize);
+	}
+
+	FVPFreeDData Decoded;
+	double Checksum = 0.0;
+	const double Begin = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumPackets; ++Index)
+	{
+		if (VPFreeD::Decode(&Packets[(Index % NumDistinct) * VPFreeD::PacketSize], VPFreeD::PacketSize, Decoded))
+		{
+			Checksum += Decoded.Pan;
+		}
+	}
+	const double Elapsed = FPlatformTime::Seconds() - Begin;
+
+	UE_LOG(LogTemp, Verbose, TEXT("FreeD decode checksum %f"), Checksum);
+	return Elapsed > 0.0 ? NumPackets / Elapsed : 0.0;
+}
+
+bool FVPTrackingSoakBenchmark::Tick(float DeltaTime)
+{
+	UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+	if (Tracking && Subjects.Num() > 0)
+	{
+		// The core ticker runs before the world, so the first lookup pays for the frame's batched evaluation
+		const double Begin = FPlatformTime::Seconds();
+		FVPTrackingSample Sample;
+		for (const FSubjectHandles& Handles : Subjects)
+		{
+			Tracking->GetEvaluatedSample(Handles.SubjectName, Sample);
+		}
+		// The histogram has microsecond resolution, the per subject split is done in the report
+		EvaluateCost.Add(FPlatformTime::Seconds() - Begin);
+	}
+
+	if (FPlatformTime::Seconds() - StartTime >= Duration)
+	{
+		// Finish removes this ticker, tell the ticker not to call again either
+		Finish();
+		return false;
+	}
+	return true;
+}
+
+void FVPTrackingSoakBenchmark::WriteReport() const
+{
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	const uint64 NumSent = Generator.GetNumSent();
+	const uint64 NumLost = Generator.GetNumLost();
+
+	UE_LOG(LogTemp, Log, TEXT("Tracking soak: %d cameras at %.0f Hz, %.1f s"), GeneratorSettings.NumCameras, GeneratorSettings.RateHz, Elapsed);
+	UE_LOG(LogTemp, Log, TEXT("  VPFreeD::Decode alone, in memory: %.2f M packets/s"), FreeDDecodeRate * 1.0e-6);
+	UE_LOG(LogTemp, Log, TEXT("  Samples: %llu sent, %llu lost on purpose, %llu received (%.0f/s)"), NumSent, NumLost, NumReceived.load(), Elapsed > 0.0 ? NumReceived.load() / Elapsed : 0.0);
+	UE_LOG(LogTemp, Log, TEXT("  Latency: p50 %.0f us, p95 %.0f us, p99 %.0f us, max %.0f us"),
+		Latency.GetPercentile(0.5) * 1.0e6, Latency.GetPercentile(0.95) * 1.0e6, Latency.GetPercentile(0.99) * 1.0e6, Latency.GetMax() * 1.0e6);
+	const double PerSubject = 1.0e6 / FMath::Max(GeneratorSettings.NumCameras, 1);
+	UE_LOG(LogTemp, Log, TEXT("  Game thread per subject: mean %.2f us, p99 %.2f us"), EvaluateCost.GetMean() * PerSubject, EvaluateCost.GetPercentile(0.99) * PerSubject);
+
+	FString Csv = TEXT("Cameras,RateHz,PacketLoss,JitterMs,Seconds,Sent,Lost,Received,FreeDDecodeOnlyPacketsPerSecond,LatencyP50Us,LatencyP95Us,LatencyP99Us,LatencyMaxUs,SubjectCostMeanUs,SubjectCostP99Us\n");
+	Csv += FString::Printf(TEXT("%d,%.0f,%.3f,%.2f,%.1f,%llu,%llu,%llu,%.0f,%.0f,%.0f,%.0f,%.0f,%.3f,%.3f\n"),
+		GeneratorSettings.NumCameras, GeneratorSettings.RateHz, GeneratorSettings.PacketLoss, GeneratorSettings.JitterMs, Elapsed,
+		NumSent, NumLost, NumReceived.load(), FreeDDecodeRate,
+		Latency.GetPercentile(0.5) * 1.0e6, Latency.GetPercentile(0.95) * 1.0e6, Latency.GetPercentile(0.99) * 1.0e6, Latency.GetMax() * 1.0e6,
+		EvaluateCost.GetMean() * PerSubject, EvaluateCost.GetPercentile(0.99) * PerSubject);
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("BelindaVP") / FString::Printf(TEXT("TrackingSoak_%s.csv"), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath))
+	{
+		UE_LOG(LogTemp, Log, TEXT("  Report written to %s"), *CsvPath);
+	}
+}
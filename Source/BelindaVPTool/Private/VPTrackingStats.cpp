@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingStats.h"
+
+namespace VPTrackingStats
+{
+	// Weight of a new interval in the running estimate of the nominal packet interval
+	static constexpr double IntervalSmoothing = 0.02;
+
+	// A gap longer than this many intervals counts the missing samples as dropped
+	static constexpr double DropThreshold = 1.5;
+}
+
+void FVPTrackingStats::OnSampleReceived(double SampleTime, double ArrivalTime, bool bSourceTimed)
+{
+	NumReceived.fetch_add(1, std::memory_order_relaxed);
+
+	// Switching timelines makes the last sample time meaningless
+	const bool bTimelineChanged = bSourceTimed != bLastSourceTimed;
+	bLastSourceTimed = bSourceTimed;
+	if (bRestart.exchange(false, std::memory_order_relaxed) || bTimelineChanged)
+	{
+		LastSampleTime = SampleTime;
+		LastArrivalTime = ArrivalTime;
+		SampleInterval = 0.0;
+		ArrivalInterval = 0.0;
+		return;
+	}
+
+	if (SampleTime <= LastSampleTime)
+	{
+		NumOutOfOrder.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const double SampleDelta = SampleTime - LastSampleTime;
+	const double ArrivalDelta = ArrivalTime - LastArrivalTime;
+	LastSampleTime = SampleTime;
+	LastArrivalTime = ArrivalTime;
+
+	if (SampleInterval <= 0.0)
+	{
+		SampleInterval = SampleDelta;
+		ArrivalInterval = ArrivalDelta;
+		return;
+	}
+
+	// A gap in arrival times is late delivery, not loss: only the sender's timeline can tell
+	if (bSourceTimed && SampleDelta > SampleInterval * VPTrackingStats::DropThreshold)
+	{
+		NumDropped.fetch_add((uint64)FMath::Max(FMath::RoundToInt(SampleDelta / SampleInterval) - 1, 1), std::memory_order_relaxed);
+	}
+	else
+	{
+		// Gaps are kept out of the nominal interval so a burst of loss doesn't stretch it
+		SampleInterval = FMath::Lerp(SampleInterval, SampleDelta, VPTrackingStats::IntervalSmoothing);
+	}
+
+	ArrivalJitter.Add(FMath::Abs(ArrivalDelta - ArrivalInterval));
+	ArrivalInterval = FMath::Lerp(ArrivalInterval, FMath::Min(ArrivalDelta, SampleInterval * VPTrackingStats::DropThreshold), VPTrackingStats::IntervalSmoothing);
+}
+
+void FVPTrackingStats::OnEvaluated(double EvaluationTime, bool bHasRange, double OldestTime, double NewestTime)
+{
+	if (!bHasRange)
+	{
+		++WindowUnderflows;
+		++TotalUnderflows;
+		LastEvaluationMargin = 0.0;
+		LastEvaluationAge = 0.0;
+		return;
+	}
+
+	LastEvaluationMargin = NewestTime - EvaluationTime;
+	LastEvaluationAge = EvaluationTime - OldestTime;
+
+	if (LastEvaluationMargin < 0.0)
+	{
+		++WindowUnderflows;
+		++TotalUnderflows;
+	}
+	else if (LastEvaluationAge < 0.0)
+	{
+		++WindowOverflows;
+		++TotalOverflows;
+	}
+
+	EvaluationMargin.Add(FMath::Max(LastEvaluationMargin, 0.0));
+}
+
+bool FVPTrackingStats::Tick(double Now, double WindowSeconds)
+{
+	if (WindowStart <= 0.0)
+	{
+		WindowStart = Now;
+		return false;
+	}
+
+	const double Elapsed = Now - WindowStart;
+	if (Elapsed < WindowSeconds)
+		return false;
+
+	const uint64 Received = GetNumReceived();
+	const uint64 Dropped = GetNumDropped();
+	const uint64 OutOfOrder = GetNumOutOfOrder();
+
+	Snapshot.WindowSeconds = Elapsed;
+	Snapshot.PacketRate = (Received - WindowStartReceived) / Elapsed;
+	Snapshot.Dropped = (uint32)(Dropped - WindowStartDropped);
+	Snapshot.OutOfOrder = (uint32)(OutOfOrder - WindowStartOutOfOrder);
+
+	Snapshot.ArrivalJitterP50 = ArrivalJitter.GetPercentile(0.5);
+	Snapshot.ArrivalJitterP95 = ArrivalJitter.GetPercentile(0.95);
+	Snapshot.ArrivalJitterMax = ArrivalJitter.GetMax();
+
+	Snapshot.EvaluationMarginMean = EvaluationMargin.GetMean();
+	Snapshot.EvaluationMarginP05 = EvaluationMargin.GetPercentile(0.05);
+	Snapshot.Underflows = WindowUnderflows;
+	Snapshot.Overflows = WindowOverflows;
+
+	Snapshot.TotalReceived = Received;
+	Snapshot.TotalDropped = Dropped;
+	Snapshot.TotalOutOfOrder = OutOfOrder;
+
+	// The receive thread may add a value while the histogram is cleared, losing one sample is fine for stats
+	ArrivalJitter.Reset();
+	EvaluationMargin.Reset();
+	WindowUnderflows = 0;
+	WindowOverflows = 0;
+
+	WindowStart = Now;
+	WindowStartReceived = Received;
+	WindowStartDropped = Dropped;
+	WindowStartOutOfOrder = OutOfOrder;
+	return true;
+}
+
+void FVPTrackingStats::Reset()
+{
+	NumReceived = 0;
+	NumDropped = 0;
+	NumOutOfOrder = 0;
+	bRestart = true;
+
+	ArrivalJitter.Reset();
+	EvaluationMargin.Reset();
+	WindowUnderflows = 0;
+	WindowOverflows = 0;
+	TotalUnderflows = 0;
+	TotalOverflows = 0;
+
+	WindowStart = 0.0;
+	WindowStartReceived = 0;
+	WindowStartDropped = 0;
+	WindowStartOutOfOrder = 0;
+	Snapshot = FVPTrackingStatsSnapshot();
+}
@@ -0,0 +1,658 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingSubsystem.h"
+#include "VPTrackingJitterBuffer.h"
+#include "VPTrackingTimedDataInput.h"
+#include "VPFramePacingSubsystem.h"
+#include "ILiveLinkClient.h"
+#include "Features/IModularFeatures.h"
+#include "Roles/LiveLinkCameraTypes.h"
+#include "Misc/App.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Evaluate subjects"), STAT_BelindaVP_Evaluate, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Subjects"), STAT_BelindaVP_Subjects, STATGROUP_BelindaVP);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Packets/s"), STAT_BelindaVP_PacketRate, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped/s"), STAT_BelindaVP_Dropped, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Out of order/s"), STAT_BelindaVP_OutOfOrder, STATGROUP_BelindaVP);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Worst arrival jitter p95 (ms)"), STAT_BelindaVP_Jitter, STATGROUP_BelindaVP);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Lowest evaluation margin p05 (ms)"), STAT_BelindaVP_Margin, STATGROUP_BelindaVP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Buffer underflows/s"), STAT_BelindaVP_Underflows, STATGROUP_BelindaVP);
+
+CSV_DEFINE_CATEGORY(BelindaVP, true);
+
+namespace VPTrackingSubsystem
+{
+	// Length of the stats windows, short enough to see a stutter's cause right away
+	static constexpr double StatsWindowSeconds = 1.0;
+
+	// Extra history kept on top of depth and delay, covers late packets and rate changes
+	static constexpr double HistoryHeadroomSeconds = 0.1;
+	static constexpr double CapacitySlack = 1.25;
+	static constexpr int32 MaxBufferCapacity = 16384;
+
+	// Samples missing their time source are dropped for this long before the buffer restarts on arrival time
+	static constexpr double TimelineFallbackSeconds = 0.5;
+}
+
+static FAutoConsoleCommand ReplayStartCommand(
+	TEXT("BelindaVP.Replay.Start"),
+	TEXT("Replays a tracking journal. Args: <JournalPath> [RealTime|Accelerated|FrameStepped] [Speed] [LiveLink|FreeD]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+			if (!Tracking || Args.Num() < 1)
+				return;
+
+			FVPReplaySettings Settings;
+			if (Args.IsValidIndex(1))
+			{
+				Settings.Mode = Args[1] == TEXT("FrameStepped") ? EVPReplayMode::FrameStepped : Args[1] == TEXT("Accelerated") ? EVPReplayMode::Accelerated : EVPReplayMode::RealTime;
+			}
+			if (Args.IsValidIndex(2))
+			{
+				Settings.Speed = FCString::Atof(*Args[2]);
+			}
+			if (Args.IsValidIndex(3))
+			{
+				Settings.Output = Args[3] == TEXT("FreeD") ? EVPReplayOutput::FreeD : EVPReplayOutput::LiveLink;
+			}
+			Tracking->StartReplay(Args[0], Settings);
+		}));
+
+static FAutoConsoleCommand ReplayStepCommand(
+	TEXT("BelindaVP.Replay.Step"),
+	TEXT("Plays the next frames of a frame stepped replay. Args: [NumFrames]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+			{
+				Tracking->StepReplay(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 1);
+			}
+		}));
+
+static FAutoConsoleCommand ReplayStopCommand(
+	TEXT("BelindaVP.Replay.Stop"),
+	TEXT("Stops the tracking replay"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+			{
+				Tracking->StopReplay();
+			}
+		}));
+
+static FAutoConsoleCommand StatsCommand(
+	TEXT("BelindaVP.Stats"),
+	TEXT("Logs the last second of tracking health of every buffered subject"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr;
+			if (!Tracking)
+				return;
+
+			TArray<TPair<FName, FVPTrackingStatsSnapshot>> SubjectStats;
+			Tracking->GetSubjectStats(SubjectStats);
+			for (const TPair<FName, FVPTrackingStatsSnapshot>& Pair : SubjectStats)
+			{
+				const FVPTrackingStatsSnapshot& Stats = Pair.Value;
+				UE_LOG(LogTemp, Log, TEXT("%s: %.1f packets/s, %u dropped, %u out of order, jitter p95 %.2f ms max %.2f ms, margin mean %.2f ms p05 %.2f ms, %u underflows, %u overflows"),
+					*Pair.Key.ToString(), Stats.PacketRate, Stats.Dropped, Stats.OutOfOrder,
+					Stats.ArrivalJitterP95 * 1000.0, Stats.ArrivalJitterMax * 1000.0,
+					Stats.EvaluationMarginMean * 1000.0, Stats.EvaluationMarginP05 * 1000.0, Stats.Underflows, Stats.Overflows);
+			}
+		}));
+
+static FAutoConsoleCommand StatsExportCommand(
+	TEXT("BelindaVP.Stats.Export"),
+	TEXT("Writes the tracking health of every buffered subject to a CSV. Args: [FilePath]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+			{
+				const FString FilePath = Tracking->ExportStatsCsv(Args.IsValidIndex(0) ? Args[0] : FString());
+				UE_LOG(LogTemp, Log, TEXT("Tracking stats written to %s"), *FilePath);
+			}
+		}));
+
+static FAutoConsoleCommand StatsResetCommand(
+	TEXT("BelindaVP.Stats.Reset"),
+	TEXT("Resets the tracking health counters"),
+	FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UVPTrackingSubsystem* Tracking = GEngine ? GEngine->GetEngineSubsystem<UVPTrackingSubsystem>() : nullptr)
+			{
+				Tracking->ResetStats();
+			}
+		}));
+
+void UVPTrackingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TimedDataInput = MakeUnique<FVPTrackingTimedDataInput>();
+	TimedDataInput->Register();
+}
+
+void UVPTrackingSubsystem::Deinitialize()
+{
+	StopRecording();
+	StopReplay();
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+		for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+		{
+			Client.UnregisterSubjectFramesHandle(Pair.Value->SubjectName, Pair.Value->StaticDataHandle, Pair.Value->FrameDataHandle);
+		}
+	}
+
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		TimedDataInput->RemoveSubject(Pair.Value->TimedDataChannel.Get());
+	}
+	TimedDataInput->Unregister();
+	TimedDataInput.Reset();
+
+	Channels.Empty();
+
+	Super::Deinitialize();
+}
+
+void UVPTrackingSubsystem::RegisterSubject(FLiveLinkSubjectName SubjectName, const FVPJitterBufferSettings& Settings)
+{
+	if (SubjectName.IsNone())
+		return;
+
+	if (TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name))
+	{
+		ApplySettings(**Existing, Settings);
+		(*Existing)->RefCount++;
+		return;
+	}
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("LiveLink client not available, can't buffer subject %s"), *SubjectName.ToString());
+		return;
+	}
+
+	ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+
+	TSharedPtr<FChannel> Channel = MakeShared<FChannel>();
+	Channel->SubjectName = SubjectName;
+	ApplySettings(*Channel, Settings);
+	Channel->Buffer = MakeUnique<FVPTrackingJitterBuffer>();
+	Channel->RefCount = 1;
+	Channel->RecordQueue = MakeShared<FVPTrackingRecorder::FQueue>(FVPTrackingRecorder::QueueSize);
+	Channel->TimedDataChannel = MakeUnique<FVPTrackingTimedDataChannel>(SubjectName.Name, *Channel->Buffer, Channel->Stats, Channel->bTimecodeSamples);
+	TimedDataInput->AddSubject(Channel->TimedDataChannel.Get());
+
+#if CSV_PROFILER
+	const TCHAR* CsvStatSuffixes[UE_ARRAY_COUNT(Channel->CsvStatNames)] = { TEXT("PacketRate"), TEXT("Dropped"), TEXT("OutOfOrder"), TEXT("JitterP95Ms"), TEXT("MarginP05Ms"), TEXT("Underflows") };
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(Channel->CsvStatNames); ++Index)
+	{
+		Channel->CsvStatNames[Index] = FName(*FString::Printf(TEXT("%s_%s"), *SubjectName.ToString(), CsvStatSuffixes[Index]));
+	}
+#endif
+
+	// The delegates keep the channel alive until they are unregistered, they can fire from the source thread
+	TSubclassOf<ULiveLinkRole> SubjectRole;
+	Client.RegisterForSubjectFrames(SubjectName,
+		FOnLiveLinkSubjectStaticDataReceived::FDelegate::CreateLambda([Channel](FLiveLinkSubjectKey, TSubclassOf<ULiveLinkRole>, const FLiveLinkStaticDataStruct&)
+			{
+				Channel->StaticDataGeneration++;
+			}),
+		FOnLiveLinkSubjectFrameDataReceived::FDelegate::CreateLambda([Channel](FLiveLinkSubjectKey, TSubclassOf<ULiveLinkRole>, const FLiveLinkFrameDataStruct& FrameData)
+			{
+				OnFrameDataReceived(FrameData, Channel.Get());
+			}),
+		Channel->StaticDataHandle,
+		Channel->FrameDataHandle,
+		SubjectRole);
+
+	Channels.Add(SubjectName.Name, Channel);
+
+	if (Recorder.IsValid())
+	{
+		StartRecordingChannel(*Channel);
+	}
+}
+
+void UVPTrackingSubsystem::UnregisterSubject(FLiveLinkSubjectName SubjectName)
+{
+	TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name);
+	if (!Existing || --(*Existing)->RefCount > 0)
+		return;
+
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+		Client.UnregisterSubjectFramesHandle(SubjectName, (*Existing)->StaticDataHandle, (*Existing)->FrameDataHandle);
+	}
+
+	TimedDataInput->RemoveSubject((*Existing)->TimedDataChannel.Get());
+
+	// The recorder keeps its own reference to the queue and drains what is left
+	Channels.Remove(SubjectName.Name);
+}
+
+void UVPTrackingSubsystem::SetSubjectSettings(FLiveLinkSubjectName SubjectName, const FVPJitterBufferSettings& Settings)
+{
+	if (TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name))
+	{
+		ApplySettings(**Existing, Settings);
+	}
+}
+
+void UVPTrackingSubsystem::ApplySettings(FChannel& Channel, const FVPJitterBufferSettings& Settings)
+{
+	Channel.Settings = Settings;
+	Channel.TimeSource.store(Settings.TimeSource, std::memory_order_relaxed);
+}
+
+void UVPTrackingSubsystem::SetSubjectDelay(FLiveLinkSubjectName SubjectName, const FVPDelayLineSettings& DelayLine, double LeadSeconds)
+{
+	if (TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name))
+	{
+		(*Existing)->DelayLine = DelayLine;
+		(*Existing)->LeadSeconds = LeadSeconds;
+		FitBufferCapacity(**Existing);
+	}
+}
+
+void UVPTrackingSubsystem::SetSubjectFilter(FLiveLinkSubjectName SubjectName, const FVPMotionFilterSettings& Filter)
+{
+	if (TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name))
+	{
+		(*Existing)->FilterSettings = Filter;
+	}
+}
+
+void UVPTrackingSubsystem::SetSubjectEncoderMapping(FLiveLinkSubjectName SubjectName, const TSharedPtr<const FVPEncoderMapping>& Mapping)
+{
+	if (TSharedPtr<FChannel>* Existing = Channels.Find(SubjectName.Name))
+	{
+		(*Existing)->EncoderMapping = Mapping;
+	}
+}
+
+bool UVPTrackingSubsystem::GetEvaluatedSample(FLiveLinkSubjectName SubjectName, FVPTrackingSample& OutSample)
+{
+	if (LastEvaluatedFrame != GFrameCounter)
+	{
+		EvaluateChannels();
+		LastEvaluatedFrame = GFrameCounter;
+	}
+
+	const TSharedPtr<FChannel>* Channel = Channels.Find(SubjectName.Name);
+	if (!Channel || !(*Channel)->bHasOutput)
+		return false;
+
+	OutSample = (*Channel)->Output;
+	return true;
+}
+
+bool UVPTrackingSubsystem::GetFusedSample(FLiveLinkSubjectName PoseSubject, FLiveLinkSubjectName LensSubject, FVPTrackingSample& OutSample, bool& bOutHasLens)
+{
+	bOutHasLens = false;
+	if (!GetEvaluatedSample(PoseSubject, OutSample))
+		return false;
+
+	// Both were evaluated in the same batch, at the same frame time mapped onto each stream's own clock
+	const TSharedPtr<FChannel>* Lens = Channels.Find(LensSubject.Name);
+	bOutHasLens = Lens && (*Lens)->bHasOutput;
+	if (bOutHasLens)
+	{
+		const FVPTrackingSample& LensSample = (*Lens)->Output;
+		OutSample.FieldOfView = LensSample.FieldOfView;
+		OutSample.FocalLength = LensSample.FocalLength;
+		OutSample.Aperture = LensSample.Aperture;
+		OutSample.FocusDistance = LensSample.FocusDistance;
+	}
+	return true;
+}
+
+uint32 UVPTrackingSubsystem::GetStaticDataGeneration(FLiveLinkSubjectName SubjectName) const
+{
+	const TSharedPtr<FChannel>* Channel = Channels.Find(SubjectName.Name);
+	return Channel ? (*Channel)->StaticDataGeneration.load() : 0;
+}
+
+void UVPTrackingSubsystem::OnFrameDataReceived(const FLiveLinkFrameDataStruct& FrameData, FChannel* Channel)
+{
+	const FLiveLinkCameraFrameData* CameraData = FrameData.Cast<FLiveLinkCameraFrameData>();
+	if (!CameraData)
+		return;
+
+	FVPTrackingSample Sample;
+	Sample.ReadFrom(*CameraData);
+
+	const double ArrivalTime = FPlatformTime::Seconds();
+	const FQualifiedFrameTime& SceneTime = CameraData->MetaData.SceneTime;
+	const EVPTrackingTimeSource TimeSource = Channel->TimeSource.load(std::memory_order_relaxed);
+	EVPTrackingTimeSource Timeline = EVPTrackingTimeSource::ArrivalTime;
+	if (TimeSource == EVPTrackingTimeSource::Timecode && SceneTime.Rate.IsValid() && SceneTime.Time.GetFrame().Value != 0)
+	{
+		Sample.Time = SceneTime.AsSeconds();
+		Timeline = EVPTrackingTimeSource::Timecode;
+	}
+	else if (TimeSource == EVPTrackingTimeSource::SourceClock && CameraData->WorldTime.GetSourceTime() > 0.0)
+	{
+		Sample.Time = Channel->SourceClock.ToLocalTime(CameraData->WorldTime.GetSourceTime(), ArrivalTime);
+		Timeline = EVPTrackingTimeSource::SourceClock;
+	}
+	else
+	{
+		Sample.Time = ArrivalTime;
+	}
+
+	const bool bSourceTimed = Timeline != EVPTrackingTimeSource::ArrivalTime;
+	if (bSourceTimed)
+	{
+		Channel->LastTimedArrival = ArrivalTime;
+	}
+
+	// Samples on two unrelated clocks would bracket each other meaninglessly. One that lost its time source is dropped
+	// while the others still carry it, past that the buffer restarts on the clock the samples have now.
+	bool bBuffered = true;
+	if (Timeline != Channel->BufferTimeline)
+	{
+		if (!bSourceTimed && Channel->BufferTimeline == TimeSource && ArrivalTime - Channel->LastTimedArrival < VPTrackingSubsystem::TimelineFallbackSeconds)
+		{
+			bBuffered = false;
+		}
+		else
+		{
+			if (Channel->Buffer->Num() > 0)
+			{
+				UE_LOG(LogTemp, Log, TEXT("%s: tracking buffer restarted on %s"), *Channel->SubjectName.ToString(), *UEnum::GetValueAsString(Timeline));
+			}
+			Channel->Buffer->Reset();
+			Channel->BufferTimeline = Timeline;
+			Channel->bTimecodeSamples = Timeline == EVPTrackingTimeSource::Timecode;
+		}
+	}
+
+	if (bBuffered)
+	{
+		Channel->Buffer->Push(Sample);
+		Channel->Stats.OnSampleReceived(Sample.Time, ArrivalTime, bSourceTimed);
+	}
+
+	if (Channel->bRecording)
+	{
+		FVPTrackingRecordEntry Entry;
+		Entry.Sample = Sample;
+		Entry.ArrivalTime = ArrivalTime;
+		Entry.SceneTime = SceneTime;
+		Entry.bHasTimecode = Timeline == EVPTrackingTimeSource::Timecode;
+		if (!Channel->RecordQueue->Enqueue(Entry))
+		{
+			Channel->NumRecordDrops++;
+		}
+	}
+}
+
+bool UVPTrackingSubsystem::StartRecording(const FString& FilePath)
+{
+	StopRecording();
+
+	Recorder = MakeUnique<FVPTrackingRecorder>();
+	if (!Recorder->Open(FilePath))
+	{
+		Recorder.Reset();
+		return false;
+	}
+
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		StartRecordingChannel(*Pair.Value);
+	}
+
+	if (UVPFramePacingSubsystem* Pacing = GEngine ? GEngine->GetEngineSubsystem<UVPFramePacingSubsystem>() : nullptr)
+	{
+		Pacing->BeginTake();
+	}
+	return true;
+}
+
+void UVPTrackingSubsystem::StopRecording()
+{
+	if (!Recorder.IsValid())
+		return;
+
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		FChannel& Channel = *Pair.Value;
+		Channel.bRecording = false;
+		if (Channel.NumRecordDrops > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Tracking recorder dropped %u samples of %s"), Channel.NumRecordDrops.load(), *Pair.Key.ToString());
+		}
+	}
+
+	Recorder->Close();
+
+	// Every take gets its pacing report next to the journal
+	if (UVPFramePacingSubsystem* Pacing = GEngine ? GEngine->GetEngineSubsystem<UVPFramePacingSubsystem>() : nullptr)
+	{
+		const FString& JournalPath = Recorder->GetFilePath();
+		Pacing->EndTake(FPaths::GetPath(JournalPath) / FPaths::GetBaseFilename(JournalPath));
+	}
+
+	Recorder.Reset();
+}
+
+bool UVPTrackingSubsystem::StartReplay(const FString& JournalPath, const FVPReplaySettings& Settings)
+{
+	StopReplay();
+
+	Replay = MakeUnique<FVPTrackingReplay>();
+	if (!Replay->Start(JournalPath, Settings))
+	{
+		Replay.Reset();
+		return false;
+	}
+	return true;
+}
+
+void UVPTrackingSubsystem::StepReplay(int32 NumFrames)
+{
+	if (Replay.IsValid())
+	{
+		Replay->Step(NumFrames);
+	}
+}
+
+void UVPTrackingSubsystem::StopReplay()
+{
+	Replay.Reset();
+}
+
+void UVPTrackingSubsystem::StartRecordingChannel(FChannel& Channel)
+{
+	// Nobody consumes the queue between two recordings, throw away what a previous take left behind
+	FVPTrackingRecordEntry Stale;
+	while (Channel.RecordQueue->Dequeue(Stale))
+	{
+	}
+
+	Channel.NumRecordDrops = 0;
+	Recorder->AddSubject(Channel.SubjectName.Name, Channel.RecordQueue);
+	Channel.bRecording = true;
+}
+
+void UVPTrackingSubsystem::EvaluateChannels()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BelindaVP_Evaluate);
+
+	const double Now = FPlatformTime::Seconds();
+	double PacketRate = 0.0;
+	uint32 Dropped = 0;
+	uint32 OutOfOrder = 0;
+	uint32 Underflows = 0;
+	double WorstJitter = 0.0;
+	double LowestMargin = Channels.Num() > 0 ? UE_DOUBLE_BIG_NUMBER : 0.0;
+
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		FChannel& Channel = *Pair.Value;
+		if (Channel.Settings.bEnabled)
+		{
+			const double EvaluationTime = GetEvaluationTime(Channel);
+			Channel.bHasOutput = Channel.Buffer->Evaluate(EvaluationTime, Channel.Output);
+			if (Channel.bHasOutput)
+			{
+				// Mapped first, a cutoff on encoder counts would mean something else at each end of a nonlinear lens
+				if (Channel.EncoderMapping.IsValid())
+				{
+					Channel.EncoderMapping->Apply(Channel.Output);
+				}
+				Channel.Filter.Apply(Channel.FilterSettings, EvaluationTime, Channel.Output);
+			}
+
+			double Oldest = 0.0;
+			double Newest = 0.0;
+			const bool bHasRange = Channel.Buffer->GetTimeRange(Oldest, Newest);
+			Channel.Stats.OnEvaluated(EvaluationTime, bHasRange, Oldest, Newest);
+		}
+		else
+		{
+			Channel.bHasOutput = false;
+		}
+
+		if (Channel.Stats.Tick(Now, VPTrackingSubsystem::StatsWindowSeconds))
+		{
+			RecordCsvStats(Channel);
+			FitBufferCapacity(Channel);
+		}
+
+		const FVPTrackingStatsSnapshot& Snapshot = Channel.Stats.GetSnapshot();
+		PacketRate += Snapshot.PacketRate;
+		Dropped += Snapshot.Dropped;
+		OutOfOrder += Snapshot.OutOfOrder;
+		Underflows += Snapshot.Underflows;
+		WorstJitter = FMath::Max(WorstJitter, Snapshot.ArrivalJitterP95);
+		LowestMargin = FMath::Min(LowestMargin, Snapshot.EvaluationMarginP05);
+	}
+
+	SET_DWORD_STAT(STAT_BelindaVP_Subjects, Channels.Num());
+	SET_FLOAT_STAT(STAT_BelindaVP_PacketRate, PacketRate);
+	SET_DWORD_STAT(STAT_BelindaVP_Dropped, Dropped);
+	SET_DWORD_STAT(STAT_BelindaVP_OutOfOrder, OutOfOrder);
+	SET_FLOAT_STAT(STAT_BelindaVP_Jitter, WorstJitter * 1000.0);
+	SET_FLOAT_STAT(STAT_BelindaVP_Margin, LowestMargin * 1000.0);
+	SET_DWORD_STAT(STAT_BelindaVP_Underflows, Underflows);
+}
+
+void UVPTrackingSubsystem::FitBufferCapacity(FChannel& Channel)
+{
+	const FVPTrackingStatsSnapshot& Snapshot = Channel.Stats.GetSnapshot();
+	const int32 Capacity = Channel.Buffer->GetCapacity();
+
+	// Evaluated before the oldest sample while the buffer is full: the delay asked for more history than it holds
+	if (Snapshot.Overflows > 0 && Channel.Buffer->Num() == Capacity)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: %u evaluations older than the %d buffered samples, held on the oldest one"),
+			*Channel.SubjectName.ToString(), Snapshot.Overflows, Capacity);
+	}
+
+	if (Snapshot.PacketRate <= 0.0)
+		return;
+
+	const FFrameRate FrameRate = FApp::GetTimecodeFrameRate();
+	const double History = Channel.Settings.DepthFrames * FrameRate.AsInterval() + FMath::Max(Channel.DelayLine.GetDelaySeconds(FrameRate) - Channel.LeadSeconds, 0.0)
+		+ VPTrackingSubsystem::HistoryHeadroomSeconds;
+	const int32 Needed = FMath::Min(FMath::CeilToInt(History * Snapshot.PacketRate * VPTrackingSubsystem::CapacitySlack), VPTrackingSubsystem::MaxBufferCapacity);
+
+	// Never shrinks, a rate that dips for a second shouldn't throw history away
+	if (Needed > Capacity)
+	{
+		Channel.Buffer->SetCapacity(Needed);
+		UE_LOG(LogTemp, Log, TEXT("%s: tracking buffer grown to %d samples for %.0f ms at %.0f Hz"),
+			*Channel.SubjectName.ToString(), Needed, History * 1000.0, Snapshot.PacketRate);
+	}
+}
+
+void UVPTrackingSubsystem::RecordCsvStats(const FChannel& Channel)
+{
+#if CSV_PROFILER
+	const FVPTrackingStatsSnapshot& Snapshot = Channel.Stats.GetSnapshot();
+	const float Values[UE_ARRAY_COUNT(Channel.CsvStatNames)] =
+	{
+		(float)Snapshot.PacketRate,
+		(float)Snapshot.Dropped,
+		(float)Snapshot.OutOfOrder,
+		(float)(Snapshot.ArrivalJitterP95 * 1000.0),
+		(float)(Snapshot.EvaluationMarginP05 * 1000.0),
+		(float)Snapshot.Underflows
+	};
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(Channel.CsvStatNames); ++Index)
+	{
+		FCsvProfiler::RecordCustomStat(Channel.CsvStatNames[Index], CSV_CATEGORY_INDEX(BelindaVP), Values[Index], ECsvCustomStatOp::Set);
+	}
+#endif
+}
+
+void UVPTrackingSubsystem::GetSubjectStats(TArray<TPair<FName, FVPTrackingStatsSnapshot>>& OutStats) const
+{
+	OutStats.Reset(Channels.Num());
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		OutStats.Emplace(Pair.Key, Pair.Value->Stats.GetSnapshot());
+	}
+}
+
+void UVPTrackingSubsystem::ResetStats()
+{
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		Pair.Value->Stats.Reset();
+	}
+}
+
+FString UVPTrackingSubsystem::ExportStatsCsv(const FString& FilePath) const
+{
+	const FString OutputPath = !FilePath.IsEmpty() ? FilePath
+		: FPaths::ProfilingDir() / TEXT("BelindaVP") / FString::Printf(TEXT("TrackingStats_%s.csv"), *FDateTime::Now().ToString());
+
+	FString Csv = TEXT("Subject,WindowSeconds,PacketRate,Dropped,OutOfOrder,JitterP50Ms,JitterP95Ms,JitterMaxMs,MarginMeanMs,MarginP05Ms,Underflows,Overflows,TotalReceived,TotalDropped,TotalOutOfOrder\n");
+	for (const TPair<FName, TSharedPtr<FChannel>>& Pair : Channels)
+	{
+		const FVPTrackingStatsSnapshot& Stats = Pair.Value->Stats.GetSnapshot();
+		Csv += FString::Printf(TEXT("%s,%.3f,%.2f,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%llu,%llu,%llu\n"),
+			*Pair.Key.ToString(), Stats.WindowSeconds, Stats.PacketRate, Stats.Dropped, Stats.OutOfOrder,
+			Stats.ArrivalJitterP50 * 1000.0, Stats.ArrivalJitterP95 * 1000.0, Stats.ArrivalJitterMax * 1000.0,
+			Stats.EvaluationMarginMean * 1000.0, Stats.EvaluationMarginP05 * 1000.0, Stats.Underflows, Stats.Overflows,
+			Stats.TotalReceived, Stats.TotalDropped, Stats.TotalOutOfOrder);
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *OutputPath) ? OutputPath : FString();
+}
+
+double UVPTrackingSubsystem::GetEvaluationTime(const FChannel& Channel)
+{
+	const FFrameRate FrameRate = FApp::GetTimecodeFrameRate();
+	const double Depth = Channel.Settings.DepthFrames * FrameRate.AsInterval() + Channel.DelayLine.GetDelaySeconds(FrameRate) - Channel.LeadSeconds;
+
+	if (Channel.bTimecodeSamples)
+	{
+		const TOptional<FQualifiedFrameTime> FrameTime = FApp::GetCurrentFrameTime();
+		if (FrameTime.IsSet())
+		{
+			return FrameTime->AsSeconds() - Depth;
+		}
+	}
+
+	// With a genlocked custom time step the current time is latched on the genlock edge
+	return FApp::GetCurrentTime() - Depth;
+}
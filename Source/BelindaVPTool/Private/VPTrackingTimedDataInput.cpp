@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingTimedDataInput.h"
+#include "VPTrackingJitterBuffer.h"
+#include "VPTrackingStats.h"
+#include "ITimeManagementModule.h"
+#include "TimedDataInputCollection.h"
+#include "Misc/App.h"
+
+#define LOCTEXT_NAMESPACE "VPTrackingTimedDataInput"
+
+FVPTrackingTimedDataChannel::FVPTrackingTimedDataChannel(FName InSubjectName, const FVPTrackingJitterBuffer& InBuffer, FVPTrackingStats& InStats, const std::atomic<bool>& bInTimecodeSamples)
+	: SubjectName(InSubjectName)
+	, Buffer(InBuffer)
+	, Stats(InStats)
+	, bTimecodeSamples(bInTimecodeSamples)
+{
+}
+
+FText FVPTrackingTimedDataChannel::GetDisplayName() const
+{
+	return FText::FromName(SubjectName);
+}
+
+ETimedDataInputState FVPTrackingTimedDataChannel::GetState() const
+{
+	if (Buffer.Num() == 0)
+		return ETimedDataInputState::Disconnected;
+
+	// No packet for a whole window while samples are still buffered
+	const FVPTrackingStatsSnapshot& Snapshot = Stats.GetSnapshot();
+	return Snapshot.WindowSeconds > 0.0 && Snapshot.PacketRate <= 0.0 ? ETimedDataInputState::Unresponsive : ETimedDataInputState::Connected;
+}
+
+FTimedDataChannelSampleTime FVPTrackingTimedDataChannel::MakeSampleTime(double Time) const
+{
+	if (bTimecodeSamples)
+	{
+		const FFrameRate Rate = FApp::GetTimecodeFrameRate();
+		return FTimedDataChannelSampleTime(0.0, FQualifiedFrameTime(Rate.AsFrameTime(Time), Rate));
+	}
+	return FTimedDataChannelSampleTime(Time, FQualifiedFrameTime());
+}
+
+FTimedDataChannelSampleTime FVPTrackingTimedDataChannel::GetOldestDataTime() const
+{
+	double Oldest = 0.0;
+	double Newest = 0.0;
+	Buffer.GetTimeRange(Oldest, Newest);
+	return MakeSampleTime(Oldest);
+}
+
+FTimedDataChannelSampleTime FVPTrackingTimedDataChannel::GetNewestDataTime() const
+{
+	double Oldest = 0.0;
+	double Newest = 0.0;
+	Buffer.GetTimeRange(Oldest, Newest);
+	return MakeSampleTime(Newest);
+}
+
+TArray<FTimedDataChannelSampleTime> FVPTrackingTimedDataChannel::GetDataTimes() const
+{
+	TArray<double> Times;
+	Buffer.GetSampleTimes(Times);
+
+	TArray<FTimedDataChannelSampleTime> Result;
+	Result.Reserve(Times.Num());
+	for (double Time : Times)
+	{
+		Result.Add(MakeSampleTime(Time));
+	}
+	return Result;
+}
+
+int32 FVPTrackingTimedDataChannel::GetNumberOfSamples() const
+{
+	return Buffer.Num();
+}
+
+int32 FVPTrackingTimedDataChannel::GetDataBufferSize() const
+{
+	return Buffer.GetCapacity();
+}
+
+void FVPTrackingTimedDataChannel::SetDataBufferSize(int32 BufferSize)
+{
+	// The buffers are preallocated so the receive path never allocates, their size is fixed
+}
+
+int32 FVPTrackingTimedDataChannel::GetBufferUnderflowStat() const
+{
+	return (int32)Stats.GetNumUnderflows();
+}
+
+int32 FVPTrackingTimedDataChannel::GetBufferOverflowStat() const
+{
+	return (int32)Stats.GetNumOverflows();
+}
+
+int32 FVPTrackingTimedDataChannel::GetFrameDroppedStat() const
+{
+	return (int32)Stats.GetNumDropped();
+}
+
+void FVPTrackingTimedDataChannel::GetLastEvaluationData(FTimedDataInputEvaluationData& OutEvaluationData) const
+{
+	OutEvaluationData.DistanceToNewestSampleSeconds = (float)Stats.GetLastEvaluationMargin();
+	OutEvaluationData.DistanceToOldestSampleSeconds = (float)Stats.GetLastEvaluationAge();
+}
+
+void FVPTrackingTimedDataChannel::ResetBufferStats()
+{
+	Stats.Reset();
+}
+
+FText FVPTrackingTimedDataInput::GetDisplayName() const
+{
+	return LOCTEXT("DisplayName", "Belinda VP Tracking");
+}
+
+TArray<ITimedDataInputChannel*> FVPTrackingTimedDataInput::GetChannels() const
+{
+	return TArray<ITimedDataInputChannel*>(Channels);
+}
+
+ETimedDataInputEvaluationType FVPTrackingTimedDataInput::GetEvaluationType() const
+{
+	for (const FVPTrackingTimedDataChannel* Channel : Channels)
+	{
+		if (Channel->HasTimecodeSamples())
+			return ETimedDataInputEvaluationType::Timecode;
+	}
+	return ETimedDataInputEvaluationType::PlatformTime;
+}
+
+FFrameRate FVPTrackingTimedDataInput::GetFrameRate() const
+{
+	return FApp::GetTimecodeFrameRate();
+}
+
+void FVPTrackingTimedDataInput::AddChannel(ITimedDataInputChannel* Channel)
+{
+	// Channels are added through AddSubject, the collection only tells us about them
+}
+
+void FVPTrackingTimedDataInput::RemoveChannel(ITimedDataInputChannel* Channel)
+{
+	Channels.RemoveSingleSwap(static_cast<FVPTrackingTimedDataChannel*>(Channel));
+}
+
+void FVPTrackingTimedDataInput::Register()
+{
+	if (!bRegistered && ITimeManagementModule::IsAvailable())
+	{
+		ITimeManagementModule::Get().GetTimedDataInputCollection().Add(this);
+		for (FVPTrackingTimedDataChannel* Channel : Channels)
+		{
+			ITimeManagementModule::Get().GetTimedDataInputCollection().Add(Channel);
+		}
+		bRegistered = true;
+	}
+}
+
+void FVPTrackingTimedDataInput::Unregister()
+{
+	if (bRegistered && ITimeManagementModule::IsAvailable())
+	{
+		for (FVPTrackingTimedDataChannel* Channel : Channels)
+		{
+			ITimeManagementModule::Get().GetTimedDataInputCollection().Remove(Channel);
+		}
+		ITimeManagementModule::Get().GetTimedDataInputCollection().Remove(this);
+	}
+	bRegistered = false;
+}
+
+void FVPTrackingTimedDataInput::AddSubject(FVPTrackingTimedDataChannel* Channel)
+{
+	Channels.AddUnique(Channel);
+	if (bRegistered && ITimeManagementModule::IsAvailable())
+	{
+		ITimeManagementModule::Get().GetTimedDataInputCollection().Add(Channel);
+	}
+}
+
+void FVPTrackingTimedDataInput::RemoveSubject(FVPTrackingTimedDataChannel* Channel)
+{
+	Channels.RemoveSingleSwap(Channel);
+	if (bRegistered && ITimeManagementModule::IsAvailable())
+	{
+		ITimeManagementModule::Get().GetTimedDataInputCollection().Remove(Channel);
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
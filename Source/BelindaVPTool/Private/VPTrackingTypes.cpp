@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VPTrackingTypes.h"
+#include "Roles/LiveLinkCameraTypes.h"
+
+double FVPDelayLineSettings::GetDelaySeconds(const FFrameRate& FrameRate) const
+{
+	const double Value = FMath::Max(Delay, 0.0f);
+	return Unit == EVPDelayUnit::Frames ? Value * FrameRate.AsInterval() : Value * 0.001;
+}
+
+double FVPClockOffsetEstimator::ToLocalTime(double SourceTime, double ArrivalTime)
+{
+	// 500 ppm, well above the drift of any real clock
+	static constexpr double MaxDriftPerSecond = 0.0005;
+
+	const double SampleOffset = ArrivalTime - SourceTime;
+	if (!bHasOffset || SampleOffset < Offset)
+	{
+		Offset = SampleOffset;
+		bHasOffset = true;
+	}
+	else
+	{
+		Offset = FMath::Min(SampleOffset, Offset + MaxDriftPerSecond * FMath::Max(ArrivalTime - LastArrivalTime, 0.0));
+	}
+
+	LastArrivalTime = ArrivalTime;
+	return SourceTime + Offset;
+}
+
+FVPTrackingSample FVPTrackingSample::Interpolate(const FVPTrackingSample& A, const FVPTrackingSample& B, double Alpha)
+{
+	FVPTrackingSample Result;
+	Result.Time = FMath::Lerp(A.Time, B.Time, Alpha);
+	Result.Location = FMath::Lerp(A.Location, B.Location, Alpha);
+	Result.Rotation = FQuat::Slerp(A.Rotation, B.Rotation, Alpha);
+
+	const float FloatAlpha = static_cast<float>(Alpha);
+	Result.FieldOfView = FMath::Lerp(A.FieldOfView, B.FieldOfView, FloatAlpha);
+	Result.FocalLength = FMath::Lerp(A.FocalLength, B.FocalLength, FloatAlpha);
+	Result.Aperture = FMath::Lerp(A.Aperture, B.Aperture, FloatAlpha);
+	Result.FocusDistance = FMath::Lerp(A.FocusDistance, B.FocusDistance, FloatAlpha);
+	return Result;
+}
+
+void FVPTrackingSample::ReadFrom(const FLiveLinkCameraFrameData& FrameData)
+{
+	Location = FrameData.Transform.GetLocation();
+	Rotation = FrameData.Transform.GetRotation();
+	FieldOfView = FrameData.FieldOfView;
+	FocalLength = FrameData.FocalLength;
+	Aperture = FrameData.Aperture;
+	FocusDistance = FrameData.FocusDistance;
+}
+
+void FVPTrackingSample::WriteTo(FLiveLinkCameraFrameData& FrameData) const
+{
+	FrameData.Transform.SetLocation(Location);
+	FrameData.Transform.SetRotation(Rotation);
+	FrameData.FieldOfView = FieldOfView;
+	FrameData.FocalLength = FocalLength;
+	FrameData.Aperture = Aperture;
+	FrameData.FocusDistance = FocusDistance;
+}
@@ -5,15 +5,47 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "CameraMangagerInterface.h"
+#include "Misc/Timecode.h"
 #include "EventTriggerComp.generated.h"
 
+UENUM(BlueprintType)
+enum class EVPTriggerTimeBase : uint8
+{
+	Timecode = 0 UMETA(DisplayName = "Timecode"),
+	// Frames since the world started playing
+	Frame = 1 UMETA(DisplayName = "Frame number"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPTriggerEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	FName Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	EVPTriggerTimeBase TimeBase = EVPTriggerTimeBase::Timecode;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event", meta = (EditCondition = "TimeBase == EVPTriggerTimeBase::Timecode"))
+	FTimecode Timecode;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event", meta = (EditCondition = "TimeBase == EVPTriggerTimeBase::Frame", ClampMin = "0"))
+	int64 Frame = 0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnVPEventTriggered, FName, EventName, FTimecode, Timecode);
 
+/**
+ * Fires named events at given timecodes or frame numbers. The component never ticks, its events
+ * are scheduled on the world's UVPEventTimelineSubsystem from BeginPlay to EndPlay.
+ */
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class BELINDAVPTOOL_API UEventTriggerComp : public UActorComponent , public ICameraMangagerInterface
 {
 	GENERATED_BODY()
 
-public:	
+public:
 	// Sets default values for this component's properties
 	UEventTriggerComp();
 
@@ -21,9 +53,32 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+public:
 	virtual void SetupCamera_Implementation() override;
+
+	UFUNCTION(BlueprintCallable, Category = "Events")
+	void AddTimecodeEvent(FName EventName, FTimecode Timecode);
+
+	UFUNCTION(BlueprintCallable, Category = "Events")
+	void AddFrameEvent(FName EventName, int64 Frame);
+
+	// Unschedules every event of the component
+	UFUNCTION(BlueprintCallable, Category = "Events")
+	void ClearEvents();
+
+	// Called by the timeline when an event is due
+	void Trigger(FName EventName, const FTimecode& Timecode);
+
+public:
+	// Scheduled at BeginPlay
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Events")
+	TArray<FVPTriggerEvent> Events;
+
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnVPEventTriggered OnEventTriggered;
+
+private:
+	void Schedule(const FVPTriggerEvent& Event);
 };
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPChromaKeyer.generated.h"
+
+/**
+ * Colour difference key with spill suppression on the CPU, for stills and frame checks. This is its own
+ * keyer, not a port of Composure's: the two won't match pixel for pixel.
+ * The screen channel is the strongest channel of KeyColor, the difference is taken against a
+ * Balance weighted mix of the two others, normalized by the difference of the key colour itself.
+ */
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPChromaKeySettings
+{
+	GENERATED_BODY()
+
+	// Linear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key")
+	FLinearColor KeyColor = FLinearColor(0.0f, 1.0f, 0.0f);
+
+	// 0 takes the first other channel only (red for green and blue screens), 1 the second one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Balance = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key", meta = (ClampMin = "0.0"))
+	float Gain = 1.0f;
+
+	// Alpha remapped so ClipBlack becomes 0 and ClipWhite 1
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float ClipBlack = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float ClipWhite = 1.0f;
+
+	// 1 brings the screen channel down to the mix of the others
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float SpillSuppression = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Key")
+	bool bPremultiply = false;
+};
+
+class BELINDAVPTOOL_API FVPChromaKeyer
+{
+public:
+	// Scalar reference, what the vector path is checked against
+	static FLinearColor KeyPixel(const FLinearColor& Pixel, const FVPChromaKeySettings& Settings);
+
+	// Vector path, tiles of rows run with ParallelFor. In and Out can be the same buffer
+	static void Key(const FLinearColor* In, FLinearColor* Out, int32 Width, int32 Height, const FVPChromaKeySettings& Settings);
+
+	// 8 bit sRGB frames, decoded to linear before keying
+	static void Key(const FColor* In, FColor* Out, int32 Width, int32 Height, const FVPChromaKeySettings& Settings);
+
+	// Largest channel difference, for golden image checks
+	static float MaxDifference(const FLinearColor* A, const FLinearColor* B, int64 NumPixels);
+};
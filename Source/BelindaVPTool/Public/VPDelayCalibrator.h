@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Estimates how many frames the video path runs behind the tracking from a recorded pan.
+ * Collects one tracking pan angle and one video motion measure per engine frame, then cross-correlates
+ * their frame to frame velocities. The peak is refined with a parabola to get a sub-frame lag.
+ * The video measure can be anything that moves with the pan (marker screen position, image shift...),
+ * its scale and sign don't matter.
+ */
+class BELINDAVPTOOL_API FVPDelayCalibrator
+{
+public:
+	// Preallocates MaxFrames of history, so collecting samples never allocates
+	void Start(int32 MaxFrames, int32 InMaxLagFrames);
+	void Stop();
+	bool IsRunning() const { return bRunning; }
+
+	void AddTrackingSample(uint64 Frame, double PanDegrees);
+	void AddVideoSample(uint64 Frame, double Motion);
+
+	// Lag of the video behind the tracking in frames, negative when the tracking is already late.
+	// Confidence is the normalized correlation at the peak.
+	bool Solve(double& OutLagFrames, double& OutConfidence) const;
+
+	static bool Solve(TArrayView<const double> InTrackingPan, TArrayView<const double> InVideoMotion, int32 InMaxLagFrames, double& OutLagFrames, double& OutConfidence);
+
+	// Below this the pan was too small or too noisy to trust the result
+	static constexpr double MinConfidence = 0.5;
+
+private:
+	int32 GetIndex(uint64 Frame);
+
+	TArray<double> TrackingPan;
+	TArray<double> VideoMotion;
+	uint64 StartFrame = 0;
+	int32 NumFrames = 0;
+	int32 MaxLagFrames = 0;
+	bool bRunning = false;
+};
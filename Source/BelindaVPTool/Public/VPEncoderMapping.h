@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPTrackingTypes.h"
+#include "VPEncoderMapping.generated.h"
+
+// One calibration measurement: the raw encoder count read at a known physical value
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPEncoderSample
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float Raw = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float Value = 0.0f;
+};
+
+/**
+ * Calibration samples of the three lens encoders, in any order and possibly noisy or repeated.
+ * An axis without samples passes the encoder value through unchanged.
+ */
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPEncoderCalibration
+{
+	GENERATED_BODY()
+
+	// Focal length in mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	TArray<FVPEncoderSample> Zoom;
+
+	// Focus distance in cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	TArray<FVPEncoderSample> Focus;
+
+	// f-stop
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	TArray<FVPEncoderSample> Iris;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPEncoderMappingSettings
+{
+	GENERATED_BODY()
+
+	// When enabled the FIZ values reaching the camera are physical, mapped by the fitted curves of Mapping
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	bool bEnabled = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FName Mapping;
+};
+
+/**
+ * Monotonic piecewise cubic fitted to encoder samples.
+ * The samples are made monotonic with isotonic regression, then joined with a shape preserving
+ * Hermite spline so the curve never overshoots between knots. Evaluation is a branch-free binary
+ * search over the knots followed by one cubic.
+ */
+class BELINDAVPTOOL_API FVPEncoderCurve
+{
+public:
+	static constexpr int32 DefaultMaxKnots = 64;
+
+	// bReciprocal fits 1/Value, which suits focus distance where the far end goes to infinity
+	bool Fit(TArrayView<const FVPEncoderSample> Samples, bool bReciprocal = false, int32 MaxKnots = DefaultMaxKnots);
+	void Reset();
+
+	bool IsValid() const { return Knots.Num() > 0; }
+	int32 GetNumKnots() const { return Knots.Num(); }
+
+	// Raw values outside the calibrated range are clamped to it
+	float Evaluate(float Raw) const;
+
+private:
+	TArray<float> Knots;
+	// a + b*t + c*t^2 + d*t^3 with t going from 0 to 1 over the segment
+	TArray<FVector4f> Segments;
+	TArray<float> InvWidths;
+	bool bReciprocal = false;
+};
+
+/** Fitted curves of one lens. Immutable once fitted, shared with the tracking subsystem. */
+struct BELINDAVPTOOL_API FVPEncoderMapping
+{
+	FVPEncoderCurve Zoom;
+	FVPEncoderCurve Focus;
+	FVPEncoderCurve Iris;
+
+	// False when no axis had enough samples
+	bool Fit(const FVPEncoderCalibration& Calibration);
+
+	// Replaces the raw focal length, focus distance and aperture of the sample with physical values
+	void Apply(FVPTrackingSample& InOutSample) const;
+};
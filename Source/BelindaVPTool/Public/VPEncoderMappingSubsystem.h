@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "VPEncoderMapping.h"
+#include "VPEncoderMappingSubsystem.generated.h"
+
+/**
+ * Named raw encoder to physical lens mappings, fitted from calibration samples.
+ * Controllers hand the mapping of their lens to the tracking subsystem, which maps every subject
+ * in the same pass that evaluates the buffers.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPEncoderMappingSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Replaces the mapping of that name, false when no axis could be fitted
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool FitMapping(FName Mapping, const FVPEncoderCalibration& Calibration);
+
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	void RemoveMapping(FName Mapping);
+
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool HasMapping(FName Mapping) const { return Mappings.Contains(Mapping); }
+
+	// One off conversion, e.g. for a calibration UI
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool MapEncoders(FName Mapping, float RawZoom, float RawFocus, float RawIris, float& OutFocalLength, float& OutFocusDistance, float& OutFStop) const;
+
+	TSharedPtr<const FVPEncoderMapping> GetMapping(FName Mapping) const;
+
+	// Bumped whenever a mapping is fitted or removed
+	uint32 GetGeneration() const { return Generation; }
+
+private:
+	TMap<FName, TSharedPtr<const FVPEncoderMapping>> Mappings;
+	uint32 Generation = 1;
+};
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "EventTriggerComp.h"
+#include "VPEventTimelineSubsystem.generated.h"
+
+/**
+ * Events sorted by time with a cursor on the first one not dispatched yet, so a frame only
+ * visits the events it fires. Added events are merged in one sort on the next Advance.
+ * Removing the events of an owner only bumps its generation, the stale entries are skipped and
+ * swept out in one pass once they make up half of the timeline.
+ */
+struct FVPEventTimeline
+{
+	struct FEntry
+	{
+		int64 Key = 0;
+		// Keeps events of the same frame in the order they were added
+		uint64 Sequence = 0;
+		TWeakObjectPtr<UEventTriggerComp> Owner;
+		FName Name;
+		// Timecode events are keyed again when the timecode rate changes
+		FTimecode Timecode;
+		// Generation of the owner when the event was added, older ones were removed
+		uint32 Generation = 0;
+	};
+
+	void Add(FEntry Entry);
+	void Remove(const UEventTriggerComp* Owner);
+	void Rekey(const FFrameRate& Rate);
+
+	// Appends the events in (last key, Key] to OutDue. Going back, or forward by more than MaxCatchUp,
+	// is a seek: only the events at Key fire.
+	void Advance(int64 Key, int64 MaxCatchUp, TArray<FEntry>& OutDue);
+
+	int32 Num() const { return Entries.Num() + Pending.Num() - NumStale; }
+
+private:
+	struct FOwnerState
+	{
+		uint32 Generation = 0;
+		int32 NumEntries = 0;
+	};
+
+	bool IsLive(const FEntry& Entry) const;
+	void Compact();
+	void Sort();
+	int32 LowerBound(int64 Key) const;
+
+	TMap<TObjectKey<UEventTriggerComp>, FOwnerState> Owners;
+	int32 NumStale = 0;
+
+	TArray<FEntry> Entries;
+	TArray<FEntry> Pending;
+	int32 Cursor = 0;
+	int64 LastKey = 0;
+	bool bStarted = false;
+	uint64 NextSequence = 0;
+};
+
+/**
+ * Schedules the UEventTriggerComp events of a playing world, one timeline on timecode and one on
+ * frames since the world started. One tick for the whole world whatever the number of triggers.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPEventTimelineSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void AddEvent(UEventTriggerComp* Owner, const FVPTriggerEvent& Event);
+	void RemoveEvents(const UEventTriggerComp* Owner);
+
+	// Frame events are keyed on this
+	UFUNCTION(BlueprintCallable, Category = "Events")
+	int64 GetFrameNumber() const { return FrameNumber; }
+
+	UFUNCTION(BlueprintCallable, Category = "Events")
+	int32 GetNumEvents() const { return TimecodeTimeline.Num() + FrameTimeline.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FVPEventTimeline TimecodeTimeline;
+	FVPEventTimeline FrameTimeline;
+	FFrameRate TimecodeRate;
+	int64 FrameNumber = 0;
+	TArray<FVPEventTimeline::FEntry> Due;
+};
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPHistogram.h"
+#include "VPFramePacing.generated.h"
+
+namespace EVPFrameFlags
+{
+	enum Type : uint8
+	{
+		None = 0,
+		// The sync count comes from a genlocked custom time step
+		Genlocked = 1 << 0,
+		HasTimecode = 1 << 1,
+		// Frame boundaries were skipped before this frame
+		Missed = 1 << 2,
+		// The frame showed the same sync or timecode as the previous one
+		Duplicated = 1 << 3,
+		TimecodeJump = 1 << 4,
+	};
+}
+
+// One engine frame, recorded when it ends
+struct FVPFrameRecord
+{
+	uint64 FrameNumber = 0;
+	// Platform time at the end of the frame
+	double Time = 0.0;
+	// FApp time of the frame, latched on the sync edge when genlocked
+	double EngineTime = 0.0;
+	float DeltaTime = 0.0f;
+	// End to end time since the previous frame
+	float FrameTime = 0.0f;
+	// Time spent waiting for the time step
+	float WaitTime = 0.0f;
+	int32 TimecodeFrame = 0;
+	uint16 SyncCountDelta = 1;
+	uint16 NumMissed = 0;
+	uint8 Flags = EVPFrameFlags::None;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPFramePacingReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	int64 Frames = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float Seconds = 0.0f;
+
+	// Period of the time step, or of the timecode without one
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float ExpectedFrameTimeMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	int64 MissedFrames = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	int64 DuplicatedFrames = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	int64 TimecodeDiscontinuities = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float FrameTimeMeanMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float FrameTimeP50Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float FrameTimeP95Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float FrameTimeP99Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float FrameTimeMaxMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float WaitMeanMs = 0.0f;
+
+	// Lowest waits are the headroom left before a missed frame
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	float WaitP05Ms = 0.0f;
+
+	// Index N counts the runs of N + 1 missed frames in a row, the last one the longer runs
+	UPROPERTY(BlueprintReadOnly, Category = "Pacing")
+	TArray<int64> MissedRuns;
+};
+
+/**
+ * Frame pacing of the engine against its time step.
+ * Frames are added from the game thread only and kept in a lock free ring of the last frames,
+ * the histograms and counters cover everything since the last Reset. Both can be read from any thread.
+ */
+class BELINDAVPTOOL_API FVPFramePacing
+{
+public:
+	// Power of two, over ten minutes at 50 fps
+	static constexpr uint32 Capacity = 32768;
+	static constexpr int32 NumMissedRunBuckets = 8;
+
+	FVPFramePacing();
+
+	// Game thread. Fills in frame time, missed, duplicated and timecode flags from the previous frame.
+	// ExpectedInterval is the time step period, TimecodeRate the rate of Record.TimecodeFrame.
+	const FVPFrameRecord& AddFrame(const FVPFrameRecord& Record, double ExpectedInterval, const FFrameRate& TimecodeRate);
+
+	// Copies the frames still in the ring, oldest first
+	void GetRecentFrames(TArray<FVPFrameRecord>& OutFrames) const;
+
+	FVPFramePacingReport GetReport() const;
+
+	const FVPHistogram& GetFrameTimeHistogram() const { return FrameTimes; }
+	const FVPHistogram& GetWaitTimeHistogram() const { return WaitTimes; }
+
+	// Game thread
+	void Reset();
+
+	// Frames as CSV, then the report and the histograms as a second CSV
+	bool SaveFramesCsv(const FString& FilePath) const;
+	bool SaveReportCsv(const FString& FilePath) const;
+
+private:
+	TArray<FVPFrameRecord> Ring;
+	std::atomic<uint64> Head{ 0 };
+
+	// Game thread
+	FVPFrameRecord Last;
+	bool bHasLast = false;
+
+	FVPHistogram FrameTimes;
+	FVPHistogram WaitTimes;
+	std::atomic<uint64> MissedRuns[NumMissedRunBuckets];
+	std::atomic<uint64> NumMissed{ 0 };
+	std::atomic<uint64> NumDuplicated{ 0 };
+	std::atomic<uint64> NumTimecodeJumps{ 0 };
+	std::atomic<double> FirstTime{ 0.0 };
+	std::atomic<double> LastTime{ 0.0 };
+	std::atomic<double> Expected{ 0.0 };
+};
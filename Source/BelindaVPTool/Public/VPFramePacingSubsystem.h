@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "VPFramePacing.h"
+#include "VPFramePacingSubsystem.generated.h"
+
+/**
+ * Times every engine frame against the active custom time step: wait, frame time, sync count,
+ * missed and duplicated frames and timecode discontinuities. Frames are also sent to Insights as
+ * counters, with a bookmark on every missed frame.
+ * A take (a tracking recording) gets its own counters, and its pacing report is written next to
+ * the journal when it stops.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPFramePacingSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	UFUNCTION(BlueprintCallable, Category = "Pacing")
+	FVPFramePacingReport GetReport() const { return Session.GetReport(); }
+
+	UFUNCTION(BlueprintCallable, Category = "Pacing")
+	void ResetPacing() { Session.Reset(); }
+
+	// Writes the recent frames and the report, <FilePath> and <FilePath>_Report. Returns the frames file or an empty string.
+	UFUNCTION(BlueprintCallable, Category = "Pacing")
+	FString ExportCsv(const FString& FilePath) const;
+
+	void BeginTake();
+	// Writes the take's <BasePath>.pacing.csv and <BasePath>.pacing_report.csv
+	void EndTake(const FString& BasePath);
+	bool IsInTake() const { return Take.IsValid(); }
+
+	const FVPFramePacing& GetPacing() const { return Session; }
+
+private:
+	void OnEndFrame();
+
+	FVPFramePacing Session;
+	TUniquePtr<FVPFramePacing> Take;
+	FDelegateHandle EndFrameHandle;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+#include "VPHistogram.h"
+
+// One CPU frame of a pool, only ever allocated by FVPFramePool
+class BELINDAVPTOOL_API FVPFrameBuffer
+{
+public:
+	~FVPFrameBuffer();
+
+	uint8* GetData() { return Data; }
+	const uint8* GetData() const { return Data; }
+	int64 GetCapacity() const { return Capacity; }
+	// Bytes of the current frame, Stride * Height
+	int64 GetSize() const { return (int64)Stride * Height; }
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Stride = 0;
+	uint32 FrameNumber = 0;
+	FTimecode Timecode;
+
+private:
+	friend class FVPFramePool;
+
+	explicit FVPFrameBuffer(int64 InCapacity);
+
+	uint8* Data = nullptr;
+	int64 Capacity = 0;
+};
+
+using FVPFrameBufferRef = TSharedRef<FVPFrameBuffer, ESPMode::ThreadSafe>;
+using FVPFrameBufferPtr = TSharedPtr<FVPFrameBuffer, ESPMode::ThreadSafe>;
+
+/**
+ * Fixed set of CPU frame buffers allocated up front, so capturing never allocates.
+ * Acquire is lock free from any thread. Frames are handed out as shared references and go back
+ * to the pool when the last one is released, a frame can be read by several consumers without a copy.
+ * An empty pool drops the frame and counts it.
+ */
+class BELINDAVPTOOL_API FVPFramePool : public TSharedFromThis<FVPFramePool, ESPMode::ThreadSafe>
+{
+public:
+	static TSharedRef<FVPFramePool, ESPMode::ThreadSafe> Create(int32 NumBuffers, int64 BufferSize);
+
+	~FVPFramePool();
+
+	// Null when every buffer is in use
+	FVPFrameBufferPtr Acquire();
+
+	// Acquire and copy the rows of a mapped frame, the copy is timed
+	FVPFrameBufferPtr AcquireAndCopy(const void* Source, int32 Width, int32 Height, int32 SourceStride, int32 BytesPerPixel);
+
+	int32 GetNumBuffers() const { return Buffers.Num(); }
+	int64 GetBufferSize() const { return BufferSize; }
+	int32 GetNumInUse() const { return NumInUse.load(std::memory_order_relaxed); }
+
+	uint64 GetNumAcquired() const { return NumAcquired.load(std::memory_order_relaxed); }
+	uint64 GetNumExhausted() const { return NumExhausted.load(std::memory_order_relaxed); }
+	uint64 GetBytesCopied() const { return BytesCopied.load(std::memory_order_relaxed); }
+	const FVPHistogram& GetCopyTimes() const { return CopyTimes; }
+
+	void ResetStats();
+
+private:
+	FVPFramePool(int32 NumBuffers, int64 InBufferSize);
+
+	void Release(FVPFrameBuffer* Buffer);
+
+	TArray<TUniquePtr<FVPFrameBuffer>> Buffers;
+	TLockFreePointerListUnordered<FVPFrameBuffer, PLATFORM_CACHE_LINE_SIZE> Free;
+	int64 BufferSize = 0;
+
+	std::atomic<int32> NumInUse{ 0 };
+	std::atomic<uint64> NumAcquired{ 0 };
+	std::atomic<uint64> NumExhausted{ 0 };
+	std::atomic<uint64> BytesCopied{ 0 };
+	FVPHistogram CopyTimes;
+};
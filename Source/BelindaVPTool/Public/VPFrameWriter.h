@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/FrameRate.h"
+#include "VPFramePool.h"
+#include "VPHistogram.h"
+#include "VPFrameWriter.generated.h"
+
+class FEvent;
+class FRunnableThread;
+
+UENUM(BlueprintType)
+enum class EVPFrameFileFormat : uint8
+{
+	Png = 0 UMETA(DisplayName = "PNG"),
+	// Half float, linear
+	Exr = 1 UMETA(DisplayName = "EXR"),
+	// BGRA bytes as captured, no encoding
+	Raw = 2 UMETA(DisplayName = "Raw"),
+};
+
+UENUM(BlueprintType)
+enum class EVPFrameDropPolicy : uint8
+{
+	// The capture waits for a free slot, no frame is lost
+	Block = 0 UMETA(DisplayName = "Block"),
+	// A full queue refuses the incoming frame
+	DropNewest = 1 UMETA(DisplayName = "Drop newest"),
+	// A full queue gives up the oldest frame not being encoded yet
+	DropOldest = 2 UMETA(DisplayName = "Drop oldest"),
+};
+
+UENUM(BlueprintType)
+enum class EVPFrameNaming : uint8
+{
+	// Frame number of the timecode, frames sharing one get a _1, _2... suffix
+	Timecode = 0 UMETA(DisplayName = "Timecode"),
+	// Submit order, for captures without a timecode
+	Sequence = 1 UMETA(DisplayName = "Submit order"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPFrameWriterSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer")
+	FString Directory;
+
+	// Files are named BaseName.<frame>.<ext>
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer")
+	FString BaseName = TEXT("Frame");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer")
+	EVPFrameFileFormat Format = EVPFrameFileFormat::Exr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer")
+	EVPFrameNaming Naming = EVPFrameNaming::Timecode;
+
+	// Timecodes count frames at the engine's timecode rate, read when the writer is created
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer", meta = (EditCondition = "Naming == EVPFrameNaming::Timecode"))
+	bool bUseEngineTimecodeRate = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer", meta = (EditCondition = "Naming == EVPFrameNaming::Timecode && !bUseEngineTimecodeRate"))
+	FFrameRate FrameRate = FFrameRate(60, 1);
+
+	// Frames waiting for a worker, each one holds a pool buffer
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 QueueCapacity = 8;
+
+	// 0 uses all cores but two
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer", meta = (ClampMin = "0", ClampMax = "32"))
+	int32 NumWorkers = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Writer")
+	EVPFrameDropPolicy DropPolicy = EVPFrameDropPolicy::DropNewest;
+};
+
+struct FVPFrameWriterStats
+{
+	uint64 NumSubmitted = 0;
+	uint64 NumWritten = 0;
+	uint64 NumFailed = 0;
+	uint64 NumDropped = 0;
+	int32 QueueDepth = 0;
+	int32 MaxQueueDepth = 0;
+	// Frames submitted to a full queue, whatever the policy did with them
+	uint64 NumQueueFull = 0;
+	// Contiguous frames done, in submit order
+	uint64 NumCompleted = 0;
+};
+
+// Called on a worker thread, strictly in submit order, never sorted by timecode. Dropped frames complete with no path
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnVPFrameWritten, uint64 /*Sequence*/, const FTimecode& /*Timecode*/, const FString& /*Path*/, bool /*bSuccess*/);
+
+/**
+ * Writes captured frames as an image sequence from a pool of worker threads, the capture only queues them.
+ * The queue is bounded, what happens when it is full is the drop policy's call. Workers finish out of order,
+ * completions are handed out in submit order, which is capture order even when the timecode goes backwards. 4K60 needs EXR or raw, PNG compression tops out well below.
+ */
+class BELINDAVPTOOL_API FVPFrameWriter
+{
+public:
+	explicit FVPFrameWriter(const FVPFrameWriterSettings& InSettings);
+
+	// Writes what is still queued, then joins the workers
+	~FVPFrameWriter();
+
+	// Any thread. False when the frame is dropped
+	bool Submit(FVPFrameBufferRef Frame);
+
+	// Blocks until every submitted frame completed
+	void Flush();
+
+	bool IsIdle() const;
+
+	FVPFrameWriterStats GetStats() const;
+
+	const FVPFrameWriterSettings& GetSettings() const { return Settings; }
+
+	int32 GetNumWorkers() const { return Workers.Num(); }
+
+	// Time Submit waited on a full queue under the Block policy
+	const FVPHistogram& GetBlockTimes() const { return BlockTimes; }
+	const FVPHistogram& GetEncodeTimes() const { return EncodeTimes; }
+
+	FOnVPFrameWritten OnFrameWritten;
+
+private:
+	class FWorker;
+
+	struct FJob
+	{
+		uint64 Sequence = 0;
+		int64 FileNumber = 0;
+		// Earlier frames with the same file number
+		int32 Repeat = 0;
+		FVPFrameBufferPtr Frame;
+	};
+
+	bool PopJob(FJob& OutJob);
+	void Process(FJob& Job);
+	void Complete(uint64 Sequence, const FTimecode& Timecode, const FString& Path, bool bSuccess);
+	FString MakePath(const FJob& Job) const;
+
+	FVPFrameWriterSettings Settings;
+
+	mutable FCriticalSection QueueLock;
+	TArray<FJob> Queue;
+	uint64 NextSequence = 0;
+	// Frames given each recent file number, a repeated timecode never overwrites a file. Numbers further than
+	// the in flight window from the newest one are forgotten.
+	TMap<int64, int32> FileNumberUses;
+	FEvent* WorkEvent = nullptr;
+	FEvent* SpaceEvent = nullptr;
+	std::atomic<bool> bStopping{ false };
+
+	// Out of order completions wait here for the ones before them
+	mutable FCriticalSection CompletionLock;
+	TMap<uint64, TTuple<FTimecode, FString, bool>> PendingCompletions;
+	uint64 NextCompletion = 0;
+
+	TArray<TUniquePtr<FWorker>> Workers;
+
+	std::atomic<int32> NumInFlight{ 0 };
+	std::atomic<uint64> NumSubmitted{ 0 };
+	std::atomic<uint64> NumWritten{ 0 };
+	std::atomic<uint64> NumFailed{ 0 };
+	std::atomic<uint64> NumDropped{ 0 };
+	std::atomic<uint64> NumQueueFull{ 0 };
+	std::atomic<int32> MaxQueueDepth{ 0 };
+	FVPHistogram BlockTimes;
+	FVPHistogram EncodeTimes;
+};
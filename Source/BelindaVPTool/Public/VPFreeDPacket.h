@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * FreeD D1 camera position/orientation message.
+ * Axes follow the stock LiveLinkFreeD decoding: FreeD X/Y are swapped into Unreal Y/X, Z is height,
+ * pan/tilt/roll map to yaw/pitch/roll. Zoom and focus are raw 24 bit encoder counts.
+ */
+struct BELINDAVPTOOL_API FVPFreeDData
+{
+	uint8 CameraId = 0;
+
+	// Degrees
+	double Pan = 0.0;
+	double Tilt = 0.0;
+	double Roll = 0.0;
+
+	// Centimeters, Unreal axes
+	FVector Position = FVector::ZeroVector;
+
+	int32 Zoom = 0;
+	int32 Focus = 0;
+	uint16 User = 0;
+};
+
+namespace VPFreeD
+{
+	static constexpr int32 PacketSize = 29;
+	static constexpr uint8 MessageD1 = 0xD1;
+	static constexpr int32 MaxEncoderValue = 0xFFFFFF;
+
+	BELINDAVPTOOL_API void Encode(const FVPFreeDData& Data, uint8 (&OutPacket)[PacketSize]);
+
+	// Checks the message type and checksum
+	BELINDAVPTOOL_API bool Decode(const uint8* Packet, int32 Size, FVPFreeDData& OutData);
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Lock free log scale histogram of durations, safe to add to from any thread.
+ * Buckets are a quarter of an octave wide, from 1 microsecond to about a second.
+ */
+class BELINDAVPTOOL_API FVPHistogram
+{
+public:
+	static constexpr int32 NumBuckets = 84;
+
+	FVPHistogram() { Reset(); }
+
+	void Add(double Seconds);
+
+	void Reset();
+
+	uint64 Num() const { return Count.load(std::memory_order_relaxed); }
+
+	double GetMax() const { return MaxMicroseconds.load(std::memory_order_relaxed) * 1.0e-6; }
+
+	double GetMean() const;
+
+	// Upper bound of the bucket holding the requested percentile, Percentile in [0, 1]
+	double GetPercentile(double Percentile) const;
+
+	// Bucket bounds in seconds, for exporters
+	static double GetBucketUpperBound(int32 Bucket);
+
+	uint64 GetBucketCount(int32 Bucket) const { return Buckets[Bucket].load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64> Buckets[NumBuckets];
+	std::atomic<uint64> Count;
+	std::atomic<uint64> SumMicroseconds;
+	std::atomic<uint64> MaxMicroseconds;
+};
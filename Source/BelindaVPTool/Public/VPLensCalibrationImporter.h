@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPLensGrid.h"
+#include "VPLensCalibrationImporter.generated.h"
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLensImportOptions
+{
+	GENERATED_BODY()
+
+	// Zoom and focus values are divided by this, e.g. 16777215 for raw FreeD counts
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens", meta = (ClampMin = "0.000001"))
+	float EncoderMax = 1.0f;
+
+	// Samples are averaged into this many zoom x focus bins, which bounds the memory whatever the file size
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens", meta = (ClampMin = "2", ClampMax = "256"))
+	int32 Bins = 64;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens", meta = (ClampMin = "64"))
+	int32 ChunkSizeKB = 4096;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLensImportResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	bool bSuccess = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	int64 NumSamples = 0;
+
+	// Samples that failed validation: missing or non finite zoom/focus, out of range, negative focal length...
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	int64 NumRejected = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	int32 NumPoints = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	float Seconds = 0.0f;
+
+	// Binary lens file written next to the lens table
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	FString OutputPath;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lens")
+	FString Error;
+};
+
+/**
+ * Reads vendor lens calibrations, CSV with a header row or JSON with one flat object per sample
+ * (a plain array, NDJSON or an array nested in a wrapper object all work).
+ * The file is read in chunks cut on record boundaries and every chunk is parsed and validated on the
+ * thread pool, with a bounded number of chunks in flight. Samples are reduced into zoom/focus bins
+ * as they are parsed, so nothing proportional to the file size is kept.
+ *
+ * Recognized fields, case and separators ignored: Zoom, Focus, FocalLength, FocusDistance,
+ * K1, K2, K3, P1, P2, NodalX, NodalY, NodalZ. Only Zoom and Focus are required.
+ */
+class BELINDAVPTOOL_API FVPLensCalibrationImporter
+{
+public:
+	static bool Import(const FString& SourcePath, const FVPLensImportOptions& Options, TArray<FVPLensCalibrationPoint>& OutPoints, FVPLensImportResult& OutResult);
+};
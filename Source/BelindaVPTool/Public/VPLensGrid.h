@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPLensSettings.h"
+#include "VPLensGrid.generated.h"
+
+/**
+ * One measured calibration point of a lens, at normalized zoom and focus encoder values.
+ * Values left at zero fall back to what the lens settings give (focal length range, no distortion...).
+ */
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLensCalibrationPoint
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Zoom = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Focus = 0.0f;
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float FocalLength = 0.0f;
+
+	// cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float FocusDistance = 0.0f;
+
+	// Brown-Conrady radial and tangential coefficients, on normalized image coordinates
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float K1 = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float K2 = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float K3 = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float P1 = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float P2 = 0.0f;
+
+	// Entrance pupil position relative to the tracked point, camera space (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FVector3f NodalShift = FVector3f::ZeroVector;
+};
+
+/**
+ * Lens values at one zoom/focus position. The layout is three SIMD registers wide, the grid stores
+ * cells like this back to back.
+ */
+struct FVPLensGridSample
+{
+	float FocalLength = 0.0f;
+	float HorizontalFOV = 0.0f;
+	float VerticalFOV = 0.0f;
+	float FocusDistance = 0.0f;
+
+	float K1 = 0.0f;
+	float K2 = 0.0f;
+	float K3 = 0.0f;
+	float P1 = 0.0f;
+
+	float P2 = 0.0f;
+	FVector3f NodalShift = FVector3f::ZeroVector;
+};
+static_assert(sizeof(FVPLensGridSample) == 12 * sizeof(float), "FVPLensGridSample must stay three vector registers wide");
+
+/**
+ * A lens compiled into a dense zoom x focus grid, evaluated with a fixed number of vector operations
+ * whatever the number of rows or calibration points it was built from.
+ * Immutable once compiled, so it can be shared between cameras and threads.
+ */
+class BELINDAVPTOOL_API FVPCompiledLens
+{
+public:
+	static constexpr int32 DefaultResolution = 33;
+
+	// Scattered points are spread over the grid with inverse distance weighting of the nearest ones, exact on the points themselves
+	void Compile(const FVPLensSettings& Lens, TArrayView<const FVPLensCalibrationPoint> Points, int32 ZoomSteps = DefaultResolution, int32 FocusSteps = DefaultResolution);
+
+	bool IsValid() const { return Cells.Num() > 0; }
+
+	const FVPLensSettings& GetLens() const { return Lens; }
+
+	// Zoom and focus are the normalized encoder values
+	void EvaluateBilinear(float Zoom, float Focus, FVPLensGridSample& OutSample) const;
+	void EvaluateBicubic(float Zoom, float Focus, FVPLensGridSample& OutSample) const;
+
+	// Evaluates many cameras in one go, ZoomFocus and OutSamples must have the same size
+	void EvaluateBatch(TArrayView<const FVector2f> ZoomFocus, TArrayView<FVPLensGridSample> OutSamples, bool bBicubic = false) const;
+
+	int32 GetZoomSteps() const { return ZoomSteps; }
+	int32 GetFocusSteps() const { return FocusSteps; }
+
+	// Compact binary lens file holding the grid and the points it was compiled from
+	bool Save(const FString& FilePath, TArrayView<const FVPLensCalibrationPoint> Points) const;
+	bool Load(const FString& FilePath, TArray<FVPLensCalibrationPoint>& OutPoints);
+
+private:
+	const FVPLensGridSample& Cell(int32 ZoomIndex, int32 FocusIndex) const { return Cells[FocusIndex * ZoomSteps + ZoomIndex]; }
+
+	FVPLensSettings Lens;
+	TArray<FVPLensGridSample> Cells;
+	int32 ZoomSteps = 0;
+	int32 FocusSteps = 0;
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPLensSettings.generated.h"
+
+class UDataTable;
+
+/**
+ * Lens and sensor of a camera body, as listed in DT_LensesSettings.
+ * Maps the normalized FIZ values sent by the encoders to focal length, f-stop and focus distance.
+ */
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLensSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	bool bEnabled = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FString SensorName;
+
+	// Table row the settings came from, tells apart lenses sharing a sensor in the caches
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FName LensName;
+
+	// Optical centre in normalized image coordinates, 0,0 top left
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FVector2f PrincipalPoint = FVector2f(0.5f, 0.5f);
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float SensorWidth = 36.0f;
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float SensorHeight = 24.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MinFocalLength = 18.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MaxFocalLength = 35.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MinFStop = 1.8f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MaxFStop = 16.0f;
+
+	// cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MinFocusDistance = 30.0f;
+
+	// cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	float MaxFocusDistance = 100000.0f;
+
+	float MapFocalLength(float Zoom) const { return FMath::Lerp(MinFocalLength, MaxFocalLength, FMath::Clamp(Zoom, 0.0f, 1.0f)); }
+	float MapFStop(float Iris) const { return FMath::Lerp(MinFStop, MaxFStop, FMath::Clamp(Iris, 0.0f, 1.0f)); }
+	float MapFocusDistance(float Focus) const { return FMath::Lerp(MinFocusDistance, MaxFocusDistance, FMath::Clamp(Focus, 0.0f, 1.0f)); }
+
+	// Reads a row of a table using the S_LensesSettings layout, OutSettings is reset first so fields not found get their defaults
+	static bool FromDataTableRow(const UDataTable* Table, FName RowName, FVPLensSettings& OutSettings);
+};
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "VPLensGrid.h"
+#include "VPLensCalibrationImporter.h"
+#include "VPLensSubsystem.generated.h"
+
+class UDataTable;
+
+/**
+ * Compiled lens grids of the DT_LensesSettings rows, built the first time a row is asked for.
+ * A grid is rebuilt when its row or calibration points change, controllers compare GetGeneration
+ * to know when to fetch it again.
+ * Imported calibrations are saved as <Row>.bvplens next to the table and picked up from there.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPLensSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Null when the row doesn't exist
+	TSharedPtr<const FVPCompiledLens> GetCompiledLens(const UDataTable* Table, FName RowName);
+
+	// Measured points of a row, e.g. from a lens calibration import. An empty array goes back to the row ranges.
+	void SetCalibrationPoints(const UDataTable* Table, FName RowName, TArray<FVPLensCalibrationPoint> Points);
+	const TArray<FVPLensCalibrationPoint>* GetCalibrationPoints(const UDataTable* Table, FName RowName) const;
+
+	void SetResolution(int32 ZoomSteps, int32 FocusSteps);
+
+	// Streams a vendor CSV/JSON calibration into the row's calibration points, compiles it and saves the lens file
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool ImportCalibration(const UDataTable* Table, FName RowName, const FString& SourcePath, const FVPLensImportOptions& Options, FVPLensImportResult& OutResult);
+
+	static FString GetLensFilePath(const UDataTable* Table, FName RowName);
+
+	uint32 GetGeneration() const { return Generation; }
+
+private:
+	using FLensKey = TTuple<FObjectKey, FName>;
+
+	void Invalidate(const UDataTable* Table);
+	void WatchTable(const UDataTable* Table);
+	TSharedPtr<const FVPCompiledLens> LoadLensFile(const UDataTable* Table, FName RowName, const FVPLensSettings& Lens);
+
+	TMap<FLensKey, TSharedPtr<const FVPCompiledLens>> CompiledLenses;
+	TMap<FLensKey, TArray<FVPLensCalibrationPoint>> CalibrationPoints;
+	TSet<TWeakObjectPtr<const UDataTable>> WatchedTables;
+	// Rows whose lens file was already looked for
+	TSet<FLensKey> LensFilesChecked;
+
+	int32 ZoomSteps = FVPCompiledLens::DefaultResolution;
+	int32 FocusSteps = FVPCompiledLens::DefaultResolution;
+	uint32 Generation = 1;
+};
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LiveLinkCameraController.h"
+#include "VPTrackingTypes.h"
+#include "VPDelayCalibrator.h"
+#include "VPLensSettings.h"
+#include "VPLensGrid.h"
+#include "VPEncoderMapping.h"
+#include "VPNodalSolver.h"
+#include "VPLiveLinkCameraController.generated.h"
+
+class UVPTrackingSubsystem;
+class UDataTable;
+struct FLiveLinkCameraStaticData;
+struct FLiveLinkCameraFrameData;
+
+/**
+ * Camera controller installed by UVPToolsLib::SetLiveLink.
+ * Drives the camera from the plugin tracking buffers instead of the latest LiveLink frame.
+ * With bFusedUpdate the pose, nodal offset, FIZ mapping and filmback are applied straight to the
+ * camera in one pass instead of going through the stock controller and the Blueprint lens setup.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPLiveLinkCameraController : public ULiveLinkCameraController
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	FVPJitterBufferSettings JitterBuffer;
+
+	// Holds the tracking back so it matches the video path latency
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	FVPDelayLineSettings DelayLine;
+
+	// Removes encoder shimmer from the buffered samples, optionally predicting a few ms ahead
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	FVPMotionFilterSettings MotionFilter;
+
+	// Separate lens encoder subject for rigs that don't send FIZ with the pose
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	FVPLensStreamSettings LensStream;
+
+	// Applies everything natively in one pass. Off falls back to the stock controller, which also handles lens files.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	bool bFusedUpdate = true;
+
+	// Offset from the tracked point to the lens entrance pupil, in camera space (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FVector NodalOffset = FVector::ZeroVector;
+
+	// Mount misalignment between the tracked point and the lens axis
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FRotator NodalRotation = FRotator::ZeroRotator;
+
+	// When enabled the FIZ values are normalized encoder values mapped to this lens, the filmback follows its sensor
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FVPLensSettings Lens;
+
+	// Fitted raw encoder curves, the lens ranges above then only locate the zoom/focus position in the lens grid
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Lens")
+	FVPEncoderMappingSettings EncoderMapping;
+
+	// Also picks up the compiled grid of the row, which then gives focal length, focus distance and nodal shift
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool SetLensFromTable(const UDataTable* InLensTable, FName RowName);
+
+	// Lens values of the last fused tick, valid once a table row was set
+	bool GetLensSample(FVPLensGridSample& OutSample) const;
+
+	// Pan the camera back and forth while AddDelayCalibrationVideoSample is fed once per frame
+	UFUNCTION(BlueprintCallable, Category = "Tracking")
+	void StartDelayCalibration(float MaxSeconds = 20.0f, float MaxLagFrames = 8.0f);
+
+	// Anything that follows the pan in the video, e.g. the screen position of a marker
+	UFUNCTION(BlueprintCallable, Category = "Tracking")
+	void AddDelayCalibrationVideoSample(float VideoMotion);
+
+	// Returns false when the pan gave no clear peak. The residual lag is added to the delay line when bApply is set.
+	UFUNCTION(BlueprintCallable, Category = "Tracking")
+	bool FinishDelayCalibration(bool bApply, float& OutLagFrames, float& OutConfidence);
+
+	// Records where a surveyed target point shows up in the image at the current tracked pose and lens
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	void AddNodalObservation(FVector TargetPoint, FVector2D ImagePoint);
+
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	void ClearNodalObservations() { NodalObservations.Reset(); }
+
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	int32 GetNumNodalObservations() const { return NodalObservations.Num(); }
+
+	// Solves the nodal offset and rotation from the observations, written to the rig when bApply is set
+	UFUNCTION(BlueprintCallable, Category = "Lens")
+	bool SolveNodalOffset(const FVPNodalSolverSettings& Settings, bool bApply, FVPNodalSolution& OutSolution);
+
+	virtual void Tick(float DeltaTime, const FLiveLinkSubjectFrameData& SubjectData) override;
+	virtual void Cleanup() override;
+	virtual void BeginDestroy() override;
+
+private:
+	bool GetBufferedSample(FVPTrackingSample& OutSample);
+	void TickStock(float DeltaTime, const FLiveLinkSubjectFrameData& SubjectData, const FVPTrackingSample* Sample);
+	void ApplyFused(const FVPTrackingSample& Sample, const FLiveLinkCameraStaticData& StaticData, const FLiveLinkCameraFrameData& FrameData);
+	const FVPCompiledLens* GetCompiledLens();
+
+	void UpdateRegistration();
+	void PushSettings(UVPTrackingSubsystem* Tracking);
+	void UpdateEncoderMapping();
+	void ReleaseSubject();
+
+	// Copy of the subject data the buffered sample is written into, reused every tick
+	FLiveLinkSubjectFrameData BufferedData;
+
+	FLiveLinkSubjectName RegisteredSubject;
+	FLiveLinkSubjectName RegisteredLensSubject;
+	// The lens subject had a sample for this frame
+	bool bHasLensStreamSample = false;
+
+	uint32 StaticDataGeneration = 0;
+
+	TWeakObjectPtr<const UDataTable> LensTable;
+	FName LensRow;
+	TSharedPtr<const FVPCompiledLens> CompiledLens;
+	uint32 CompiledLensGeneration = 0;
+	FVPLensGridSample LensSample;
+	bool bHasLensSample = false;
+
+	TSharedPtr<const FVPEncoderMapping> ActiveEncoderMapping;
+	FName ActiveEncoderMappingName;
+	uint32 EncoderMappingGeneration = 0;
+
+	FVPDelayCalibrator DelayCalibrator;
+
+	// Pose and lens the camera was last driven with, before the nodal offset
+	FTransform LastTrackedPose;
+	float LastFocalLength = 0.0f;
+	TArray<FVPNodalObservation> NodalObservations;
+};
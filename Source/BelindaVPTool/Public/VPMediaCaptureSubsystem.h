@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "MediaCapture.h"
+#include "VPMediaCaptureSubsystem.generated.h"
+
+class FSceneViewport;
+class UMediaOutput;
+class UTextureRenderTarget2D;
+
+UENUM(BlueprintType)
+enum class EVPCaptureSource : uint8
+{
+	// PIE or game viewport, the level editor viewport when not playing
+	Viewport = 0 UMETA(DisplayName = "Viewport"),
+	RenderTarget = 1 UMETA(DisplayName = "Render target"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPCaptureOutputSettings
+{
+	GENERATED_BODY()
+
+	// e.g. Program, CleanFeed, Matte
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capture")
+	FName Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capture")
+	TObjectPtr<UMediaOutput> MediaOutput;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capture")
+	EVPCaptureSource Source = EVPCaptureSource::Viewport;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capture", meta = (EditCondition = "Source == EVPCaptureSource::RenderTarget"))
+	TObjectPtr<UTextureRenderTarget2D> RenderTarget;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Capture")
+	FMediaCaptureOptions Options;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPCaptureStatus
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Capture")
+	FName Name;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Capture")
+	FString MediaOutput;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Capture")
+	EVPCaptureSource Source = EVPCaptureSource::Viewport;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Capture")
+	EMediaCaptureState State = EMediaCaptureState::Stopped;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Capture")
+	FIntPoint Size = FIntPoint::ZeroValue;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnVPCaptureStateChanged, FName, Name, EMediaCaptureState, State);
+
+// Returns the viewport to capture when nothing is playing, set by the editor module
+DECLARE_DELEGATE_RetVal(TSharedPtr<FSceneViewport>, FVPCaptureViewportResolver);
+
+/**
+ * Named media captures running side by side, each from a viewport or a render target.
+ * Applying settings to a running capture only swaps its source when the output and options are
+ * unchanged, otherwise that capture alone is restarted. Stops never wait for the pending frames.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPMediaCaptureSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Starts the capture, or reconfigures the one of the same name
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	bool StartCapture(const FVPCaptureOutputSettings& Settings);
+
+	// Captures not in Outputs are stopped, the others started or reconfigured
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	int32 ApplyCaptures(const TArray<FVPCaptureOutputSettings>& Outputs);
+
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	void StopCapture(FName Name);
+
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	void StopAllCaptures();
+
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	TArray<FVPCaptureStatus> GetCaptureStatus() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Capture")
+	UMediaCapture* GetCapture(FName Name) const;
+
+	UPROPERTY(BlueprintAssignable, Category = "Capture")
+	FOnVPCaptureStateChanged OnCaptureStateChanged;
+
+	void SetViewportResolver(FVPCaptureViewportResolver Resolver) { ViewportResolver = MoveTemp(Resolver); }
+
+private:
+	bool Capture(UMediaCapture* MediaCapture, const FVPCaptureOutputSettings& Settings);
+	bool UpdateSource(UMediaCapture* MediaCapture, const FVPCaptureOutputSettings& Settings);
+	TSharedPtr<FSceneViewport> ResolveViewport() const;
+	void Release(UMediaCapture* MediaCapture);
+	void PruneStopped();
+
+	UPROPERTY()
+	TMap<FName, TObjectPtr<UMediaCapture>> Captures;
+
+	UPROPERTY()
+	TMap<FName, FVPCaptureOutputSettings> CaptureSettings;
+
+	// Kept alive until their last frames went out
+	UPROPERTY()
+	TArray<TObjectPtr<UMediaCapture>> Stopping;
+
+	FVPCaptureViewportResolver ViewportResolver;
+};
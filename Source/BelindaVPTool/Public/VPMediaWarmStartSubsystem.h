@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "VPHistogram.h"
+#include "VPMediaWarmStartSubsystem.generated.h"
+
+class UMediaBundle;
+class UMediaTexture;
+
+UENUM(BlueprintType)
+enum class EVPWarmState : uint8
+{
+	// Not playing yet, or not anymore
+	Opening = 0 UMETA(DisplayName = "Opening"),
+	// Playing and settled, a switch to it shows a frame right away
+	Ready = 1 UMETA(DisplayName = "Ready"),
+	Error = 2 UMETA(DisplayName = "Error"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPWarmSource
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "WarmStart")
+	TObjectPtr<UMediaBundle> Bundle;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WarmStart")
+	EVPWarmState State = EVPWarmState::Opening;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WarmStart")
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	// Engine frames since the player started playing
+	int32 FramesPlaying = 0;
+	int64 EstimatedBytes = 0;
+	double LastActiveTime = 0.0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnVPMediaSwitched, UMediaBundle*, Previous, UMediaBundle*, Active, UMediaTexture*, Texture);
+
+/**
+ * Keeps media bundles open and playing in the background so switching inputs never waits on a
+ * player to open and settle. Each primed bundle holds an open reference on its media source, the least
+ * recently active ones are closed when the estimated memory goes over MemoryBudgetMB.
+ * A switch to a ready bundle completes on the same frame, one that is still opening completes the
+ * frame it settles, the previous input staying up meanwhile. It is abandoned after SwitchTimeoutFrames.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPMediaWarmStartSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Priming a bundle that failed closes and opens it again
+	UFUNCTION(BlueprintCallable, Category = "WarmStart")
+	bool Prime(UMediaBundle* Bundle);
+
+	// Closes the bundle unless it is the active or pending one
+	UFUNCTION(BlueprintCallable, Category = "WarmStart")
+	void Release(UMediaBundle* Bundle);
+
+	// True when the switch happened right away
+	UFUNCTION(BlueprintCallable, Category = "WarmStart")
+	bool SwitchTo(UMediaBundle* Bundle);
+
+	UFUNCTION(BlueprintPure, Category = "WarmStart")
+	UMediaBundle* GetActive() const { return Active; }
+
+	UFUNCTION(BlueprintCallable, Category = "WarmStart")
+	TArray<FVPWarmSource> GetSources() const { return Sources; }
+
+	// Bind the comp element or material to the new texture here
+	UPROPERTY(BlueprintAssignable, Category = "WarmStart")
+	FOnVPMediaSwitched OnMediaSwitched;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WarmStart", meta = (ClampMin = "64"))
+	int32 MemoryBudgetMB = 1024;
+
+	// Frames a player must have been playing before it counts as settled
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WarmStart", meta = (ClampMin = "0", ClampMax = "30"))
+	int32 SettleFrames = 3;
+
+	// Engine frames a switch waits for its bundle to settle before it is abandoned
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "WarmStart", meta = (ClampMin = "1"))
+	int32 SwitchTimeoutFrames = 60;
+
+	// Time between a switch request and its completion
+	const FVPHistogram& GetSwitchLatencies() const { return SwitchLatencies; }
+
+	// Engine frames the last switch took, 0 when it was warm
+	int32 GetLastSwitchFrames() const { return LastSwitchFrames; }
+
+private:
+	void OnBeginFrame();
+	void CompleteSwitch();
+	void Trim();
+	void Close(int32 Index);
+	FVPWarmSource* Find(UMediaBundle* Bundle);
+
+	UPROPERTY()
+	TArray<FVPWarmSource> Sources;
+
+	UPROPERTY()
+	TObjectPtr<UMediaBundle> Active;
+
+	UPROPERTY()
+	TObjectPtr<UMediaBundle> Pending;
+
+	uint64 PendingFrame = 0;
+	double PendingTime = 0.0;
+	int32 LastSwitchFrames = 0;
+	FVPHistogram SwitchLatencies;
+	FDelegateHandle BeginFrameHandle;
+};
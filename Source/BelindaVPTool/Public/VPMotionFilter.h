@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPTrackingTypes.h"
+
+/**
+ * Per subject smoothing and prediction state, run on the evaluated samples once per frame.
+ * Every axis (location, pan/tilt/roll, focal length, focus distance) is filtered on its own with
+ * the parameters set for it. Angles are unwrapped so a pan through 180 degrees doesn't jump.
+ */
+class BELINDAVPTOOL_API FVPMotionFilter
+{
+public:
+	enum EAxis : int32
+	{
+		AxisX,
+		AxisY,
+		AxisZ,
+		AxisPan,
+		AxisTilt,
+		AxisRoll,
+		AxisFocalLength,
+		AxisFocusDistance,
+		NumAxes
+	};
+
+	void Reset();
+
+	// Filters InOutSample in place. Time is the filter clock, the frame's evaluation time rather than the
+	// sample's own, so a sample held through a dropout keeps the filter running instead of resetting it.
+	void Apply(const FVPMotionFilterSettings& Settings, double Time, FVPTrackingSample& InOutSample);
+
+private:
+	struct FAxisState
+	{
+		// Unwrapped input of the previous frame
+		double Raw = 0.0;
+		double Value = 0.0;
+		double Velocity = 0.0;
+		double Acceleration = 0.0;
+	};
+
+	static const FVPAxisFilterParams& GetParams(const FVPMotionFilterSettings& Settings, int32 Axis);
+
+	static void OneEuro(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State);
+	static void CriticallyDamped(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State);
+	static void Predictive(const FVPAxisFilterParams& Params, double Input, double DeltaTime, FAxisState& State);
+
+	FAxisState Axes[NumAxes];
+	double LastTime = 0.0;
+	EVPMotionFilterMode LastMode = EVPMotionFilterMode::None;
+	bool bInitialized = false;
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPNodalSolver.generated.h"
+
+/**
+ * One target point seen by the camera: where it is, where it shows up in the image, and the tracked
+ * pose and lens at that moment. The target point is in the same space as the tracking.
+ */
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPNodalObservation
+{
+	GENERATED_BODY()
+
+	// Tracked pose without any nodal offset
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	FTransform TrackedPose;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	FVector TargetPoint = FVector::ZeroVector;
+
+	// Normalized image position, 0,0 top left and 1,1 bottom right
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	FVector2D ImagePoint = FVector2D(0.5, 0.5);
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	float FocalLength = 35.0f;
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	float SensorWidth = 36.0f;
+
+	// mm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	float SensorHeight = 24.0f;
+
+	// Lens grid nodal shift at that zoom and focus, added to the solved offset like at runtime
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	FVector NodalShift = FVector::ZeroVector;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPNodalSolverSettings
+{
+	GENERATED_BODY()
+
+	// Random minimal sets tried, spread over the task graph
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal", meta = (ClampMin = "1"))
+	int32 Hypotheses = 512;
+
+	// Reprojection error under which an observation agrees with a hypothesis
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal", meta = (ClampMin = "0.1"))
+	float InlierThresholdPixels = 3.0f;
+
+	// Only used to express the errors in pixels
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal", meta = (ClampMin = "1"))
+	int32 ImageWidth = 1920;
+
+	// The solve fails when fewer observations than this fraction agree
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinInlierRatio = 0.5f;
+
+	// Starting point of every fit, usually the current offset
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Nodal")
+	FTransform InitialOffset;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPNodalSolution
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Nodal")
+	bool bSolved = false;
+
+	// From the tracked point to the camera, in the tracked point's space, the observations' NodalShift not included
+	UPROPERTY(BlueprintReadOnly, Category = "Nodal")
+	FTransform Offset;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Nodal")
+	float RmsErrorPixels = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Nodal")
+	int32 NumInliers = 0;
+};
+
+/**
+ * Solves the full rigid offset between the tracked point and the lens entrance pupil from 2D/3D
+ * correspondences. Random minimal sets are fitted in parallel (RANSAC) to reject bad clicks and
+ * tracking glitches, then the best consensus set is refined with a Huber weighted Levenberg-Marquardt.
+ */
+class BELINDAVPTOOL_API FVPNodalSolver
+{
+public:
+	static constexpr int32 MinimalSetSize = 4;
+
+	static bool Solve(TArrayView<const FVPNodalObservation> Observations, const FVPNodalSolverSettings& Settings, FVPNodalSolution& OutSolution);
+};
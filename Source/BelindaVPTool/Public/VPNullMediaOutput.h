@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MediaOutput.h"
+#include "MediaCapture.h"
+#include "Engine/EngineTypes.h"
+#include "VPFramePool.h"
+#include "VPFrameWriter.h"
+#include "VPNullMediaOutput.generated.h"
+
+UENUM(BlueprintType)
+enum class EVPNullOutputMode : uint8
+{
+	// Frames are released as soon as they are copied
+	Discard = 0 UMETA(DisplayName = "Discard"),
+	// Raw BGRA frames are written to OutputDirectory off the render thread
+	RawFiles = 1 UMETA(DisplayName = "Raw files"),
+	// PNG or EXR sequence in OutputDirectory, encoded by the frame writer's workers
+	ImageSequence = 2 UMETA(DisplayName = "Image sequence"),
+};
+
+/**
+ * Media output with no device behind it. Frames go through the capture readback and the frame pool
+ * like a card output, so capture throughput can be measured on machines without one.
+ */
+UCLASS(BlueprintType)
+class BELINDAVPTOOL_API UVPNullMediaOutput : public UMediaOutput
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output")
+	FIntPoint Size = FIntPoint(1920, 1080);
+
+	// Frames queued or being encoded by the writer hold a buffer each, raised to what the writer can hold at once
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 NumBuffers = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output")
+	EVPNullOutputMode Mode = EVPNullOutputMode::Discard;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output", meta = (EditCondition = "Mode != EVPNullOutputMode::Discard"))
+	FDirectoryPath OutputDirectory;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output", meta = (ClampMin = "1", EditCondition = "Mode != EVPNullOutputMode::Discard"))
+	int32 WriteEveryNthFrame = 1;
+
+	// Directory and format are taken from the output and its mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Output", meta = (EditCondition = "Mode != EVPNullOutputMode::Discard"))
+	FVPFrameWriterSettings Writer;
+
+	//~ UMediaOutput interface
+	virtual bool Validate(FString& FailureReason) const override;
+	virtual FIntPoint GetRequestedSize() const override { return Size; }
+	virtual EPixelFormat GetRequestedPixelFormat() const override { return EPixelFormat::PF_B8G8R8A8; }
+	virtual EMediaCaptureConversionOperation GetConversionOperation(EMediaCaptureSourceType InSourceType) const override { return EMediaCaptureConversionOperation::NONE; }
+
+protected:
+	virtual UMediaCapture* CreateMediaCaptureImpl() override;
+};
+
+struct FVPNullFrameSink;
+
+UCLASS()
+class BELINDAVPTOOL_API UVPNullMediaCapture : public UMediaCapture
+{
+	GENERATED_BODY()
+
+public:
+	//~ UMediaCapture interface
+	virtual bool HasFinishedProcessing() const override;
+	virtual void OnFrameCaptured_RenderingThread(const FCaptureBaseData& InBaseData, TSharedPtr<FMediaCaptureUserData, ESPMode::ThreadSafe> InUserData, void* InBuffer, int32 Width, int32 Height, int32 BytesPerRow) override;
+
+	// Valid once capturing, kept after the stop for its counters
+	TSharedPtr<FVPFramePool, ESPMode::ThreadSafe> GetFramePool() const { return FramePool; }
+
+	uint64 GetNumFramesConsumed() const;
+	uint64 GetNumFramesWritten() const;
+
+	// Null in Discard mode
+	const FVPFrameWriter* GetFrameWriter() const;
+
+protected:
+	virtual bool InitializeCapture() override;
+	virtual void StopCaptureImpl(bool bAllowPendingFrameToBeProcess) override;
+
+private:
+	TSharedPtr<FVPFramePool, ESPMode::ThreadSafe> FramePool;
+	TSharedPtr<FVPNullFrameSink, ESPMode::ThreadSafe> Sink;
+};
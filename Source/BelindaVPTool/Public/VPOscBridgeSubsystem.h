@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Containers/MpscQueue.h"
+#include "VPHistogram.h"
+#include "VPOscPacket.h"
+#include "VPOscBridgeSubsystem.generated.h"
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPOscBinding
+{
+	GENERATED_BODY()
+
+	// Full OSC address, e.g. /rig/nodal
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	FString Address;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	TObjectPtr<UObject> Target;
+
+	// Property of the target, dots walk into structs: "NodalOffset", "NodalRotation.Yaw", "RelativeLocation.Z".
+	// A struct takes the message arguments in the order of its numeric members.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	FString PropertyPath;
+
+	// Index of the first message argument used
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC", meta = (ClampMin = "0"))
+	int32 FirstArgument = 0;
+
+	// Applied to every argument, faders usually send 0..1
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	float Scale = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	float Offset = 0.0f;
+};
+
+/**
+ * Maps OSC control surfaces onto rig properties (target rotation, nodal offset...).
+ * Every listened port has its own receive thread that decodes the packets and keeps only the latest
+ * values of each address, handing them over through a lock free queue every FlushIntervalMs at most.
+ * The game thread merges what arrived at the start of every frame and applies it in one batch,
+ * so a fader sending at 1 kHz costs one property write per frame.
+ * Addresses without a binding are published on the stage cue bus under VPStageCueTopics::Osc.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPOscBridgeSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	UFUNCTION(BlueprintCallable, Category = "OSC")
+	bool StartListening(int32 Port);
+
+	UFUNCTION(BlueprintCallable, Category = "OSC")
+	void StopListening(int32 Port);
+
+	UFUNCTION(BlueprintCallable, Category = "OSC")
+	void StopAll();
+
+	UFUNCTION(BlueprintPure, Category = "OSC")
+	TArray<int32> GetPorts() const;
+
+	// False when the property path doesn't resolve to numbers on the target
+	UFUNCTION(BlueprintCallable, Category = "OSC")
+	bool Bind(const FVPOscBinding& Binding);
+
+	// Removes the bindings of Target, of every address when Address is empty
+	UFUNCTION(BlueprintCallable, Category = "OSC")
+	void Unbind(UObject* Target, const FString& Address);
+
+	// Longest a receive thread keeps coalescing before handing its values over
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC", meta = (ClampMin = "0.1", ClampMax = "20"))
+	float FlushIntervalMs = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "OSC")
+	bool bPublishUnboundToCues = true;
+
+	uint64 GetNumPackets() const { return NumPackets.load(std::memory_order_relaxed); }
+	uint64 GetNumMessages() const { return NumMessages.load(std::memory_order_relaxed); }
+	uint64 GetNumDecodeErrors() const { return NumDecodeErrors.load(std::memory_order_relaxed); }
+	uint64 GetNumBatches() const { return NumBatches; }
+	// Address updates left after coalescing, bound or published
+	uint64 GetNumApplied() const { return NumApplied; }
+
+	// Receive time of the newest value of a frame to its application
+	const FVPHistogram& GetLatencies() const { return Latencies; }
+	void ResetLatencies() { Latencies.Reset(); }
+
+private:
+	class FReceiver;
+
+	struct FUpdate
+	{
+		FString Address;
+		VPOsc::FValues Values;
+	};
+
+	struct FBatch
+	{
+		TArray<FUpdate> Updates;
+		double ReceiveTime = 0.0;
+	};
+
+	struct FResolvedBinding
+	{
+		TWeakObjectPtr<UObject> Target;
+		// Resolved again when the target or its class is reinstanced
+		FString PropertyPath;
+		// Outermost first, all but the last are struct properties
+		TArray<FProperty*, TInlineAllocator<2>> Chain;
+		int32 FirstArgument = 0;
+		float Scale = 1.0f;
+		float Offset = 0.0f;
+	};
+
+	void OnBeginFrame();
+	void OnObjectsReplaced(const TMap<UObject*, UObject*>& ReplacementMap);
+	// Fills the property chain from the target and the path, false when it isn't numeric anymore
+	static bool Resolve(FResolvedBinding& Binding, const FString& Address);
+	void Apply(const FResolvedBinding& Binding, TConstArrayView<float> Values, TSet<UObject*>& OutTouched);
+
+	TArray<TSharedPtr<FReceiver>> Receivers;
+	TMpscQueue<FBatch> Queue;
+
+	TMultiMap<FString, FResolvedBinding> Bindings;
+
+	// Merged batches of the current frame
+	TMap<FString, VPOsc::FValues> FrameUpdates;
+
+	std::atomic<uint64> NumPackets{ 0 };
+	std::atomic<uint64> NumMessages{ 0 };
+	std::atomic<uint64> NumDecodeErrors{ 0 };
+	uint64 NumBatches = 0;
+	uint64 NumApplied = 0;
+	FVPHistogram Latencies;
+
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle ObjectsReplacedHandle;
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StringView.h"
+#include "Templates/Function.h"
+
+/**
+ * Minimal OSC 1.0 decoding for control surfaces. Numeric arguments (f, i, d, h, T, F) come out as floats
+ * in argument order, strings, blobs and the other types are skipped. Bundles are walked recursively,
+ * their time tags ignored: everything is applied as soon as it arrives.
+ */
+namespace VPOsc
+{
+	static constexpr int32 MaxArguments = 16;
+
+	using FValues = TArray<float, TInlineAllocator<4>>;
+
+	// Address is not null terminated. Called for every message of the packet, nested bundles included.
+	using FMessageCallback = TFunctionRef<void(FAnsiStringView Address, TConstArrayView<float> Values)>;
+
+	// False on malformed data, the messages decoded before the error were still delivered
+	BELINDAVPTOOL_API bool Decode(const uint8* Packet, int32 Size, FMessageCallback OnMessage);
+
+	// Single message with float arguments
+	BELINDAVPTOOL_API void Encode(FAnsiStringView Address, TConstArrayView<float> Values, TArray<uint8>& OutPacket);
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineTypes.h"
+#include "Misc/FrameRate.h"
+#include "VPPlateReader.h"
+#include "VPPlatePlayerComponent.generated.h"
+
+class UTexture2D;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnVPPlateTextureCreated, UTexture2D*, Texture);
+
+/**
+ * Plays an image sequence plate into a texture, for the plate elements that used to read it through a
+ * media bundle. Frames come from a read-ahead FVPPlateReader, the last frame stays up when the next
+ * one isn't decoded yet. Follows the engine timecode, or its own playhead when that is turned off.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class BELINDAVPTOOL_API UVPPlatePlayerComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVPPlatePlayerComponent();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate")
+	FDirectoryPath Directory;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate")
+	FFrameRate FrameRate = FFrameRate(25, 1);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate")
+	bool bLoop = true;
+
+	// Off, the plate plays from its first frame at BeginPlay
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate")
+	bool bFollowTimecode = true;
+
+	// Off, the file numbers are taken as timecode frames, as the frame writer names them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate", meta = (EditCondition = "bFollowTimecode"))
+	bool bUseStartTimecode = false;
+
+	// Engine timecode the first frame of the plate is shown at
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate", meta = (EditCondition = "bFollowTimecode && bUseStartTimecode"))
+	FTimecode StartTimecode;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate|Cache", meta = (ClampMin = "1", ClampMax = "240"))
+	int32 ReadAheadFrames = 24;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate|Cache", meta = (ClampMin = "64"))
+	int32 CacheBudgetMB = 4096;
+
+	// 0 uses half of the cores
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate|Cache", meta = (ClampMin = "0", ClampMax = "16"))
+	int32 NumDecodeWorkers = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Plate|Cache")
+	bool bUseMemoryMapping = true;
+
+	UFUNCTION(BlueprintCallable, Category = "Plate")
+	bool OpenPlate();
+
+	UFUNCTION(BlueprintCallable, Category = "Plate")
+	void ClosePlate();
+
+	// Own playhead only
+	UFUNCTION(BlueprintCallable, Category = "Plate")
+	void SetPlaying(bool bInPlaying) { bPlaying = bInPlaying; }
+
+	// Sequence frame number, moves the own playhead only
+	UFUNCTION(BlueprintCallable, Category = "Plate")
+	void Seek(int64 FrameNumber);
+
+	UFUNCTION(BlueprintPure, Category = "Plate")
+	UTexture2D* GetTexture() const { return Texture; }
+
+	UFUNCTION(BlueprintPure, Category = "Plate")
+	int64 GetDisplayedFrame() const { return DisplayedFrame; }
+
+	// Created on the first decoded frame and again when the plate size changes
+	UPROPERTY(BlueprintAssignable, Category = "Plate")
+	FOnVPPlateTextureCreated OnTextureCreated;
+
+	const FVPPlateReader& GetReader() const { return Reader; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	void Upload(const FVPPlateFramePtr& Frame);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture2D> Texture;
+
+	FVPPlateReader Reader;
+	bool bPlaying = true;
+	double Playhead = 0.0;
+	int64 DisplayedFrame = INDEX_NONE;
+};
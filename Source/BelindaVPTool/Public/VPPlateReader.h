@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ImageCore.h"
+#include "Misc/FrameRate.h"
+#include "Misc/Timecode.h"
+#include "VPHistogram.h"
+
+class FEvent;
+
+struct FVPPlateReaderSettings
+{
+	// Plates are numbered by timecode frame at this rate, as the frame writer names them
+	FFrameRate FrameRate = FFrameRate(25, 1);
+	// Timecode the first file of the sequence is shown at, for plates numbered from 0 or 1. Unset, the
+	// file numbers are the timecode frames.
+	TOptional<FTimecode> StartTimecode;
+	int32 ReadAheadFrames = 24;
+	int32 CacheBudgetMB = 4096;
+	// 0 uses half of the cores
+	int32 NumWorkers = 0;
+	bool bLoop = true;
+	// Network shares that can't be mapped fall back to plain reads
+	bool bUseMemoryMapping = true;
+};
+
+// One decoded plate frame, linear half float RGBA
+struct FVPPlateFrame
+{
+	int64 FrameNumber = 0;
+	FImage Image;
+
+	int64 GetSizeBytes() const { return Image.RawData.Num(); }
+};
+
+using FVPPlateFramePtr = TSharedPtr<const FVPPlateFrame, ESPMode::ThreadSafe>;
+
+/**
+ * Image sequence reader for media plates. Asking for a frame queues the next ReadAheadFrames in the play
+ * direction, wrapping around when looping, and worker threads decode them into a cache held under
+ * CacheBudgetMB. The least recently used frames outside the read-ahead window go first.
+ */
+class BELINDAVPTOOL_API FVPPlateReader
+{
+public:
+	FVPPlateReader() = default;
+	~FVPPlateReader();
+
+	// Finds the numbered EXR, PNG or JPEG files of the directory, the most common extension wins
+	bool Open(const FString& Directory, const FVPPlateReaderSettings& InSettings);
+	void Close();
+
+	bool IsOpen() const { return Frames.Num() > 0; }
+
+	int64 GetFirstFrame() const { return FirstFrame; }
+	int64 GetLastFrame() const { return LastFrame; }
+	int32 GetNumFrames() const { return Frames.Num(); }
+	const FVPPlateReaderSettings& GetSettings() const { return Settings; }
+
+	// Frame of the sequence shown at Timecode, INDEX_NONE past the ends when not looping
+	int64 GetFrameAtTimecode(const FTimecode& Timecode) const;
+
+	// Into the sequence range when looping, unchanged otherwise
+	int64 Wrap(int64 FrameNumber) const;
+
+	// Game thread. Never waits, null when the frame is still being read
+	FVPPlateFramePtr GetFrame(int64 FrameNumber);
+
+	// Waits up to Timeout seconds for the frame, for offline renders
+	FVPPlateFramePtr GetFrameBlocking(int64 FrameNumber, double Timeout);
+
+	uint64 GetNumHits() const { return NumHits.load(std::memory_order_relaxed); }
+	uint64 GetNumMisses() const { return NumMisses.load(std::memory_order_relaxed); }
+	int64 GetCachedBytes() const;
+	const FVPHistogram& GetDecodeTimes() const { return DecodeTimes; }
+
+private:
+	class FWorker;
+
+	struct FCacheEntry
+	{
+		FVPPlateFramePtr Frame;
+		uint64 LastUse = 0;
+	};
+
+	void QueueReadAhead(int64 FrameNumber);
+	bool PopRequest(int64& OutFrameNumber);
+	void Decode(int64 FrameNumber);
+	void Trim();
+	bool InWindow(int64 FrameNumber) const;
+
+	FVPPlateReaderSettings Settings;
+	TMap<int64, FString> Frames;
+	int64 FirstFrame = 0;
+	int64 LastFrame = -1;
+
+	mutable FCriticalSection Lock;
+	TMap<int64, FCacheEntry> Cache;
+	TSet<int64> InFlight;
+	// Nearest to the playhead first
+	TArray<int64> Requests;
+	int64 CachedBytes = 0;
+	uint64 UseCounter = 0;
+	int64 WindowStart = 0;
+	int32 Direction = 1;
+	int64 LastRequested = INDEX_NONE;
+
+	FEvent* WorkEvent = nullptr;
+	std::atomic<bool> bStopping{ false };
+	TArray<TUniquePtr<FWorker>> Workers;
+
+	std::atomic<uint64> NumHits{ 0 };
+	std::atomic<uint64> NumMisses{ 0 };
+	FVPHistogram DecodeTimes;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPLensSettings.h"
+#include "VPLensGrid.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+enum class EVPSTMapDirection : uint32
+{
+	// For each pixel of the undistorted image, where to read the filmed plate
+	Undistort = 0,
+	// For each pixel of the distorted image, where to read the CG render
+	Distort = 1,
+};
+
+/**
+ * UV displacement map of one lens sample, two floats per pixel with the usual ST convention:
+ * S goes left to right, T bottom to top, both normalized over the image.
+ * Either generated in memory or a read only view over a cache file.
+ */
+class BELINDAVPTOOL_API FVPSTMap
+{
+public:
+	~FVPSTMap();
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	EVPSTMapDirection GetDirection() const { return Direction; }
+
+	// Row major, top row first
+	const FVector2f* GetData() const { return Data; }
+	FVector2f GetST(int32 X, int32 Y) const { return Data[Y * Width + X]; }
+
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+
+	// CRC of the pixels, for regression checks
+	uint32 ComputeChecksum() const;
+
+	// Evaluates the Brown-Conrady model over every pixel with ParallelFor, four pixels per vector op
+	static TSharedPtr<FVPSTMap> Generate(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 Width, int32 Height, EVPSTMapDirection Direction);
+
+	// Opens a cache file written by Save, null when it doesn't match the expected key
+	static TSharedPtr<FVPSTMap> Load(const FString& FilePath, uint64 ExpectedKey);
+
+	bool Save(const FString& FilePath, uint64 Key) const;
+
+private:
+	int32 Width = 0;
+	int32 Height = 0;
+	EVPSTMapDirection Direction = EVPSTMapDirection::Undistort;
+	const FVector2f* Data = nullptr;
+
+	TArray<FVector2f> Pixels;
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+};
+
+/**
+ * ST maps cached on disk under Saved/BelindaVP/STMaps, named after a hash of the lens name, sensor and
+ * principal point, the sample and the resolution. Maps asked for again while still in use are shared,
+ * otherwise the cache file is memory mapped instead of being generated again. Thread safe, one thread
+ * generates and saves a given map while the others asking for it wait.
+ */
+class BELINDAVPTOOL_API FVPSTMapCache
+{
+public:
+	static TSharedPtr<const FVPSTMap> FindOrGenerate(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 Width, int32 Height, EVPSTMapDirection Direction = EVPSTMapDirection::Undistort);
+
+	static uint64 ComputeKey(const FVPLensSettings& Lens, const FVPLensGridSample& Sample, int32 Width, int32 Height, EVPSTMapDirection Direction);
+
+	static FString GetCacheDirectory();
+	static FString GetCachePath(uint64 Key);
+
+	// Deletes every cache file, maps in use stay valid until released
+	static void ClearDiskCache();
+};
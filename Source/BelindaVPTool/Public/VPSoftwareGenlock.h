@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenlockedCustomTimeStep.h"
+#include "GenlockedTimecodeProvider.h"
+#include "Math/RandomStream.h"
+#include "VPSoftwareGenlock.generated.h"
+
+UENUM(BlueprintType)
+enum class EVPSoftwareGenlockMode : uint8
+{
+	// Waits for the next frame boundary of the platform clock
+	Realtime = 0 UMETA(DisplayName = "Real time"),
+	// Never waits, every frame advances the engine time by exactly one period
+	FixedStep = 1 UMETA(DisplayName = "Fixed step"),
+	// Real time with every sync pulse moved by a random offset, and some pulses missed
+	Jitter = 2 UMETA(DisplayName = "Jitter injection"),
+};
+
+/**
+ * Genlock without a video card: sync pulses are the frame boundaries of FPlatformTime, so the
+ * genlocked pipeline (timecode, tracking buffers, frame pacing) runs on any machine.
+ * Fixed step is deterministic: the engine time only depends on the frame count, whatever the
+ * machine does. Jitter injection is seeded, the same seed gives the same pulse offsets and misses.
+ */
+UCLASS(Blueprintable, EditInlineNew, meta = (DisplayName = "Belinda VP Software Genlock"))
+class BELINDAVPTOOL_API UVPSoftwareGenlockTimeStep : public UGenlockedCustomTimeStep
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UFixedFrameRateCustomTimeStep Interface
+	virtual bool Initialize(UEngine* InEngine) override;
+	virtual void Shutdown(UEngine* InEngine) override;
+	virtual bool UpdateTimeStep(UEngine* InEngine) override;
+	virtual ECustomTimeStepSynchronizationState GetSynchronizationState() const override;
+	virtual FFrameRate GetFixedFrameRate() const override { return FrameRate; }
+	//~ End UFixedFrameRateCustomTimeStep Interface
+
+	//~ Begin UGenlockedCustomTimeStep Interface
+	virtual FFrameRate GetSyncRate() const override { return FrameRate; }
+	virtual uint32 GetLastSyncCountDelta() const override { return LastSyncCountDelta; }
+	virtual bool IsLastSyncDataValid() const override { return bLastSyncDataValid; }
+	virtual bool WaitForSync() override;
+	//~ End UGenlockedCustomTimeStep Interface
+
+	// Sync pulses since Initialize, missed ones included
+	uint64 GetSyncCount() const { return SyncCount; }
+	uint64 GetNumMissedSyncs() const { return NumMissedSyncs; }
+
+	// Platform time of the last sync, virtual in fixed step
+	double GetLastSyncTime() const { return LastSyncTime; }
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock")
+	FFrameRate FrameRate = FFrameRate(25, 1);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock")
+	EVPSoftwareGenlockMode Mode = EVPSoftwareGenlockMode::Realtime;
+
+	// The last part of the wait is spun instead of slept, sleeps overshoot by up to a scheduler quantum
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock", meta = (ClampMin = "0", ClampMax = "10", Units = "Milliseconds"))
+	float SpinMilliseconds = 2.0f;
+
+	// Pulses are moved by up to this much either way
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock|Jitter", meta = (ClampMin = "0", Units = "Milliseconds", EditCondition = "Mode == EVPSoftwareGenlockMode::Jitter"))
+	float JitterMilliseconds = 2.0f;
+
+	// Chance of a pulse being missed, the frame then waits for the next one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock|Jitter", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "Mode == EVPSoftwareGenlockMode::Jitter"))
+	float MissProbability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Genlock|Jitter", meta = (EditCondition = "Mode == EVPSoftwareGenlockMode::Jitter"))
+	int32 Seed = 0;
+
+private:
+	void WaitUntil(double Seconds) const;
+
+	ECustomTimeStepSynchronizationState State = ECustomTimeStepSynchronizationState::Closed;
+	FRandomStream Random;
+	double StartSeconds = 0.0;
+	double LastSyncTime = 0.0;
+	uint64 SyncCount = 0;
+	uint64 NumMissedSyncs = 0;
+	uint32 LastSyncCountDelta = 1;
+	bool bLastSyncDataValid = false;
+};
+
+/**
+ * Timecode of the software genlock. Counts its sync pulses when it's the engine time step, so
+ * timecode and frames never drift apart, otherwise reads the platform clock.
+ */
+UCLASS(Blueprintable, EditInlineNew, meta = (DisplayName = "Belinda VP Software Timecode"))
+class BELINDAVPTOOL_API UVPSoftwareTimecodeProvider : public UGenlockedTimecodeProvider
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin UTimecodeProvider Interface
+	virtual bool FetchTimecode(FQualifiedFrameTime& OutFrameTime) override;
+	virtual ETimecodeProviderSynchronizationState GetSynchronizationState() const override { return State; }
+	virtual bool Initialize(UEngine* InEngine) override;
+	virtual void Shutdown(UEngine* InEngine) override;
+	//~ End UTimecodeProvider Interface
+
+public:
+	// Used when the engine time step isn't the software genlock
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Timecode")
+	FFrameRate FrameRate = FFrameRate(25, 1);
+
+	// Starts at the local time of day instead of 00:00:00:00
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Timecode")
+	bool bStartAtTimeOfDay = true;
+
+private:
+	FFrameRate GetRate() const;
+
+	ETimecodeProviderSynchronizationState State = ETimecodeProviderSynchronizationState::Closed;
+	double StartSeconds = 0.0;
+	// Time of day at Initialize, in seconds
+	double StartOffset = 0.0;
+};
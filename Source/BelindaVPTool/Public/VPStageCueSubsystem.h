@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Containers/MpscQueue.h"
+#include "Misc/Timecode.h"
+#include "VPStageCueSubsystem.generated.h"
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPStageCue
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cue")
+	FName Topic;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cue")
+	FName Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cue")
+	float Value = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cue")
+	FVector Vector = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cue")
+	FString Text;
+
+	// Timecode of the frame the cue was dispatched on
+	UPROPERTY(BlueprintReadOnly, Category = "Cue")
+	FTimecode Timecode;
+
+	// Platform time it was posted at
+	UPROPERTY(BlueprintReadOnly, Category = "Cue")
+	double PostTime = 0.0;
+};
+
+// Topics sent by the plugin
+namespace VPStageCueTopics
+{
+	// Name is the camera manager that was set up
+	extern BELINDAVPTOOL_API const FName SetupCamera;
+	// Name is the event of a UEventTriggerComp
+	extern BELINDAVPTOOL_API const FName Trigger;
+	// Text is an OSC address without a binding, Value its first argument and Vector the first three.
+	// Name stays empty: senders can make up any number of addresses, FNames are never freed.
+	extern BELINDAVPTOOL_API const FName Osc;
+}
+
+// All the cues of one topic dispatched in a frame, in the order they were posted
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnVPStageCues, TConstArrayView<FVPStageCue>);
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FVPStageCueHandler, const FVPStageCue&, Cue);
+
+/**
+ * Stage cues by topic. Listeners subscribe to the topics they care about, so a cue only reaches
+ * those whatever the number of objects in the level.
+ * Post can be called from any thread (tracking, OSC, remote control...): cues go through a lock free
+ * queue that the game thread drains at the start of every frame, grouped by topic so every native
+ * listener is called once per frame with the whole batch. Publish dispatches right away on the game thread.
+ * Listeners of NAME_None get every topic.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPStageCueSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Any thread
+	void Post(FVPStageCue Cue);
+
+	// Game thread
+	UFUNCTION(BlueprintCallable, Category = "Stage Cues")
+	void Publish(const FVPStageCue& Cue);
+
+	FDelegateHandle Subscribe(FName Topic, FOnVPStageCues::FDelegate Delegate);
+	void Unsubscribe(FName Topic, FDelegateHandle Handle);
+
+	// Blueprint handlers are called once per cue
+	UFUNCTION(BlueprintCallable, Category = "Stage Cues")
+	void SubscribeToTopic(FName Topic, FVPStageCueHandler Handler);
+
+	UFUNCTION(BlueprintCallable, Category = "Stage Cues")
+	void UnsubscribeFromTopic(FName Topic, FVPStageCueHandler Handler);
+
+	// Removes every native and Blueprint subscription bound to Listener
+	UFUNCTION(BlueprintCallable, Category = "Stage Cues")
+	void UnsubscribeAll(const UObject* Listener);
+
+	// Game thread, called at the start of every frame
+	void Drain();
+
+	uint64 GetNumPosted() const { return NumPosted.load(std::memory_order_relaxed); }
+	uint64 GetNumDispatched() const { return NumDispatched; }
+
+private:
+	struct FTopic
+	{
+		FOnVPStageCues Native;
+		TArray<FVPStageCueHandler> Handlers;
+	};
+
+	// Cues sorted by topic
+	void Dispatch(TArrayView<FVPStageCue> Cues);
+	void DispatchTopic(FName Topic, TConstArrayView<FVPStageCue> Cues);
+
+	// Shared so a listener subscribing during a dispatch doesn't move the topic being dispatched
+	TMap<FName, TSharedPtr<FTopic>> Topics;
+
+	TMpscQueue<FVPStageCue> Queue;
+	TArray<FVPStageCue> Batch;
+	std::atomic<uint64> NumPosted{ 0 };
+	uint64 NumDispatched = 0;
+
+	FDelegateHandle BeginFrameHandle;
+};
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "VPTrackingReplay.h"
+#include "VPLiveLinkCameraController.h"
 #include "VPToolsLib.generated.h"
 
 
@@ -29,6 +31,26 @@ public :
 
 	UFUNCTION(BlueprintCallable, Category = "VPTools")
 	static void SetLiveLink(ULiveLinkComponentController* freedFiz, UCameraComponent* camComp);
+
+	// Controller installed by SetLiveLink, used to set the delay line and run its calibration
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static UVPLiveLinkCameraController* GetTrackingController(ULiveLinkComponentController* freedFiz);
+
+	// Returns the journal path, empty when the recording couldn't start
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static FString StartTrackingRecording(FString takeName);
+
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static void StopTrackingRecording();
+
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static bool StartTrackingReplay(FString journalPath, FVPReplaySettings settings);
+
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static void StepTrackingReplay(int32 numFrames = 1);
+
+	UFUNCTION(BlueprintCallable, Category = "VPTools")
+	static void StopTrackingReplay();
 	
 	//UFUNCTION(BlueprintCallable, Category = "VPTools")
 	//static void RestartEditor();
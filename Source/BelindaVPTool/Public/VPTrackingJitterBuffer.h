@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPTrackingTypes.h"
+
+/**
+ * Fixed capacity, time ordered ring of tracking samples.
+ * Push can be called from the LiveLink receive thread, Evaluate from the game thread.
+ * All storage is allocated up front so neither call allocates.
+ */
+class BELINDAVPTOOL_API FVPTrackingJitterBuffer
+{
+public:
+	explicit FVPTrackingJitterBuffer(int32 InCapacity = 256);
+
+	// Inserts a sample in time order. Late samples are slotted in place, the oldest sample is dropped when full.
+	void Push(const FVPTrackingSample& Sample);
+
+	// Interpolates the buffered samples at Time. Holds the first/last sample outside the buffered range.
+	bool Evaluate(double Time, FVPTrackingSample& OutSample) const;
+
+	void Reset();
+
+	// Times of the oldest and newest buffered samples, false when empty
+	bool GetTimeRange(double& OutOldest, double& OutNewest) const;
+
+	// For monitoring tools, allocates
+	void GetSampleTimes(TArray<double>& OutTimes) const;
+
+	int32 Num() const;
+
+	int32 GetCapacity() const { return Samples.Num(); }
+
+	// Allocates, keeps the newest samples that fit
+	void SetCapacity(int32 NewCapacity);
+
+private:
+	const FVPTrackingSample& At(int32 Index) const { return Samples[(Head + Index) % Samples.Num()]; }
+	FVPTrackingSample& At(int32 Index) { return Samples[(Head + Index) % Samples.Num()]; }
+
+	mutable FCriticalSection Lock;
+
+	TArray<FVPTrackingSample> Samples;
+
+	// Index of the oldest sample
+	int32 Head = 0;
+
+	int32 Count = 0;
+};
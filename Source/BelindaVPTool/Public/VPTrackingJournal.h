@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VPTrackingTypes.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * On disk layout of the tracking journals.
+ * A header followed by fixed size records, each carrying its own CRC. A session that dies mid write
+ * leaves at most one torn record at the end, the reader stops at the first record that doesn't check out.
+ * The sidecar .idx file maps sample times to record indices and can be rebuilt from the journal.
+ */
+namespace VPTrackingJournal
+{
+	static constexpr uint32 FileMagic = 0x4A505642;   // BVPJ
+	static constexpr uint32 RecordMagic = 0x52505642; // BVPR
+	static constexpr uint32 Version = 1;
+	static constexpr int32 RecordSize = 128;
+	static constexpr int32 PayloadSize = 108;
+	static constexpr int32 MaxSubjectNameLength = PayloadSize - 1;
+
+	enum class ERecordType : uint16
+	{
+		Subject = 1,
+		Sample = 2,
+	};
+
+	struct FFileHeader
+	{
+		uint32 Magic = FileMagic;
+		uint32 Version = VPTrackingJournal::Version;
+		uint32 RecordSize = VPTrackingJournal::RecordSize;
+		uint32 Reserved = 0;
+		// FPlatformTime::Seconds when the recording started, arrival times are stored relative to it
+		double StartTime = 0.0;
+		int64 StartUtcTicks = 0;
+	};
+
+	struct FRecord
+	{
+		uint32 Magic = RecordMagic;
+		uint16 Type = 0;
+		uint16 SubjectIndex = 0;
+		uint64 Sequence = 0;
+		uint8 Payload[PayloadSize] = {};
+		uint32 Crc = 0;
+
+		uint32 ComputeCrc() const;
+		bool IsValid() const { return Magic == RecordMagic && Crc == ComputeCrc(); }
+	};
+
+	struct FSamplePayload
+	{
+		double ArrivalTime;
+		double SampleTime;
+		int32 TimecodeFrame;
+		float TimecodeSubFrame;
+		int32 RateNumerator;
+		int32 RateDenominator;
+		double Location[3];
+		double Rotation[4];
+		float FieldOfView;
+		float FocalLength;
+		float Aperture;
+		float FocusDistance;
+	};
+
+	struct FIndexEntry
+	{
+		double SampleTime;
+		uint64 RecordIndex;
+	};
+
+	static_assert(sizeof(FFileHeader) == 32, "Journal header layout changed");
+	static_assert(sizeof(FRecord) == RecordSize, "Journal record layout changed");
+	static_assert(sizeof(FSamplePayload) <= PayloadSize, "Sample payload doesn't fit a record");
+}
+
+/** One sample as handed from the receive thread to the journal writer. */
+struct BELINDAVPTOOL_API FVPTrackingRecordEntry
+{
+	FVPTrackingSample Sample;
+	double ArrivalTime = 0.0;
+	FQualifiedFrameTime SceneTime;
+	bool bHasTimecode = false;
+};
+
+/** Memory mapped, read only view over a tracking journal. */
+class BELINDAVPTOOL_API FVPTrackingJournalReader
+{
+public:
+	~FVPTrackingJournalReader();
+
+	bool Open(const FString& FilePath);
+	void Close();
+
+	bool IsOpen() const { return Records != nullptr; }
+
+	const TArray<FString>& GetSubjects() const { return Subjects; }
+
+	// Number of leading records that passed validation
+	int64 NumRecords() const { return NumValidRecords; }
+
+	// Returns false for subject declarations, they are consumed while opening
+	bool GetSample(int64 RecordIndex, int32& OutSubjectIndex, FVPTrackingRecordEntry& OutEntry) const;
+
+	// First record whose sample time is at or after Time
+	int64 FindRecordAtTime(double Time) const;
+
+	const VPTrackingJournal::FFileHeader& GetHeader() const { return Header; }
+
+private:
+	void LoadIndex(const FString& IndexPath);
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	VPTrackingJournal::FFileHeader Header;
+	const VPTrackingJournal::FRecord* Records = nullptr;
+	int64 NumValidRecords = 0;
+
+	TArray<FString> Subjects;
+	TArray<VPTrackingJournal::FIndexEntry> Index;
+};
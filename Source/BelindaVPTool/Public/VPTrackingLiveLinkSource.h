@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ILiveLinkSource.h"
+
+class ILiveLinkClient;
+
+/** Minimal LiveLink source the plugin's replayed and synthesized camera subjects are pushed under. */
+class BELINDAVPTOOL_API FVPTrackingLiveLinkSource : public ILiveLinkSource
+{
+public:
+	FVPTrackingLiveLinkSource(const FText& InSourceType, const FString& InMachineName);
+
+	//~ Begin ILiveLinkSource Interface
+	virtual void ReceiveClient(ILiveLinkClient* InClient, FGuid InSourceGuid) override;
+	virtual bool IsSourceStillValid() const override;
+	virtual bool RequestSourceShutdown() override;
+	virtual FText GetSourceType() const override { return SourceType; }
+	virtual FText GetSourceMachineName() const override { return FText::FromString(MachineName); }
+	virtual FText GetSourceStatus() const override;
+	//~ End ILiveLinkSource Interface
+
+	// Registers the source with the LiveLink client, false when LiveLink isn't loaded
+	static bool AddToClient(const TSharedPtr<FVPTrackingLiveLinkSource>& Source);
+	static void RemoveFromClient(const TSharedPtr<FVPTrackingLiveLinkSource>& Source);
+
+	// Declares a camera subject supporting FOV, focal length, aperture and focus distance
+	void PushCameraStaticData(FName SubjectName);
+
+	void PushCameraFrame(FName SubjectName, FLiveLinkFrameDataStruct&& FrameData);
+
+	FGuid GetSourceGuid() const { return SourceGuid; }
+
+private:
+	std::atomic<ILiveLinkClient*> Client{ nullptr };
+	FGuid SourceGuid;
+	FText SourceType;
+	FString MachineName;
+};
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "VPTrackingReplay.h"
+#include "VPTrackingLoadGenerator.generated.h"
+
+class FRunnableThread;
+class FSocket;
+class FInternetAddr;
+class FVPTrackingLiveLinkSource;
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLoadGeneratorSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator", meta = (ClampMin = "1", ClampMax = "255"))
+	int32 NumCameras = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator", meta = (ClampMin = "60.0", ClampMax = "2000.0"))
+	float RateHz = 240.0f;
+
+	// Fraction of the packets that are never sent
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float PacketLoss = 0.0f;
+
+	// Each packet is held back by a random delay up to this, which also reorders them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator", meta = (ClampMin = "0.0"))
+	float JitterMs = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator")
+	EVPReplayOutput Output = EVPReplayOutput::LiveLink;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator")
+	FString SubjectPrefix = TEXT("VPSynth");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator|FreeD")
+	FString FreeDAddress = TEXT("127.0.0.1");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator|FreeD")
+	int32 FreeDPort = 40000;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LoadGenerator")
+	int32 Seed = 0;
+};
+
+// Motion of one synthetic camera, its random phases drawn once from the seed
+struct BELINDAVPTOOL_API FVPSynthCameraMotion
+{
+	FVPSynthCameraMotion() = default;
+	FVPSynthCameraMotion(int32 InCameraIndex, int32 Seed);
+
+	FVPTrackingSample Evaluate(double Time) const;
+
+	int32 CameraIndex = 0;
+	double Phases[8] = {};
+};
+
+/**
+ * Synthesizes smooth jib/dolly like camera motion for N cameras and sends it at a fixed rate,
+ * with optional loss and jitter. The send time is stamped in the LiveLink world time so receivers
+ * can measure latency.
+ */
+class BELINDAVPTOOL_API FVPTrackingLoadGenerator : public FRunnable
+{
+public:
+	FVPTrackingLoadGenerator() = default;
+	virtual ~FVPTrackingLoadGenerator();
+
+	bool Start(const FVPLoadGeneratorSettings& InSettings);
+	void Finish();
+
+	FName GetSubjectName(int32 CameraIndex) const;
+
+	uint64 GetNumSent() const { return NumSent.load(); }
+	uint64 GetNumLost() const { return NumLost.load(); }
+
+	// Plausible motion of one camera at Time, also used to check the received values.
+	// Draws the phases on every call, keep an FVPSynthCameraMotion for many samples.
+	static FVPTrackingSample SynthesizeSample(int32 CameraIndex, int32 Seed, double Time);
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	struct FPendingPacket
+	{
+		double SendTime = 0.0;
+		int32 CameraIndex = 0;
+		uint16 Sequence = 0;
+		FVPTrackingSample Sample;
+	};
+
+	void Send(const FPendingPacket& Packet);
+
+	FVPLoadGeneratorSettings Settings;
+	TArray<FName> SubjectNames;
+	TArray<FVPSynthCameraMotion> Motions;
+
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopRequested{ false };
+
+	TSharedPtr<FVPTrackingLiveLinkSource> LiveLinkSource;
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> FreeDTarget;
+
+	// Generator thread only, preallocated so a run doesn't allocate
+	TArray<FPendingPacket> Pending;
+
+	std::atomic<uint64> NumSent{ 0 };
+	std::atomic<uint64> NumLost{ 0 };
+};
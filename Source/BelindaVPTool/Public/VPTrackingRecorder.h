@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/CircularQueue.h"
+#include "VPTrackingJournal.h"
+
+class FRunnableThread;
+class IFileHandle;
+
+/**
+ * Writes tracking samples to a journal file from its own thread.
+ * Each subject hands its samples over through a lock free single producer / single consumer queue,
+ * so the receive thread never waits on the disk. A full queue drops the sample and counts it.
+ */
+class BELINDAVPTOOL_API FVPTrackingRecorder : public FRunnable
+{
+public:
+	using FQueue = TCircularQueue<FVPTrackingRecordEntry>;
+
+	// Power of two, about four seconds of a 1 kHz source
+	static constexpr uint32 QueueSize = 4096;
+
+	FVPTrackingRecorder() = default;
+	virtual ~FVPTrackingRecorder();
+
+	bool Open(const FString& FilePath);
+
+	// Writes everything still queued and closes the files
+	void Close();
+
+	bool IsOpen() const { return Thread != nullptr; }
+
+	const FString& GetFilePath() const { return JournalPath; }
+
+	// Game thread. The queue must only ever be fed from one thread at a time.
+	void AddSubject(FName SubjectName, TSharedPtr<FQueue> Queue);
+
+	uint64 GetNumWrittenSamples() const { return NumWrittenSamples.load(); }
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	struct FSubject
+	{
+		FName Name;
+		uint16 Index = 0;
+		bool bDeclared = false;
+		TSharedPtr<FQueue> Queue;
+		// Writer thread only, the queue a re-registered subject fed before
+		TSharedPtr<FQueue> PreviousQueue;
+	};
+
+	bool Drain(bool bFinal);
+	bool WriteSamples(const FSubject& Subject, FQueue& Queue);
+	void WritePending();
+
+	FString JournalPath;
+
+	TUniquePtr<IFileHandle> JournalFile;
+	TUniquePtr<IFileHandle> IndexFile;
+
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopRequested{ false };
+
+	FCriticalSection SubjectsLock;
+	TArray<FSubject> Subjects;
+
+	// Writer thread only
+	TArray<FSubject> WriterSubjects;
+	TArray<VPTrackingJournal::FRecord> PendingRecords;
+	double StartTime = 0.0;
+	uint64 NextSequence = 0;
+	double NextIndexTime = -DBL_MAX;
+	double LastFlushTime = 0.0;
+
+	std::atomic<uint64> NumWrittenSamples{ 0 };
+};
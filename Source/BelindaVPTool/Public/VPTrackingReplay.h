@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Misc/FrameRate.h"
+#include "VPTrackingJournal.h"
+#include "VPTrackingReplay.generated.h"
+
+class FRunnableThread;
+class FSocket;
+class FInternetAddr;
+class FVPTrackingLiveLinkSource;
+
+UENUM(BlueprintType)
+enum class EVPReplayMode : uint8
+{
+	RealTime = 0 UMETA(DisplayName = "Real time"),
+	Accelerated = 1 UMETA(DisplayName = "Accelerated"),
+	FrameStepped = 2 UMETA(DisplayName = "Frame stepped"),
+};
+
+UENUM(BlueprintType)
+enum class EVPReplayOutput : uint8
+{
+	LiveLink = 0 UMETA(DisplayName = "LiveLink frames"),
+	FreeD = 1 UMETA(DisplayName = "FreeD UDP packets"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPReplaySettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	EVPReplayMode Mode = EVPReplayMode::RealTime;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	EVPReplayOutput Output = EVPReplayOutput::LiveLink;
+
+	// Playback speed in accelerated mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay", meta = (ClampMin = "0.01"))
+	float Speed = 4.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	bool bLoop = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay|FreeD")
+	FString FreeDAddress = TEXT("127.0.0.1");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay|FreeD")
+	int32 FreeDPort = 40000;
+
+	// Focal length in mm mapped onto the full zoom encoder range
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay|FreeD")
+	FVector2D FocalLengthRange = FVector2D(10.0, 100.0);
+
+	// Focus distance in cm mapped onto the full focus encoder range
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay|FreeD")
+	FVector2D FocusDistanceRange = FVector2D(30.0, 10000.0);
+};
+
+/**
+ * Plays a tracking journal back on its own thread, either straight into LiveLink or as FreeD packets
+ * so the stock FreeD source can pick them up. Real time playback reproduces the recorded arrival jitter.
+ */
+class BELINDAVPTOOL_API FVPTrackingReplay : public FRunnable
+{
+public:
+	FVPTrackingReplay() = default;
+	virtual ~FVPTrackingReplay();
+
+	bool Start(const FString& JournalPath, const FVPReplaySettings& InSettings);
+	void Finish();
+
+	bool IsPlaying() const { return Thread != nullptr && !bFinished; }
+
+	// Frame stepped mode only, plays the samples of the next frames
+	void Step(int32 NumFrames = 1);
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	void Emit(int32 SubjectIndex, const FVPTrackingRecordEntry& Entry);
+	void SendFreeD(int32 SubjectIndex, const FVPTrackingRecordEntry& Entry);
+	bool Rewind();
+
+	FVPReplaySettings Settings;
+	FVPTrackingJournalReader Reader;
+
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopRequested{ false };
+	std::atomic<bool> bFinished{ false };
+	std::atomic<int32> PendingSteps{ 0 };
+
+	TSharedPtr<FVPTrackingLiveLinkSource> LiveLinkSource;
+
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> FreeDTarget;
+
+	// Replay thread only
+	int64 Cursor = 0;
+	double FirstArrivalTime = 0.0;
+	double FirstSampleTime = 0.0;
+	double StepTime = 0.0;
+
+	// Engine timecode rate when the replay started, for the samples recorded without timecode
+	FFrameRate FallbackFrameRate;
+
+	// Engine timeline when the replay started, recorded scene times are moved onto it
+	double TimelineAnchor = 0.0;
+	double WallAnchor = 0.0;
+
+	// Replay thread only, set by the first timecoded sample of each pass
+	TOptional<double> FirstSceneSeconds;
+	double SceneOffset = 0.0;
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "VPHistogram.h"
+#include "VPTrackingLoadGenerator.h"
+
+/**
+ * Runs the load generator against the plugin tracking path for a while and reports
+ * sample latency up to the LiveLink receive delegate and the game thread cost of evaluating
+ * the buffered subjects, next to the cost of VPFreeD::Decode on its own.
+ * Results go to the log and to a CSV in the profiling folder. Started with BelindaVP.Soak.
+ */
+class BELINDAVPTOOL_API FVPTrackingSoakBenchmark
+{
+public:
+	~FVPTrackingSoakBenchmark();
+
+	bool Start(const FVPLoadGeneratorSettings& Settings, double DurationSeconds);
+
+	// Stops early, the report is written either way
+	void Finish();
+
+	bool IsRunning() const { return TickerHandle.IsValid(); }
+
+	// Runs VPFreeD::Decode alone over NumPackets in-memory packets, returns packets per second.
+	// No socket or LiveLink source is involved, it bounds the decode cost only.
+	static double MeasureFreeDDecodeRate(int32 NumPackets = 1000000);
+
+	// Stops the run started from the console, before the engine goes away
+	static void ShutdownConsoleRun();
+
+private:
+	bool Tick(float DeltaTime);
+	void WriteReport() const;
+
+	struct FSubjectHandles
+	{
+		FName SubjectName;
+		FDelegateHandle StaticDataHandle;
+		FDelegateHandle FrameDataHandle;
+	};
+
+	FVPLoadGeneratorSettings GeneratorSettings;
+	FVPTrackingLoadGenerator Generator;
+	TArray<FSubjectHandles> Subjects;
+
+	FVPHistogram Latency;
+	// Game thread time to evaluate all the subjects once per frame
+	FVPHistogram EvaluateCost;
+	std::atomic<uint64> NumReceived{ 0 };
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	double StartTime = 0.0;
+	double Duration = 0.0;
+	double FreeDDecodeRate = 0.0;
+};
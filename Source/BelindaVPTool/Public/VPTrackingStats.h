@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "VPHistogram.h"
+
+DECLARE_STATS_GROUP(TEXT("BelindaVP"), STATGROUP_BelindaVP, STATCAT_Advanced);
+
+// One closed stats window of a subject, durations in seconds
+struct FVPTrackingStatsSnapshot
+{
+	double WindowSeconds = 0.0;
+
+	double PacketRate = 0.0;
+	uint32 Dropped = 0;
+	uint32 OutOfOrder = 0;
+
+	double ArrivalJitterP50 = 0.0;
+	double ArrivalJitterP95 = 0.0;
+	double ArrivalJitterMax = 0.0;
+
+	// How far the newest sample was ahead of the evaluation time
+	double EvaluationMarginMean = 0.0;
+	double EvaluationMarginP05 = 0.0;
+	// Frames evaluated past the newest sample (held) or before the oldest one
+	uint32 Underflows = 0;
+	uint32 Overflows = 0;
+
+	uint64 TotalReceived = 0;
+	uint64 TotalDropped = 0;
+	uint64 TotalOutOfOrder = 0;
+};
+
+/**
+ * Health counters of one tracking subject.
+ * The receive side is only written by the LiveLink source thread and the evaluation side only by the
+ * game thread, so each side accumulates without locks. The game thread closes a window every second
+ * or so and keeps a snapshot of it.
+ */
+class BELINDAVPTOOL_API FVPTrackingStats
+{
+public:
+	// Receive thread. Drops are only inferred when SampleTime comes from the sender (timecode or source clock).
+	void OnSampleReceived(double SampleTime, double ArrivalTime, bool bSourceTimed);
+
+	// Game thread, bHasRange is false when the buffer was empty
+	void OnEvaluated(double EvaluationTime, bool bHasRange, double OldestTime, double NewestTime);
+
+	// Game thread, returns true when a window was closed and the snapshot updated
+	bool Tick(double Now, double WindowSeconds);
+
+	const FVPTrackingStatsSnapshot& GetSnapshot() const { return Snapshot; }
+
+	uint64 GetNumReceived() const { return NumReceived.load(std::memory_order_relaxed); }
+	uint64 GetNumDropped() const { return NumDropped.load(std::memory_order_relaxed); }
+	uint64 GetNumOutOfOrder() const { return NumOutOfOrder.load(std::memory_order_relaxed); }
+	uint64 GetNumUnderflows() const { return TotalUnderflows; }
+	uint64 GetNumOverflows() const { return TotalOverflows; }
+
+	double GetLastEvaluationMargin() const { return LastEvaluationMargin; }
+	double GetLastEvaluationAge() const { return LastEvaluationAge; }
+
+	// Game thread. Resets the totals, the receive side restarts its interval estimate on the next sample
+	void Reset();
+
+private:
+	// Receive thread
+	double LastSampleTime = 0.0;
+	double LastArrivalTime = 0.0;
+	double SampleInterval = 0.0;
+	double ArrivalInterval = 0.0;
+	bool bLastSourceTimed = false;
+	std::atomic<bool> bRestart{ true };
+
+	std::atomic<uint64> NumReceived{ 0 };
+	std::atomic<uint64> NumDropped{ 0 };
+	std::atomic<uint64> NumOutOfOrder{ 0 };
+	FVPHistogram ArrivalJitter;
+
+	// Game thread
+	FVPHistogram EvaluationMargin;
+	uint32 WindowUnderflows = 0;
+	uint32 WindowOverflows = 0;
+	uint64 TotalUnderflows = 0;
+	uint64 TotalOverflows = 0;
+	double LastEvaluationMargin = 0.0;
+	double LastEvaluationAge = 0.0;
+
+	double WindowStart = 0.0;
+	uint64 WindowStartReceived = 0;
+	uint64 WindowStartDropped = 0;
+	uint64 WindowStartOutOfOrder = 0;
+
+	FVPTrackingStatsSnapshot Snapshot;
+};
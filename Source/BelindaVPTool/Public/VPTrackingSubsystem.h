@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "LiveLinkTypes.h"
+#include "VPTrackingTypes.h"
+#include "VPMotionFilter.h"
+#include "VPEncoderMapping.h"
+#include "VPTrackingStats.h"
+#include "VPTrackingTimedDataInput.h"
+#include "VPTrackingRecorder.h"
+#include "VPTrackingReplay.h"
+#include "VPTrackingSubsystem.generated.h"
+
+class FVPTrackingJitterBuffer;
+class ULiveLinkRole;
+
+/**
+ * Owns the per subject tracking buffers fed straight from the LiveLink receive path.
+ * Every registered subject is evaluated once per engine frame, the first time a controller asks for it.
+ */
+UCLASS()
+class BELINDAVPTOOL_API UVPTrackingSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Subjects are ref counted so several controllers can share one buffer
+	void RegisterSubject(FLiveLinkSubjectName SubjectName, const FVPJitterBufferSettings& Settings);
+	void UnregisterSubject(FLiveLinkSubjectName SubjectName);
+	void SetSubjectSettings(FLiveLinkSubjectName SubjectName, const FVPJitterBufferSettings& Settings);
+
+	// Extra latency compensation on top of the buffer depth, limited by what the buffer still holds.
+	// LeadSeconds evaluates the subject that much earlier in its own stream, to cancel a latency of its own.
+	void SetSubjectDelay(FLiveLinkSubjectName SubjectName, const FVPDelayLineSettings& DelayLine, double LeadSeconds = 0.0);
+
+	// Smoothing and prediction run on the evaluated sample, for all the subjects in one pass
+	void SetSubjectFilter(FLiveLinkSubjectName SubjectName, const FVPMotionFilterSettings& Filter);
+
+	// Raw encoder to physical FIZ, applied before the filter so its cutoffs are in mm and cm. Null leaves the values as received.
+	void SetSubjectEncoderMapping(FLiveLinkSubjectName SubjectName, const TSharedPtr<const FVPEncoderMapping>& Mapping);
+
+	// Sample of the subject evaluated at this frame's genlocked time
+	bool GetEvaluatedSample(FLiveLinkSubjectName SubjectName, FVPTrackingSample& OutSample);
+
+	// Pose of one subject with focus, iris and zoom of another, both evaluated at the same genlocked instant.
+	// Falls back to the pose subject's own lens values when the lens subject has nothing buffered, bOutHasLens is false then.
+	bool GetFusedSample(FLiveLinkSubjectName PoseSubject, FLiveLinkSubjectName LensSubject, FVPTrackingSample& OutSample, bool& bOutHasLens);
+
+	// Bumped every time the subject receives new static data
+	uint32 GetStaticDataGeneration(FLiveLinkSubjectName SubjectName) const;
+
+	// Journals every sample of the registered subjects until StopRecording is called
+	bool StartRecording(const FString& FilePath);
+	void StopRecording();
+	bool IsRecording() const { return Recorder.IsValid(); }
+
+	// Plays a journal back in place of the tracking hardware
+	bool StartReplay(const FString& JournalPath, const FVPReplaySettings& Settings);
+	void StepReplay(int32 NumFrames);
+	void StopReplay();
+	bool IsReplaying() const { return Replay.IsValid() && Replay->IsPlaying(); }
+
+	// Last closed one second window of every registered subject
+	void GetSubjectStats(TArray<TPair<FName, FVPTrackingStatsSnapshot>>& OutStats) const;
+	void ResetStats();
+
+	// Writes the subject stats as CSV, returns the file path or an empty string
+	FString ExportStatsCsv(const FString& FilePath = FString()) const;
+
+private:
+	struct FChannel
+	{
+		FLiveLinkSubjectName SubjectName;
+		// Game thread only, the receive thread reads the time source below
+		FVPJitterBufferSettings Settings;
+		std::atomic<EVPTrackingTimeSource> TimeSource{ EVPTrackingTimeSource::ArrivalTime };
+		FVPDelayLineSettings DelayLine;
+		double LeadSeconds = 0.0;
+		FVPMotionFilterSettings FilterSettings;
+		FVPMotionFilter Filter;
+		TSharedPtr<const FVPEncoderMapping> EncoderMapping;
+		TUniquePtr<FVPTrackingJitterBuffer> Buffer;
+		FVPTrackingSample Output;
+		bool bHasOutput = false;
+		int32 RefCount = 0;
+		std::atomic<uint32> StaticDataGeneration{ 0 };
+		// Set when the samples are keyed on timecode rather than arrival time
+		std::atomic<bool> bTimecodeSamples{ false };
+		// Receive thread only
+		FVPClockOffsetEstimator SourceClock;
+		// Clock the buffered samples are keyed on, the buffer never holds two
+		EVPTrackingTimeSource BufferTimeline = EVPTrackingTimeSource::ArrivalTime;
+		double LastTimedArrival = 0.0;
+		FDelegateHandle StaticDataHandle;
+		FDelegateHandle FrameDataHandle;
+
+		// Fed from the receive thread while a recording runs
+		TSharedPtr<FVPTrackingRecorder::FQueue> RecordQueue;
+		std::atomic<bool> bRecording{ false };
+		std::atomic<uint32> NumRecordDrops{ 0 };
+
+		FVPTrackingStats Stats;
+		TUniquePtr<FVPTrackingTimedDataChannel> TimedDataChannel;
+#if CSV_PROFILER
+		FName CsvStatNames[6];
+#endif
+	};
+
+	// Called when a subject closes a stats window
+	static void RecordCsvStats(const FChannel& Channel);
+
+	static void OnFrameDataReceived(const FLiveLinkFrameDataStruct& FrameData, FChannel* Channel);
+
+	void EvaluateChannels();
+
+	static double GetEvaluationTime(const FChannel& Channel);
+
+	static void ApplySettings(FChannel& Channel, const FVPJitterBufferSettings& Settings);
+
+	// Grows the buffer to hold depth plus delay at the measured packet rate
+	static void FitBufferCapacity(FChannel& Channel);
+
+	void StartRecordingChannel(FChannel& Channel);
+
+	TMap<FName, TSharedPtr<FChannel>> Channels;
+
+	TUniquePtr<FVPTrackingRecorder> Recorder;
+
+	TUniquePtr<FVPTrackingReplay> Replay;
+
+	TUniquePtr<FVPTrackingTimedDataInput> TimedDataInput;
+
+	uint64 LastEvaluatedFrame = MAX_uint64;
+};
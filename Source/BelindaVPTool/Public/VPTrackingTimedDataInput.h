@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ITimedDataInput.h"
+
+class FVPTrackingJitterBuffer;
+class FVPTrackingStats;
+
+/**
+ * One buffered tracking subject as seen by the Timed Data Monitor.
+ * Only reads the buffer and the stats, the subsystem removes it before those go away.
+ */
+class BELINDAVPTOOL_API FVPTrackingTimedDataChannel : public ITimedDataInputChannel
+{
+public:
+	FVPTrackingTimedDataChannel(FName InSubjectName, const FVPTrackingJitterBuffer& InBuffer, FVPTrackingStats& InStats, const std::atomic<bool>& bInTimecodeSamples);
+
+	//~ Begin ITimedDataInputChannel Interface
+	virtual FText GetDisplayName() const override;
+	virtual ETimedDataInputState GetState() const override;
+	virtual FTimedDataChannelSampleTime GetOldestDataTime() const override;
+	virtual FTimedDataChannelSampleTime GetNewestDataTime() const override;
+	virtual TArray<FTimedDataChannelSampleTime> GetDataTimes() const override;
+	virtual int32 GetNumberOfSamples() const override;
+	virtual int32 GetDataBufferSize() const override;
+	virtual void SetDataBufferSize(int32 BufferSize) override;
+	virtual bool IsBufferStatsEnabled() const override { return bBufferStatsEnabled; }
+	virtual void SetBufferStatsEnabled(bool bEnable) override { bBufferStatsEnabled = bEnable; }
+	virtual int32 GetBufferUnderflowStat() const override;
+	virtual int32 GetBufferOverflowStat() const override;
+	virtual int32 GetFrameDroppedStat() const override;
+	virtual void GetLastEvaluationData(FTimedDataInputEvaluationData& OutEvaluationData) const override;
+	virtual void ResetBufferStats() override;
+	//~ End ITimedDataInputChannel Interface
+
+	bool HasTimecodeSamples() const { return bTimecodeSamples.load(); }
+
+private:
+	FTimedDataChannelSampleTime MakeSampleTime(double Time) const;
+
+	FName SubjectName;
+	const FVPTrackingJitterBuffer& Buffer;
+	FVPTrackingStats& Stats;
+	const std::atomic<bool>& bTimecodeSamples;
+	bool bBufferStatsEnabled = true;
+};
+
+/**
+ * Groups the plugin tracking buffers under one input in the Timed Data Monitor.
+ * The evaluation offset is set per rig on the camera controller (buffer depth and delay line), so
+ * the input reports none and ignores the monitor's calibration.
+ */
+class BELINDAVPTOOL_API FVPTrackingTimedDataInput : public ITimedDataInput
+{
+public:
+	//~ Begin ITimedDataInput Interface
+	virtual FText GetDisplayName() const override;
+	virtual TArray<ITimedDataInputChannel*> GetChannels() const override;
+	virtual ETimedDataInputEvaluationType GetEvaluationType() const override;
+	virtual void SetEvaluationType(ETimedDataInputEvaluationType Evaluation) override {}
+	virtual double GetEvaluationOffsetInSeconds() const override { return 0.0; }
+	virtual void SetEvaluationOffsetInSeconds(double Offset) override {}
+	virtual FFrameRate GetFrameRate() const override;
+	virtual void AddChannel(ITimedDataInputChannel* Channel) override;
+	virtual void RemoveChannel(ITimedDataInputChannel* Channel) override;
+	virtual bool SupportsSubFrames() const override { return true; }
+	//~ End ITimedDataInput Interface
+
+	// Registers with the TimeManagement collection
+	void Register();
+	void Unregister();
+
+	void AddSubject(FVPTrackingTimedDataChannel* Channel);
+	void RemoveSubject(FVPTrackingTimedDataChannel* Channel);
+
+private:
+	TArray<FVPTrackingTimedDataChannel*> Channels;
+	bool bRegistered = false;
+};
@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LiveLinkTypes.h"
+#include "VPTrackingTypes.generated.h"
+
+struct FLiveLinkCameraFrameData;
+
+UENUM(BlueprintType)
+enum class EVPTrackingTimeSource : uint8
+{
+	Timecode = 0 UMETA(DisplayName = "Timecode"),
+	ArrivalTime = 1 UMETA(DisplayName = "Arrival time"),
+	// The LiveLink world time stamped by the source, moved onto the engine clock with an estimated offset
+	SourceClock = 2 UMETA(DisplayName = "Source clock"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPJitterBufferSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	bool bEnabled = true;
+
+	// Which clock the incoming samples are ordered on. Falls back to arrival time when a sample has no timecode.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	EVPTrackingTimeSource TimeSource = EVPTrackingTimeSource::Timecode;
+
+	// How many frames behind the genlocked frame time the buffer is evaluated.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.0", ClampMax = "16.0"))
+	float DepthFrames = 2.0f;
+};
+
+UENUM(BlueprintType)
+enum class EVPDelayUnit : uint8
+{
+	Frames = 0 UMETA(DisplayName = "Frames"),
+	Milliseconds = 1 UMETA(DisplayName = "Milliseconds"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPDelayLineSettings
+{
+	GENERATED_BODY()
+
+	// How long the tracking is held back to line up with the video path. Fractions of a frame are interpolated.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.0"))
+	float Delay = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	EVPDelayUnit Unit = EVPDelayUnit::Frames;
+
+	double GetDelaySeconds(const FFrameRate& FrameRate) const;
+};
+
+UENUM(BlueprintType)
+enum class EVPMotionFilterMode : uint8
+{
+	None = 0 UMETA(DisplayName = "None"),
+	OneEuro = 1 UMETA(DisplayName = "One euro"),
+	CriticallyDamped = 2 UMETA(DisplayName = "Critically damped"),
+	Predictive = 3 UMETA(DisplayName = "Constant acceleration prediction"),
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPAxisFilterParams
+{
+	GENERATED_BODY()
+
+	// One euro: cutoff in Hz when the axis is still, lower removes more shimmer
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.01"))
+	float MinCutoff = 1.0f;
+
+	// One euro: how fast the cutoff opens with speed, higher lags less on fast moves
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.0"))
+	float Beta = 0.01f;
+
+	// One euro: cutoff in Hz of the speed estimate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.01"))
+	float DerivativeCutoff = 1.0f;
+
+	// Critically damped: seconds to catch up with the input
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.001"))
+	float SmoothingTime = 0.03f;
+
+	// Prediction: 0 follows the input, towards 1 trusts the motion model more
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.0", ClampMax = "0.99"))
+	float PredictionDamping = 0.5f;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPMotionFilterSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	EVPMotionFilterMode Mode = EVPMotionFilterMode::None;
+
+	// Extrapolates the filtered motion ahead to hide some of the tracking latency
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "0.0", ClampMax = "100.0"))
+	float PredictionMs = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams X;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams Y;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams Z;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams Pan;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams Tilt;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams Roll;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams FocalLength;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking|Axes")
+	FVPAxisFilterParams FocusDistance;
+};
+
+USTRUCT(BlueprintType)
+struct BELINDAVPTOOL_API FVPLensStreamSettings
+{
+	GENERATED_BODY()
+
+	// Takes focus, iris and zoom from another subject, resampled at the same instant as the pose
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	bool bEnabled = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	FLiveLinkSubjectName Subject;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking")
+	EVPTrackingTimeSource TimeSource = EVPTrackingTimeSource::Timecode;
+
+	// How much later than the pose the lens encoder stamps the same instant
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tracking", meta = (ClampMin = "-100.0", ClampMax = "100.0"))
+	float LatencyMs = 0.0f;
+};
+
+/**
+ * Maps a source's own clock onto FPlatformTime. The lowest arrival minus source time seen is the
+ * best offset estimate (the least delayed packet), it is allowed to creep up slowly to follow drift.
+ */
+struct BELINDAVPTOOL_API FVPClockOffsetEstimator
+{
+	double ToLocalTime(double SourceTime, double ArrivalTime);
+
+	void Reset() { bHasOffset = false; }
+
+private:
+	double Offset = 0.0;
+	double LastArrivalTime = 0.0;
+	bool bHasOffset = false;
+};
+
+/**
+ * One camera tracking sample as stored in the plugin buffers. Kept as a plain struct so it can be
+ * copied around the receive threads without touching UObjects.
+ */
+struct BELINDAVPTOOL_API FVPTrackingSample
+{
+	// Seconds on the timeline selected by EVPTrackingTimeSource
+	double Time = 0.0;
+
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+
+	float FieldOfView = 0.0f;
+	float FocalLength = 0.0f;
+	float Aperture = 0.0f;
+	float FocusDistance = 0.0f;
+
+	static FVPTrackingSample Interpolate(const FVPTrackingSample& A, const FVPTrackingSample& B, double Alpha);
+
+	void ReadFrom(const FLiveLinkCameraFrameData& FrameData);
+	void WriteTo(FLiveLinkCameraFrameData& FrameData) const;
+};
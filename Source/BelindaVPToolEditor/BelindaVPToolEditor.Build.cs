@@ -57,6 +57,7 @@ public class BelindaVPToolEditor : ModuleRules
                 "UnrealEd",
                 "UMGEditor",
                 "BelindaVPTool",
+                "LiveLinkComponents",
                 "LevelEditor",
                 "MediaIOCore",
                 "MediaFrameworkUtilities",
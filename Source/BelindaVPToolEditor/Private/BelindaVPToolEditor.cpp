@@ -25,6 +25,13 @@
 #include "Widgets/Layout/SBox.h"
 #include "Widgets/Images/SImage.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "UObject/UObjectHash.h"
+#include "VPStageCueSubsystem.h"
+#include "VPMediaCaptureSubsystem.h"
+#include "VPToolsLib.h"
+#include "LiveLinkComponentController.h"
+#include "IAssetViewport.h"
+#include "Slate/SceneViewport.h"
 #include "GenlockedTimecodeProvider.h"
 #include "GenlockedCustomTimeStep.h"
 #include "LiveLinkPreset.h"
@@ -46,6 +53,41 @@ IMPLEMENT_MODULE(FBelindaVPToolEditorModule, BelindaVPToolEditor)
 
 #define LOCTEXT_NAMESPACE "FBelindaVPToolEditorModule"
 
+// Lets native listeners react to the camera manager setup without an interface call on every actor
+static void PublishSetupCameraCue(const AActor* CameraManager)
+{
+	UVPStageCueSubsystem* Cues = GEngine ? GEngine->GetEngineSubsystem<UVPStageCueSubsystem>() : nullptr;
+	if (!Cues || !IsValid(CameraManager))
+		return;
+
+	FVPStageCue Cue;
+	Cue.Topic = VPStageCueTopics::SetupCamera;
+	Cue.Name = CameraManager->GetFName();
+	Cue.Vector = CameraManager->GetActorLocation();
+	Cues->Publish(Cue);
+}
+
+// Native classes of the plugin (e.g. the software genlock) are options too, their path is the class path
+static void AddPluginNativeClasses(UClass* ClassType, TArray<TSharedPtr<FString>>& Options, TArray<FConfigAssetDatas>& AssetsDatas)
+{
+	TArray<UClass*> DerivedClasses;
+	GetDerivedClasses(ClassType, DerivedClasses);
+
+	for (UClass* Class : DerivedClasses)
+	{
+		if (!Class->HasAnyClassFlags(CLASS_Native) || Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+			continue;
+		if (Class->GetOutermost()->GetName() != TEXT("/Script/BelindaVPTool"))
+			continue;
+
+		Options.Add(MakeShared<FString>(Class->GetName()));
+		FConfigAssetDatas tempDatas;
+		tempDatas.name = Class->GetName();
+		tempDatas.path = Class->GetPathName();
+		AssetsDatas.Add(tempDatas);
+	}
+}
+
 void FBelindaVPToolEditorModule::StartupModule()
 {
 	// Register a function to be called when menu system is initialized
@@ -848,33 +890,6 @@ TSharedRef<SDockTab> FBelindaVPToolEditorModule::OnSpawnPluginTab(const FSpawnTa
 																										]
 																								]
 
-																						]
-																						+ SVerticalBox::Slot()
-																						.VAlign(EVerticalAlignment::VAlign_Center)
-																						.Padding(2)
-																						[
-																							SNew(SHorizontalBox)
-
-																								+ SHorizontalBox::Slot()
-																								[
-																									SNew(SCheckBox)
-																										.IsChecked_Raw(this, &FBelindaVPToolEditorModule::GetFirstCheckboxState)
-																										.OnCheckStateChanged_Raw(this, &FBelindaVPToolEditorModule::OnFirstCheckboxChanged)
-																										[
-																											SNew(STextBlock).Text(FText::FromString(TEXT("Method1")))
-																										]
-																								]
-																								+ SHorizontalBox::Slot()
-																								[
-																									SNew(SCheckBox)
-																										.IsChecked_Raw(this, &FBelindaVPToolEditorModule::GetSecondCheckboxState)
-																										.OnCheckStateChanged_Raw(this, &FBelindaVPToolEditorModule::OnSecondCheckboxChanged)
-																										[
-																											SNew(STextBlock).Text(FText::FromString(TEXT("Method2")))
-																										]
-																								]
-
-
 																						]
 																				]
 																		]
@@ -1013,6 +1028,13 @@ FText FBelindaVPToolEditorModule::GetNodalValue() const
 	if (!IsValid(spawnedCamMan))
 		return FText::AsNumber(0.0f);
 
+	// The tracking controller's offset is what a nodal solve writes, the rig property is the fallback
+	if (ULiveLinkComponentController* LiveLinkComponent = spawnedCamMan->FindComponentByClass<ULiveLinkComponentController>())
+	{
+		if (const UVPLiveLinkCameraController* Controller = UVPToolsLib::GetTrackingController(LiveLinkComponent))
+			return FText::AsNumber(Controller->NodalOffset.Z);
+	}
+
 	float MyFloatValue = 0.0f;
 
 	FProperty* Property = spawnedCamMan->GetClass()->FindPropertyByName(FName("ZNodalOffset"));
@@ -1107,6 +1129,9 @@ void FBelindaVPToolEditorModule::FindTCBlueprintsOfClass(UClass* ClassType)
 			}
 		}
 	}
+
+	AddPluginNativeClasses(ClassType, TCBlueprintOptions, TCAssetsDatas);
+
 	if (!TCBlueprintOptions.IsEmpty())
 		TCSelectedBlueprint = TCBlueprintOptions[0];
 }
@@ -1151,6 +1176,9 @@ void FBelindaVPToolEditorModule::FindTSBlueprintsOfClass(UClass* ClassType)
 			}
 		}
 	}
+
+	AddPluginNativeClasses(ClassType, TSBlueprintOptions, TSAssetsDatas);
+
 	if (!TSBlueprintOptions.IsEmpty())
 		TSSelectedBlueprint = TSBlueprintOptions[0];
 }
@@ -1181,7 +1209,6 @@ void FBelindaVPToolEditorModule::FindMOBlueprintsOfClass(UClass* ClassType)
 
 	//UE_LOG(LogTemp, Warning, TEXT("Total Assets Found: %d"), AssetData.Num());
 	MOAssetsDatas.Empty();
-	moFiles.Empty();
 	for (const FAssetData& Asset : AssetData)
 	{
 		// Log asset info to see what assets were found
@@ -1199,8 +1226,6 @@ void FBelindaVPToolEditorModule::FindMOBlueprintsOfClass(UClass* ClassType)
 				UE_LOG(LogTemp, Warning, TEXT("Asset is a child of UMediaOutput"));
 				MOBlueprintOptions.Add(MakeShared<FString>(LoadedAsset->GetName()));
 
-				moFiles.Add(Cast<UMediaOutput>(LoadedAsset));
-
 				FConfigAssetDatas tempDatas;
 				tempDatas.name = Asset.AssetName.ToString();
 				tempDatas.path = Asset.GetSoftObjectPath().ToString();
@@ -1836,35 +1861,6 @@ void FBelindaVPToolEditorModule::RegisterMenuExtensions()
 	));
 }
 
-void FBelindaVPToolEditorModule::OnFirstCheckboxChanged(ECheckBoxState NewState)
-{
-	if (NewState == ECheckBoxState::Checked)
-	{
-		FirstCheckboxState = ECheckBoxState::Checked;
-		SecondCheckboxState = ECheckBoxState::Unchecked;
-		UE_LOG(LogTemp, Error, TEXT("Object not selected !"));
-	}
-	else
-	{
-		FirstCheckboxState = ECheckBoxState::Unchecked;
-		UE_LOG(LogTemp, Error, TEXT("Object  selected !"));
-
-	}
-}
-
-void FBelindaVPToolEditorModule::OnSecondCheckboxChanged(ECheckBoxState NewState)
-{
-	if (NewState == ECheckBoxState::Checked)
-	{
-		SecondCheckboxState = ECheckBoxState::Checked;
-		FirstCheckboxState = ECheckBoxState::Unchecked;
-	}
-	else
-	{
-		SecondCheckboxState = ECheckBoxState::Unchecked;
-	}
-}
-
 void FBelindaVPToolEditorModule::RunEditorUtilityWidget(FString WidgetPath)
 {
 	// Get the Editor Utility Subsystem
@@ -2034,6 +2030,7 @@ FReply FBelindaVPToolEditorModule::SpawnAndSetupRig(BtnType btnType)
 				{
 					CallFunctionByName(spawnedCam, TEXT("FixLiveLink"));
 					CallFunctionByName(spawnedCamMan, TEXT("SetupCamera"));
+					PublishSetupCameraCue(spawnedCamMan);
 					FocusAndSelect(spawnedCamMan);
 				}, 0.1f, false);
 		}
@@ -2168,22 +2165,9 @@ bool FBelindaVPToolEditorModule::CallFunctionByNameWWorld(UObject* Object, FName
 
 			FFunctionParams Params;
 			Params.WorldContext = GetCurrentWorld();
-			for (int i = 0; i < MOAssetsDatas.Num(); i++)
-			{
-				if (MOAssetsDatas[i].name == GetSelectedMOBlueprintItem().ToString())
-				{
-					Params.MediaOutputFile = moFiles[i];
-					break;
-				}
-			}
-			if (FirstCheckboxState == ECheckBoxState::Checked)
-			{
-				Params.bUseMethod1 = true;
-			}
-			else
-			{
-				Params.bUseMethod1 = false;
-			}
+			Params.MediaOutputFile = GetSelectedMediaOutput();
+			// The Blueprint functions still take the flag, Method1 was the default
+			Params.bUseMethod1 = true;
 
 			Object->ProcessEvent(Function, &Params); // Pass the parameters to ProcessEvent
 			return true;
@@ -2331,6 +2315,7 @@ void FBelindaVPToolEditorModule::SetupCam()
 		GetCurrentWorld()->GetTimerManager().SetTimer(UnusedHandle, [&]()
 			{
 				CallFunctionByName(spawnedCamMan, TEXT("SetupCamera"));
+				PublishSetupCameraCue(spawnedCamMan);
 			}, 0.1f, false);
 	}
 }
@@ -2369,6 +2354,7 @@ void FBelindaVPToolEditorModule::PlaceAtObject()
 					GetCurrentWorld()->GetTimerManager().SetTimer(UnusedHandle, [&]()
 						{
 							CallFunctionByName(spawnedCamMan, TEXT("SetupCamera"));
+							PublishSetupCameraCue(spawnedCamMan);
 						}, 0.1f, false);
 
 
@@ -2386,15 +2372,49 @@ void FBelindaVPToolEditorModule::FocusOnObject()
 		GEngine->Exec(GetCurrentWorld(), TEXT("CAMERA ALIGN"));
 }
 
+UMediaOutput* FBelindaVPToolEditorModule::GetSelectedMediaOutput() const
+{
+	// The list is rebuilt on refresh, the asset is loaded from its path rather than kept alongside
+	const FString Selected = GetSelectedMOBlueprintItem().ToString();
+	for (const FConfigAssetDatas& Datas : MOAssetsDatas)
+	{
+		if (Datas.name == Selected)
+			return Cast<UMediaOutput>(FSoftObjectPath(Datas.path).TryLoad());
+	}
+	return nullptr;
+}
+
 void FBelindaVPToolEditorModule::ApplyMediaCapture()
 {
-	//UMediaFrameworkCapturePanel::AddViewportCapture()
-	// Ensure we are using the correct path (with _C for the Blueprint Class)
-	FString BlueprintPath = TEXT("/BelindaVPTool/Blueprints/EUB_EditorFunctions.EUB_EditorFunctions_C");
-	// Load the Blueprint class
-	UClass* BlueprintClass = LoadBlueprintClassByPath(BlueprintPath);
+	UVPMediaCaptureSubsystem* Captures = GEngine ? GEngine->GetEngineSubsystem<UVPMediaCaptureSubsystem>() : nullptr;
+	if (!Captures)
+		return;
+
+	UMediaOutput* MediaOutput = GetSelectedMediaOutput();
+
+	// "None" stops the program output
+	const FName ProgramName(TEXT("Program"));
+	if (!MediaOutput)
+	{
+		Captures->StopCapture(ProgramName);
+		return;
+	}
+
+	// Outside of PIE the level editor viewport is captured
+	Captures->SetViewportResolver(FVPCaptureViewportResolver::CreateLambda([]() -> TSharedPtr<FSceneViewport>
+		{
+			FLevelEditorModule* LevelEditorModule = FModuleManager::GetModulePtr<FLevelEditorModule>("LevelEditor");
+			TSharedPtr<IAssetViewport> Viewport = LevelEditorModule ? LevelEditorModule->GetFirstActiveViewport() : nullptr;
+			return Viewport.IsValid() ? Viewport->GetSharedActiveViewport() : nullptr;
+		}));
 
-	CallFunctionByNameWWorld(BlueprintClass->GetDefaultObject(), TEXT("SetMediaCapture"));
+	FVPCaptureOutputSettings Settings;
+	Settings.Name = ProgramName;
+	Settings.MediaOutput = MediaOutput;
+	if (Captures->StartCapture(Settings) && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, FString::Printf(TEXT("Media capture started on %s"), *MediaOutput->GetName()));
+	}
 }
 
 
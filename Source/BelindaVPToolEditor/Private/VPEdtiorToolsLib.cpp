@@ -12,6 +12,12 @@
 #include "Misc/ConfigCacheIni.h"
 #include <Settings/EditorSettings.h>
 
+// Blueprint assets are referenced by their generated class, native classes by their own path
+static FString ToClassPath(const FString& Path)
+{
+	return Path.StartsWith(TEXT("/Script/")) ? Path : Path + TEXT("_C");
+}
+
 static void EnsureSectionsAreSaveable(const FString& IniPath, const TArray<FString>& DesiredSections)
 {
 	const FString SectionsToSaveSection = TEXT("SectionsToSave");
@@ -148,8 +154,8 @@ void UVPEdtiorToolsLib::ApplyProjectSettings(const FProjectSettingsDatas& UserDa
 	GConfig->SetString(SectionLL, TEXT("DefaultLiveLinkPreset"), *UserDatas.LLPath, *GameIniPath);
 
 	const TCHAR* SectionEngine = TEXT("/Script/Engine.Engine");
-	GConfig->SetString(SectionEngine, TEXT("CustomTimeStepClassName"), *(UserDatas.tsPath + TEXT("_C")), *EngineIniPath);
-	GConfig->SetString(SectionEngine, TEXT("TimecodeProviderClassName"), *(UserDatas.tcPath + TEXT("_C")), *EngineIniPath);
+	GConfig->SetString(SectionEngine, TEXT("CustomTimeStepClassName"), *ToClassPath(UserDatas.tsPath), *EngineIniPath);
+	GConfig->SetString(SectionEngine, TEXT("TimecodeProviderClassName"), *ToClassPath(UserDatas.tcPath), *EngineIniPath);
 	GConfig->SetBool(SectionEngine, TEXT("bGenerateDefaultTimecode"), UserDatas.genTC, *EngineIniPath);
 
 	if (UserDatas.genTC)
@@ -177,6 +177,8 @@ public:
 
 	void ApplyMediaCapture();
 
+	UMediaOutput* GetSelectedMediaOutput() const;
+
 	void SpawnCompCam();
 
 	void SpawnNDCam();
@@ -236,21 +238,6 @@ private :
 
 	FText pilotCamBtnTxt;
 
-	TArray<UMediaOutput*> moFiles;
-
 	TSharedPtr<SDockTab> BelindaVPToolkitTab;
 	TSharedPtr<SEditableTextBox> NumericTextBox;
-	public:
-
-		// Functions to handle checkbox state change
-		void OnFirstCheckboxChanged(ECheckBoxState NewState);
-		void OnSecondCheckboxChanged(ECheckBoxState NewState);
-
-		// Variables to store the state of checkboxes
-		ECheckBoxState FirstCheckboxState = ECheckBoxState::Checked;
-		ECheckBoxState SecondCheckboxState = ECheckBoxState::Unchecked;
-
-		// Getters for checkbox states
-		ECheckBoxState GetFirstCheckboxState() const { return FirstCheckboxState; }
-		ECheckBoxState GetSecondCheckboxState() const { return SecondCheckboxState; }
 };